@@ -0,0 +1,434 @@
+#include "ESPNowBenchmark.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+    const uint32_t REPORT_RETRY_MS = 100;
+    const uint8_t FILLER = 0x5A;  // Nonzero, so the wire format can't trim the payload
+
+    void putU32(uint8_t* out, uint32_t value) {
+        out[0] = value & 0xFF;
+        out[1] = (value >> 8) & 0xFF;
+        out[2] = (value >> 16) & 0xFF;
+        out[3] = (value >> 24) & 0xFF;
+    }
+
+    uint64_t platformClockNs() {
+        return Platform::nowUs() * 1000;
+    }
+
+    uint32_t getU32(const uint8_t* in) {
+        return static_cast<uint32_t>(in[0]) |
+               (static_cast<uint32_t>(in[1]) << 8) |
+               (static_cast<uint32_t>(in[2]) << 16) |
+               (static_cast<uint32_t>(in[3]) << 24);
+    }
+}
+
+// Payload layout, all kinds:
+//   [0] kind  [1] token  [2] flags  [3] payload size
+//   [4..7]  data: counter         echo: counter      report: messages received
+//   [8..11] data: sender micros() echo: echoed time  report: payload bytes received
+//   [12..]  data: filler          echo: messages received so far
+
+ESPNowBenchmark::Config ESPNowBenchmark::defaultConfig() {
+    static const uint8_t SIZES[] = {12, 24, 32};
+    static const uint16_t RATES[] = {50, 100, 250, 500, 1000};
+
+    Config config = {};
+    config.payload_count = sizeof(SIZES) / sizeof(SIZES[0]);
+    for (uint8_t i = 0; i < config.payload_count; i++) {
+        config.payload_sizes[i] = SIZES[i];
+    }
+    config.rate_count = sizeof(RATES) / sizeof(RATES[0]);
+    for (uint8_t i = 0; i < config.rate_count; i++) {
+        config.rates_hz[i] = RATES[i];
+    }
+    config.step_ms = ESPNowGlobalConfig::BENCHMARK_STEP_MS;
+    config.drain_ms = ESPNowGlobalConfig::BENCHMARK_DRAIN_MS;
+    config.echo_every = ESPNowGlobalConfig::BENCHMARK_ECHO_EVERY;
+    config.crypto_iterations = ESPNowGlobalConfig::BENCHMARK_CRYPTO_ITERATIONS;
+#ifdef ARDUINO
+    config.source = "radio";
+#else
+    config.source = "sim";
+#endif
+    return config;
+}
+
+ESPNowBenchmark::ESPNowBenchmark(ESPNowManager& manager)
+    : manager(manager)
+    , config(defaultConfig())
+    , phase(Phase::IDLE)
+    , step(0)
+    , step_count(0)
+    , token(0)
+    , counter(0)
+    , step_start_us(0)
+    , drain_start_ms(0)
+    , last_request_ms(0)
+    , frames_at_start(0)
+    , cpu_us(0)
+    , crypto_us_at_start(0)
+    , crypto_frames_at_start(0)
+    , echo_received(0)
+    , current()
+    , result_count(0)
+    , rx_token(0)
+    , rx_prev_token(0)
+    , rx_count(0)
+    , rx_bytes(0)
+    , replies_sent(0)
+{
+    manager.getDispatchTable().on<ESPNowBenchmark, &ESPNowBenchmark::onMessage>(ESPNowConfig::MSG_BENCHMARK, this);
+}
+
+ESPNowBenchmark::~ESPNowBenchmark() {
+    manager.getDispatchTable().clearOwner(this);
+}
+
+hal_status_t ESPNowBenchmark::start(const Config& bench_config) {
+    if (isRunning()) {
+        return HAL_BUSY;
+    }
+    if (!manager.isPaired()) {
+        LOG_WARNING("ESPNow", "Benchmark needs a paired link");
+        return HAL_NOT_INITIALIZED;
+    }
+    if (bench_config.payload_count == 0 || bench_config.payload_count > MAX_SWEEP_VALUES ||
+        bench_config.rate_count == 0 || bench_config.rate_count > MAX_SWEEP_VALUES ||
+        bench_config.step_ms == 0) {
+        return HAL_INVALID_PARAM;
+    }
+    for (uint8_t i = 0; i < bench_config.payload_count; i++) {
+        if (bench_config.payload_sizes[i] < MIN_PAYLOAD || bench_config.payload_sizes[i] > MAX_PAYLOAD) {
+            return HAL_INVALID_PARAM;
+        }
+    }
+    for (uint8_t i = 0; i < bench_config.rate_count; i++) {
+        if (bench_config.rates_hz[i] == 0) {
+            return HAL_INVALID_PARAM;
+        }
+    }
+
+    config = bench_config;
+    if (!config.source) {
+        config.source = defaultConfig().source;
+    }
+    step = 0;
+    step_count = config.payload_count * config.rate_count;
+    result_count = 0;
+
+    LOG_INFO("ESPNow", "Benchmark started: %u steps of %u ms", step_count, config.step_ms);
+    if (manager.isEncryptionEnabled() && config.crypto_iterations > 0) {
+        printCryptoCost(config.source, config.crypto_iterations);
+    }
+    printCsvHeader();
+    beginStep();
+    return HAL_OK;
+}
+
+void ESPNowBenchmark::stop() {
+    if (!isRunning()) {
+        return;
+    }
+    phase = Phase::IDLE;
+    LOG_INFO("ESPNow", "Benchmark stopped after %u of %u steps", result_count, step_count);
+}
+
+void ESPNowBenchmark::update() {
+    if (phase == Phase::IDLE) {
+        return;
+    }
+    if (!manager.isPaired()) {
+        LOG_WARNING("ESPNow", "Benchmark aborted, link lost in step %u", step);
+        phase = Phase::IDLE;
+        return;
+    }
+
+    if (phase == Phase::SENDING) {
+        uint64_t elapsed_us = Platform::nowUs() - step_start_us;
+        if (elapsed_us >= static_cast<uint64_t>(config.step_ms) * 1000) {
+            current.duration_ms = static_cast<uint32_t>(elapsed_us / 1000);
+            phase = Phase::DRAINING;
+            drain_start_ms = millis();
+            requestReport();
+            return;
+        }
+        sendDue();
+        return;
+    }
+
+    // DRAINING: the report ends the step early
+    uint32_t now_ms = millis();
+    if (current.report_received || now_ms - drain_start_ms >= config.drain_ms) {
+        finishStep();
+    } else if (now_ms - last_request_ms >= REPORT_RETRY_MS) {
+        requestReport();
+    }
+}
+
+void ESPNowBenchmark::beginStep() {
+    current = Result();
+    current.step = step;
+    current.payload_size = config.payload_sizes[step / config.rate_count];
+    current.rate_hz = config.rates_hz[step % config.rate_count];
+
+    if (++token == 0) token = 1;
+    counter = 0;
+    cpu_us = 0;
+    echo_received = 0;
+    rtt.reset();
+    ESPNowManager::Stats stats = manager.getStats();
+    frames_at_start = stats.frames_sent;
+    crypto_us_at_start = stats.crypto_us;
+    crypto_frames_at_start = stats.frames_sealed + stats.frames_opened;
+    step_start_us = Platform::nowUs();
+    phase = Phase::SENDING;
+}
+
+void ESPNowBenchmark::sendDue() {
+    uint64_t elapsed_us = Platform::nowUs() - step_start_us;
+    uint32_t due = static_cast<uint32_t>(elapsed_us * current.rate_hz / 1000000) + 1;
+
+    // Behind schedule after a slow tick: catch up a little, drop the rest
+    if (due > current.sent + current.send_failed + ESPNowGlobalConfig::BENCHMARK_MAX_BURST) {
+        uint32_t skipped = due - (current.sent + current.send_failed) - ESPNowGlobalConfig::BENCHMARK_MAX_BURST;
+        current.send_failed += skipped;
+        counter += skipped;
+    }
+
+    ESPNowMessage msg;
+    msg.type = ESPNowConfig::MSG_BENCHMARK;
+    msg.data[0] = KIND_DATA;
+    msg.data[1] = token;
+    msg.data[3] = current.payload_size;
+    memset(msg.data + HEADER_SIZE, FILLER, current.payload_size - HEADER_SIZE);
+
+    bool sent_any = false;
+    while (current.sent + current.send_failed < due) {
+        counter++;
+        bool echo = config.echo_every && (counter % config.echo_every) == 0;
+        msg.data[2] = echo ? FLAG_ECHO : 0;
+        putU32(msg.data + 4, counter);
+
+        uint32_t start_us = micros();
+        putU32(msg.data + 8, start_us);
+        if (manager.sendMessage(msg) == HAL_OK) {
+            current.sent++;
+        } else {
+            current.send_failed++;
+        }
+        cpu_us += micros() - start_us;
+        sent_any = true;
+    }
+
+    if (sent_any) {
+        uint32_t start_us = micros();
+        manager.flush();
+        cpu_us += micros() - start_us;
+    }
+}
+
+void ESPNowBenchmark::finishStep() {
+    Result& result = current;
+    if (!result.report_received) {
+        result.received = echo_received;  // Lower bound: counted at the last echo
+    }
+    if (result.received > result.sent) {
+        result.received = result.sent;
+    }
+    uint32_t attempted = result.sent + result.send_failed;
+    result.loss_pct = attempted ? 100.0f * (attempted - result.received) / attempted : 0.0f;
+    result.goodput_kbps = result.duration_ms
+        ? static_cast<float>(result.received) * result.payload_size * 8 / result.duration_ms
+        : 0.0f;
+    rtt.summarize(result.rtt);
+    result.cpu_us_per_msg = attempted ? cpu_us / attempted : 0;
+    ESPNowManager::Stats stats = manager.getStats();
+    result.frames_sent = stats.frames_sent - frames_at_start;
+    uint32_t crypto_frames = stats.frames_sealed + stats.frames_opened - crypto_frames_at_start;
+    result.crypto_us_per_frame = crypto_frames
+        ? static_cast<float>(stats.crypto_us - crypto_us_at_start) / crypto_frames
+        : 0.0f;
+
+    if (result_count < MAX_STEPS) {
+        results[result_count++] = result;
+    }
+    printCsvRow(config.source, result);
+
+    step++;
+    if (step < step_count) {
+        beginStep();
+    } else {
+        phase = Phase::IDLE;
+        LOG_INFO("ESPNow", "Benchmark finished, %u steps", result_count);
+    }
+}
+
+void ESPNowBenchmark::requestReport() {
+    ESPNowMessage msg;
+    msg.type = ESPNowConfig::MSG_BENCHMARK;
+    msg.data[0] = KIND_REPORT_REQUEST;
+    msg.data[1] = token;
+    manager.sendMessage(msg);
+    manager.flush();
+    last_request_ms = millis();
+}
+
+void ESPNowBenchmark::send(const ESPNowMessage& msg, ESPNowManager::PeerId peer) {
+    if (peer == manager.getPrimaryPeer()) {
+        manager.sendMessage(msg);
+    } else {
+        manager.sendMessageTo(peer, msg);
+    }
+    replies_sent++;
+}
+
+void ESPNowBenchmark::onMessage(const ESPNowMessage& msg, ESPNowManager::PeerId peer) {
+    switch (msg.data[0]) {
+        case KIND_DATA:
+            onData(msg, peer);
+            break;
+        case KIND_ECHO:
+            onEcho(msg);
+            break;
+        case KIND_REPORT_REQUEST: {
+            ESPNowMessage reply;
+            reply.type = ESPNowConfig::MSG_BENCHMARK;
+            reply.data[0] = KIND_REPORT;
+            reply.data[1] = msg.data[1];
+            bool known = msg.data[1] == rx_token;
+            putU32(reply.data + 4, known ? rx_count : 0);
+            putU32(reply.data + 8, known ? rx_bytes : 0);
+            send(reply, peer);
+            break;
+        }
+        case KIND_REPORT:
+            onReport(msg);
+            break;
+        default:
+            break;
+    }
+}
+
+void ESPNowBenchmark::onData(const ESPNowMessage& msg, ESPNowManager::PeerId peer) {
+    uint8_t msg_token = msg.data[1];
+    if (msg_token == 0 || msg_token == rx_prev_token) {
+        return;
+    }
+    if (msg_token != rx_token) {
+        rx_prev_token = rx_token;
+        rx_token = msg_token;
+        rx_count = 0;
+        rx_bytes = 0;
+    }
+    rx_count++;
+    rx_bytes += msg.data[3];
+
+    if (msg.data[2] & FLAG_ECHO) {
+        ESPNowMessage reply;
+        reply.type = ESPNowConfig::MSG_BENCHMARK;
+        reply.data[0] = KIND_ECHO;
+        reply.data[1] = msg_token;
+        memcpy(reply.data + 4, msg.data + 4, 8);  // Counter and sender time, unchanged
+        putU32(reply.data + 12, rx_count);
+        send(reply, peer);
+    }
+}
+
+void ESPNowBenchmark::onEcho(const ESPNowMessage& msg) {
+    if (phase == Phase::IDLE || msg.data[1] != token) {
+        return;
+    }
+    rtt.record(micros() - getU32(msg.data + 8));
+    uint32_t peer_count = getU32(msg.data + 12);
+    if (peer_count > echo_received) {
+        echo_received = peer_count;
+    }
+}
+
+void ESPNowBenchmark::onReport(const ESPNowMessage& msg) {
+    if (phase != Phase::DRAINING || msg.data[1] != token) {
+        return;
+    }
+    current.received = getU32(msg.data + 4);
+    current.report_received = true;
+}
+
+void ESPNowBenchmark::printCsvHeader() {
+    Logger::logRaw("source,step,payload_bytes,rate_hz,duration_ms,sent,send_failed,received,"
+                   "loss_pct,goodput_kbps,rtt_samples,rtt_p50_us,rtt_p95_us,rtt_p99_us,"
+                   "rtt_max_us,cpu_us_per_msg,frames_sent,report,crypto_us_per_frame");
+}
+
+void ESPNowBenchmark::printCsvRow(const char* source, const Result& result) {
+    char line[208];
+    snprintf(line, sizeof(line), "%s,%u,%u,%u,%lu,%lu,%lu,%lu,%.2f,%.2f,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%u,%.2f",
+             source, result.step, result.payload_size, result.rate_hz,
+             static_cast<unsigned long>(result.duration_ms),
+             static_cast<unsigned long>(result.sent),
+             static_cast<unsigned long>(result.send_failed),
+             static_cast<unsigned long>(result.received),
+             result.loss_pct, result.goodput_kbps,
+             static_cast<unsigned long>(result.rtt.count),
+             static_cast<unsigned long>(result.rtt.p50_us),
+             static_cast<unsigned long>(result.rtt.p95_us),
+             static_cast<unsigned long>(result.rtt.p99_us),
+             static_cast<unsigned long>(result.rtt.max_us),
+             static_cast<unsigned long>(result.cpu_us_per_msg),
+             static_cast<unsigned long>(result.frames_sent),
+             result.report_received ? 1 : 0,
+             result.crypto_us_per_frame);
+    Logger::logRaw(line);
+}
+
+void ESPNowBenchmark::printCryptoCost(const char* source, uint16_t iterations, ClockNs clock_ns) {
+    static const uint8_t KEY[ESPNowSession::KEY_SIZE] = {1, 2, 3, 4, 5, 6, 7, 8};
+    static const uint8_t NONCES[2 * ESPNowSession::NONCE_SIZE] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+    static const uint16_t FRAME_SIZES[] = {16, 32, 64, 128, ESPNowWire::MAX_FRAME_SIZE - ESPNowSession::OVERHEAD};
+
+    if (!clock_ns) {
+        clock_ns = &platformClockNs;
+    }
+    if (iterations == 0) {
+        return;
+    }
+
+    ESPNowSession session;
+    session.setPairingKey(KEY);
+    session.setMasterKey(KEY);
+    session.installTrafficKey(NONCES, NONCES + ESPNowSession::NONCE_SIZE);
+
+    uint8_t frame[ESPNowWire::MAX_FRAME_SIZE];
+    uint8_t sealed[ESPNowWire::MAX_FRAME_SIZE];
+    uint8_t opened[ESPNowWire::MAX_FRAME_SIZE];
+    memset(frame, FILLER, sizeof(frame));
+    frame[0] = ESPNowWire::FRAME_MAGIC;
+    frame[1] = ESPNowWire::WIRE_VERSION << 4;
+    frame[2] = ESPNowConfig::ROLE_HANDHELD;
+
+    Logger::logRaw("source,frame_bytes,sealed_bytes,seal_us,open_us");
+    for (uint16_t frame_size : FRAME_SIZES) {
+        size_t sealed_len = 0;
+        uint64_t start_ns = clock_ns();
+        for (uint16_t i = 0; i < iterations; i++) {
+            sealed_len = session.seal(frame, frame_size, sealed, sizeof(sealed));
+        }
+        uint64_t seal_ns = clock_ns() - start_ns;
+
+        // Only the first open is delivered, the rest are rejected as replays
+        // after the same authentication and decryption
+        start_ns = clock_ns();
+        for (uint16_t i = 0; i < iterations; i++) {
+            session.open(sealed, sealed_len, frame[2], opened, sizeof(opened), 0);
+        }
+        uint64_t open_ns = clock_ns() - start_ns;
+
+        char line[96];
+        snprintf(line, sizeof(line), "%s,%u,%u,%.2f,%.2f", source, frame_size,
+                 static_cast<unsigned>(sealed_len),
+                 seal_ns / 1000.0f / iterations, open_ns / 1000.0f / iterations);
+        Logger::logRaw(line);
+    }
+}
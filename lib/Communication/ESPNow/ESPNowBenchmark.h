@@ -0,0 +1,147 @@
+#ifndef ESPNOW_BENCHMARK_H
+#define ESPNOW_BENCHMARK_H
+
+#include "../../Core/Platform.h"
+#include "../../Core/LatencyHistogram.h"
+#include "../../Config/espnow_config.h"
+#include "../../HAL/Core/hal_types.h"
+#include "ESPNowManager.h"
+
+// Link throughput and latency sweep over a paired ESPNowManager.
+//
+// Both ends create one; it binds MSG_BENCHMARK in the manager's dispatch
+// table and answers the peer's traffic on its own. The end that calls
+// start() runs every payload size at every rate for step_ms, then asks the
+// peer how much arrived. Every echo_every-th message asks for an echo,
+// which gives the round trip. One CSV row per step goes to serial:
+//
+//   source,step,payload_bytes,rate_hz,duration_ms,sent,send_failed,received,
+//   loss_pct,goodput_kbps,rtt_samples,rtt_p50_us,rtt_p95_us,rtt_p99_us,
+//   rtt_max_us,cpu_us_per_msg,frames_sent,report,crypto_us_per_frame
+//
+// Goodput counts the payload bytes the peer received. CPU time is what
+// sendMessage() and flush() took on this end, per message. With a link task
+// running, that only covers queueing the request. crypto_us_per_frame is the
+// session's seal and open time per frame on this end, 0 when unencrypted.
+//
+// With encryption on, start() first prints printCryptoCost()'s table:
+//
+//   source,frame_bytes,sealed_bytes,seal_us,open_us
+class ESPNowBenchmark {
+public:
+    static constexpr uint8_t MAX_SWEEP_VALUES = 8;
+    static constexpr uint8_t MAX_STEPS = MAX_SWEEP_VALUES * MAX_SWEEP_VALUES;
+    static constexpr uint8_t HEADER_SIZE = 12;  // kind, token, flags, size, counter, tx time
+    static constexpr uint8_t MIN_PAYLOAD = HEADER_SIZE;
+    static constexpr uint8_t MAX_PAYLOAD = sizeof(ESPNowMessage::data);
+
+    struct Config {
+        uint8_t payload_sizes[MAX_SWEEP_VALUES];  // Bytes, MIN_PAYLOAD..MAX_PAYLOAD
+        uint8_t payload_count;
+        uint16_t rates_hz[MAX_SWEEP_VALUES];
+        uint8_t rate_count;
+        uint32_t step_ms;
+        uint32_t drain_ms;          // Wait for the peer's report after each step
+        uint8_t echo_every;         // 0 = no RTT samples
+        const char* source;         // First CSV column, e.g. "radio" or "sim"
+        uint16_t crypto_iterations; // Per frame size in the crypto cost table, 0 = none
+    };
+
+    struct Result {
+        uint8_t step;
+        uint8_t payload_size;
+        uint16_t rate_hz;
+        uint32_t duration_ms;
+        uint32_t sent;
+        uint32_t send_failed;
+        uint32_t received;          // From the peer's report, or its last echo
+        float loss_pct;
+        float goodput_kbps;
+        LatencyHistogram::Summary rtt;
+        uint32_t cpu_us_per_msg;
+        uint32_t frames_sent;       // Radio frames; fewer than sent when coalesced
+        bool report_received;
+        float crypto_us_per_frame;
+    };
+
+    static Config defaultConfig();
+
+    explicit ESPNowBenchmark(ESPNowManager& manager);
+    ~ESPNowBenchmark();
+
+    hal_status_t start(const Config& config);
+    hal_status_t start() { return start(defaultConfig()); }
+    void stop();
+    void update();  // Call every tick from the app task
+
+    bool isRunning() const { return phase != Phase::IDLE; }
+    uint8_t getStepCount() const { return step_count; }
+    uint8_t getCurrentStep() const { return step; }
+    uint8_t getResultCount() const { return result_count; }
+    const Result& getResult(uint8_t index) const { return results[index]; }
+    uint32_t getRepliesSent() const { return replies_sent; }  // As the responding end
+
+    static void printCsvHeader();
+    static void printCsvRow(const char* source, const Result& result);
+
+    // Seal and open cost of a session for a range of frame sizes, averaged
+    // over iterations. clock_ns defaults to Platform::nowUs(); the host
+    // passes a real clock, as simulated time stands still during a call.
+    typedef uint64_t (*ClockNs)();
+    static void printCryptoCost(const char* source, uint16_t iterations, ClockNs clock_ns = nullptr);
+
+private:
+    enum class Phase : uint8_t {
+        IDLE,
+        SENDING,
+        DRAINING
+    };
+
+    enum Kind : uint8_t {
+        KIND_DATA = 1,
+        KIND_ECHO = 2,
+        KIND_REPORT_REQUEST = 3,
+        KIND_REPORT = 4
+    };
+
+    static constexpr uint8_t FLAG_ECHO = 0x01;
+
+    ESPNowManager& manager;
+    Config config;
+    Phase phase;
+    uint8_t step;
+    uint8_t step_count;
+    uint8_t token;                  // Tags this step's traffic, never 0
+    uint32_t counter;
+    uint64_t step_start_us;
+    uint32_t drain_start_ms;
+    uint32_t last_request_ms;
+    uint32_t frames_at_start;
+    uint32_t cpu_us;
+    uint32_t crypto_us_at_start;
+    uint32_t crypto_frames_at_start;
+    uint32_t echo_received;         // Peer's count carried by the last echo
+    Result current;
+    LatencyHistogram rtt;
+    Result results[MAX_STEPS];
+    uint8_t result_count;
+
+    // Responding end, per token
+    uint8_t rx_token;
+    uint8_t rx_prev_token;          // Late frames from the last step are ignored
+    uint32_t rx_count;
+    uint32_t rx_bytes;
+    uint32_t replies_sent;
+
+    void beginStep();
+    void sendDue();
+    void finishStep();
+    void requestReport();
+    void send(const ESPNowMessage& msg, ESPNowManager::PeerId peer);
+    void onMessage(const ESPNowMessage& msg, ESPNowManager::PeerId peer);
+    void onData(const ESPNowMessage& msg, ESPNowManager::PeerId peer);
+    void onEcho(const ESPNowMessage& msg);
+    void onReport(const ESPNowMessage& msg);
+};
+
+#endif
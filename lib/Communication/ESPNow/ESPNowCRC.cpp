@@ -0,0 +1,94 @@
+#include "ESPNowCRC.h"
+
+#ifdef ESPNOW_CRC_HAS_ROM
+    #include <esp_rom_crc.h>
+#endif
+
+namespace {
+    struct CRCTables {
+        uint16_t t[4][256];
+    };
+
+    constexpr CRCTables makeTables() {
+        CRCTables tables = {};
+        for (uint16_t i = 0; i < 256; i++) {
+            uint16_t crc = static_cast<uint16_t>(i << 8);
+            for (int j = 0; j < 8; j++) {
+                crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ ESPNowCRC::POLYNOMIAL)
+                                     : static_cast<uint16_t>(crc << 1);
+            }
+            tables.t[0][i] = crc;
+        }
+        // t[k][i] is the CRC of byte i followed by k zero bytes
+        for (int k = 1; k < 4; k++) {
+            for (uint16_t i = 0; i < 256; i++) {
+                uint16_t prev = tables.t[k - 1][i];
+                tables.t[k][i] = static_cast<uint16_t>((prev << 8) ^ tables.t[0][prev >> 8]);
+            }
+        }
+        return tables;
+    }
+
+    // Generated at compile time; const data lives in flash (.rodata)
+    constexpr CRCTables CRC_TABLES = makeTables();
+}
+
+namespace ESPNowCRC {
+
+uint16_t crc16Bitwise(const uint8_t* data, size_t len, uint16_t crc) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int j = 0; j < 8; j++) {
+            if (crc & 0x8000) {
+                crc = (crc << 1) ^ POLYNOMIAL;
+            } else {
+                crc <<= 1;
+            }
+        }
+    }
+    return crc;
+}
+
+uint16_t crc16Table(const uint8_t* data, size_t len, uint16_t crc) {
+    const uint16_t* table = CRC_TABLES.t[0];
+    for (size_t i = 0; i < len; i++) {
+        crc = static_cast<uint16_t>((crc << 8) ^ table[(crc >> 8) ^ data[i]]);
+    }
+    return crc;
+}
+
+uint16_t crc16Slice4(const uint8_t* data, size_t len, uint16_t crc) {
+    const uint16_t (*t)[256] = CRC_TABLES.t;
+
+    while (len >= 4) {
+        // The 16-bit CRC only overlaps the first two bytes of each block
+        uint8_t b0 = static_cast<uint8_t>(data[0] ^ (crc >> 8));
+        uint8_t b1 = static_cast<uint8_t>(data[1] ^ (crc & 0xFF));
+        crc = t[3][b0] ^ t[2][b1] ^ t[1][data[2]] ^ t[0][data[3]];
+        data += 4;
+        len -= 4;
+    }
+
+    return crc16Table(data, len, crc);
+}
+
+#ifdef ESPNOW_CRC_HAS_ROM
+uint16_t crc16Rom(const uint8_t* data, size_t len, uint16_t crc) {
+    // The ROM routine inverts its seed and result
+    return static_cast<uint16_t>(~esp_rom_crc16_be(static_cast<uint16_t>(~crc), data, len));
+}
+#endif
+
+const char* backendName() {
+#if ESPNOW_CRC_BACKEND == ESPNOW_CRC_BACKEND_BITWISE
+    return "bitwise";
+#elif ESPNOW_CRC_BACKEND == ESPNOW_CRC_BACKEND_TABLE
+    return "table";
+#elif ESPNOW_CRC_BACKEND == ESPNOW_CRC_BACKEND_SLICE4
+    return "slice4";
+#else
+    return "rom";
+#endif
+}
+
+}
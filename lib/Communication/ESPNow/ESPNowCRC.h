@@ -0,0 +1,71 @@
+#ifndef ESPNOW_CRC_H
+#define ESPNOW_CRC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF, no reflection, no xorout)
+// used to validate ESP-NOW frames.
+//
+// Several interchangeable backends are provided; all of them are bit-exact
+// with the original bit-at-a-time loop. The backend used by crc16() is chosen
+// at compile time with ESPNOW_CRC_BACKEND (one of the values below). When it
+// is not set, the ESP32 ROM routine is used on target and slice-by-4 on host.
+#define ESPNOW_CRC_BACKEND_BITWISE  0
+#define ESPNOW_CRC_BACKEND_TABLE    1
+#define ESPNOW_CRC_BACKEND_SLICE4   2
+#define ESPNOW_CRC_BACKEND_ROM      3
+
+#if defined(ESP_PLATFORM) && defined(__has_include)
+    #if __has_include(<esp_rom_crc.h>)
+        #define ESPNOW_CRC_HAS_ROM 1
+    #endif
+#endif
+
+#ifndef ESPNOW_CRC_BACKEND
+    #ifdef ESPNOW_CRC_HAS_ROM
+        #define ESPNOW_CRC_BACKEND ESPNOW_CRC_BACKEND_ROM
+    #else
+        #define ESPNOW_CRC_BACKEND ESPNOW_CRC_BACKEND_SLICE4
+    #endif
+#endif
+
+#if (ESPNOW_CRC_BACKEND == ESPNOW_CRC_BACKEND_ROM) && !defined(ESPNOW_CRC_HAS_ROM)
+    #error "ESPNOW_CRC_BACKEND_ROM requested but esp_rom_crc.h is not available"
+#endif
+
+namespace ESPNowCRC {
+    static constexpr uint16_t INITIAL_VALUE = 0xFFFF;
+    static constexpr uint16_t POLYNOMIAL = 0x1021;
+
+    // Reference implementation, one bit per iteration
+    uint16_t crc16Bitwise(const uint8_t* data, size_t len, uint16_t crc = INITIAL_VALUE);
+
+    // One 256-entry lookup per byte (512 bytes of const table, flash resident)
+    uint16_t crc16Table(const uint8_t* data, size_t len, uint16_t crc = INITIAL_VALUE);
+
+    // Four bytes per iteration using four 256-entry tables (2 KB)
+    uint16_t crc16Slice4(const uint8_t* data, size_t len, uint16_t crc = INITIAL_VALUE);
+
+#ifdef ESPNOW_CRC_HAS_ROM
+    // ESP32 mask ROM implementation (no table in application flash)
+    uint16_t crc16Rom(const uint8_t* data, size_t len, uint16_t crc = INITIAL_VALUE);
+#endif
+
+    // Selected backend
+    inline uint16_t crc16(const uint8_t* data, size_t len, uint16_t crc = INITIAL_VALUE) {
+#if ESPNOW_CRC_BACKEND == ESPNOW_CRC_BACKEND_BITWISE
+        return crc16Bitwise(data, len, crc);
+#elif ESPNOW_CRC_BACKEND == ESPNOW_CRC_BACKEND_TABLE
+        return crc16Table(data, len, crc);
+#elif ESPNOW_CRC_BACKEND == ESPNOW_CRC_BACKEND_SLICE4
+        return crc16Slice4(data, len, crc);
+#else
+        return crc16Rom(data, len, crc);
+#endif
+    }
+
+    const char* backendName();
+}
+
+#endif
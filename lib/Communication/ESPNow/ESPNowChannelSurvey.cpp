@@ -0,0 +1,219 @@
+#include "ESPNowChannelSurvey.h"
+#include "../../Config/espnow_config.h"
+#include <string.h>
+
+namespace {
+    const float SMOOTHING = 0.5f;  // Weight of a new measurement
+}
+
+ESPNowChannelSurvey::Config ESPNowChannelSurvey::defaultConfig() {
+    Config config = {};
+    config.channel_mask = ESPNowGlobalConfig::CHANNEL_SURVEY_MASK;
+    config.dwell_ms = ESPNowGlobalConfig::CHANNEL_SURVEY_DWELL_MS;
+    config.degraded_loss_pct = ESPNowGlobalConfig::CHANNEL_DEGRADED_LOSS_PCT;
+    config.degraded_ms = ESPNowGlobalConfig::CHANNEL_DEGRADED_MS;
+    config.switch_margin_pct = ESPNowGlobalConfig::CHANNEL_SWITCH_MARGIN_PCT;
+    config.max_age_ms = ESPNowGlobalConfig::CHANNEL_RESULT_MAX_AGE_MS;
+    return config;
+}
+
+ESPNowChannelSurvey::ESPNowChannelSurvey(const Config& config)
+    : config(config)
+    , active(false)
+    , start_ms(0)
+    , home(MIN_CHANNEL)
+    , dwell_ms(1)
+    , slot_count(0)
+    , degraded(false)
+    , degraded_since_ms(0) {
+    reset();
+}
+
+void ESPNowChannelSurvey::reset() {
+    memset(channels, 0, sizeof(channels));
+    memset(surveyed, 0, sizeof(surveyed));
+    memset(pending, 0, sizeof(pending));
+    active = false;
+    slot_count = 0;
+    degraded = false;
+}
+
+void ESPNowChannelSurvey::begin(uint32_t start, uint8_t home_channel, uint16_t channel_mask, uint8_t dwell) {
+    memset(pending, 0, sizeof(pending));
+    start_ms = start;
+    home = home_channel;
+    dwell_ms = dwell ? dwell : 1;
+
+    uint8_t count = 0;
+    for (uint8_t channel = MIN_CHANNEL; channel <= MAX_CHANNEL; channel++) {
+        if ((channel_mask & (1u << channel)) && channel != home) {
+            surveyed[count++] = channel;
+        }
+    }
+    slot_count = 2 * count;
+    active = slot_count > 0;
+}
+
+void ESPNowChannelSurvey::cancel() {
+    active = false;
+}
+
+int16_t ESPNowChannelSurvey::slotAt(uint32_t now_ms) const {
+    if (static_cast<int32_t>(now_ms - start_ms) < 0) {
+        return -1;
+    }
+    uint32_t slot = (now_ms - start_ms) / dwell_ms;
+    return static_cast<int16_t>(slot < slot_count ? slot : slot_count);
+}
+
+uint8_t ESPNowChannelSurvey::slotChannel(uint8_t slot) const {
+    if (slot >= slot_count) {
+        return home;
+    }
+    return (slot & 1) ? home : surveyed[slot / 2];
+}
+
+void ESPNowChannelSurvey::recordSlot(uint8_t slot, const SlotSample& sample) {
+    if (!active || slot >= slot_count) {
+        return;
+    }
+    addSample(pending[slotChannel(slot) - MIN_CHANNEL], sample);
+}
+
+void ESPNowChannelSurvey::finish(bool commit, uint32_t now_ms) {
+    if (!active) {
+        return;
+    }
+    active = false;
+    if (!commit) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < MAX_CHANNEL; i++) {
+        float loss_pct;
+        if (!sampleLoss(pending[i], loss_pct)) {
+            continue;
+        }
+        int8_t rssi = pending[i].rssi_count
+            ? static_cast<int8_t>(pending[i].rssi_sum / pending[i].rssi_count)
+            : 0;
+        record(i + MIN_CHANNEL, loss_pct, rssi, now_ms);
+    }
+}
+
+void ESPNowChannelSurvey::record(uint8_t channel, float loss_pct, int8_t rssi, uint32_t now_ms) {
+    if (!isValidChannel(channel)) {
+        return;
+    }
+    ChannelStats& stats = channels[channel - MIN_CHANNEL];
+
+    // Stale results are replaced, not blended
+    if (!isFresh(stats, now_ms)) {
+        stats.loss_pct = loss_pct;
+        stats.rssi = rssi;
+        stats.samples = 0;
+    } else {
+        stats.loss_pct += (loss_pct - stats.loss_pct) * SMOOTHING;
+        if (rssi != 0) {
+            stats.rssi = stats.rssi ? static_cast<int8_t>(stats.rssi + (rssi - stats.rssi) * SMOOTHING) : rssi;
+        }
+    }
+    if (stats.samples < UINT16_MAX) {
+        stats.samples++;
+    }
+    stats.measured_ms = now_ms;
+}
+
+void ESPNowChannelSurvey::avoid(uint8_t channel, uint32_t until_ms) {
+    if (isValidChannel(channel)) {
+        channels[channel - MIN_CHANNEL].avoid_until_ms = until_ms;
+    }
+}
+
+uint8_t ESPNowChannelSurvey::pickBest(uint8_t current, uint32_t now_ms) const {
+    int8_t best = -1;
+    for (uint8_t i = 0; i < MAX_CHANNEL; i++) {
+        const ChannelStats& stats = channels[i];
+        uint8_t channel = i + MIN_CHANNEL;
+        if (channel == current || !(config.channel_mask & (1u << channel)) || !isFresh(stats, now_ms) ||
+            static_cast<int32_t>(now_ms - stats.avoid_until_ms) < 0) {
+            continue;
+        }
+        // Lowest loss; between equals, the stronger signal
+        if (best < 0 || stats.loss_pct < channels[best].loss_pct ||
+            (stats.loss_pct == channels[best].loss_pct && stats.rssi > channels[best].rssi)) {
+            best = static_cast<int8_t>(i);
+        }
+    }
+    if (best < 0) {
+        return current;
+    }
+
+    // Nothing known about the current channel counts as fully lost
+    float current_loss = 100.0f;
+    if (isValidChannel(current) && isFresh(channels[current - MIN_CHANNEL], now_ms)) {
+        current_loss = channels[current - MIN_CHANNEL].loss_pct;
+    }
+    if (channels[best].loss_pct + config.switch_margin_pct > current_loss) {
+        return current;
+    }
+    return best + MIN_CHANNEL;
+}
+
+bool ESPNowChannelSurvey::hasFreshResults(uint32_t now_ms) const {
+    for (uint8_t channel = MIN_CHANNEL; channel <= MAX_CHANNEL; channel++) {
+        if (channel != home && (config.channel_mask & (1u << channel)) &&
+            isFresh(channels[channel - MIN_CHANNEL], now_ms)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ESPNowChannelSurvey::checkDegraded(float loss_pct, uint32_t now_ms) {
+    if (loss_pct <= config.degraded_loss_pct) {
+        degraded = false;
+        return false;
+    }
+    if (!degraded) {
+        degraded = true;
+        degraded_since_ms = now_ms;
+    }
+    return now_ms - degraded_since_ms >= config.degraded_ms;
+}
+
+bool ESPNowChannelSurvey::sampleLoss(const SlotSample& sample, float& loss_pct) {
+    // The peer's probes give one direction, our unacknowledged frames the
+    // other (plus the acknowledgements' way back)
+    float total = 0.0f;
+    uint8_t parts = 0;
+    if (sample.probes_expected > 0) {
+        uint8_t received = sample.probes_received < sample.probes_expected
+            ? sample.probes_received : sample.probes_expected;
+        total += 100.0f * (sample.probes_expected - received) / sample.probes_expected;
+        parts++;
+    }
+    if (sample.tx_frames > 0) {
+        uint16_t failed = sample.tx_failed < sample.tx_frames ? sample.tx_failed : sample.tx_frames;
+        total += 100.0f * failed / sample.tx_frames;
+        parts++;
+    }
+    if (parts == 0) {
+        return false;
+    }
+    loss_pct = total / parts;
+    return true;
+}
+
+bool ESPNowChannelSurvey::isFresh(const ChannelStats& stats, uint32_t now_ms) const {
+    return stats.samples > 0 && now_ms - stats.measured_ms <= config.max_age_ms;
+}
+
+void ESPNowChannelSurvey::addSample(SlotSample& total, const SlotSample& sample) {
+    total.tx_frames += sample.tx_frames;
+    total.tx_failed += sample.tx_failed;
+    total.probes_expected += sample.probes_expected;
+    total.probes_received += sample.probes_received;
+    total.rssi_sum += sample.rssi_sum;
+    total.rssi_count += sample.rssi_count;
+}
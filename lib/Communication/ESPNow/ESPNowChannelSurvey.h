@@ -0,0 +1,112 @@
+#ifndef ESPNOW_CHANNEL_SURVEY_H
+#define ESPNOW_CHANNEL_SURVEY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Per-channel link quality and the channel decisions taken from it. No radio
+// here: ESPNowManager hops, sends the probes, feeds in what it measured and
+// carries out the decisions, so the same logic runs on the simulated medium.
+//
+// A survey is a fixed schedule of dwell_ms slots that both ends follow at
+// the same time: each surveyed channel in turn, with the home channel (the
+// one the link runs on) in between, so the link is never off it for more
+// than one slot. Each end counts the peer's probes and its own unacknowledged
+// frames per slot; finish() turns them into a loss figure per channel.
+//
+// Outside a survey the current channel keeps being measured through
+// record(). Loss above degraded_loss_pct for degraded_ms calls for a new
+// survey, and pickBest() only leaves a channel for one that is better by
+// switch_margin_pct, so two similar channels don't flap.
+class ESPNowChannelSurvey {
+public:
+    static constexpr uint8_t MIN_CHANNEL = 1;
+    static constexpr uint8_t MAX_CHANNEL = 13;
+    static constexpr uint8_t MAX_SLOTS = 2 * (MAX_CHANNEL - 1);
+
+    struct Config {
+        uint16_t channel_mask;      // Bit n = channel n
+        uint8_t dwell_ms;           // Per slot
+        float degraded_loss_pct;
+        uint32_t degraded_ms;
+        float switch_margin_pct;
+        uint32_t max_age_ms;        // Older results don't count
+    };
+
+    struct ChannelStats {
+        float loss_pct;             // Smoothed; only valid with samples > 0
+        int8_t rssi;                // Smoothed dBm of the peer's frames, 0 = not heard
+        uint16_t samples;
+        uint32_t measured_ms;
+        uint32_t avoid_until_ms;    // Skipped by pickBest() until then
+    };
+
+    // What one end saw during one slot
+    struct SlotSample {
+        uint16_t tx_frames;
+        uint16_t tx_failed;         // Not acknowledged by the peer's radio
+        uint8_t probes_expected;
+        uint8_t probes_received;
+        int32_t rssi_sum;
+        uint8_t rssi_count;
+    };
+
+    static Config defaultConfig();
+    static bool isValidChannel(uint8_t channel) { return channel >= MIN_CHANNEL && channel <= MAX_CHANNEL; }
+
+    explicit ESPNowChannelSurvey(const Config& config);
+
+    void reset();  // Forgets every measurement
+    const Config& getConfig() const { return config; }
+
+    // Survey schedule
+    void begin(uint32_t start_ms, uint8_t home_channel, uint16_t channel_mask, uint8_t dwell_ms);
+    void cancel();
+    bool isActive() const { return active; }
+    uint8_t getHomeChannel() const { return home; }
+    uint8_t getSlotCount() const { return slot_count; }
+    int16_t slotAt(uint32_t now_ms) const;  // -1 before the start, getSlotCount() once over
+    uint8_t slotChannel(uint8_t slot) const;
+    uint32_t slotStart(uint8_t slot) const { return start_ms + static_cast<uint32_t>(slot) * dwell_ms; }
+    uint8_t getDwellMs() const { return dwell_ms; }
+    void recordSlot(uint8_t slot, const SlotSample& sample);
+    // Merges the slots into the channel stats, or drops them, e.g. when the
+    // peer never took part
+    void finish(bool commit, uint32_t now_ms);
+
+    // Measurement outside a survey, e.g. of the current channel while paired
+    void record(uint8_t channel, float loss_pct, int8_t rssi, uint32_t now_ms);
+    void avoid(uint8_t channel, uint32_t until_ms);
+
+    // Best channel that beats current by the switch margin, else current
+    uint8_t pickBest(uint8_t current, uint32_t now_ms) const;
+    bool hasFreshResults(uint32_t now_ms) const;
+    // True once loss_pct stayed above the degraded threshold for degraded_ms
+    bool checkDegraded(float loss_pct, uint32_t now_ms);
+    void clearDegraded() { degraded = false; }
+
+    const ChannelStats& get(uint8_t channel) const { return channels[channel - MIN_CHANNEL]; }
+
+    // Loss in percent from a slot's counters; false if it holds nothing
+    static bool sampleLoss(const SlotSample& sample, float& loss_pct);
+
+private:
+    Config config;
+    ChannelStats channels[MAX_CHANNEL];
+
+    bool active;
+    uint32_t start_ms;
+    uint8_t home;
+    uint8_t dwell_ms;
+    uint8_t slot_count;
+    uint8_t surveyed[MAX_CHANNEL];  // Slot 2n is on surveyed[n], slot 2n + 1 on home
+    SlotSample pending[MAX_CHANNEL];
+
+    bool degraded;
+    uint32_t degraded_since_ms;
+
+    bool isFresh(const ChannelStats& stats, uint32_t now_ms) const;
+    static void addSample(SlotSample& total, const SlotSample& sample);
+};
+
+#endif
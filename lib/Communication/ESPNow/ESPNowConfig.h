@@ -1,10 +1,11 @@
 #ifndef ESPNOW_CONFIG_H
 #define ESPNOW_CONFIG_H
 
-#include <Arduino.h>
+#include "../../Core/Platform.h"
 
 namespace ESPNowConfig {
-    static constexpr uint8_t CHANNEL = 1;
+    static constexpr uint8_t CHANNEL = 1;           // Home channel: discovery, pairing and resume
+    static constexpr uint8_t PEER_CHANNEL_CURRENT = 0;  // Radio peers follow the channel the radio is on
     static constexpr uint8_t ENCRYPT = 0;
     
     static constexpr uint32_t SEARCH_INTERVAL_MS = 1000;
@@ -24,13 +25,70 @@ namespace ESPNowConfig {
         MSG_DISCONNECT = 0x06,
         MSG_SCREEN_SYNC = 0x07,
         MSG_BUTTON_DATA = 0x08,
-        MSG_INPUT_EVENT = 0x09
+        MSG_INPUT_EVENT = 0x09,
+        MSG_RC_CHANNELS = 0x0A,
+        MSG_COMMAND = 0x0B,
+        MSG_ACK = 0x0C,
+        MSG_TELEMETRY = 0x0D,
+        MSG_RESUME = 0x0E,       // Fast reconnect to a cached session, no announce
+        MSG_KEEPALIVE = 0x0F,    // Liveness only, sent when the link is otherwise idle
+        MSG_BENCHMARK = 0x10,    // ESPNowBenchmark traffic, variable length
+        MSG_CHANNEL_PLAN = 0x11, // Channel survey or move, from the base station
+        MSG_CHANNEL_PROBE = 0x12 // Sent by both ends in every survey slot
+    };
+    
+    // MSG_CHANNEL_PLAN operations
+    enum ChannelPlanOp : uint8_t {
+        CHANNEL_OP_SURVEY = 0x01,
+        CHANNEL_OP_MOVE = 0x02
+    };
+    
+    // MSG_COMMAND identifiers, always sent on the reliable lane
+    enum CommandId : uint8_t {
+        CMD_ARM = 0x01,
+        CMD_DISARM = 0x02,
+        CMD_SET_MODE = 0x03
     };
     
     enum DeviceRole : uint8_t {
         ROLE_HANDHELD = 0x10,
-        ROLE_BASE_STATION = 0x20
+        ROLE_BASE_STATION = 0x20,
+        ROLE_DRONE = 0x30
     };
+    
+    // Receive lanes, drained in this order every update()
+    enum MessagePriority : uint8_t {
+        PRIORITY_CONTROL = 0,   // Pilot input, always handled first
+        PRIORITY_LINK = 1,      // Pairing and connection management
+        PRIORITY_BULK = 2,      // Keepalive and UI sync
+        PRIORITY_COUNT = 3
+    };
+    
+    // Sent and accepted unsealed even in an encrypted session (ESPNowSession)
+    static inline bool isHandshakeMessage(uint8_t type) {
+        return type == MSG_ANNOUNCE || type == MSG_PAIR_REQUEST ||
+               type == MSG_PAIR_RESPONSE || type == MSG_RESUME;
+    }
+    
+    static inline MessagePriority getMessagePriority(uint8_t type) {
+        switch (type) {
+            case MSG_INPUT_EVENT:
+            case MSG_BUTTON_DATA:
+            case MSG_RC_CHANNELS:
+            case MSG_COMMAND:
+            case MSG_ACK:
+                return PRIORITY_CONTROL;
+            case MSG_ANNOUNCE:
+            case MSG_PAIR_REQUEST:
+            case MSG_PAIR_RESPONSE:
+            case MSG_DISCONNECT:
+            case MSG_RESUME:
+            case MSG_CHANNEL_PLAN:
+                return PRIORITY_LINK;
+            default:
+                return PRIORITY_BULK;
+        }
+    }
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,281 @@
+#include "ESPNowCrypto.h"
+#include <string.h>
+
+namespace {
+    inline uint32_t load32(const uint8_t* p) {
+        return static_cast<uint32_t>(p[0]) |
+               (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) |
+               (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    inline void store32(uint8_t* p, uint32_t v) {
+        p[0] = v & 0xFF;
+        p[1] = (v >> 8) & 0xFF;
+        p[2] = (v >> 16) & 0xFF;
+        p[3] = (v >> 24) & 0xFF;
+    }
+
+    inline void store64(uint8_t* p, uint64_t v) {
+        store32(p, static_cast<uint32_t>(v));
+        store32(p + 4, static_cast<uint32_t>(v >> 32));
+    }
+
+    inline uint32_t rotl(uint32_t v, int n) {
+        return (v << n) | (v >> (32 - n));
+    }
+
+    #define CHACHA_QR(a, b, c, d) \
+        a += b; d ^= a; d = rotl(d, 16); \
+        c += d; b ^= c; b = rotl(b, 12); \
+        a += b; d ^= a; d = rotl(d, 8); \
+        c += d; b ^= c; b = rotl(b, 7)
+
+    void initState(uint32_t* s, const uint8_t* key) {
+        s[0] = 0x61707865;  // "expand 32-byte k"
+        s[1] = 0x3320646e;
+        s[2] = 0x79622d32;
+        s[3] = 0x6b206574;
+        for (int i = 0; i < 8; i++) {
+            s[4 + i] = load32(key + 4 * i);
+        }
+    }
+
+    void doubleRounds(uint32_t* x) {
+        for (int i = 0; i < 10; i++) {
+            CHACHA_QR(x[0], x[4], x[8], x[12]);
+            CHACHA_QR(x[1], x[5], x[9], x[13]);
+            CHACHA_QR(x[2], x[6], x[10], x[14]);
+            CHACHA_QR(x[3], x[7], x[11], x[15]);
+            CHACHA_QR(x[0], x[5], x[10], x[15]);
+            CHACHA_QR(x[1], x[6], x[11], x[12]);
+            CHACHA_QR(x[2], x[7], x[8], x[13]);
+            CHACHA_QR(x[3], x[4], x[9], x[14]);
+        }
+    }
+
+    void chachaBlock(const uint32_t* state, uint8_t* out) {
+        uint32_t x[16];
+        memcpy(x, state, sizeof(x));
+        doubleRounds(x);
+        for (int i = 0; i < 16; i++) {
+            store32(out + 4 * i, x[i] + state[i]);
+        }
+    }
+
+    const uint8_t ZERO_PAD[16] = {0};
+}
+
+namespace ESPNowCrypto {
+
+void chacha20Xor(const uint8_t* key, const uint8_t* nonce, uint32_t counter,
+                 const uint8_t* in, uint8_t* out, size_t len) {
+    uint32_t state[16];
+    initState(state, key);
+    state[12] = counter;
+    state[13] = load32(nonce);
+    state[14] = load32(nonce + 4);
+    state[15] = load32(nonce + 8);
+
+    uint8_t block[64];
+    while (len > 0) {
+        chachaBlock(state, block);
+        size_t n = len < sizeof(block) ? len : sizeof(block);
+        for (size_t i = 0; i < n; i++) {
+            out[i] = in[i] ^ block[i];
+        }
+        in += n;
+        out += n;
+        len -= n;
+        state[12]++;
+    }
+    wipe(block, sizeof(block));
+    wipe(state, sizeof(state));
+}
+
+void hchacha20(const uint8_t* key, const uint8_t* input, uint8_t* out) {
+    uint32_t x[16];
+    initState(x, key);
+    for (int i = 0; i < 4; i++) {
+        x[12 + i] = load32(input + 4 * i);
+    }
+    doubleRounds(x);
+    for (int i = 0; i < 4; i++) {
+        store32(out + 4 * i, x[i]);
+        store32(out + 16 + 4 * i, x[12 + i]);
+    }
+    wipe(x, sizeof(x));
+}
+
+// 26-bit limbs, 32x32->64 multiplies: fast on the ESP32's 32-bit core
+Poly1305::Poly1305(const uint8_t* key) : buffered(0) {
+    r[0] = load32(key + 0) & 0x3ffffff;
+    r[1] = (load32(key + 3) >> 2) & 0x3ffff03;
+    r[2] = (load32(key + 6) >> 4) & 0x3ffc0ff;
+    r[3] = (load32(key + 9) >> 6) & 0x3f03fff;
+    r[4] = (load32(key + 12) >> 8) & 0x00fffff;
+    for (int i = 0; i < 5; i++) {
+        h[i] = 0;
+    }
+    for (int i = 0; i < 4; i++) {
+        pad[i] = load32(key + 16 + 4 * i);
+    }
+}
+
+void Poly1305::block(const uint8_t* m, uint32_t hibit) {
+    const uint32_t s1 = r[1] * 5, s2 = r[2] * 5, s3 = r[3] * 5, s4 = r[4] * 5;
+
+    uint32_t h0 = h[0] + (load32(m + 0) & 0x3ffffff);
+    uint32_t h1 = h[1] + ((load32(m + 3) >> 2) & 0x3ffffff);
+    uint32_t h2 = h[2] + ((load32(m + 6) >> 4) & 0x3ffffff);
+    uint32_t h3 = h[3] + ((load32(m + 9) >> 6) & 0x3ffffff);
+    uint32_t h4 = h[4] + ((load32(m + 12) >> 8) | hibit);
+
+    uint64_t d0 = (uint64_t)h0 * r[0] + (uint64_t)h1 * s4 + (uint64_t)h2 * s3 + (uint64_t)h3 * s2 + (uint64_t)h4 * s1;
+    uint64_t d1 = (uint64_t)h0 * r[1] + (uint64_t)h1 * r[0] + (uint64_t)h2 * s4 + (uint64_t)h3 * s3 + (uint64_t)h4 * s2;
+    uint64_t d2 = (uint64_t)h0 * r[2] + (uint64_t)h1 * r[1] + (uint64_t)h2 * r[0] + (uint64_t)h3 * s4 + (uint64_t)h4 * s3;
+    uint64_t d3 = (uint64_t)h0 * r[3] + (uint64_t)h1 * r[2] + (uint64_t)h2 * r[1] + (uint64_t)h3 * r[0] + (uint64_t)h4 * s4;
+    uint64_t d4 = (uint64_t)h0 * r[4] + (uint64_t)h1 * r[3] + (uint64_t)h2 * r[2] + (uint64_t)h3 * r[1] + (uint64_t)h4 * r[0];
+
+    uint32_t c;
+    c = (uint32_t)(d0 >> 26); h0 = (uint32_t)d0 & 0x3ffffff;
+    d1 += c; c = (uint32_t)(d1 >> 26); h1 = (uint32_t)d1 & 0x3ffffff;
+    d2 += c; c = (uint32_t)(d2 >> 26); h2 = (uint32_t)d2 & 0x3ffffff;
+    d3 += c; c = (uint32_t)(d3 >> 26); h3 = (uint32_t)d3 & 0x3ffffff;
+    d4 += c; c = (uint32_t)(d4 >> 26); h4 = (uint32_t)d4 & 0x3ffffff;
+    h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+    h1 += c;
+
+    h[0] = h0; h[1] = h1; h[2] = h2; h[3] = h3; h[4] = h4;
+}
+
+void Poly1305::update(const uint8_t* data, size_t len) {
+    if (len == 0) return;
+    if (buffered > 0) {
+        size_t n = 16 - buffered;
+        if (n > len) n = len;
+        memcpy(buffer + buffered, data, n);
+        buffered += n;
+        data += n;
+        len -= n;
+        if (buffered < 16) return;
+        block(buffer, 1u << 24);
+        buffered = 0;
+    }
+    while (len >= 16) {
+        block(data, 1u << 24);
+        data += 16;
+        len -= 16;
+    }
+    if (len > 0) {
+        memcpy(buffer, data, len);
+        buffered = len;
+    }
+}
+
+void Poly1305::finish(uint8_t* tag) {
+    if (buffered > 0) {
+        // Last partial block: a 1 byte after the data, no high bit
+        buffer[buffered] = 1;
+        memset(buffer + buffered + 1, 0, 16 - buffered - 1);
+        block(buffer, 0);
+    }
+
+    uint32_t h0 = h[0], h1 = h[1], h2 = h[2], h3 = h[3], h4 = h[4];
+    uint32_t c;
+    c = h1 >> 26; h1 &= 0x3ffffff;
+    h2 += c; c = h2 >> 26; h2 &= 0x3ffffff;
+    h3 += c; c = h3 >> 26; h3 &= 0x3ffffff;
+    h4 += c; c = h4 >> 26; h4 &= 0x3ffffff;
+    h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+    h1 += c;
+
+    // h - p, selected without branching if h >= p
+    uint32_t g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+    uint32_t g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+    uint32_t g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+    uint32_t g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+    uint32_t g4 = h4 + c - (1u << 26);
+
+    uint32_t mask = (g4 >> 31) - 1;
+    h0 = (h0 & ~mask) | (g0 & mask);
+    h1 = (h1 & ~mask) | (g1 & mask);
+    h2 = (h2 & ~mask) | (g2 & mask);
+    h3 = (h3 & ~mask) | (g3 & mask);
+    h4 = (h4 & ~mask) | (g4 & mask);
+
+    h0 = h0 | (h1 << 26);
+    h1 = (h1 >> 6) | (h2 << 20);
+    h2 = (h2 >> 12) | (h3 << 14);
+    h3 = (h3 >> 18) | (h4 << 8);
+
+    uint64_t f;
+    f = (uint64_t)h0 + pad[0];             store32(tag + 0, (uint32_t)f);
+    f = (uint64_t)h1 + pad[1] + (f >> 32); store32(tag + 4, (uint32_t)f);
+    f = (uint64_t)h2 + pad[2] + (f >> 32); store32(tag + 8, (uint32_t)f);
+    f = (uint64_t)h3 + pad[3] + (f >> 32); store32(tag + 12, (uint32_t)f);
+
+    wipe(r, sizeof(r));
+    wipe(h, sizeof(h));
+    wipe(pad, sizeof(pad));
+}
+
+namespace {
+    void aeadTag(const uint8_t* key, const uint8_t* nonce, const uint8_t* aad, size_t aad_len,
+                 const uint8_t* ciphertext, size_t len, uint8_t* tag) {
+        uint8_t one_time_key[64] = {0};
+        chacha20Xor(key, nonce, 0, one_time_key, one_time_key, sizeof(one_time_key));
+
+        Poly1305 mac(one_time_key);
+        mac.update(aad, aad_len);
+        mac.update(ZERO_PAD, (16 - aad_len % 16) % 16);
+        mac.update(ciphertext, len);
+        mac.update(ZERO_PAD, (16 - len % 16) % 16);
+        uint8_t lengths[16];
+        store64(lengths, aad_len);
+        store64(lengths + 8, len);
+        mac.update(lengths, sizeof(lengths));
+        mac.finish(tag);
+
+        wipe(one_time_key, sizeof(one_time_key));
+    }
+}
+
+void seal(const uint8_t* key, const uint8_t* nonce, const uint8_t* aad, size_t aad_len,
+          uint8_t* data, size_t len, uint8_t* tag) {
+    chacha20Xor(key, nonce, 1, data, data, len);
+    aeadTag(key, nonce, aad, aad_len, data, len, tag);
+}
+
+bool open(const uint8_t* key, const uint8_t* nonce, const uint8_t* aad, size_t aad_len,
+          uint8_t* data, size_t len, const uint8_t* tag, size_t tag_len) {
+    if (tag_len == 0 || tag_len > TAG_SIZE) {
+        return false;
+    }
+    uint8_t expected[TAG_SIZE];
+    aeadTag(key, nonce, aad, aad_len, data, len, expected);
+    bool valid = equal(expected, tag, tag_len);
+    wipe(expected, sizeof(expected));
+    if (!valid) {
+        return false;
+    }
+    chacha20Xor(key, nonce, 1, data, data, len);
+    return true;
+}
+
+bool equal(const uint8_t* a, const uint8_t* b, size_t len) {
+    uint8_t diff = 0;
+    for (size_t i = 0; i < len; i++) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+void wipe(void* data, size_t len) {
+    volatile uint8_t* p = static_cast<volatile uint8_t*>(data);
+    while (len--) {
+        *p++ = 0;
+    }
+}
+
+}
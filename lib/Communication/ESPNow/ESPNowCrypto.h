@@ -0,0 +1,56 @@
+#ifndef ESPNOW_CRYPTO_H
+#define ESPNOW_CRYPTO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ChaCha20-Poly1305 AEAD (RFC 8439) and HChaCha20 key derivation, used to
+// seal ESP-NOW frames. Portable C++ with no heap and no tables, so target
+// and host run (and benchmark) exactly the same code; the ESP32 has no
+// ChaCha accelerator that mbedtls could use instead.
+namespace ESPNowCrypto {
+    static constexpr size_t KEY_SIZE = 32;
+    static constexpr size_t NONCE_SIZE = 12;
+    static constexpr size_t TAG_SIZE = 16;
+    static constexpr size_t HCHACHA_INPUT_SIZE = 16;
+
+    // XORs len bytes of keystream starting at block counter into out (in == out is fine)
+    void chacha20Xor(const uint8_t* key, const uint8_t* nonce, uint32_t counter,
+                     const uint8_t* in, uint8_t* out, size_t len);
+
+    // 256-bit subkey from a key and a 128-bit input (the XChaCha20 construction)
+    void hchacha20(const uint8_t* key, const uint8_t* input, uint8_t* out);
+
+    class Poly1305 {
+    public:
+        explicit Poly1305(const uint8_t* key);  // One-time key, never reused
+        void update(const uint8_t* data, size_t len);
+        void finish(uint8_t* tag);               // TAG_SIZE bytes
+
+    private:
+        uint32_t r[5];
+        uint32_t h[5];
+        uint32_t pad[4];
+        uint8_t buffer[16];
+        size_t buffered;
+
+        void block(const uint8_t* m, uint32_t hibit);
+    };
+
+    // Encrypts data in place and writes the full tag
+    void seal(const uint8_t* key, const uint8_t* nonce, const uint8_t* aad, size_t aad_len,
+              uint8_t* data, size_t len, uint8_t* tag);
+
+    // Checks the first tag_len bytes of the tag (1..TAG_SIZE) and only then
+    // decrypts data in place. Returns false, data untouched, on a mismatch.
+    bool open(const uint8_t* key, const uint8_t* nonce, const uint8_t* aad, size_t aad_len,
+              uint8_t* data, size_t len, const uint8_t* tag, size_t tag_len);
+
+    // Constant-time comparison
+    bool equal(const uint8_t* a, const uint8_t* b, size_t len);
+
+    // Overwrites key material in a way the compiler can't drop
+    void wipe(void* data, size_t len);
+}
+
+#endif
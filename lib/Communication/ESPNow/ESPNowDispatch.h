@@ -0,0 +1,183 @@
+#ifndef ESPNOW_DISPATCH_H
+#define ESPNOW_DISPATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../../Config/espnow_config.h"
+#include "ESPNowMessage.h"
+#include "ESPNowPeerTable.h"
+
+// Decoded application payloads. Each one has an ESPNowPayloadTraits
+// specialization naming its message type and filling it from the message.
+namespace ESPNowPayload {
+    struct ScreenSync {
+        uint8_t screen_id;
+        char name[31];
+    };
+
+    struct ButtonData {
+        uint8_t states;
+        uint32_t timestamp;     // Sender's millis()
+    };
+
+    struct InputEvent {
+        uint8_t event_type;
+        uint8_t button_id;
+        uint16_t data;
+    };
+
+    struct RcChannels {
+        uint8_t count;
+        uint8_t bits;           // 11 or 12
+        uint16_t channels[ESPNowMessage::RC_MAX_CHANNELS];
+    };
+
+    struct Command {
+        uint8_t command;        // ESPNowConfig::CommandId
+        uint8_t argument;
+    };
+}
+
+// decode() returns false for a payload that can't be valid; the handler is skipped
+template<typename Payload>
+struct ESPNowPayloadTraits;
+
+template<>
+struct ESPNowPayloadTraits<ESPNowPayload::ScreenSync> {
+    static constexpr uint8_t TYPE = ESPNowConfig::MSG_SCREEN_SYNC;
+    static bool decode(const ESPNowMessage& msg, ESPNowPayload::ScreenSync& out) {
+        out.screen_id = msg.getScreenId();
+        msg.getScreenName(out.name, sizeof(out.name));
+        return true;
+    }
+};
+
+template<>
+struct ESPNowPayloadTraits<ESPNowPayload::ButtonData> {
+    static constexpr uint8_t TYPE = ESPNowConfig::MSG_BUTTON_DATA;
+    static bool decode(const ESPNowMessage& msg, ESPNowPayload::ButtonData& out) {
+        out.states = msg.getButtonStates();
+        out.timestamp = msg.getButtonTimestamp();
+        return true;
+    }
+};
+
+template<>
+struct ESPNowPayloadTraits<ESPNowPayload::InputEvent> {
+    static constexpr uint8_t TYPE = ESPNowConfig::MSG_INPUT_EVENT;
+    static bool decode(const ESPNowMessage& msg, ESPNowPayload::InputEvent& out) {
+        out.event_type = msg.getInputEventType();
+        out.button_id = msg.getInputButtonId();
+        out.data = msg.getInputEventData();
+        return true;
+    }
+};
+
+template<>
+struct ESPNowPayloadTraits<ESPNowPayload::RcChannels> {
+    static constexpr uint8_t TYPE = ESPNowConfig::MSG_RC_CHANNELS;
+    static bool decode(const ESPNowMessage& msg, ESPNowPayload::RcChannels& out) {
+        out.bits = msg.getRcChannelBits();
+        out.count = msg.getRcChannels(out.channels, ESPNowMessage::RC_MAX_CHANNELS);
+        return out.count > 0;
+    }
+};
+
+template<>
+struct ESPNowPayloadTraits<ESPNowPayload::Command> {
+    static constexpr uint8_t TYPE = ESPNowConfig::MSG_COMMAND;
+    static bool decode(const ESPNowMessage& msg, ESPNowPayload::Command& out) {
+        out.command = msg.getCommandId();
+        out.argument = msg.getCommandArgument();
+        return true;
+    }
+};
+
+// Message handlers indexed by message type. Binding a member function
+// instantiates a small thunk that decodes the payload and calls it on the
+// bound object, so dispatch is one indexed call and needs no globals.
+//
+//   table.on<ESPNowPayload::ButtonData, App, &App::onButtonData>(this);
+//   table.on<App, &App::onTelemetry>(ESPNowConfig::MSG_TELEMETRY, this);
+//
+// A new message type only needs a payload struct and traits (or the raw
+// form); the manager just forwards everything it doesn't handle itself.
+class ESPNowDispatchTable {
+public:
+    typedef ESPNowPeerTable<ESPNowGlobalConfig::MAX_PEERS>::PeerId PeerId;
+    typedef void (*Handler)(void* context, const ESPNowMessage& msg, PeerId peer);
+
+    static constexpr size_t TYPE_COUNT = 32;  // Message types 0x00-0x1F
+
+    ESPNowDispatchTable() {
+        for (size_t i = 0; i < TYPE_COUNT; i++) {
+            entries[i].handler = nullptr;
+            entries[i].context = nullptr;
+        }
+    }
+
+    // Typed handler: void Owner::method(const Payload&, PeerId)
+    template<typename Payload, typename Owner, void (Owner::*Method)(const Payload&, PeerId)>
+    bool on(Owner* owner) {
+        static_assert(ESPNowPayloadTraits<Payload>::TYPE < TYPE_COUNT, "Message type outside the dispatch table");
+        return set(ESPNowPayloadTraits<Payload>::TYPE, &typedThunk<Payload, Owner, Method>, owner);
+    }
+
+    // Raw handler for types without a payload struct: void Owner::method(const ESPNowMessage&, PeerId)
+    template<typename Owner, void (Owner::*Method)(const ESPNowMessage&, PeerId)>
+    bool on(uint8_t type, Owner* owner) {
+        return set(type, &rawThunk<Owner, Method>, owner);
+    }
+
+    bool set(uint8_t type, Handler handler, void* context) {
+        if (type >= TYPE_COUNT) return false;
+        entries[type].handler = handler;
+        entries[type].context = context;
+        return true;
+    }
+
+    void clear(uint8_t type) { set(type, nullptr, nullptr); }
+
+    // Drops every handler bound to owner, e.g. before it is destroyed
+    void clearOwner(const void* owner) {
+        for (size_t i = 0; i < TYPE_COUNT; i++) {
+            if (entries[i].context == owner) {
+                entries[i].handler = nullptr;
+                entries[i].context = nullptr;
+            }
+        }
+    }
+
+    bool has(uint8_t type) const { return type < TYPE_COUNT && entries[type].handler != nullptr; }
+
+    // Returns false if no handler is registered for msg.type
+    bool dispatch(const ESPNowMessage& msg, PeerId peer) const {
+        if (!has(msg.type)) return false;
+        const Entry& entry = entries[msg.type];
+        entry.handler(entry.context, msg, peer);
+        return true;
+    }
+
+private:
+    struct Entry {
+        Handler handler;
+        void* context;
+    };
+
+    Entry entries[TYPE_COUNT];
+
+    template<typename Payload, typename Owner, void (Owner::*Method)(const Payload&, PeerId)>
+    static void typedThunk(void* context, const ESPNowMessage& msg, PeerId peer) {
+        Payload payload;
+        if (ESPNowPayloadTraits<Payload>::decode(msg, payload)) {
+            (static_cast<Owner*>(context)->*Method)(payload, peer);
+        }
+    }
+
+    template<typename Owner, void (Owner::*Method)(const ESPNowMessage&, PeerId)>
+    static void rawThunk(void* context, const ESPNowMessage& msg, PeerId peer) {
+        (static_cast<Owner*>(context)->*Method)(msg, peer);
+    }
+};
+
+#endif
@@ -0,0 +1,188 @@
+#include "ESPNowLinkTask.h"
+#include "ESPNowManager.h"
+
+ESPNowLinkTask::Config ESPNowLinkTask::defaultConfig() {
+    Config config;
+    config.priority = ESPNowGlobalConfig::LINK_TASK_PRIORITY;
+    config.core = ESPNowGlobalConfig::LINK_TASK_CORE;
+    config.stack_size = ESPNowGlobalConfig::LINK_TASK_STACK_SIZE;
+    config.max_sleep_ms = ESPNowGlobalConfig::LINK_TASK_MAX_SLEEP_MS;
+    return config;
+}
+
+ESPNowLinkTask::ESPNowLinkTask(ESPNowManager& manager)
+    : manager(manager)
+    , config(defaultConfig())
+    , running(false)
+    , stop_requested(false)
+    , update_count(0)
+    , updates_started(0)
+    , max_update_us(0)
+#ifdef ARDUINO
+    , task_handle(nullptr)
+#else
+    , thread_id(std::thread::id())
+    , wake_pending(false)
+#endif
+{
+}
+
+ESPNowLinkTask::~ESPNowLinkTask() {
+    stop();
+}
+
+hal_status_t ESPNowLinkTask::start(const Config& task_config) {
+    if (isRunning()) {
+        return HAL_BUSY;
+    }
+
+    config = task_config;
+    if (config.max_sleep_ms == 0) {
+        config.max_sleep_ms = 1;
+    }
+    stop_requested.store(false, std::memory_order_release);
+    running.store(true, std::memory_order_release);
+
+    // From here on the manager hands app calls over to this task
+    manager.attachLinkTask(this);
+
+#ifdef ARDUINO
+    BaseType_t core = (config.core < 0) ? tskNO_AFFINITY : config.core;
+    if (xTaskCreatePinnedToCore(&ESPNowLinkTask::taskEntry, "espnow_link", config.stack_size, this,
+                                config.priority, &task_handle, core) != pdPASS) {
+        manager.attachLinkTask(nullptr);
+        running.store(false, std::memory_order_release);
+        LOG_ERROR("ESPNow", "Failed to create link task");
+        return HAL_ERROR;
+    }
+    LOG_INFO("ESPNow", "Link task started (priority %u, core %d)", config.priority, config.core);
+#else
+    // Priority and core have no meaning for a host thread
+    thread = std::thread(&ESPNowLinkTask::run, this);
+    LOG_INFO("ESPNow", "Link task started (host thread)");
+#endif
+    return HAL_OK;
+}
+
+void ESPNowLinkTask::stop() {
+    if (!isRunning()) {
+        return;
+    }
+
+    stop_requested.store(true, std::memory_order_release);
+    wake();
+
+#ifdef ARDUINO
+    // The task clears running as the last thing before deleting itself
+    while (isRunning()) {
+        vTaskDelay(1);
+    }
+    task_handle = nullptr;
+#else
+    if (thread.joinable()) {
+        thread.join();
+    }
+    thread_id.store(std::thread::id(), std::memory_order_release);
+    running.store(false, std::memory_order_release);
+#endif
+
+    // Requests still queued run on the caller from now on
+    manager.attachLinkTask(nullptr);
+    LOG_INFO("ESPNow", "Link task stopped after %u updates (max %u us)",
+             getUpdateCount(), getMaxUpdateUs());
+}
+
+bool ESPNowLinkTask::isCurrentTask() const {
+#ifdef ARDUINO
+    return task_handle != nullptr && xTaskGetCurrentTaskHandle() == task_handle;
+#else
+    return std::this_thread::get_id() == thread_id.load(std::memory_order_acquire);
+#endif
+}
+
+void ESPNowLinkTask::wake() {
+#ifdef ARDUINO
+    if (task_handle) {
+        xTaskNotifyGive(task_handle);
+    }
+#else
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        wake_pending = true;
+    }
+    wake_signal.notify_one();
+#endif
+}
+
+bool ESPNowLinkTask::waitForUpdate(uint32_t timeout_ms) {
+    // An update already running may have passed the request queue
+    uint32_t target = updates_started.load(std::memory_order_acquire) + 1;
+#ifdef ARDUINO
+    uint32_t start_ms = millis();
+    while (static_cast<int32_t>(update_count.load(std::memory_order_acquire) - target) < 0) {
+        if (!isRunning() || millis() - start_ms >= timeout_ms) {
+            return false;
+        }
+        vTaskDelay(1);
+    }
+#else
+    // Real time: the simulated clock may not move while the app waits
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (static_cast<int32_t>(update_count.load(std::memory_order_acquire) - target) < 0) {
+        if (!isRunning() || std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+#endif
+    return true;
+}
+
+void ESPNowLinkTask::run() {
+#ifndef ARDUINO
+    thread_id.store(std::this_thread::get_id(), std::memory_order_release);
+#endif
+    uint32_t last_update_ms = millis();
+
+    while (!stop_requested.load(std::memory_order_acquire)) {
+        uint32_t now_ms = millis();
+        uint32_t start_us = micros();
+
+        updates_started.fetch_add(1, std::memory_order_acq_rel);
+        manager.update(now_ms - last_update_ms);
+        last_update_ms = now_ms;
+
+        uint32_t elapsed_us = micros() - start_us;
+        update_count.fetch_add(1, std::memory_order_release);
+        if (elapsed_us > max_update_us.load(std::memory_order_relaxed)) {
+            max_update_us.store(elapsed_us, std::memory_order_relaxed);
+        }
+
+        // At least one tick, so a deadline that stays due can't starve lower priorities
+        uint32_t sleep_ms = manager.getTimeUntilNextDeadline();
+        if (sleep_ms > config.max_sleep_ms) sleep_ms = config.max_sleep_ms;
+        if (sleep_ms == 0) sleep_ms = 1;
+        sleep(sleep_ms);
+    }
+}
+
+void ESPNowLinkTask::sleep(uint32_t timeout_ms) {
+#ifdef ARDUINO
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms));
+#else
+    std::unique_lock<std::mutex> lock(wake_mutex);
+    wake_signal.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this] { return wake_pending; });
+    wake_pending = false;
+#endif
+}
+
+#ifdef ARDUINO
+void ESPNowLinkTask::taskEntry(void* arg) {
+    ESPNowLinkTask* task = static_cast<ESPNowLinkTask*>(arg);
+    // Set here too: at a higher priority the task runs before xTaskCreate returns
+    task->task_handle = xTaskGetCurrentTaskHandle();
+    task->run();
+    task->running.store(false, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+#endif
@@ -0,0 +1,78 @@
+#ifndef ESPNOW_LINK_TASK_H
+#define ESPNOW_LINK_TASK_H
+
+#include "../../Core/Platform.h"
+#include "../../Config/espnow_config.h"
+#include "../../HAL/Core/hal_types.h"
+#include <atomic>
+
+#ifndef ARDUINO
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+class ESPNowManager;
+
+// Runs ESPNowManager::update() in its own task, so display redraws and the
+// loop() delay can't hold back control traffic. The task sleeps until the
+// manager's next deadline, a received frame or an app request wakes it.
+//
+// While it runs, the app keeps using the manager as before from one app
+// task: sends and connection requests are queued to the link task, and
+// the message callbacks are queued back and run from the app's own
+// update() call. On the host the task is a std::thread.
+class ESPNowLinkTask {
+public:
+    struct Config {
+        uint8_t priority;
+        int8_t core;            // -1 = no affinity
+        uint32_t stack_size;
+        uint32_t max_sleep_ms;  // Upper bound between two updates
+    };
+
+    static Config defaultConfig();
+
+    explicit ESPNowLinkTask(ESPNowManager& manager);
+    ~ESPNowLinkTask();
+
+    hal_status_t start(const Config& config);
+    hal_status_t start() { return start(defaultConfig()); }
+    void stop();  // Returns once the task has finished its current update
+    bool isRunning() const { return running.load(std::memory_order_acquire); }
+    bool isCurrentTask() const;
+
+    void wake();  // Safe from any task, including the Wi-Fi callback
+
+    // For an app task that needs a queued request carried out: returns once
+    // an update that started after the call has finished, false on timeout
+    bool waitForUpdate(uint32_t timeout_ms);
+
+    uint32_t getUpdateCount() const { return update_count.load(std::memory_order_relaxed); }
+    uint32_t getMaxUpdateUs() const { return max_update_us.load(std::memory_order_relaxed); }
+
+private:
+    ESPNowManager& manager;
+    Config config;
+    std::atomic<bool> running;
+    std::atomic<bool> stop_requested;
+    std::atomic<uint32_t> update_count;
+    std::atomic<uint32_t> updates_started;
+    std::atomic<uint32_t> max_update_us;
+
+#ifdef ARDUINO
+    TaskHandle_t task_handle;
+    static void taskEntry(void* arg);
+#else
+    std::thread thread;
+    std::atomic<std::thread::id> thread_id;  // Set by the thread itself, before its first update
+    std::mutex wake_mutex;
+    std::condition_variable wake_signal;
+    bool wake_pending;
+#endif
+
+    void run();
+    void sleep(uint32_t timeout_ms);
+};
+
+#endif
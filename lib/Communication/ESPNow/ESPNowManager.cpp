@@ -1,97 +1,183 @@
 #include "ESPNowManager.h"
+#include "ESPNowRadioTransport.h"
+#include "ESPNowLinkTask.h"
 
-ESPNowManager* ESPNowManager::instance = nullptr;
-SemaphoreHandle_t ESPNowManager::instance_mutex = nullptr;
-
-ESPNowManager::ESPNowManager(ESPNowConfig::DeviceRole role, const uint8_t* peer_mac)
-    : device_role(role)
+ESPNowManager::ESPNowManager(ESPNowConfig::DeviceRole role, const uint8_t* peer_mac, ESPNowTransport* transport)
+    : transport(transport)
+    , device_role(role)
     , current_state(State::UNINITIALIZED)
-    , state_machine("ESPNow")
-    , message_sequence(0)
+    , state_machine("ESPNow", this)
     , ping_counter(0)
     , last_activity_time(0)
-    , state_timer(0)
     , connection_start_time(0)
+    , reconnect_attempts(0)
+    , last_tx_time(0)
+    , link_alive(false)
+    , link_lost(false)
+    , link_lost_activity_time(0)
+    , session_id(0)
+    , reconnect_start_time(0)
+    , has_peer_nonce(false)
+    , channel_survey(ESPNowChannelSurvey::defaultConfig())
+    , link_channel(ESPNowConfig::CHANNEL)
+    , channel_plan(ChannelPlan::NONE)
+    , channel_plan_id(0)
+    , channel_plan_start(0)
+    , channel_target(ESPNowConfig::CHANNEL)
+    , channel_announcements(0)
+    , channel_surveyed(false)
+    , channel_hold_until(0)
+    , channel_next_survey(0)
+    , channel_confirming(false)
+    , channel_previous(ESPNowConfig::CHANNEL)
+    , channel_moved_at(0)
+    , survey_slot(-1)
+    , survey_probes_sent(0)
+    , survey_peer_probes(0)
+    , channel_tx_frames(0)
+    , channel_tx_failed(0)
     , peer_added(false)
     , is_initialized(false)
     , auto_reconnect(role == ESPNowConfig::ROLE_BASE_STATION)  // Only base station auto-reconnects
-    , screen_sync_callback(nullptr)
-    , button_data_callback(nullptr)
-    , input_event_callback(nullptr) {
+    , process_budget_us(ESPNowGlobalConfig::RX_PROCESS_BUDGET_US)
+    , clock_filter_count(0)
+    , clock_filter_next(0)
+    , latency_changed(true)
+    , peers(ESPNowGlobalConfig::MAX_SEQUENCE_GAP)
+    , primary_peer(INVALID_PEER)
+    , tx_batch_start_us(0)
+    , coalescing_enabled(ESPNowGlobalConfig::ENABLE_TX_COALESCING && !ESPNowGlobalConfig::USE_LEGACY_WIRE_FORMAT)
+    , rx_invalid_count(0)
+    , rx_byte_count(0)
+    , rx_unknown_peer_count(0)
+    , rx_unsealed_count(0)
+    , delivery_callback(nullptr)
+    , reliable_tx(ESPNowGlobalConfig::RELIABLE_INITIAL_RTO_MS, ESPNowGlobalConfig::RELIABLE_MAX_RTO_MS,
+                  ESPNowGlobalConfig::RELIABLE_MAX_ATTEMPTS)
+    , peer_removal_pending(false)
+    , tx_failed_count(0)
+    , tx_failed_seen(0)
+    , rc_timer(nullptr)
+    , rc_stream_running(false)
+    , rc_frame_due(false)
+    , rc_channel_count(0)
+    , rc_frames_sent(0)
+    , rx_claimed(RxPool::INVALID_INDEX)
+    , link_task(nullptr)
+    , registered_peer(INVALID_PEER) {
     
     memcpy(peer_mac_address, peer_mac, 6);
     memset(&stats, 0, sizeof(stats));
     memset(own_mac_address, 0, 6);
+    memset(rc_channels, 0, sizeof(rc_channels));
+    memset(ping_history, 0, sizeof(ping_history));
+    memset(&pending_pong, 0, sizeof(pending_pong));
+    memset(clock_filter, 0, sizeof(clock_filter));
+    memset(peer_nonce, 0, sizeof(peer_nonce));
+    memset(&survey_sample, 0, sizeof(survey_sample));
+    stats.channel = link_channel;
+    portMUX_INITIALIZE(&rc_lock);
+    portMUX_INITIALIZE(&rx_sequence_lock);
+    
+    if (ESPNowGlobalConfig::ENABLE_ENCRYPTION) {
+        setPairingKey(ESPNowGlobalConfig::PAIRING_KEY);
+    }
     
-    // Initialize mutexes
-    queue_mutex = xSemaphoreCreateMutex();
-    state_mutex = xSemaphoreCreateMutex();
+    // The pairing peer takes the first slot, even before its MAC is known
+    primary_peer = peers.add(peer_mac_address, device_role == ESPNowConfig::ROLE_BASE_STATION
+                                                   ? ESPNowConfig::ROLE_HANDHELD
+                                                   : ESPNowConfig::ROLE_BASE_STATION);
     
-    // Initialize static mutex if needed
-    if (instance_mutex == nullptr) {
-        instance_mutex = xSemaphoreCreateMutex();
+#ifdef ARDUINO
+    if (!this->transport) {
+        this->transport = &ESPNowRadioTransport::getInstance();
     }
+#endif
     
-    registerInstance(this);
+    // Initialize mutexes
+    state_mutex = xSemaphoreCreateMutex();
+    publishState();
 }
 
 ESPNowManager::~ESPNowManager() {
     shutdown();
-    unregisterInstance(this);
     
     // Clean up mutexes
-    if (queue_mutex) {
-        vSemaphoreDelete(queue_mutex);
-        queue_mutex = nullptr;
-    }
     if (state_mutex) {
         vSemaphoreDelete(state_mutex);
         state_mutex = nullptr;
     }
 }
 
+hal_status_t ESPNowManager::setPairingKey(const uint8_t* key) {
+    if (is_initialized) {
+        return HAL_ERROR;
+    }
+    if (key && ESPNowGlobalConfig::USE_LEGACY_WIRE_FORMAT) {
+        LOG_WARNING("ESPNow", "Encryption needs the compact wire format, staying unencrypted");
+        key = nullptr;
+    }
+    session.setPairingKey(key);
+    return HAL_OK;
+}
+
 hal_status_t ESPNowManager::init() {
-    LOG_INFO("ESPNow", "Initializing ESP-NOW");
+    LOG_INFO("ESPNow", "Initializing ESP-NOW (CRC backend: %s)", ESPNowCRC::backendName());
+    if (session.isEnabled()) {
+        LOG_INFO("ESPNow", "Session encryption: ChaCha20-Poly1305, %u-byte tag",
+                 static_cast<unsigned>(ESPNowSession::TAG_SIZE));
+        if (session.isPairingKeyZero()) {
+            LOG_WARNING("ESPNow", "Pairing key is all zeros");
+        }
+    }
     
     // Try to load saved peer if we don't have one
     uint8_t zero_mac[6] = {0};
     if (memcmp(peer_mac_address, zero_mac, 6) == 0) {
         if (loadSavedPeer()) {
             LOG_INFO("ESPNow", "Using saved peer MAC address");
+            uint8_t role = primary().role;
+            peers.remove(primary_peer);
+            primary_peer = peers.add(peer_mac_address, role);
         }
     }
     
-    WiFi.mode(WIFI_STA);
-    WiFi.disconnect();
+    // A session saved before a reboot can still be resumed by the peer
+    if (ESPNowGlobalConfig::ENABLE_FAST_RECONNECT) {
+        loadSavedSession();
+    }
+    
+    if (!transport) {
+        LOG_ERROR("ESPNow", "No transport");
+        return HAL_ERROR;
+    }
+    
+    if (transport->begin(&ESPNowManager::onDataReceived, &ESPNowManager::onDataSent, this) != HAL_OK) {
+        LOG_ERROR("ESPNow", "Failed to initialize ESP-NOW");
+        return HAL_ERROR;
+    }
+    
+    // Discovery and pairing always start on the home channel
+    link_channel = ESPNowConfig::CHANNEL;
+    transport->setChannel(link_channel);
+    stats.channel = link_channel;
     
-    WiFi.macAddress(own_mac_address);
+    transport->getMacAddress(own_mac_address);
     LOG_INFO("ESPNow", "Own MAC: %02X:%02X:%02X:%02X:%02X:%02X",
              own_mac_address[0], own_mac_address[1], own_mac_address[2],
              own_mac_address[3], own_mac_address[4], own_mac_address[5]);
     LOG_INFO("ESPNow", "Peer MAC: %02X:%02X:%02X:%02X:%02X:%02X",
              peer_mac_address[0], peer_mac_address[1], peer_mac_address[2],
              peer_mac_address[3], peer_mac_address[4], peer_mac_address[5]);
+
     
-    if (esp_now_init() != ESP_OK) {
-        LOG_ERROR("ESPNow", "Failed to initialize ESP-NOW");
-        return HAL_ERROR;
-    }
-    
-    esp_now_register_recv_cb(onDataReceived);
-    esp_now_register_send_cb(onDataSent);
-    
-    state_machine.registerState(State::UNINITIALIZED, "UNINITIALIZED",
-        [this](uint32_t dt) { return handleUninitialized(dt); });
-    state_machine.registerState(State::SEARCHING, "SEARCHING",
-        [this](uint32_t dt) { return handleSearching(dt); });
-    state_machine.registerState(State::PAIRING, "PAIRING",
-        [this](uint32_t dt) { return handlePairing(dt); });
-    state_machine.registerState(State::PAIRED, "PAIRED",
-        [this](uint32_t dt) { return handlePaired(dt); });
-    state_machine.registerState(State::RECONNECTING, "RECONNECTING",
-        [this](uint32_t dt) { return handleReconnecting(dt); });
-    state_machine.registerState(State::ERROR, "ERROR",
-        [this](uint32_t dt) { return handleError(dt); });
+    state_machine.registerState(State::UNINITIALIZED, "UNINITIALIZED", &ESPNowManager::handleUninitialized);
+    state_machine.registerState(State::SEARCHING, "SEARCHING", &ESPNowManager::handleSearching);
+    state_machine.registerState(State::PAIRING, "PAIRING", &ESPNowManager::handlePairing);
+    state_machine.registerState(State::PAIRED, "PAIRED", &ESPNowManager::handlePaired);
+    state_machine.registerState(State::RECONNECTING, "RECONNECTING", &ESPNowManager::handleReconnecting);
+    state_machine.registerState(State::ERROR, "ERROR", &ESPNowManager::handleError);
+    state_machine.setTransitionHandler(&ESPNowManager::onStateChanged);
     
     is_initialized = true;
     
@@ -101,126 +187,228 @@ hal_status_t ESPNowManager::init() {
         transitionToState(State::SEARCHING);
     } else {
         // Handheld stays in UNINITIALIZED until manually started
-        current_state = State::UNINITIALIZED;
+        applyState(State::UNINITIALIZED);
         LOG_INFO("ESPNow", "Handheld ESP-NOW initialized but not started (manual mode)");
     }
     
+    publishState();
     return HAL_OK;
 }
 
 hal_status_t ESPNowManager::update(uint32_t delta_ms) {
     if (!is_initialized) return HAL_ERROR;
     
+    if (isAppCaller()) {
+        dispatchCallbacks();
+        return HAL_OK;
+    }
+    processRequests();
+    
+    // Flagged by the RC stream timer; goes out ahead of this tick's other work
+    if (rc_frame_due.exchange(false, std::memory_order_acq_rel)) {
+        sendRcFrame();
+    }
+    
     // Process queued messages from ISR context
     processMessageQueue();
-    
-    // Thread-safe state update
-    if (xSemaphoreTake(state_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        state_timer += delta_ms;
-        hal_status_t result = state_machine.update(delta_ms);
-        xSemaphoreGive(state_mutex);
-        return result;
+    serviceReliable();
+    updatePeerStates();
+    
+    // State handlers only run when one of their deadlines has passed
+    hal_status_t result = HAL_OK;
+    if (timers.anyDue(millis())) {
+        // Thread-safe state update
+        if (xSemaphoreTake(state_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+            result = state_machine.update(delta_ms);
+            xSemaphoreGive(state_mutex);
+        } else {
+            result = HAL_ERROR;
+        }
     }
     
-    return HAL_ERROR;
+    // Replies generated while processing this tick go out together
+    flush();
+    publishState();
+    return result;
+}
+
+void ESPNowManager::publishState() {
+    PublishedState state;
+    state.stats = stats;
+    state.loss_pct = measureLossRate();
+    state.loss_1s_pct = measureLossRate1s();
+    state.loss_10s_pct = measureLossRate10s();
+    state.connection_start_time = connection_start_time;
+    state.last_activity_time = last_activity_time;
+    state.session_id = session_id;
+    state.peer_count = peers.count();
+    published.publish(state);
+    
+    if (latency_changed) {
+        PublishedLatency latency;
+        latency.rtt = rtt_histogram;
+        latency.one_way = one_way_histogram;
+        published_latency.publish(latency);
+        latency_changed = false;
+    }
 }
 
 hal_status_t ESPNowManager::shutdown() {
     if (!is_initialized) return HAL_OK;
     
+    stopRcStream();
+    if (rc_timer) {
+        esp_timer_delete(rc_timer);
+        rc_timer = nullptr;
+    }
+    
+    // Nothing can be retransmitted after this point
+    reliable_tx.cancel(&ESPNowManager::onReliableResolved, this);
     removePeer();
-    esp_now_deinit();
+    transport->end();
+    session.clear();  // A saved session brings its key back on the next init()
+    for (PeerId id = 0; id < peers.capacity(); id++) {
+        peers.get(id).radio_registered = false;  // Dropped with the transport
+    }
     is_initialized = false;
+    publishState();
     
     return HAL_OK;
 }
 
-hal_status_t ESPNowManager::handleUninitialized(uint32_t delta_ms) {
+hal_status_t ESPNowManager::handleUninitialized(uint32_t) {
     return HAL_OK;
 }
 
-hal_status_t ESPNowManager::handleSearching(uint32_t delta_ms) {
-    static uint32_t last_announce = 0;
+hal_status_t ESPNowManager::handleSearching(uint32_t) {
+    uint32_t now = millis();
     
     // Only base station broadcasts announcements
-    if (device_role == ESPNowConfig::ROLE_BASE_STATION) {
-        if (millis() - last_announce > ESPNowConfig::SEARCH_INTERVAL_MS) {
-            sendAnnounce();
-            last_announce = millis();
-            LOG_DEBUG("ESPNow", "Base station searching for peer...");
-        }
-    } else {
-        // Handheld just listens
-        if (state_timer % 2000 == 0) {
-            LOG_DEBUG("ESPNow", "Handheld listening for base station...");
-        }
+    if (timers.expire(TIMER_ANNOUNCE, now)) {
+        sendAnnounce();
+        timers.arm(TIMER_ANNOUNCE, now + ESPNowConfig::SEARCH_INTERVAL_MS);
+        LOG_DEBUG("ESPNow", "Base station searching for peer...");
+    }
+    
+    // Handheld just listens
+    if (timers.expire(TIMER_STATUS_LOG, now)) {
+        LOG_DEBUG("ESPNow", "Handheld listening for base station...");
+        timers.arm(TIMER_STATUS_LOG, now + 2000);
     }
     
-    if (state_timer > ESPNowConfig::PAIRING_TIMEOUT_MS * 3) {
+    if (timers.expire(TIMER_STATE_TIMEOUT, now)) {
         LOG_WARNING("ESPNow", "Search timeout, restarting");
-        state_timer = 0;
+        timers.arm(TIMER_STATE_TIMEOUT, now + ESPNowConfig::PAIRING_TIMEOUT_MS * 3);
     }
     
     return HAL_OK;
 }
 
-hal_status_t ESPNowManager::handlePairing(uint32_t delta_ms) {
-    static uint32_t last_retry = 0;
+hal_status_t ESPNowManager::handlePairing(uint32_t) {
+    uint32_t now = millis();
     
     // Reduced timeout for faster recovery
-    if (state_timer > 3000) {
+    if (timers.expire(TIMER_STATE_TIMEOUT, now)) {
         LOG_WARNING("ESPNow", "Pairing timeout, back to searching");
         removePeer();
-        // Don't call transitionToState here - return the new state instead
-        current_state = State::SEARCHING;
-        state_machine.transitionTo(State::SEARCHING);
-        state_timer = 0;
+        // Don't call transitionToState here - we already hold the state mutex
+        applyState(State::SEARCHING);
         return HAL_OK;
     }
     
     // Only handheld should be in PAIRING state waiting for response
-    if (device_role == ESPNowConfig::ROLE_HANDHELD) {
-        if (millis() - last_retry > 1000) {
-            LOG_DEBUG("ESPNow", "Handheld waiting for pair response...");
-            last_retry = millis();
-        }
+    if (timers.expire(TIMER_STATUS_LOG, now)) {
+        LOG_DEBUG("ESPNow", "Handheld waiting for pair response...");
+        timers.arm(TIMER_STATUS_LOG, now + 1000);
     }
     
     return HAL_OK;
 }
 
-hal_status_t ESPNowManager::handlePaired(uint32_t delta_ms) {
-    static uint32_t last_ping = 0;
+hal_status_t ESPNowManager::handlePaired(uint32_t) {
+    uint32_t now = millis();
     
-    if (device_role == ESPNowConfig::ROLE_BASE_STATION) {
-        if (millis() - last_ping > ESPNowConfig::PING_INTERVAL_MS) {
+    if (timers.expire(TIMER_PING, now)) {
+        if (!ESPNowGlobalConfig::ENABLE_ADAPTIVE_KEEPALIVE) {
             if (sendPing() == HAL_OK) {
-                last_ping = millis();
+                timers.arm(TIMER_PING, now + ESPNowConfig::PING_INTERVAL_MS);
             } else {
                 LOG_ERROR("ESPNow", "Failed to send ping");
+                timers.arm(TIMER_PING, now + 1);
+            }
+        } else if (static_cast<int32_t>(now - nextKeepaliveTime()) >= 0) {
+            // Nothing went out lately, or no RTT probe could ride along. A held
+            // pong proves liveness as well; only a due probe needs a ping.
+            hal_status_t status;
+            if (pending_pong.valid) {
+                pending_pong.valid = false;
+                status = sendPong(pending_pong.counter, pending_pong.rx_us);
+            } else if (now - stats.last_ping_time >= ESPNowGlobalConfig::RTT_PROBE_INTERVAL_MS) {
+                status = sendPing();
+            } else {
+                status = sendKeepalive();
+            }
+            
+            if (status == HAL_OK) {
+                stats.keepalives_sent++;
+                timers.arm(TIMER_PING, nextKeepaliveTime());
+            } else {
+                LOG_ERROR("ESPNow", "Failed to send keepalive");
+                timers.arm(TIMER_PING, now + 1);
             }
+        } else {
+            // Other traffic went out since this was armed
+            timers.arm(TIMER_PING, nextKeepaliveTime());
+        }
+    }
+    
+    if (timers.expire(TIMER_PONG, now) && pending_pong.valid) {
+        // No data frame to ride in
+        pending_pong.valid = false;
+        sendPong(pending_pong.counter, pending_pong.rx_us);
+    }
+    
+    if (timers.expire(TIMER_LINK_MISS, now)) {
+        uint32_t miss_ms = ESPNowGlobalConfig::KEEPALIVE_IDLE_MS * ESPNowGlobalConfig::LINK_MISS_COUNT;
+        if (now - last_activity_time <= miss_ms) {
+            timers.arm(TIMER_LINK_MISS, last_activity_time + miss_ms + 1);
+        } else if (link_alive) {
+            // Re-armed by processMessage() when the peer is heard again
+            link_alive = false;
+            stats.link_failsafes++;
+            stats.last_failsafe_ms = now - last_activity_time;
+            LOG_WARNING("ESPNow", "Link failsafe: nothing heard for %u ms", stats.last_failsafe_ms);
         }
     }
     
-    if (millis() - last_activity_time > ESPNowConfig::CONNECTION_TIMEOUT_MS) {
+    if (timers.expire(TIMER_CHANNEL, now)) {
+        serviceChannel(now);
+    }
+    
+    // Armed for the oldest possible timeout; traffic since then pushes it back
+    if (timers.expire(TIMER_LINK_TIMEOUT, now)) {
+        if (now - last_activity_time <= ESPNowConfig::CONNECTION_TIMEOUT_MS) {
+            timers.arm(TIMER_LINK_TIMEOUT, last_activity_time + ESPNowConfig::CONNECTION_TIMEOUT_MS + 1);
+            return HAL_OK;
+        }
+        
         LOG_WARNING("ESPNow", "Connection timeout after %u ms of inactivity", 
-                    millis() - last_activity_time);
+                    now - last_activity_time);
+        link_lost = true;
+        link_lost_activity_time = last_activity_time;
         
-        // Try to reconnect if auto-reconnect is enabled
-        if (auto_reconnect) {
+        // Try to reconnect if auto-reconnect is enabled, or resume a cached
+        // session; a handheld in manual mode still stops if that fails
+        if (auto_reconnect || canResume()) {
             transitionToState(State::RECONNECTING);
         } else {
             // For handheld in manual mode, go back to UNINITIALIZED
             removePeer();
             if (device_role == ESPNowConfig::ROLE_HANDHELD) {
-                current_state = State::UNINITIALIZED;
-                state_machine.transitionTo(State::UNINITIALIZED);
-                state_timer = 0;
+                applyState(State::UNINITIALIZED);
                 LOG_INFO("ESPNow", "Handheld disconnected - manual reconnect required");
             } else {
-                current_state = State::SEARCHING;
-                state_machine.transitionTo(State::SEARCHING);
-                state_timer = 0;
+                applyState(State::SEARCHING);
             }
         }
     }
@@ -228,261 +416,982 @@ hal_status_t ESPNowManager::handlePaired(uint32_t delta_ms) {
     return HAL_OK;
 }
 
-hal_status_t ESPNowManager::handleReconnecting(uint32_t delta_ms) {
-    static uint32_t retry_count = 0;
-    static uint32_t last_retry = 0;
+hal_status_t ESPNowManager::handleReconnecting(uint32_t) {
+    uint32_t now = millis();
     
-    // Retry sending messages periodically
-    if (millis() - last_retry > 1000) {
-        if (device_role == ESPNowConfig::ROLE_BASE_STATION) {
-            sendAnnounce();
-        } else {
-            // Handheld tries to send pair request directly
+    // Success is detected in processMessage() as soon as the peer is heard again
+    if (!timers.expire(TIMER_RETRY, now)) {
+        return HAL_OK;
+    }
+    
+    if (canResume()) {
+        if (now - reconnect_start_time < ESPNowGlobalConfig::FAST_RECONNECT_WINDOW_MS) {
+            // Both ends retry, so the first resume through after a dropout ends it
             if (addPeer() == HAL_OK) {
-                sendPairRequest();
+                sendResume(false);
             }
+            reconnect_attempts++;
+            LOG_DEBUG("ESPNow", "Resume attempt %u", reconnect_attempts);
+            timers.arm(TIMER_RETRY, now + nextResumeDelay());
+            return HAL_OK;
+        }
+        
+        LOG_WARNING("ESPNow", "Fast reconnect failed after %u attempts", reconnect_attempts);
+        removePeer();
+        if (!auto_reconnect && device_role == ESPNowConfig::ROLE_HANDHELD) {
+            applyState(State::UNINITIALIZED);
+            LOG_INFO("ESPNow", "Handheld disconnected - manual reconnect required");
+        } else {
+            applyState(State::SEARCHING);
         }
-        last_retry = millis();
-        retry_count++;
-        LOG_INFO("ESPNow", "Reconnection attempt %u", retry_count);
+        return HAL_OK;
     }
     
-    // Give up after 10 attempts and go back to searching
-    if (retry_count > 10) {
-        LOG_WARNING("ESPNow", "Reconnection failed after %u attempts", retry_count);
-        retry_count = 0;
-        removePeer();
-        current_state = State::SEARCHING;
-        state_machine.transitionTo(State::SEARCHING);
-        state_timer = 0;
+    if (device_role == ESPNowConfig::ROLE_BASE_STATION) {
+        sendAnnounce();
+    } else {
+        // Handheld tries to send pair request directly
+        if (addPeer() == HAL_OK) {
+            sendPairRequest();
+        }
     }
+    reconnect_attempts++;
+    LOG_INFO("ESPNow", "Reconnection attempt %u", reconnect_attempts);
     
-    // Check if we got a response that indicates successful reconnection
-    if (millis() - last_activity_time < 1000) {
-        LOG_INFO("ESPNow", "Reconnection successful!");
-        retry_count = 0;
-        current_state = State::PAIRED;
-        state_machine.transitionTo(State::PAIRED);
-        state_timer = 0;
-        connection_start_time = millis();
+    // Give up after 10 attempts and go back to searching
+    if (reconnect_attempts > 10) {
+        LOG_WARNING("ESPNow", "Reconnection failed after %u attempts", reconnect_attempts);
+        removePeer();
+        applyState(State::SEARCHING);
+        return HAL_OK;
     }
     
+    timers.arm(TIMER_RETRY, now + 1000);
     return HAL_OK;
 }
 
-hal_status_t ESPNowManager::handleError(uint32_t delta_ms) {
-    if (state_timer > 5000) {
-        current_state = State::SEARCHING;
-        state_machine.transitionTo(State::SEARCHING);
-        state_timer = 0;
+uint32_t ESPNowManager::nextResumeDelay() const {
+    // Exponential from a few ms, then linear: a short dropout is recovered
+    // almost at once, a long one doesn't flood the channel
+    uint32_t doublings = (reconnect_attempts > 0) ? reconnect_attempts - 1 : 0;
+    if (doublings > 16) doublings = 16;
+    uint32_t delay_ms = static_cast<uint32_t>(ESPNowGlobalConfig::FAST_RECONNECT_INITIAL_MS) << doublings;
+    if (delay_ms > ESPNowGlobalConfig::FAST_RECONNECT_STEP_MS) {
+        delay_ms = ESPNowGlobalConfig::FAST_RECONNECT_STEP_MS;
     }
-    return HAL_OK;
+    return delay_ms;
 }
 
-hal_status_t ESPNowManager::sendMessage(const ESPNowMessage& msg) {
-    // Defensive checks
-    if (!is_initialized) {
-        LOG_ERROR("ESPNow", "Cannot send message - not initialized");
-        return HAL_ERROR;
+bool ESPNowManager::acceptSecureResume(const ESPNowMessage* msg) {
+    if (!ESPNowSession::verify(*msg, session.getMasterKey())) {
+        LOG_WARNING("ESPNow", "Resume failed authentication");
+        session.recordAuthFailure();
+        return false;
     }
     
-    // Allow sending in SEARCHING state for pairing messages
-    bool is_pairing_msg = (msg.type == ESPNowConfig::MSG_PAIR_REQUEST || 
-                          msg.type == ESPNowConfig::MSG_PAIR_RESPONSE ||
-                          msg.type == ESPNowConfig::MSG_ANNOUNCE);
-    
-    if (!is_pairing_msg && current_state != State::PAIRED && current_state != State::PAIRING) {
-        LOG_WARNING("ESPNow", "Cannot send message in state %s", getStateString());
-        return HAL_ERROR;
+    // The handheld leads every exchange with its nonce, and the base's reply
+    // echoes it: a traffic key is only ever derived from two fresh nonces
+    const uint8_t* nonce = msg->getHandshakeNonce();
+    if (device_role == ESPNowConfig::ROLE_BASE_STATION) {
+        if (msg->isResumeReply()) {
+            return false;
+        }
+        // A repeated request gets the same reply and keeps the key
+        if (!has_peer_nonce || memcmp(nonce, peer_nonce, sizeof(peer_nonce)) != 0) {
+            memcpy(peer_nonce, nonce, sizeof(peer_nonce));
+            has_peer_nonce = true;
+            session.newLocalNonce();
+            flush();  // Still sealed with the key the handheld has
+            session.installTrafficKey(nonce, session.getLocalNonce());
+        }
+        sendResume(true, nonce);
+        return true;
     }
     
-    if (!peer_added) {
-        LOG_DEBUG("ESPNow", "Adding peer before sending message");
-        if (addPeer() != HAL_OK) {
-            LOG_ERROR("ESPNow", "Failed to add peer for sending");
-            return HAL_ERROR;
+    if (!msg->isResumeReply()) {
+        // The base lost the link; even if we didn't, its reply brings a new key
+        if (current_state == State::PAIRED) {
+            session.newLocalNonce();
         }
+        sendResume(false);
+        return false;
     }
-    
-    LOG_DEBUG("ESPNow", "Sending message type %d to %02X:%02X:%02X:%02X:%02X:%02X",
-              msg.type, peer_mac_address[0], peer_mac_address[1], peer_mac_address[2],
-              peer_mac_address[3], peer_mac_address[4], peer_mac_address[5]);
-    
-    esp_err_t result = esp_now_send(peer_mac_address, (uint8_t*)&msg, sizeof(ESPNowMessage));
-    if (result == ESP_OK) {
-        stats.messages_sent++;
-        return HAL_OK;
+    if (memcmp(msg->getResumeEcho(), session.getLocalNonce(), ESPNowSession::NONCE_SIZE) != 0) {
+        return false;  // Answers an earlier request
     }
-    
-    LOG_ERROR("ESPNow", "Send failed with error: %d", result);
-    return HAL_ERROR;
+    session.installTrafficKey(session.getLocalNonce(), nonce);
+    return true;
 }
 
-hal_status_t ESPNowManager::sendAnnounce() {
-    ESPNowMessage msg;
-    msg.type = ESPNowConfig::MSG_ANNOUNCE;
-    msg.role = device_role;
-    msg.sequence = message_sequence++;
-    msg.timestamp = millis();
-    msg.updateCRC();
-    
-    uint8_t broadcast_mac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-    esp_now_peer_info_t peer_info = {};
-    memcpy(peer_info.peer_addr, broadcast_mac, 6);
-    peer_info.channel = ESPNowConfig::CHANNEL;
-    peer_info.encrypt = false;
-    
-    if (!esp_now_is_peer_exist(broadcast_mac)) {
-        esp_now_add_peer(&peer_info);
-    }
-    
-    esp_err_t result = esp_now_send(broadcast_mac, (uint8_t*)&msg, sizeof(ESPNowMessage));
-    
-    if (!esp_now_is_peer_exist(broadcast_mac)) {
-        esp_now_del_peer(broadcast_mac);
+bool ESPNowManager::isChannelPlanner() const {
+    return ESPNowGlobalConfig::ENABLE_CHANNEL_AGILITY && device_role == ESPNowConfig::ROLE_BASE_STATION;
+}
+
+void ESPNowManager::resetChannel() {
+    channel_survey.cancel();
+    channel_survey.clearDegraded();
+    channel_plan = ChannelPlan::NONE;
+    channel_plan_id = 0;
+    channel_confirming = false;
+    channel_surveyed = false;
+    channel_hold_until = millis();
+    channel_next_survey = channel_hold_until;
+    survey_slot = -1;
+    
+    if (link_channel != ESPNowConfig::CHANNEL) {
+        LOG_INFO("ESPNow", "Back on home channel %u", ESPNowConfig::CHANNEL);
     }
-    
-    return (result == ESP_OK) ? HAL_OK : HAL_ERROR;
+    link_channel = ESPNowConfig::CHANNEL;
+    stats.channel = link_channel;
+    tuneRadio(link_channel);
 }
 
-hal_status_t ESPNowManager::sendPairRequest() {
-    ESPNowMessage msg;
-    msg.type = ESPNowConfig::MSG_PAIR_REQUEST;
-    msg.role = device_role;
-    msg.sequence = message_sequence++;
-    msg.timestamp = millis();
-    msg.updateCRC();
-    
-    return sendMessage(msg);
+void ESPNowManager::tuneRadio(uint8_t channel) {
+    if (is_initialized && transport->getChannel() != channel) {
+        transport->setChannel(channel);
+    }
 }
 
-hal_status_t ESPNowManager::sendPairResponse() {
-    ESPNowMessage msg;
-    msg.type = ESPNowConfig::MSG_PAIR_RESPONSE;
-    msg.role = device_role;
-    msg.sequence = message_sequence++;
-    msg.timestamp = millis();
-    msg.updateCRC();
-    
-    return sendMessage(msg);
+hal_status_t ESPNowManager::startChannelSurvey() {
+    if (!isChannelPlanner() || peers.count() > 1) {
+        return HAL_NOT_SUPPORTED;
+    }
+    if (current_state != State::PAIRED) {
+        return HAL_ERROR;
+    }
+    if (isChannelPlanPending()) {
+        return HAL_BUSY;
+    }
+    announceChannelPlan(ChannelPlan::SURVEY, link_channel, millis());
+    return HAL_OK;
 }
 
-hal_status_t ESPNowManager::sendPing() {
-    ESPNowMessage msg;
-    msg.type = ESPNowConfig::MSG_PING;
-    msg.role = device_role;
-    msg.sequence = message_sequence++;
-    msg.timestamp = millis();
-    msg.setPingData(ping_counter++);
-    
-    stats.ping_count++;
-    stats.last_ping_time = millis();
-    
-    return sendMessage(msg);
+hal_status_t ESPNowManager::moveToChannel(uint8_t channel) {
+    if (!ESPNowChannelSurvey::isValidChannel(channel)) {
+        return HAL_INVALID_PARAM;
+    }
+    if (!isChannelPlanner() || peers.count() > 1) {
+        return HAL_NOT_SUPPORTED;
+    }
+    if (current_state != State::PAIRED) {
+        return HAL_ERROR;
+    }
+    if (isChannelPlanPending()) {
+        return HAL_BUSY;
+    }
+    if (channel != link_channel) {
+        announceChannelPlan(ChannelPlan::MOVE, channel, millis());
+    }
+    return HAL_OK;
 }
 
-hal_status_t ESPNowManager::sendPong(uint32_t counter) {
-    ESPNowMessage msg;
-    msg.type = ESPNowConfig::MSG_PONG;
-    msg.role = device_role;
-    msg.sequence = message_sequence++;
-    msg.timestamp = millis();
-    msg.setPongData(counter);
-    
-    stats.pong_count++;
-    stats.last_pong_time = millis();
+void ESPNowManager::announceChannelPlan(ChannelPlan plan, uint8_t channel, uint32_t now) {
+    channel_plan = plan;
+    channel_plan_id = (channel_plan_id == UINT8_MAX) ? 1 : channel_plan_id + 1;
+    channel_plan_start = now + ESPNowGlobalConfig::CHANNEL_PLAN_LEAD_MS;
+    channel_target = channel;
+    channel_announcements = ESPNowGlobalConfig::CHANNEL_PLAN_REPEATS;
+    
+    if (plan == ChannelPlan::SURVEY) {
+        channel_survey.begin(channel_plan_start, link_channel, ESPNowGlobalConfig::CHANNEL_SURVEY_MASK,
+                             ESPNowGlobalConfig::CHANNEL_SURVEY_DWELL_MS);
+        survey_slot = -1;
+        survey_peer_probes = 0;
+        channel_surveyed = true;
+        stats.channel_surveys++;
+        LOG_INFO("ESPNow", "Channel survey of %u slots from channel %u",
+                 channel_survey.getSlotCount(), link_channel);
+    } else {
+        LOG_INFO("ESPNow", "Moving link from channel %u to %u", link_channel, channel);
+    }
     
-    return sendMessage(msg);
+    sendChannelPlan(now);
+    timers.arm(TIMER_CHANNEL, now + ESPNowGlobalConfig::CHANNEL_PLAN_LEAD_MS /
+                                    ESPNowGlobalConfig::CHANNEL_PLAN_REPEATS);
 }
 
-hal_status_t ESPNowManager::sendDisconnect() {
-    ESPNowMessage msg;
-    msg.type = ESPNowConfig::MSG_DISCONNECT;
-    msg.role = device_role;
-    msg.sequence = message_sequence++;
-    msg.timestamp = millis();
-    msg.updateCRC();
+hal_status_t ESPNowManager::sendChannelPlan(uint32_t now) {
+    uint32_t start_in = static_cast<int32_t>(channel_plan_start - now) > 0 ? channel_plan_start - now : 0;
     
+    ESPNowMessage msg;
+    if (channel_plan == ChannelPlan::SURVEY) {
+        msg.setChannelPlan(ESPNowConfig::CHANNEL_OP_SURVEY, channel_plan_id, link_channel,
+                           channel_survey.getDwellMs(), start_in, ESPNowGlobalConfig::CHANNEL_SURVEY_MASK);
+    } else {
+        msg.setChannelPlan(ESPNowConfig::CHANNEL_OP_MOVE, channel_plan_id, channel_target, 0, start_in, 0);
+    }
+    if (channel_announcements > 0) {
+        channel_announcements--;
+    }
     return sendMessage(msg);
 }
 
-hal_status_t ESPNowManager::disconnect() {
-    if (current_state != State::PAIRED && current_state != State::PAIRING) {
-        return HAL_OK;  // Already disconnected
+void ESPNowManager::acceptChannelPlan(const ESPNowMessage* msg, uint32_t now) {
+    if (!ESPNowGlobalConfig::ENABLE_CHANNEL_AGILITY || device_role != ESPNowConfig::ROLE_HANDHELD) {
+        return;
     }
     
-    LOG_INFO("ESPNow", "User-initiated disconnect");
+    // Later copies of a plan only correct its start until it begins
+    uint8_t plan_id = msg->getChannelPlanId();
+    bool started = channel_plan == ChannelPlan::NONE || static_cast<int32_t>(now - channel_plan_start) >= 0;
+    if (plan_id == channel_plan_id && started) {
+        return;
+    }
     
-    // Send disconnect message to peer if we're paired
-    if (current_state == State::PAIRED && peer_added) {
-        sendDisconnect();
-        delay(10);  // Give time for message to send
+    uint8_t op = msg->getChannelPlanOp();
+    uint8_t channel = msg->getChannelPlanChannel();
+    if (op == ESPNowConfig::CHANNEL_OP_SURVEY) {
+        // Surveyed from the channel the link is on, or not at all
+        if (channel != link_channel || msg->getChannelPlanDwell() == 0) {
+            LOG_WARNING("ESPNow", "Ignoring channel survey from channel %u, link is on %u", channel, link_channel);
+            return;
+        }
+    } else if (op != ESPNowConfig::CHANNEL_OP_MOVE || !ESPNowChannelSurvey::isValidChannel(channel)) {
+        LOG_WARNING("ESPNow", "Invalid channel plan %u (channel %u)", op, channel);
+        return;
     }
     
-    // Clean up and go back to searching
-    removePeer();
-    transitionToState(State::SEARCHING);
+    if (channel_plan == ChannelPlan::SURVEY && plan_id != channel_plan_id) {
+        // Replaced in the middle of a survey
+        channel_survey.cancel();
+        tuneRadio(link_channel);
+    }
     
-    return HAL_OK;
+    bool is_new = plan_id != channel_plan_id;
+    uint32_t start = now + msg->getChannelPlanStartIn();
+    channel_plan_id = plan_id;
+    channel_plan_start = start;
+    channel_announcements = 0;
+    channel_confirming = false;
+    
+    if (op == ESPNowConfig::CHANNEL_OP_SURVEY) {
+        channel_plan = ChannelPlan::SURVEY;
+        channel_survey.begin(start, link_channel, msg->getChannelPlanMask(), msg->getChannelPlanDwell());
+        if (is_new) {
+            survey_slot = -1;
+            survey_peer_probes = 0;
+            stats.channel_surveys++;
+        }
+    } else {
+        channel_plan = ChannelPlan::MOVE;
+        channel_target = channel;
+    }
+    timers.arm(TIMER_CHANNEL, start);
 }
 
-hal_status_t ESPNowManager::startConnection() {
-    if (!is_initialized) {
-        LOG_ERROR("ESPNow", "Cannot start connection - not initialized");
-        return HAL_ERROR;
+void ESPNowManager::countChannelProbe(const ESPNowMessage* msg) {
+    // A probe for another channel was sent before a hop and tells nothing
+    if (channel_plan != ChannelPlan::SURVEY || survey_slot < 0 ||
+        msg->getProbeChannel() != channel_survey.slotChannel(survey_slot)) {
+        return;
     }
-    
-    if (current_state != State::UNINITIALIZED) {
-        LOG_WARNING("ESPNow", "Connection already started (state: %s)", getStateString());
-        return HAL_OK;
+    if (survey_sample.probes_received < UINT8_MAX) {
+        survey_sample.probes_received++;
     }
-    
-    LOG_INFO("ESPNow", "Starting ESP-NOW connection search");
-    transitionToState(State::SEARCHING);
-    
-    return HAL_OK;
+    if (stats.rssi != 0 && survey_sample.rssi_count < UINT8_MAX) {
+        survey_sample.rssi_sum += stats.rssi;
+        survey_sample.rssi_count++;
+    }
+    survey_peer_probes++;
 }
 
-hal_status_t ESPNowManager::stopConnection() {
-    if (!is_initialized) {
-        return HAL_OK;
+void ESPNowManager::serviceChannel(uint32_t now) {
+    // Announced but not started: the base station repeats the announcement
+    if (channel_plan != ChannelPlan::NONE && static_cast<int32_t>(now - channel_plan_start) < 0) {
+        uint32_t next = channel_plan_start;
+        if (channel_announcements > 0) {
+            sendChannelPlan(now);
+            uint32_t repeat_at = now + ESPNowGlobalConfig::CHANNEL_PLAN_LEAD_MS /
+                                       ESPNowGlobalConfig::CHANNEL_PLAN_REPEATS;
+            if (channel_announcements > 0 && static_cast<int32_t>(repeat_at - next) < 0) {
+                next = repeat_at;
+            }
+        }
+        timers.arm(TIMER_CHANNEL, next);
+        return;
     }
     
-    LOG_INFO("ESPNow", "Stopping ESP-NOW connection");
-    
-    // Send disconnect if we're connected
-    if (current_state == State::PAIRED) {
-        sendDisconnect();
+    if (channel_plan == ChannelPlan::SURVEY) {
+        serviceSurvey(now);
+        return;
     }
     
-    // Clean up
-    removePeer();
-    
-    // Go back to uninitialized state (manual mode)
-    current_state = State::UNINITIALIZED;
-    state_machine.transitionTo(State::UNINITIALIZED);
+    if (channel_plan == ChannelPlan::MOVE) {
+        flush();  // Anything batched goes out where the peer still is
+        channel_plan = ChannelPlan::NONE;
+        channel_previous = link_channel;
+        link_channel = channel_target;
+        stats.channel = link_channel;
+        stats.channel_moves++;
+        tuneRadio(link_channel);
+        channel_confirming = true;
+        channel_moved_at = now;
+        timers.arm(TIMER_CHANNEL, now + ESPNowGlobalConfig::CHANNEL_CONFIRM_MS);
+        return;
+    }
     
-    LOG_INFO("ESPNow", "Connection stopped");
+    if (channel_confirming) {
+        channel_confirming = false;
+        if (static_cast<int32_t>(last_activity_time - channel_moved_at) > 0) {
+            LOG_INFO("ESPNow", "Link moved to channel %u", link_channel);
+        } else {
+            LOG_WARNING("ESPNow", "Peer not heard on channel %u, back to %u", link_channel, channel_previous);
+            if (isChannelPlanner()) {
+                // The peer may still hear this end: it is told to come back as well
+                ESPNowMessage msg;
+                channel_plan_id = (channel_plan_id == UINT8_MAX) ? 1 : channel_plan_id + 1;
+                msg.setChannelPlan(ESPNowConfig::CHANNEL_OP_MOVE, channel_plan_id, channel_previous, 0, 0, 0);
+                sendMessage(msg);
+                flush();
+            }
+            channel_survey.avoid(link_channel, now + ESPNowGlobalConfig::CHANNEL_HOLD_MS);
+            link_channel = channel_previous;
+            stats.channel = link_channel;
+            stats.channel_reverts++;
+            tuneRadio(link_channel);
+        }
+        channel_hold_until = now + ESPNowGlobalConfig::CHANNEL_HOLD_MS;
+        if (isChannelPlanner()) {
+            // Loss is measured afresh once the 1 s window no longer covers the move
+            channel_tx_frames = txFrameCount();
+            channel_tx_failed = tx_failed_count.load(std::memory_order_relaxed);
+            timers.arm(TIMER_CHANNEL, now + 1000);
+        }
+        return;
+    }
     
-    return HAL_OK;
+    if (isChannelPlanner()) {
+        checkChannelQuality(now);
+    }
 }
 
-hal_status_t ESPNowManager::processMessage(const uint8_t* sender_mac, const ESPNowMessage* msg) {
-    // Defensive checks
-    if (!msg || !sender_mac) {
-        LOG_ERROR("ESPNow", "Null pointer in processMessage");
+void ESPNowManager::serviceSurvey(uint32_t now) {
+    int16_t slot = channel_survey.slotAt(now);
+    if (slot != survey_slot) {
+        if (survey_slot >= 0) {
+            survey_sample.tx_frames = static_cast<uint16_t>(txFrameCount() - channel_tx_frames);
+            survey_sample.tx_failed = static_cast<uint16_t>(tx_failed_count.load(std::memory_order_relaxed) -
+                                                            channel_tx_failed);
+            channel_survey.recordSlot(survey_slot, survey_sample);
+        }
+        if (slot >= channel_survey.getSlotCount()) {
+            finishSurvey(now);
+            return;
+        }
+        
+        flush();
+        survey_slot = slot;
+        tuneRadio(channel_survey.slotChannel(slot));
+        memset(&survey_sample, 0, sizeof(survey_sample));
+        survey_sample.probes_expected = ESPNowGlobalConfig::CHANNEL_SURVEY_PROBES;
+        survey_probes_sent = 0;
+        channel_tx_frames = txFrameCount();
+        channel_tx_failed = tx_failed_count.load(std::memory_order_relaxed);
+    }
+    
+    // Probes are spread over the slot, clear of the hops at either end
+    uint32_t slot_start = channel_survey.slotStart(survey_slot);
+    uint32_t dwell = channel_survey.getDwellMs();
+    uint32_t guard = ESPNowGlobalConfig::CHANNEL_SURVEY_GUARD_MS;
+    uint32_t window = dwell > 2 * guard ? dwell - 2 * guard : 1;
+    uint32_t next = slot_start + dwell;
+    if (survey_probes_sent < ESPNowGlobalConfig::CHANNEL_SURVEY_PROBES) {
+        uint32_t due = slot_start + guard + survey_probes_sent * window / ESPNowGlobalConfig::CHANNEL_SURVEY_PROBES;
+        if (static_cast<int32_t>(now - due) >= 0) {
+            ESPNowMessage probe;
+            probe.setChannelProbe(channel_survey.slotChannel(survey_slot), survey_probes_sent);
+            sendMessage(probe);
+            survey_probes_sent++;
+            due = slot_start + guard + survey_probes_sent * window / ESPNowGlobalConfig::CHANNEL_SURVEY_PROBES;
+        }
+        if (survey_probes_sent < ESPNowGlobalConfig::CHANNEL_SURVEY_PROBES &&
+            static_cast<int32_t>(due - next) < 0) {
+            next = due;
+        }
+    }
+    timers.arm(TIMER_CHANNEL, next);
+}
+
+void ESPNowManager::finishSurvey(uint32_t now) {
+    flush();
+    tuneRadio(link_channel);
+    channel_plan = ChannelPlan::NONE;
+    survey_slot = -1;
+    
+    // Without a single probe from the peer it wasn't hopping along
+    bool took_part = survey_peer_probes > 0;
+    channel_survey.finish(took_part, now);
+    channel_survey.clearDegraded();
+    if (!took_part) {
+        LOG_WARNING("ESPNow", "Channel survey discarded, no probes from the peer");
+    }
+    if (!isChannelPlanner()) {
+        return;
+    }
+    
+    channel_hold_until = now + ESPNowGlobalConfig::CHANNEL_HOLD_MS;
+    channel_tx_frames = txFrameCount();
+    channel_tx_failed = tx_failed_count.load(std::memory_order_relaxed);
+    
+    uint8_t best = channel_survey.pickBest(link_channel, now);
+    if (took_part && best != link_channel) {
+        announceChannelPlan(ChannelPlan::MOVE, best, now);
+        return;
+    }
+    LOG_INFO("ESPNow", "Channel survey done, staying on channel %u", link_channel);
+    const ESPNowChannelSurvey::ChannelStats& current = channel_survey.get(link_channel);
+    if (took_part && current.samples > 0 && current.loss_pct > ESPNowGlobalConfig::CHANNEL_DEGRADED_LOSS_PCT) {
+        channel_next_survey = now + ESPNowGlobalConfig::CHANNEL_HOLD_MS;
+    }
+    timers.arm(TIMER_CHANNEL, now + 1000);  // Once the 1 s loss window has left the survey behind
+}
+
+void ESPNowManager::checkChannelQuality(uint32_t now) {
+    uint32_t next = now + ESPNowGlobalConfig::CHANNEL_CHECK_INTERVAL_MS;
+    
+    // Other peers stay on the home channel and wouldn't follow a move
+    if (peers.count() > 1) {
+        if (link_channel != ESPNowConfig::CHANNEL && channel_plan == ChannelPlan::NONE) {
+            LOG_INFO("ESPNow", "Other peers registered, returning to the home channel");
+            announceChannelPlan(ChannelPlan::MOVE, ESPNowConfig::CHANNEL, now);
+            return;
+        }
+        timers.arm(TIMER_CHANNEL, next);
+        return;
+    }
+    
+    // Loss both ways, weighed like a survey slot: sequence gaps in what the
+    // peer sent, and our frames its radio didn't acknowledge
+    uint32_t tx_frames = txFrameCount() - channel_tx_frames;
+    uint32_t tx_failed = tx_failed_count.load(std::memory_order_relaxed) - channel_tx_failed;
+    channel_tx_frames += tx_frames;
+    channel_tx_failed += tx_failed;
+    float loss_pct = measureLossRate1s();
+    if (tx_frames > 0) {
+        loss_pct = (loss_pct + 100.0f * (tx_failed < tx_frames ? tx_failed : tx_frames) / tx_frames) / 2.0f;
+    }
+    channel_survey.record(link_channel, loss_pct, stats.rssi, now);
+    bool degraded = channel_survey.checkDegraded(loss_pct, now);
+    
+    if (degraded && static_cast<int32_t>(now - channel_next_survey) >= 0) {
+        LOG_WARNING("ESPNow", "Channel %u degraded, %u%% loss", link_channel, static_cast<unsigned>(loss_pct));
+        announceChannelPlan(ChannelPlan::SURVEY, link_channel, now);
+        return;
+    }
+    if (static_cast<int32_t>(now - channel_hold_until) >= 0) {
+        // Once per pairing, unless earlier results are still fresh
+        if (!channel_surveyed && !channel_survey.hasFreshResults(now)) {
+            announceChannelPlan(ChannelPlan::SURVEY, link_channel, now);
+            return;
+        }
+        uint8_t best = channel_survey.pickBest(link_channel, now);
+        if (best != link_channel) {
+            announceChannelPlan(ChannelPlan::MOVE, best, now);
+            return;
+        }
+    }
+    timers.arm(TIMER_CHANNEL, next);
+}
+
+hal_status_t ESPNowManager::handleError(uint32_t) {
+    if (timers.expire(TIMER_STATE_TIMEOUT, millis())) {
+        applyState(State::SEARCHING);
+    }
+    return HAL_OK;
+}
+
+hal_status_t ESPNowManager::sendMessage(const ESPNowMessage& msg) {
+    if (isAppCaller()) {
+        return postRequest(LinkRequestType::SEND_MESSAGE, &msg);
+    }
+    
+    ESPNowMessage stamped;
+    hal_status_t status = prepareMessage(msg, stamped);
+    if (status != HAL_OK) {
+        return status;
+    }
+    return routeMessage(stamped, 0);
+}
+
+hal_status_t ESPNowManager::sendReliable(const ESPNowMessage& msg) {
+    if (isAppCaller()) {
+        return postRequest(LinkRequestType::SEND_RELIABLE, &msg);
+    }
+    
+    if (!ESPNowGlobalConfig::ENABLE_RELIABLE_LANE || ESPNowGlobalConfig::USE_LEGACY_WIRE_FORMAT) {
+        return sendMessage(msg);  // Legacy frames have no room for the reliable flag
+    }
+    
+    if (reliable_tx.getInFlight() >= ESPNowReliable::Sender::SLOT_COUNT) {
+        LOG_WARNING("ESPNow", "Reliable lane full, message type %d not sent", msg.type);
+        return HAL_BUSY;
+    }
+    
+    ESPNowMessage stamped;
+    hal_status_t status = prepareMessage(msg, stamped);
+    if (status != HAL_OK) {
+        return status;
+    }
+    
+    // Tracked even if this first send fails; the retransmit timer covers it
+    reliable_tx.track(stamped, millis());
+    routeMessage(stamped, ESPNowWire::RECORD_FLAG_RELIABLE);
+    return HAL_OK;
+}
+
+hal_status_t ESPNowManager::sendCommand(ESPNowConfig::CommandId command, uint8_t argument) {
+    ESPNowMessage msg;
+    msg.setCommand(command, argument);
+    return sendReliable(msg);
+}
+
+hal_status_t ESPNowManager::prepareMessage(const ESPNowMessage& msg, ESPNowMessage& stamped) {
+    // Defensive checks
+    if (!is_initialized) {
+        LOG_ERROR("ESPNow", "Cannot send message - not initialized");
         return HAL_ERROR;
     }
     
-    if (!msg->isValid()) {
-        LOG_WARNING("ESPNow", "Invalid message received (magic=%02X, CRC check failed)", msg->magic);
-        stats.messages_received++;  // Count as received but invalid
+    // Allow sending in SEARCHING state for pairing messages
+    bool is_pairing_msg = (msg.type == ESPNowConfig::MSG_PAIR_REQUEST || 
+                          msg.type == ESPNowConfig::MSG_PAIR_RESPONSE ||
+                          msg.type == ESPNowConfig::MSG_ANNOUNCE ||
+                          msg.type == ESPNowConfig::MSG_RESUME);
+    
+    if (!is_pairing_msg && current_state != State::PAIRED && current_state != State::PAIRING) {
+        LOG_WARNING("ESPNow", "Cannot send message in state %s", getStateString());
         return HAL_ERROR;
     }
     
+    if (!peer_added) {
+        LOG_DEBUG("ESPNow", "Adding peer before sending message");
+        if (addPeer() != HAL_OK) {
+            LOG_ERROR("ESPNow", "Failed to add peer for sending");
+            return HAL_ERROR;
+        }
+    }
+    
+    LOG_DEBUG("ESPNow", "Sending message type %d to %02X:%02X:%02X:%02X:%02X:%02X",
+              msg.type, peer_mac_address[0], peer_mac_address[1], peer_mac_address[2],
+              peer_mac_address[3], peer_mac_address[4], peer_mac_address[5]);
+    
+    // Every message sent to the peer gets the next sequence number; the
+    // receiver uses it for loss and duplicate tracking
+    stamped = msg;
+    stamped.role = device_role;
+    stamped.sequence = primary().tx_sequence++;
+    if (stamped.timestamp == 0) {
+        stamped.timestamp = millis();
+    }
+    if (ESPNowGlobalConfig::USE_LEGACY_WIRE_FORMAT) {
+        stamped.updateCRC();
+    }
+    primary().stats.messages_sent++;
+    return HAL_OK;
+}
+
+hal_status_t ESPNowManager::routeMessage(const ESPNowMessage& msg, uint8_t record_flags) {
+    // Timing probes skip the batch so coalescing delay doesn't skew latency;
+    // anything already batched goes first to keep the delta timestamps in order
+    bool is_timing_msg = (msg.type == ESPNowConfig::MSG_PING || msg.type == ESPNowConfig::MSG_PONG);
+    // With encryption on, handshake messages go out alone and unsealed
+    bool send_clear = session.isEnabled() && ESPNowConfig::isHandshakeMessage(msg.type);
+    
+    if (coalescing_enabled && !is_timing_msg && !send_clear) {
+        return queueForBatch(msg, record_flags);
+    }
+    
+    if (coalescing_enabled) {
+        flush();
+    }
+    
+    return transmitFrame(peer_mac_address, msg, primary().tx_wire, record_flags, !send_clear);
+}
+
+hal_status_t ESPNowManager::queueForBatch(const ESPNowMessage& msg, uint8_t record_flags) {
+    if (!tx_batch.isEmpty() && !tx_batch.fits(msg)) {
+        flush();
+    }
+    
+    if (tx_batch.isEmpty()) {
+        tx_batch.begin(tx_batch_buffer, frameCapacity(), device_role);
+        tx_batch_start_us = micros();
+    }
+    
+    if (!tx_batch.append(msg, primary().tx_wire, record_flags)) {
+        LOG_ERROR("ESPNow", "Failed to encode message type %d", msg.type);
+        return HAL_ERROR;
+    }
+    stats.messages_sent++;
+    
+    if (tx_batch.getLength() >= ESPNowGlobalConfig::TX_COALESCE_FLUSH_BYTES ||
+        micros() - tx_batch_start_us >= ESPNowGlobalConfig::TX_COALESCE_DEADLINE_US) {
+        return flush();
+    }
+    
+    return HAL_OK;
+}
+
+hal_status_t ESPNowManager::flush() {
+    // The link task flushes at the end of every update
+    if (tx_batch.isEmpty() || isAppCaller()) {
+        return HAL_OK;
+    }
+    
+    piggybackLinkRecords();
+    size_t frame_len = tx_batch.finish();
+    // Start a fresh batch whatever the outcome
+    tx_batch.begin(tx_batch_buffer, frameCapacity(), device_role);
+    
+    if (frame_len == 0) {
+        return HAL_ERROR;
+    }
+    return transmitRaw(peer_mac_address, tx_batch_buffer, frame_len);
+}
+
+void ESPNowManager::setCoalescing(bool enabled) {
+    if (isAppCaller()) {
+        postRequest(LinkRequestType::SET_COALESCING, nullptr, INVALID_PEER, enabled ? 1 : 0);
+        return;
+    }
+    if (!enabled) {
+        flush();
+    }
+    coalescing_enabled = enabled && !ESPNowGlobalConfig::USE_LEGACY_WIRE_FORMAT;
+}
+
+hal_status_t ESPNowManager::transmitFrame(const uint8_t* mac, const ESPNowMessage& msg,
+                                          ESPNowWire::EncoderState& wire_state, uint8_t record_flags,
+                                          bool seal) {
+    hal_status_t result;
+    
+    if (ESPNowGlobalConfig::USE_LEGACY_WIRE_FORMAT) {
+        result = transmitRaw(mac, reinterpret_cast<const uint8_t*>(&msg), sizeof(ESPNowMessage));
+    } else {
+        uint8_t frame[ESPNowWire::MAX_FRAME_SIZE];
+        size_t frame_len = ESPNowWire::encode(msg, wire_state, frame, frameCapacity(), 0, record_flags);
+        if (frame_len == 0) {
+            LOG_ERROR("ESPNow", "Failed to encode message type %d", msg.type);
+            return HAL_ERROR;
+        }
+        result = transmitRaw(mac, frame, frame_len, seal);
+    }
+    
+    if (result == HAL_OK) {
+        stats.messages_sent++;
+    }
+    return result;
+}
+
+hal_status_t ESPNowManager::transmitRaw(const uint8_t* mac, const uint8_t* frame, size_t len, bool seal) {
+    bool to_peer = isMacEqual(mac, peer_mac_address);
+    
+    // Nothing but the handshake reaches the peer unencrypted, even before the keys exist
+    uint8_t sealed[ESPNowWire::MAX_FRAME_SIZE];
+    if (seal && to_peer && session.isEnabled()) {
+        len = session.seal(frame, len, sealed, sizeof(sealed));
+        if (len == 0) {
+            return HAL_ERROR;
+        }
+        frame = sealed;
+    }
+    
+    if (transport->send(mac, frame, len) != HAL_OK) {
+        return HAL_ERROR;
+    }
+    
+    stats.frames_sent++;
+    stats.bytes_sent += len;
+    if (to_peer) {
+        last_tx_time = millis();
+    }
+    return HAL_OK;
+}
+
+size_t ESPNowManager::frameCapacity() const {
+    return ESPNowWire::MAX_FRAME_SIZE - (session.isEnabled() ? ESPNowSession::OVERHEAD : 0);
+}
+
+hal_status_t ESPNowManager::sendAnnounce() {
+    ESPNowMessage msg;
+    msg.type = ESPNowConfig::MSG_ANNOUNCE;
+    msg.role = device_role;
+    msg.sequence = primary().tx_sequence++;
+    msg.timestamp = millis();
+    msg.updateCRC();
+    
+    uint8_t broadcast_mac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    if (!transport->hasPeer(broadcast_mac)) {
+        transport->addPeer(broadcast_mac, ESPNowConfig::PEER_CHANNEL_CURRENT);
+    }
+    
+    // Broadcasts always carry an absolute timestamp
+    ESPNowWire::EncoderState broadcast_wire;
+    ESPNowWire::resetEncoder(broadcast_wire);
+    hal_status_t result = transmitFrame(broadcast_mac, msg, broadcast_wire);
+    
+    if (!transport->hasPeer(broadcast_mac)) {
+        transport->removePeer(broadcast_mac);
+    }
+    
+    return result;
+}
+
+hal_status_t ESPNowManager::sendPairRequest() {
+    ESPNowMessage msg;
+    msg.role = device_role;
+    msg.timestamp = millis();
+    if (session.isEnabled()) {
+        msg.setPairRequest(session.getLocalNonce());
+        ESPNowSession::sign(msg, session.getPairingKey());
+    } else {
+        msg.setPairRequest();
+    }
+    
+    return sendMessage(msg);
+}
+
+hal_status_t ESPNowManager::sendPairResponse() {
+    // Every pairing starts a new session
+    do {
+        session_id = Platform::randomU32();
+    } while (session_id == 0);
+    
+    ESPNowMessage msg;
+    msg.role = device_role;
+    msg.timestamp = millis();
+    if (session.isEnabled()) {
+        // Keyed by the master key the handheld derives from it
+        msg.setPairResponse(session_id, session.getLocalNonce());
+        ESPNowSession::sign(msg, session.getMasterKey());
+    } else {
+        msg.setPairResponse(session_id);
+    }
+    
+    return sendMessage(msg);
+}
+
+hal_status_t ESPNowManager::sendResume(bool reply, const uint8_t* echo) {
+    ESPNowMessage msg;
+    msg.role = device_role;
+    msg.timestamp = millis();
+    if (session.isEnabled()) {
+        msg.setResume(session_id, reply, session.getLocalNonce(), echo);
+        ESPNowSession::sign(msg, session.getMasterKey());
+    } else {
+        msg.setResume(session_id, reply);
+    }
+    
+    return sendMessage(msg);
+}
+
+hal_status_t ESPNowManager::sendPing() {
+    ESPNowMessage msg;
+    msg.type = ESPNowConfig::MSG_PING;
+    msg.role = device_role;
+    msg.timestamp = millis();
+    uint32_t counter = ping_counter++;
+    msg.setPingData(counter);
+    
+    recordPing(counter);
+    return sendMessage(msg);
+}
+
+hal_status_t ESPNowManager::sendKeepalive() {
+    ESPNowMessage msg;
+    msg.type = ESPNowConfig::MSG_KEEPALIVE;
+    msg.role = device_role;
+    msg.timestamp = millis();
+    return sendMessage(msg);
+}
+
+void ESPNowManager::recordPing(uint32_t counter) {
+    stats.ping_count++;
+    stats.last_ping_time = millis();
+    
+    PingRecord& record = ping_history[counter % ESPNowGlobalConfig::PING_HISTORY_SIZE];
+    record.counter = counter;
+    record.pending = true;
+    record.send_us = micros();
+}
+
+uint32_t ESPNowManager::nextKeepaliveTime() const {
+    // Idle keepalive, or an overdue RTT probe when no data frame carried one
+    uint32_t idle_at = last_tx_time + ESPNowGlobalConfig::KEEPALIVE_IDLE_MS;
+    uint32_t probe_at = stats.last_ping_time + 2 * ESPNowGlobalConfig::RTT_PROBE_INTERVAL_MS;
+    return (static_cast<int32_t>(probe_at - idle_at) < 0) ? probe_at : idle_at;
+}
+
+void ESPNowManager::piggybackLinkRecords() {
+    // Stamped just before the frame leaves, so the echoed times stay exact
+    if (!ESPNowGlobalConfig::ENABLE_ADAPTIVE_KEEPALIVE || current_state != State::PAIRED) {
+        return;
+    }
+    uint32_t now = millis();
+    
+    if (pending_pong.valid) {
+        ESPNowMessage pong;
+        pong.role = device_role;
+        pong.timestamp = now;
+        pong.setPongData(pending_pong.counter, pending_pong.rx_us, micros());
+        if (appendToBatch(pong)) {
+            pending_pong.valid = false;
+            stats.pong_count++;
+            stats.last_pong_time = now;
+            stats.link_records_piggybacked++;
+        }
+    }
+    
+    if (now - stats.last_ping_time >= ESPNowGlobalConfig::RTT_PROBE_INTERVAL_MS) {
+        ESPNowMessage ping;
+        ping.role = device_role;
+        ping.timestamp = now;
+        ping.setPingData(ping_counter);
+        if (appendToBatch(ping)) {
+            recordPing(ping_counter++);
+            stats.link_records_piggybacked++;
+        }
+    }
+}
+
+bool ESPNowManager::appendToBatch(const ESPNowMessage& msg) {
+    // Size check first: a sequence number taken and not sent would count as a loss
+    ESPNowMessage stamped = msg;
+    stamped.sequence = primary().tx_sequence;
+    if (tx_batch.isEmpty() || !tx_batch.fits(stamped) || prepareMessage(msg, stamped) != HAL_OK) {
+        return false;
+    }
+    if (!tx_batch.append(stamped, primary().tx_wire)) {
+        return false;
+    }
+    stats.messages_sent++;
+    return true;
+}
+
+hal_status_t ESPNowManager::sendPong(uint32_t counter, uint32_t ping_rx_us) {
+    ESPNowMessage msg;
+    msg.type = ESPNowConfig::MSG_PONG;
+    msg.role = device_role;
+    msg.timestamp = millis();
+    msg.setPongData(counter, ping_rx_us, micros());
+    
+    stats.pong_count++;
+    stats.last_pong_time = millis();
+    
+    return sendMessage(msg);
+}
+
+hal_status_t ESPNowManager::sendDisconnect() {
+    ESPNowMessage msg;
+    msg.type = ESPNowConfig::MSG_DISCONNECT;
+    msg.role = device_role;
+    msg.timestamp = millis();
+    msg.updateCRC();
+    
+    // Reliable, so a lost disconnect doesn't leave the peer waiting for a timeout
+    hal_status_t status = sendReliable(msg);
+    // Usually followed by peer removal, so don't leave it batched
+    flush();
+    return status;
+}
+
+hal_status_t ESPNowManager::disconnect() {
+    if (isAppCaller()) {
+        return postRequest(LinkRequestType::DISCONNECT);
+    }
+    
+    if (current_state != State::PAIRED && current_state != State::PAIRING) {
+        return HAL_OK;  // Already disconnected
+    }
+    
+    LOG_INFO("ESPNow", "User-initiated disconnect");
+    link_lost = false;
+    session_id = 0;
+    
+    // Send disconnect message to peer if we're paired
+    if (current_state == State::PAIRED && peer_added) {
+        sendDisconnect();
+    }
+    
+    // Clean up and go back to searching. The radio peer stays until the
+    // disconnect is acknowledged or given up on (serviceReliable()).
+    removePeer();
+    transitionToState(State::SEARCHING);
+    
+    return HAL_OK;
+}
+
+hal_status_t ESPNowManager::startConnection() {
+    if (!is_initialized) {
+        LOG_ERROR("ESPNow", "Cannot start connection - not initialized");
+        return HAL_ERROR;
+    }
+    
+    if (isAppCaller()) {
+        return postRequest(LinkRequestType::START_CONNECTION);
+    }
+    
+    if (current_state != State::UNINITIALIZED) {
+        LOG_WARNING("ESPNow", "Connection already started (state: %s)", getStateString());
+        return HAL_OK;
+    }
+    
+    LOG_INFO("ESPNow", "Starting ESP-NOW connection search");
+    transitionToState(State::SEARCHING);
+    
+    return HAL_OK;
+}
+
+hal_status_t ESPNowManager::stopConnection() {
+    if (!is_initialized) {
+        return HAL_OK;
+    }
+    if (isAppCaller()) {
+        return postRequest(LinkRequestType::STOP_CONNECTION);
+    }
+    
+    LOG_INFO("ESPNow", "Stopping ESP-NOW connection");
+    link_lost = false;
+    session_id = 0;
+    
+    // Send disconnect if we're connected
+    if (current_state == State::PAIRED) {
+        sendDisconnect();
+    }
+    
+    // Clean up
+    removePeer();
+    
+    // Go back to uninitialized state (manual mode)
+    applyState(State::UNINITIALIZED);
+    
+    LOG_INFO("ESPNow", "Connection stopped");
+    
+    return HAL_OK;
+}
+
+hal_status_t ESPNowManager::processMessage(const uint8_t* sender_mac, const ESPNowMessage* msg,
+                                           uint32_t rx_time_us, bool reliable) {
+    // Defensive checks
+    if (!msg || !sender_mac) {
+        LOG_ERROR("ESPNow", "Null pointer in processMessage");
+        return HAL_ERROR;
+    }
+    
+    // Frames were validated by the wire decoder before being queued
     last_activity_time = millis();
     stats.messages_received++;
     
+    if (reliable) {
+        // Always acknowledge, even a retransmission whose first ACK was lost;
+        // queued before handling because a disconnect removes the peer
+        bool is_new = primary().reliable_rx.accept(msg->sequence);
+        sendAck(primary_peer);
+        if (!is_new) {
+            return HAL_OK;
+        }
+    }
+    
     switch (msg->type) {
         case ESPNowConfig::MSG_ANNOUNCE:
             if (current_state == State::SEARCHING && isMacEqual(sender_mac, peer_mac_address)) {
@@ -504,14 +1413,32 @@ hal_status_t ESPNowManager::processMessage(const uint8_t* sender_mac, const ESPN
             break;
             
         case ESPNowConfig::MSG_PAIR_REQUEST:
-            // Base station receives pair request while SEARCHING
+            // Base station receives pair request while SEARCHING, or from a
+            // handheld that dropped the link while the base was reconnecting
             if (device_role == ESPNowConfig::ROLE_BASE_STATION) {
-                if (current_state == State::SEARCHING && isMacEqual(sender_mac, peer_mac_address)) {
+                if ((current_state == State::SEARCHING || current_state == State::RECONNECTING) &&
+                    isMacEqual(sender_mac, peer_mac_address)) {
+                    if (session.isEnabled() && !ESPNowSession::verify(*msg, session.getPairingKey())) {
+                        LOG_WARNING("ESPNow", "Pair request failed authentication");
+                        session.recordAuthFailure();
+                        break;
+                    }
                     LOG_INFO("ESPNow", "Base station received pair request from %02X:%02X:%02X:%02X:%02X:%02X",
                              sender_mac[0], sender_mac[1], sender_mac[2],
                              sender_mac[3], sender_mac[4], sender_mac[5]);
                     if (addPeer() == HAL_OK) {
                         LOG_INFO("ESPNow", "Base station sending pair response and transitioning to PAIRED");
+                        if (session.isEnabled()) {
+                            // The one key exchange: a new master key from both nonces,
+                            // and the first traffic key from that
+                            uint8_t master[ESPNowSession::KEY_SIZE];
+                            session.newLocalNonce();
+                            session.deriveMasterKey(msg->getHandshakeNonce(), session.getLocalNonce(), master);
+                            session.setMasterKey(master);
+                            ESPNowCrypto::wipe(master, sizeof(master));
+                            session.installTrafficKey(msg->getHandshakeNonce(), session.getLocalNonce());
+                            has_peer_nonce = false;
+                        }
                         sendPairResponse();
                         transitionToState(State::PAIRED);
                         // Send immediate ping to confirm
@@ -522,9 +1449,27 @@ hal_status_t ESPNowManager::processMessage(const uint8_t* sender_mac, const ESPN
             break;
             
         case ESPNowConfig::MSG_PAIR_RESPONSE:
-            if (device_role == ESPNowConfig::ROLE_HANDHELD && current_state == State::PAIRING) {
+            // Also while reconnecting without a session; the base answers those pair requests too
+            if (device_role == ESPNowConfig::ROLE_HANDHELD &&
+                (current_state == State::PAIRING || current_state == State::RECONNECTING)) {
                 if (isMacEqual(sender_mac, peer_mac_address)) {
+                    if (session.isEnabled()) {
+                        uint8_t master[ESPNowSession::KEY_SIZE];
+                        session.deriveMasterKey(session.getLocalNonce(), msg->getHandshakeNonce(), master);
+                        bool valid = ESPNowSession::verify(*msg, master);
+                        if (valid) {
+                            session.setMasterKey(master);
+                            session.installTrafficKey(session.getLocalNonce(), msg->getHandshakeNonce());
+                        }
+                        ESPNowCrypto::wipe(master, sizeof(master));
+                        if (!valid) {
+                            LOG_WARNING("ESPNow", "Pair response failed authentication");
+                            session.recordAuthFailure();
+                            break;
+                        }
+                    }
                     LOG_INFO("ESPNow", "Handheld received pair response from base, connection established");
+                    session_id = msg->getSessionId();  // 0 from a base without fast reconnect
                     transitionToState(State::PAIRED);
                 }
             }
@@ -533,55 +1478,115 @@ hal_status_t ESPNowManager::processMessage(const uint8_t* sender_mac, const ESPN
         case ESPNowConfig::MSG_PING:
             if (current_state == State::PAIRED) {
                 uint32_t counter = msg->getPingPongCounter();
-                sendPong(counter);
+                if (ESPNowGlobalConfig::ENABLE_ADAPTIVE_KEEPALIVE && ESPNowGlobalConfig::PONG_HOLD_MS > 0) {
+                    // Goes out with the next data frame, or alone once the hold expires
+                    pending_pong.counter = counter;
+                    pending_pong.rx_us = rx_time_us;
+                    pending_pong.valid = true;
+                    timers.arm(TIMER_PONG, millis() + ESPNowGlobalConfig::PONG_HOLD_MS);
+                } else {
+                    sendPong(counter, rx_time_us);
+                }
                 LOG_DEBUG("ESPNow", "Ping %u received, sending pong", counter);
             }
             break;
             
         case ESPNowConfig::MSG_PONG:
             if (current_state == State::PAIRED) {
-                uint32_t counter = msg->getPingPongCounter();
-                stats.latency_ms = millis() - stats.last_ping_time;
-                LOG_DEBUG("ESPNow", "Pong %u received, latency: %u ms", counter, stats.latency_ms);
+                handlePong(msg, rx_time_us);
+            }
+            break;
+            
+        case ESPNowConfig::MSG_RESUME:
+            // Only the cached session; after a manual stop the pilot reconnects
+            if (canResume() && msg->getSessionId() == session_id &&
+                current_state != State::UNINITIALIZED && isMacEqual(sender_mac, peer_mac_address)) {
+                if (session.isEnabled()) {
+                    if (!acceptSecureResume(msg)) {
+                        break;
+                    }
+                } else if (!msg->isResumeReply()) {
+                    sendResume(true);
+                }
+                if (current_state != State::PAIRED) {
+                    LOG_INFO("ESPNow", "Session resumed after %u attempts", reconnect_attempts);
+                    stats.fast_reconnects++;
+                    transitionToState(State::PAIRED);
+                }
             }
             break;
             
         case ESPNowConfig::MSG_DISCONNECT:
             if (isMacEqual(sender_mac, peer_mac_address)) {
                 LOG_INFO("ESPNow", "Disconnect received from peer");
+                session_id = 0;
                 removePeer();
                 transitionToState(State::SEARCHING);
             }
             break;
             
-        case ESPNowConfig::MSG_SCREEN_SYNC:
-            if (screen_sync_callback && current_state == State::PAIRED) {
-                screen_sync_callback(msg);
+        case ESPNowConfig::MSG_KEEPALIVE:
+            break;  // Only refreshes last_activity_time
+            
+        case ESPNowConfig::MSG_CHANNEL_PLAN:
+            if (current_state == State::PAIRED) {
+                acceptChannelPlan(msg, millis());
             }
             break;
             
-        case ESPNowConfig::MSG_BUTTON_DATA:
-            if (button_data_callback && current_state == State::PAIRED) {
-                button_data_callback(msg);
+        case ESPNowConfig::MSG_CHANNEL_PROBE:
+            if (current_state == State::PAIRED) {
+                countChannelProbe(msg);
             }
             break;
             
-        case ESPNowConfig::MSG_INPUT_EVENT:
-            if (input_event_callback && current_state == State::PAIRED) {
-                input_event_callback(msg);
-            }
+        case ESPNowConfig::MSG_ACK: {
+            uint32_t ack_sequence = 0;
+            uint32_t ack_bitmap = 0;
+            msg->getAck(ack_sequence, ack_bitmap);
+            reliable_tx.acknowledge(ack_sequence, ack_bitmap, &ESPNowManager::onReliableResolved, this);
             break;
+        }
             
         default:
-            LOG_WARNING("ESPNow", "Unknown message type: %d", msg->type);
+            // Application messages go to whoever registered for the type
+            if (!dispatch_table.has(msg->type)) {
+                LOG_WARNING("ESPNow", "Unhandled message type: %d", msg->type);
+            } else if (current_state == State::PAIRED) {
+                deliverCallback(CallbackKind::MESSAGE, msg, primary_peer);
+            }
             break;
     }
     
+    if (!link_alive && current_state == State::PAIRED) {
+        link_alive = true;
+        if (stats.link_failsafes > 0) {
+            LOG_INFO("ESPNow", "Link failsafe cleared");
+        }
+        timers.arm(TIMER_LINK_MISS, last_activity_time +
+                   ESPNowGlobalConfig::KEEPALIVE_IDLE_MS * ESPNowGlobalConfig::LINK_MISS_COUNT + 1);
+    }
+    
+    // Any traffic from the peer ends a reconnect. Encrypted, that means
+    // sealed traffic; the handshake messages above decide for themselves.
+    if (current_state == State::RECONNECTING &&
+        !(session.isEnabled() && ESPNowConfig::isHandshakeMessage(msg->type))) {
+        LOG_INFO("ESPNow", "Reconnection successful!");
+        transitionToState(State::PAIRED);
+    }
+    
     return HAL_OK;
 }
 
 hal_status_t ESPNowManager::addPeer() {
-    if (peer_added) return HAL_OK;
+    if (peer_added) {
+        if (peer_removal_pending) {
+            // New session before the old disconnect resolved; it must not reach the new one
+            peer_removal_pending = false;
+            reliable_tx.cancel(&ESPNowManager::onReliableResolved, this);
+        }
+        return HAL_OK;
+    }
     
     // Validate MAC address
     uint8_t zero_mac[6] = {0};
@@ -591,19 +1596,12 @@ hal_status_t ESPNowManager::addPeer() {
     }
     
     // Check if peer already exists
-    if (esp_now_is_peer_exist(peer_mac_address)) {
+    if (transport->hasPeer(peer_mac_address)) {
         peer_added = true;
         return HAL_OK;
     }
     
-    esp_now_peer_info_t peer_info = {};
-    memcpy(peer_info.peer_addr, peer_mac_address, 6);
-    peer_info.channel = ESPNowConfig::CHANNEL;
-    peer_info.encrypt = false;
-    
-    esp_err_t result = esp_now_add_peer(&peer_info);
-    if (result != ESP_OK) {
-        LOG_ERROR("ESPNow", "Failed to add peer: %d", result);
+    if (transport->addPeer(peer_mac_address, ESPNowConfig::PEER_CHANNEL_CURRENT) != HAL_OK) {
         return HAL_ERROR;
     }
     
@@ -615,8 +1613,20 @@ hal_status_t ESPNowManager::addPeer() {
 hal_status_t ESPNowManager::removePeer() {
     if (!peer_added) return HAL_OK;
     
-    esp_now_del_peer(peer_mac_address);
+    // Anything still batched (e.g. a disconnect) must leave before the peer goes
+    flush();
+    
+    // Reliable traffic belongs to this session, except a disconnect still waiting
+    // for its ACK; that keeps the radio peer until serviceReliable() resolves it
+    reliable_tx.cancel(&ESPNowManager::onReliableResolved, this, ESPNowConfig::MSG_DISCONNECT);
+    if (reliable_tx.hasInFlight()) {
+        peer_removal_pending = true;
+        return HAL_OK;
+    }
+    
+    transport->removePeer(peer_mac_address);
     peer_added = false;
+    peer_removal_pending = false;
     return HAL_OK;
 }
 
@@ -637,8 +1647,10 @@ void ESPNowManager::transitionToState(State new_state) {
     }
     
     const char* old_state = getStateString();
-    current_state = new_state;
     state_machine.transitionTo(new_state);
+    if (new_state != State::PAIRED) {
+        resetChannel();
+    }
     
     LOG_INFO("ESPNow", "[%s] State: %s -> %s", 
              (device_role == ESPNowConfig::ROLE_BASE_STATION) ? "BASE" : "HANDHELD",
@@ -646,29 +1658,109 @@ void ESPNowManager::transitionToState(State new_state) {
     
     if (new_state == State::SEARCHING) {
         removePeer();
-        state_timer = 0;
         last_activity_time = millis();
     } else if (new_state == State::PAIRING) {
-        state_timer = 0;
         last_activity_time = millis();
+        session.newLocalNonce();  // Every handshake gets its own
+    } else if (new_state == State::RECONNECTING) {
+        session.newLocalNonce();
     } else if (new_state == State::PAIRED) {
         ping_counter = 0;
+        pending_pong.valid = false;
+        link_alive = true;
         stats.ping_count = 0;
         stats.pong_count = 0;
+        resetLatencyStats();
+        primary().rx_reset.store(true, std::memory_order_release);
+        primary().reliable_rx.reset();
         last_activity_time = millis();
         connection_start_time = millis();
         LOG_INFO("ESPNow", "Connection established with peer!");
         
+        if (link_lost) {
+            // Outage as the pilot sees it: last traffic before the loss until paired again
+            link_lost = false;
+            stats.reconnects++;
+            stats.last_outage_ms = connection_start_time - link_lost_activity_time;
+            LOG_INFO("ESPNow", "Link recovered after %u ms", stats.last_outage_ms);
+        }
+        
         // Save the peer for future reconnection
         if (auto_reconnect) {
             savePeer();
         }
     }
     
-    state_timer = 0;
+    armStateTimers(new_state);
+    
+    if (need_mutex) {
+        xSemaphoreGive(state_mutex);
+    }
+}
+
+void ESPNowManager::applyState(State new_state) {
+    state_machine.transitionTo(new_state);
+    if (new_state != State::PAIRED) {
+        resetChannel();
+    }
+    armStateTimers(new_state);
+}
+
+void ESPNowManager::onStateChanged(State, State to) {
+    current_state = to;
+}
+
+void ESPNowManager::armStateTimers(State new_state) {
+    uint32_t now = millis();
+    timers.cancelAll();
     
-    if (need_mutex) {
-        xSemaphoreGive(state_mutex);
+    switch (new_state) {
+        case State::SEARCHING:
+            if (device_role == ESPNowConfig::ROLE_BASE_STATION) {
+                timers.arm(TIMER_ANNOUNCE, now);
+            } else {
+                timers.arm(TIMER_STATUS_LOG, now + 2000);
+            }
+            timers.arm(TIMER_STATE_TIMEOUT, now + ESPNowConfig::PAIRING_TIMEOUT_MS * 3);
+            break;
+            
+        case State::PAIRING:
+            timers.arm(TIMER_STATE_TIMEOUT, now + 3000);
+            if (device_role == ESPNowConfig::ROLE_HANDHELD) {
+                timers.arm(TIMER_STATUS_LOG, now + 1000);
+            }
+            break;
+            
+        case State::PAIRED:
+            if (ESPNowGlobalConfig::ENABLE_ADAPTIVE_KEEPALIVE) {
+                // Both ends keep the link busy enough for the miss count
+                timers.arm(TIMER_PING, now);
+                timers.arm(TIMER_LINK_MISS, last_activity_time +
+                           ESPNowGlobalConfig::KEEPALIVE_IDLE_MS * ESPNowGlobalConfig::LINK_MISS_COUNT + 1);
+            } else if (device_role == ESPNowConfig::ROLE_BASE_STATION) {
+                timers.arm(TIMER_PING, now + ESPNowConfig::PING_INTERVAL_MS);
+            }
+            timers.arm(TIMER_LINK_TIMEOUT, last_activity_time + ESPNowConfig::CONNECTION_TIMEOUT_MS + 1);
+            if (isChannelPlanner()) {
+                // First check surveys, or moves straight to a channel known to be better
+                channel_tx_frames = txFrameCount();
+                channel_tx_failed = tx_failed_count.load(std::memory_order_relaxed);
+                timers.arm(TIMER_CHANNEL, now + ESPNowGlobalConfig::CHANNEL_SURVEY_DELAY_MS);
+            }
+            break;
+            
+        case State::RECONNECTING:
+            reconnect_attempts = 0;
+            reconnect_start_time = now;
+            timers.arm(TIMER_RETRY, now);
+            break;
+            
+        case State::ERROR:
+            timers.arm(TIMER_STATE_TIMEOUT, now + 5000);
+            break;
+            
+        default:
+            break;  // UNINITIALIZED waits for startConnection()
     }
 }
 
@@ -692,44 +1784,25 @@ void ESPNowManager::getPeerMacAddress(uint8_t* mac) const {
     memcpy(mac, peer_mac_address, 6);
 }
 
-void ESPNowManager::onDataReceived(const uint8_t* mac_addr, const uint8_t* data, int len) {
-    // Safely access instance with mutex
-    if (xSemaphoreTake(instance_mutex, 0) != pdTRUE) {
-        // Can't wait in ISR context, drop message
+void ESPNowManager::onDataReceived(void* context, const uint8_t* mac_addr, const uint8_t* data, int len,
+                                   int8_t rssi) {
+    if (!context || !data || len <= 0) {
         return;
     }
     
-    if (!instance || len != sizeof(ESPNowMessage)) {
-        xSemaphoreGive(instance_mutex);
-        return;
-    }
-    
-    const ESPNowMessage* msg = reinterpret_cast<const ESPNowMessage*>(data);
-    
-    // Queue message for processing in main context
-    instance->queueMessage(mac_addr, msg);
-    
-    xSemaphoreGive(instance_mutex);
+    // Decode and queue for processing in main context
+    static_cast<ESPNowManager*>(context)->receiveFrame(mac_addr, data, len, rssi);
 }
 
-void ESPNowManager::onDataSent(const uint8_t* mac_addr, esp_now_send_status_t status) {
-    // Safely access instance with mutex
-    if (xSemaphoreTake(instance_mutex, 0) != pdTRUE) {
-        return;
-    }
-    
-    if (!instance) {
-        xSemaphoreGive(instance_mutex);
+void ESPNowManager::onDataSent(void* context, const uint8_t* mac_addr, bool delivered) {
+    if (!context || delivered) {
         return;
     }
     
-    if (status != ESP_NOW_SEND_SUCCESS) {
-        LOG_WARNING("ESPNow", "Send failed to %02X:%02X:%02X:%02X:%02X:%02X",
-                    mac_addr[0], mac_addr[1], mac_addr[2],
-                    mac_addr[3], mac_addr[4], mac_addr[5]);
-    }
-    
-    xSemaphoreGive(instance_mutex);
+    static_cast<ESPNowManager*>(context)->tx_failed_count.fetch_add(1, std::memory_order_relaxed);
+    LOG_WARNING("ESPNow", "Send failed to %02X:%02X:%02X:%02X:%02X:%02X",
+                mac_addr[0], mac_addr[1], mac_addr[2],
+                mac_addr[3], mac_addr[4], mac_addr[5]);
 }
 
 bool ESPNowManager::loadSavedPeer() {
@@ -760,11 +1833,37 @@ void ESPNowManager::savePeer() {
     preferences.putBool("has_saved", true);
     preferences.putBytes("peer_mac", peer_mac_address, 6);
     preferences.putBool("auto_reconnect", auto_reconnect);
+    preferences.putUInt("session_id", session_id);
+    if (session.hasMasterKey()) {
+        preferences.putBytes("session_key", session.getMasterKey(), ESPNowSession::KEY_SIZE);
+    }
     preferences.end();
     
     LOG_INFO("ESPNow", "Saved peer MAC to preferences");
 }
 
+void ESPNowManager::loadSavedSession() {
+    preferences.begin("espnow", true);  // Read-only mode
+    
+    uint8_t saved_mac[6] = {0};
+    size_t len = preferences.getBytes("peer_mac", saved_mac, 6);
+    uint32_t saved_session = preferences.getUInt("session_id", 0);
+    uint8_t saved_key[ESPNowSession::KEY_SIZE];
+    size_t key_len = preferences.getBytes("session_key", saved_key, sizeof(saved_key));
+    preferences.end();
+    
+    // Only valid for the peer it was made with; encrypted, only with its key
+    if (len == 6 && saved_session != 0 && isMacEqual(saved_mac, peer_mac_address) &&
+        (!session.isEnabled() || key_len == sizeof(saved_key))) {
+        session_id = saved_session;
+        if (session.isEnabled()) {
+            session.setMasterKey(saved_key);
+        }
+        LOG_INFO("ESPNow", "Loaded saved session %08X", session_id);
+    }
+    ESPNowCrypto::wipe(saved_key, sizeof(saved_key));
+}
+
 void ESPNowManager::clearSavedPeer() {
     preferences.begin("espnow", false);
     preferences.clear();
@@ -788,13 +1887,21 @@ void ESPNowManager::setAutoReconnect(bool enabled) {
 }
 
 uint32_t ESPNowManager::getConnectionUptime() const {
-    if (current_state != State::PAIRED || connection_start_time == 0) {
+    uint32_t start_time = published.read().connection_start_time;
+    if (current_state != State::PAIRED || start_time == 0) {
         return 0;
     }
-    return millis() - connection_start_time;
+    return millis() - start_time;
 }
 
-float ESPNowManager::getPacketLossRate() const {
+float ESPNowManager::measureLossRate() const {
+    if (ESPNowGlobalConfig::ENABLE_SEQUENCE_CHECK) {
+        portENTER_CRITICAL(&rx_sequence_lock);
+        float loss = primary().rx_sequence.getLossRate();
+        portEXIT_CRITICAL(&rx_sequence_lock);
+        return loss * 100.0f;
+    }
+    
     uint32_t total_sent = stats.ping_count;
     uint32_t total_received = stats.pong_count;
     
@@ -806,59 +1913,727 @@ float ESPNowManager::getPacketLossRate() const {
     return (float)lost / (float)total_sent * 100.0f;
 }
 
-void ESPNowManager::registerInstance(ESPNowManager* mgr) {
-    if (xSemaphoreTake(instance_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        instance = mgr;
-        xSemaphoreGive(instance_mutex);
+void ESPNowManager::handlePong(const ESPNowMessage* msg, uint32_t rx_time_us) {
+    uint32_t counter = msg->getPingPongCounter();
+    PingRecord& record = ping_history[counter % ESPNowGlobalConfig::PING_HISTORY_SIZE];
+    
+    // Late, duplicated or unknown pongs would pair with the wrong send time
+    if (!record.pending || record.counter != counter) {
+        LOG_DEBUG("ESPNow", "Ignoring stale pong %u", counter);
+        return;
+    }
+    record.pending = false;
+    
+    // t1 ping sent, t2 ping received by peer, t3 pong sent by peer, t4 pong received
+    uint32_t t1 = record.send_us;
+    uint32_t t4 = rx_time_us;
+    uint32_t t2 = 0;
+    uint32_t t3 = 0;
+    msg->getPongTimes(t2, t3);
+    
+    uint32_t round_trip_us = t4 - t1;
+    stats.latency_ms = round_trip_us / 1000;
+    
+    uint32_t turnaround_us = t3 - t2;
+    if (turnaround_us >= round_trip_us) {
+        // Peer did not stamp its times; only the raw round trip is usable
+        rtt_histogram.record(round_trip_us);
+    } else {
+        uint32_t delay_us = round_trip_us - turnaround_us;
+        int32_t offset_us = static_cast<int32_t>(
+            (static_cast<int64_t>(static_cast<int32_t>(t2 - t1)) +
+             static_cast<int64_t>(static_cast<int32_t>(t3 - t4))) / 2);
+        rtt_histogram.record(delay_us);
+        
+        // Keep the offset of the lowest-delay recent exchange: queueing inflates
+        // delay and makes the symmetric-path assumption less accurate
+        ClockSample& sample = clock_filter[clock_filter_next];
+        sample.delay_us = delay_us;
+        sample.offset_us = offset_us;
+        clock_filter_next = (clock_filter_next + 1) % ESPNowGlobalConfig::CLOCK_FILTER_SIZE;
+        if (clock_filter_count < ESPNowGlobalConfig::CLOCK_FILTER_SIZE) clock_filter_count++;
+        
+        const ClockSample* best = &clock_filter[0];
+        for (uint8_t i = 1; i < clock_filter_count; i++) {
+            if (clock_filter[i].delay_us < best->delay_us) best = &clock_filter[i];
+        }
+        stats.clock_offset_us = best->offset_us;
+        stats.clock_offset_valid = clock_filter_count >= ESPNowGlobalConfig::CLOCK_FILTER_MIN_SAMPLES;
+        
+        if (stats.clock_offset_valid) {
+            int32_t one_way_us = static_cast<int32_t>(t2 - t1) - stats.clock_offset_us;
+            one_way_histogram.record(one_way_us > 0 ? static_cast<uint32_t>(one_way_us) : 0);
+        }
     }
+    
+    rtt_histogram.summarize(stats.rtt);
+    one_way_histogram.summarize(stats.one_way);
+    latency_changed = true;
+    
+    LOG_DEBUG("ESPNow", "Pong %u received, rtt %u us, p99 %u us", counter, round_trip_us, stats.rtt.p99_us);
+}
+
+void ESPNowManager::resetLatencyStats() {
+    rtt_histogram.reset();
+    one_way_histogram.reset();
+    memset(ping_history, 0, sizeof(ping_history));
+    clock_filter_count = 0;
+    clock_filter_next = 0;
+    memset(&stats.rtt, 0, sizeof(stats.rtt));
+    memset(&stats.one_way, 0, sizeof(stats.one_way));
+    stats.clock_offset_us = 0;
+    stats.clock_offset_valid = false;
+    latency_changed = true;
+}
+
+float ESPNowManager::measureLossRate1s() const {
+    uint32_t now = millis();
+    portENTER_CRITICAL(&rx_sequence_lock);
+    float loss = primary().rx_sequence.getLossRate1s(now);
+    portEXIT_CRITICAL(&rx_sequence_lock);
+    return loss * 100.0f;
 }
 
-void ESPNowManager::unregisterInstance(ESPNowManager* mgr) {
-    if (xSemaphoreTake(instance_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        if (instance == mgr) {
-            instance = nullptr;
+float ESPNowManager::measureLossRate10s() const {
+    uint32_t now = millis();
+    portENTER_CRITICAL(&rx_sequence_lock);
+    float loss = primary().rx_sequence.getLossRate10s(now);
+    portEXIT_CRITICAL(&rx_sequence_lock);
+    return loss * 100.0f;
+}
+
+ESPNowManager::PeerId ESPNowManager::registerPeer(const uint8_t* mac, ESPNowConfig::DeviceRole role) {
+    uint8_t zero_mac[6] = {0};
+    if (!mac || memcmp(mac, zero_mac, 6) == 0) {
+        LOG_ERROR("ESPNow", "Cannot register peer with zero MAC address");
+        return INVALID_PEER;
+    }
+    
+    if (isAppCaller()) {
+        // The table belongs to the link task; wait for it to add the peer
+        ESPNowMessage request;
+        memcpy(request.data, mac, 6);
+        request.data[6] = role;
+        ESPNowLinkTask* task = link_task.load(std::memory_order_acquire);
+        if (postRequest(LinkRequestType::REGISTER_PEER, &request) != HAL_OK ||
+            !task->waitForUpdate(ESPNowGlobalConfig::LINK_REQUEST_WAIT_MS)) {
+            LOG_ERROR("ESPNow", "Link task did not register the peer");
+            return INVALID_PEER;
         }
-        xSemaphoreGive(instance_mutex);
+        return registered_peer.load(std::memory_order_acquire);
+    }
+    
+    PeerId id = peers.add(mac, role);
+    if (id == INVALID_PEER) {
+        LOG_ERROR("ESPNow", "Peer table full (%u peers)", peers.capacity());
+        return INVALID_PEER;
+    }
+    
+    LOG_INFO("ESPNow", "Registered peer %u: %02X:%02X:%02X:%02X:%02X:%02X",
+             id, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return id;
+}
+
+hal_status_t ESPNowManager::unregisterPeer(PeerId peer_id) {
+    if (peer_id == primary_peer) {
+        LOG_ERROR("ESPNow", "The pairing peer is removed with disconnect()");
+        return HAL_ERROR;
+    }
+    if (isAppCaller()) {
+        return postRequest(LinkRequestType::UNREGISTER_PEER, nullptr, peer_id);
+    }
+    if (!peers.isValid(peer_id)) {
+        return HAL_ERROR;
+    }
+    
+    ESPNowPeer& peer = peers.get(peer_id);
+    if (peer.radio_registered) {
+        transport->removePeer(peer.mac);
+    }
+    peers.remove(peer_id);
+    return HAL_OK;
+}
+
+const ESPNowPeer* ESPNowManager::getPeer(PeerId peer_id) const {
+    return peers.isValid(peer_id) ? &peers.get(peer_id) : nullptr;
+}
+
+hal_status_t ESPNowManager::sendMessageTo(PeerId peer_id, const ESPNowMessage& msg) {
+    if (isAppCaller()) {
+        return postRequest(LinkRequestType::SEND_TO_PEER, &msg, peer_id);
+    }
+    
+    if (peer_id == primary_peer) {
+        return sendMessage(msg);
+    }
+    
+    if (!is_initialized) {
+        LOG_ERROR("ESPNow", "Cannot send message - not initialized");
+        return HAL_ERROR;
+    }
+    if (!peers.isValid(peer_id)) {
+        LOG_ERROR("ESPNow", "Cannot send message to unknown peer %u", peer_id);
+        return HAL_ERROR;
+    }
+    
+    ESPNowPeer& peer = peers.get(peer_id);
+    if (!peer.radio_registered && addRadioPeer(peer) != HAL_OK) {
+        return HAL_ERROR;
+    }
+    
+    ESPNowMessage stamped = msg;
+    stamped.role = device_role;
+    stamped.sequence = peer.tx_sequence++;
+    if (stamped.timestamp == 0) {
+        stamped.timestamp = millis();
+    }
+    if (ESPNowGlobalConfig::USE_LEGACY_WIRE_FORMAT) {
+        stamped.updateCRC();
+    }
+    
+    hal_status_t result = transmitFrame(peer.mac, stamped, peer.tx_wire);
+    if (result == HAL_OK) {
+        peer.stats.messages_sent++;
     }
+    return result;
 }
 
-void ESPNowManager::queueMessage(const uint8_t* sender_mac, const ESPNowMessage* msg) {
-    if (!msg || !sender_mac) return;
+hal_status_t ESPNowManager::addRadioPeer(ESPNowPeer& peer) {
+    if (!transport->hasPeer(peer.mac) && transport->addPeer(peer.mac, ESPNowConfig::PEER_CHANNEL_CURRENT) != HAL_OK) {
+        return HAL_ERROR;
+    }
+    peer.radio_registered = true;
+    return HAL_OK;
+}
+
+void ESPNowManager::processPeerMessage(PeerId peer_id, const ESPNowMessage* msg, uint32_t rx_time_us,
+                                       bool reliable) {
+    ESPNowPeer& peer = peers.get(peer_id);
+    if (peer.state != ESPNowPeerState::ACTIVE) {
+        LOG_INFO("ESPNow", "Peer %u active", peer_id);
+        peer.state = ESPNowPeerState::ACTIVE;
+    }
+    
+    if (reliable) {
+        bool is_new = peer.reliable_rx.accept(msg->sequence);
+        sendAck(peer_id);
+        if (!is_new) {
+            return;
+        }
+    }
     
-    if (xSemaphoreTake(queue_mutex, 0) == pdTRUE) {
-        // Limit queue size to prevent memory issues
-        if (message_queue.size() < 32) {
-            QueuedMessage queued;
-            memcpy(queued.sender_mac, sender_mac, 6);
-            memcpy(&queued.message, msg, sizeof(ESPNowMessage));
-            message_queue.push(queued);
+    switch (msg->type) {
+        case ESPNowConfig::MSG_PING: {
+            // Answered so the peer can measure the link; we don't ping it ourselves
+            ESPNowMessage pong;
+            pong.type = ESPNowConfig::MSG_PONG;
+            pong.setPongData(msg->getPingPongCounter(), rx_time_us, micros());
+            sendMessageTo(peer_id, pong);
+            break;
         }
-        xSemaphoreGive(queue_mutex);
+            
+        case ESPNowConfig::MSG_ANNOUNCE:
+        case ESPNowConfig::MSG_PAIR_REQUEST:
+        case ESPNowConfig::MSG_PAIR_RESPONSE:
+        case ESPNowConfig::MSG_DISCONNECT:
+        case ESPNowConfig::MSG_PONG:
+        case ESPNowConfig::MSG_ACK:
+        case ESPNowConfig::MSG_KEEPALIVE:
+            // No handshake or reliable sends towards additional peers
+            break;
+            
+        default:
+            if (dispatch_table.has(msg->type)) {
+                deliverCallback(CallbackKind::MESSAGE, msg, peer_id);
+            }
+            break;
     }
 }
 
-void ESPNowManager::processMessageQueue() {
-    // Process up to 5 messages per update to avoid blocking
-    int processed = 0;
+void ESPNowManager::updatePeerStates() {
+    uint32_t now = millis();
     
-    while (processed < 5) {
-        QueuedMessage queued;
-        bool has_message = false;
+    for (PeerId id = 0; id < peers.capacity(); id++) {
+        if (!peers.isValid(id)) continue;
+        ESPNowPeer& peer = peers.get(id);
+        peer.stats.bytes_received = peer.rx_bytes.load(std::memory_order_relaxed);
         
-        // Get message from queue
-        if (xSemaphoreTake(queue_mutex, pdMS_TO_TICKS(5)) == pdTRUE) {
-            if (!message_queue.empty()) {
-                queued = message_queue.front();
-                message_queue.pop();
-                has_message = true;
+        if (id == primary_peer) {
+            // Follows the handshake state machine
+            if (current_state == State::PAIRED) {
+                peer.state = ESPNowPeerState::ACTIVE;
+            } else if (current_state == State::RECONNECTING) {
+                peer.state = ESPNowPeerState::LOST;
+            } else {
+                peer.state = ESPNowPeerState::IDLE;
             }
-            xSemaphoreGive(queue_mutex);
+        } else if (peer.state == ESPNowPeerState::ACTIVE &&
+                   now - peer.stats.last_activity_ms > ESPNowConfig::CONNECTION_TIMEOUT_MS) {
+            LOG_WARNING("ESPNow", "Peer %u lost after %u ms of inactivity", id, now - peer.stats.last_activity_ms);
+            peer.state = ESPNowPeerState::LOST;
         }
-        
-        if (!has_message) break;
-        
-        // Process message outside of mutex
-        processMessage(queued.sender_mac, &queued.message);
-        processed++;
+    }
+}
+
+void ESPNowManager::receiveFrame(const uint8_t* sender_mac, const uint8_t* data, int len, int8_t rssi) {
+    rx_byte_count.fetch_add(len, std::memory_order_relaxed);
+    
+    PeerId peer_id = peers.pin(sender_mac);
+    if (peer_id == INVALID_PEER) {
+        rx_unknown_peer_count.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    receivePeerFrame(peer_id, sender_mac, data, len, rssi);
+    peers.unpin();
+}
+
+void ESPNowManager::receivePeerFrame(PeerId peer_id, const uint8_t* sender_mac, const uint8_t* data, int len,
+                                     int8_t rssi) {
+    ESPNowPeer& peer = peers.get(peer_id);
+    peer.rx_bytes.fetch_add(len, std::memory_order_relaxed);
+    
+    DecodeContext context = { this, sender_mac, peer_id, static_cast<uint32_t>(micros()), rssi, false };
+    size_t decoded;
+    if (ESPNowSession::isSealed(data, len)) {
+        // Only the pairing peer seals; its frames are opened into a local copy
+        uint8_t opened[ESPNowWire::MAX_FRAME_SIZE];
+        size_t opened_len = (peer_id == primary_peer)
+            ? session.open(data, len, peer.role, opened, sizeof(opened), millis())
+            : 0;
+        if (opened_len == 0) {
+            return;  // Counted by the session
+        }
+        context.sealed = true;
+        decoded = ESPNowWire::decodeOpenedFrameInto(opened, opened_len, peer.rx_wire, &ESPNowManager::onRecordClaim,
+                                                    &ESPNowManager::onRecordDecoded, &context);
+    } else {
+        decoded = ESPNowWire::decodeFrameInto(data, len, peer.rx_wire, &ESPNowManager::onRecordClaim,
+                                              &ESPNowManager::onRecordDecoded, &context);
+    }
+    if (decoded == 0) {
+        rx_invalid_count.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+ESPNowMessage* ESPNowManager::onRecordClaim(void* context) {
+    ESPNowManager* manager = static_cast<DecodeContext*>(context)->manager;
+    
+    if (manager->rx_claimed == RxPool::INVALID_INDEX) {
+        manager->rx_claimed = manager->rx_pool.claim();
+        if (manager->rx_claimed == RxPool::INVALID_INDEX) {
+            return nullptr;  // Every buffer is waiting for update(); the rest of the frame is dropped
+        }
+    }
+    return &manager->rx_pool[manager->rx_claimed].message;
+}
+
+void ESPNowManager::onRecordDecoded(void* context, const ESPNowMessage&, uint8_t record_flags) {
+    DecodeContext* ctx = static_cast<DecodeContext*>(context);
+    ctx->manager->queueMessage(ctx->sender_mac, ctx->peer, ctx->rx_time_us, ctx->rssi, record_flags, ctx->sealed);
+}
+
+void ESPNowManager::queueMessage(const uint8_t* sender_mac, PeerId peer_id, uint32_t rx_time_us, int8_t rssi,
+                                 uint8_t record_flags, bool sealed) {
+    bool reliable = (record_flags & ESPNowWire::RECORD_FLAG_RELIABLE) != 0;
+    if (!sender_mac || rx_claimed == RxPool::INVALID_INDEX) return;
+    
+    // Already decoded in place; from here on only the index moves
+    QueuedMessage& queued = rx_pool[rx_claimed];
+    const ESPNowMessage* msg = &queued.message;
+    
+    // Encrypted, only the handshake may come from the pairing peer in the
+    // clear, and its unauthenticated sequence numbers stay out of the tracker
+    bool unsealed_from_peer = !sealed && peer_id == primary_peer && session.isEnabled();
+    if (unsealed_from_peer && !ESPNowConfig::isHandshakeMessage(msg->type)) {
+        rx_unsealed_count.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    
+    // Track each peer's sequence in arrival order, before the priority lanes reorder it
+    if (ESPNowGlobalConfig::ENABLE_SEQUENCE_CHECK && !unsealed_from_peer) {
+        ESPNowPeer& peer = peers.get(peer_id);
+        portENTER_CRITICAL(&rx_sequence_lock);
+        if (peer.rx_reset.exchange(false, std::memory_order_acq_rel)) {
+            peer.rx_sequence.reset();
+        }
+        SequenceTracker::Result result = peer.rx_sequence.check(msg->sequence, millis());
+        portEXIT_CRITICAL(&rx_sequence_lock);
+        // Reliable duplicates still go through so their ACK can be repeated
+        if (!SequenceTracker::shouldDeliver(result) && !reliable) {
+            return;
+        }
+    }
+    
+    memcpy(queued.sender_mac, sender_mac, 6);
+    queued.peer = peer_id;
+    queued.peer_generation = peers.get(peer_id).generation;
+    queued.rx_time_us = rx_time_us;
+    queued.rssi = rssi;
+    queued.reliable = reliable;
+    
+    // Never blocks; a full lane is counted in the drop statistics and the
+    // buffer stays claimed for the next record
+    if (rx_lanes[ESPNowConfig::getMessagePriority(msg->type)].push(rx_claimed)) {
+        rx_claimed = RxPool::INVALID_INDEX;
+    }
+}
+
+void ESPNowManager::processMessageQueue() {
+    uint32_t start_us = micros();
+    
+    // Snapshot every lane once so the whole pending set is drained in one pass;
+    // frames arriving meanwhile wait for the next update()
+    size_t pending[ESPNowConfig::PRIORITY_COUNT];
+    for (uint8_t lane = 0; lane < ESPNowConfig::PRIORITY_COUNT; lane++) {
+        pending[lane] = rx_lanes[lane].size();
+    }
+    
+    RxPool::Index index;
+    bool budget_spent = false;
+    for (uint8_t lane = 0; lane < ESPNowConfig::PRIORITY_COUNT && !budget_spent; lane++) {
+        while (pending[lane] > 0) {
+            // Control traffic is always drained; lower lanes are deferred once the budget is spent
+            if (lane != ESPNowConfig::PRIORITY_CONTROL &&
+                micros() - start_us >= process_budget_us) {
+                budget_spent = true;
+                break;
+            }
+            if (!rx_lanes[lane].pop(index)) break;
+            pending[lane]--;
+            
+            // Handlers read the pooled buffer in place; it goes back once they return
+            const QueuedMessage& queued = rx_pool[index];
+            
+            // The peer may have been unregistered, or replaced, while the message was queued
+            if (peers.isCurrent(queued.peer, queued.peer_generation)) {
+                ESPNowPeer& peer = peers.get(queued.peer);
+                peer.stats.messages_received++;
+                peer.stats.last_activity_ms = millis();
+                
+                if (queued.peer == primary_peer) {
+                    stats.rssi = queued.rssi;
+                    processMessage(queued.sender_mac, &queued.message, queued.rx_time_us, queued.reliable);
+                } else {
+                    processPeerMessage(queued.peer, &queued.message, queued.rx_time_us, queued.reliable);
+                }
+            }
+            rx_pool.release(index);
+        }
+    }
+    
+    uint32_t dropped = 0;
+    uint32_t high_watermark = 0;
+    for (uint8_t lane = 0; lane < ESPNowConfig::PRIORITY_COUNT; lane++) {
+        dropped += rx_lanes[lane].getDropCount();
+        if (rx_lanes[lane].getHighWatermark() > high_watermark) {
+            high_watermark = rx_lanes[lane].getHighWatermark();
+        }
+    }
+    stats.rx_queue_dropped = dropped;
+    stats.rx_queue_high_watermark = high_watermark;
+    stats.rx_pool_exhausted = rx_pool.getExhaustedCount();
+    stats.rx_invalid = rx_invalid_count.load(std::memory_order_relaxed);
+    stats.bytes_received = rx_byte_count.load(std::memory_order_relaxed);
+    stats.rc_frames_sent = rc_frames_sent;
+    
+    stats.rx_unknown_peer = rx_unknown_peer_count.load(std::memory_order_relaxed);
+    stats.rx_unsealed = rx_unsealed_count.load(std::memory_order_relaxed);
+    
+    ESPNowSession::Stats crypto = session.getStats();
+    stats.frames_sealed = crypto.frames_sealed;
+    stats.frames_opened = crypto.frames_opened;
+    stats.auth_failures = crypto.auth_failures;
+    stats.replays_rejected = crypto.replays_rejected;
+    stats.crypto_us = crypto.crypto_us;
+    
+    portENTER_CRITICAL(&rx_sequence_lock);
+    SequenceTracker::Counters sequence = primary().rx_sequence.getCounters();
+    portEXIT_CRITICAL(&rx_sequence_lock);
+    stats.rx_lost = sequence.lost;
+    stats.rx_duplicates = sequence.duplicates;
+    stats.rx_reordered = sequence.reordered;
+    stats.rx_stale = sequence.stale;
+    stats.rx_resyncs = sequence.resyncs;
+    
+    const ESPNowReliable::Sender::Counters& reliable = reliable_tx.getCounters();
+    stats.tx_failed = tx_failed_count.load(std::memory_order_relaxed);
+    stats.reliable_sent = reliable.sent;
+    stats.reliable_delivered = reliable.delivered;
+    stats.reliable_retransmits = reliable.retransmits;
+    stats.reliable_failed = reliable.failed;
+    stats.reliable_duplicates = primary().reliable_rx.getDuplicates();
+}
+
+hal_status_t ESPNowManager::sendAck(PeerId peer_id) {
+    const ESPNowReliable::Receiver& receiver = peers.get(peer_id).reliable_rx;
+    ESPNowMessage msg;
+    msg.setAck(receiver.getAckSequence(), receiver.getAckBitmap());
+    return sendMessageTo(peer_id, msg);
+}
+
+void ESPNowManager::serviceReliable() {
+    uint32_t now = millis();
+    
+    // A failed first send reported by the radio is retried without waiting for the RTO
+    uint32_t failures = tx_failed_count.load(std::memory_order_relaxed);
+    if (failures != tx_failed_seen) {
+        tx_failed_seen = failures;
+        reliable_tx.expedite(now);
+    }
+    
+    reliable_tx.poll(now, &ESPNowManager::onReliableRetransmit, &ESPNowManager::onReliableResolved, this);
+    
+    if (peer_removal_pending && !reliable_tx.hasInFlight()) {
+        flush();
+        transport->removePeer(peer_mac_address);
+        peer_added = false;
+        peer_removal_pending = false;
+        LOG_DEBUG("ESPNow", "Deferred peer removal complete");
+    }
+}
+
+void ESPNowManager::onReliableRetransmit(void* context, const ESPNowMessage& msg) {
+    ESPNowManager* manager = static_cast<ESPNowManager*>(context);
+    LOG_DEBUG("ESPNow", "Retransmitting message type %d seq %u", msg.type, msg.sequence);
+    manager->routeMessage(msg, ESPNowWire::RECORD_FLAG_RELIABLE);
+}
+
+void ESPNowManager::onReliableResolved(void* context, const ESPNowMessage& msg, bool delivered) {
+    ESPNowManager* manager = static_cast<ESPNowManager*>(context);
+    if (!delivered) {
+        LOG_WARNING("ESPNow", "Message type %d seq %u was not acknowledged", msg.type, msg.sequence);
+    }
+    if (manager->delivery_callback) {
+        manager->deliverCallback(CallbackKind::DELIVERY, &msg, INVALID_PEER, delivered);
+    }
+}
+
+void ESPNowManager::attachLinkTask(ESPNowLinkTask* task) {
+    link_task.store(task, std::memory_order_release);
+    
+    if (!task) {
+        // Back to running inline: whatever the task left queued runs here
+        processRequests();
+        dispatchCallbacks();
+    }
+}
+
+bool ESPNowManager::isAppCaller() const {
+    ESPNowLinkTask* task = link_task.load(std::memory_order_acquire);
+    return task && !task->isCurrentTask();
+}
+
+hal_status_t ESPNowManager::postRequest(LinkRequestType type, const ESPNowMessage* msg, PeerId peer,
+                                        uint16_t value) {
+    LinkRequest request;
+    request.type = type;
+    request.peer = peer;
+    request.value = value;
+    if (msg) {
+        request.message = *msg;
+    }
+    
+    if (!link_requests.push(request)) {
+        LOG_WARNING("ESPNow", "Link task queue full, request %d dropped", static_cast<int>(type));
+        return HAL_BUSY;
+    }
+    
+    ESPNowLinkTask* task = link_task.load(std::memory_order_acquire);
+    if (task) {
+        task->wake();
+    }
+    return HAL_OK;
+}
+
+void ESPNowManager::processRequests() {
+    LinkRequest request;
+    while (link_requests.pop(request)) {
+        switch (request.type) {
+            case LinkRequestType::SEND_MESSAGE:
+                sendMessage(request.message);
+                break;
+            case LinkRequestType::SEND_TO_PEER:
+                sendMessageTo(request.peer, request.message);
+                break;
+            case LinkRequestType::SEND_RELIABLE:
+                sendReliable(request.message);
+                break;
+            case LinkRequestType::START_CONNECTION:
+                startConnection();
+                break;
+            case LinkRequestType::STOP_CONNECTION:
+                stopConnection();
+                break;
+            case LinkRequestType::DISCONNECT:
+                disconnect();
+                break;
+            case LinkRequestType::SET_COALESCING:
+                setCoalescing(request.value != 0);
+                break;
+            case LinkRequestType::START_RC_STREAM:
+                startRcStream(request.value);
+                break;
+            case LinkRequestType::STOP_RC_STREAM:
+                stopRcStream();
+                break;
+            case LinkRequestType::REGISTER_PEER:
+                registered_peer.store(registerPeer(request.message.data,
+                                                   static_cast<ESPNowConfig::DeviceRole>(request.message.data[6])),
+                                      std::memory_order_release);
+                break;
+            case LinkRequestType::UNREGISTER_PEER:
+                unregisterPeer(request.peer);
+                break;
+        }
+    }
+    stats.link_requests_dropped = link_requests.getDropCount();
+}
+
+void ESPNowManager::deliverCallback(CallbackKind kind, const ESPNowMessage* msg, PeerId peer, bool delivered) {
+    if (!link_task.load(std::memory_order_acquire)) {
+        invokeCallback(kind, msg, peer, delivered);
+        return;
+    }
+    
+    // The receive buffer goes back to the pool, so the app gets its own copy
+    LinkEvent event;
+    event.kind = kind;
+    event.peer = peer;
+    event.delivered = delivered;
+    event.message = *msg;
+    if (!link_events.push(event)) {
+        stats.link_events_dropped = link_events.getDropCount();
+    }
+}
+
+void ESPNowManager::dispatchCallbacks() {
+    LinkEvent event;
+    while (link_events.pop(event)) {
+        invokeCallback(event.kind, &event.message, event.peer, event.delivered);
+    }
+}
+
+void ESPNowManager::invokeCallback(CallbackKind kind, const ESPNowMessage* msg, PeerId peer, bool delivered) {
+    if (kind == CallbackKind::MESSAGE) {
+        dispatch_table.dispatch(*msg, peer);
+    } else if (delivery_callback) {
+        delivery_callback(msg, delivered);
+    }
+}
+
+hal_status_t ESPNowManager::startRcStream(uint16_t rate_hz) {
+    if (!is_initialized) {
+        LOG_ERROR("ESPNow", "Cannot start RC stream - not initialized");
+        return HAL_ERROR;
+    }
+    
+    if (isAppCaller()) {
+        return postRequest(LinkRequestType::START_RC_STREAM, nullptr, INVALID_PEER, rate_hz);
+    }
+    
+    if (rate_hz < ESPNowGlobalConfig::RC_STREAM_MIN_RATE_HZ) rate_hz = ESPNowGlobalConfig::RC_STREAM_MIN_RATE_HZ;
+    if (rate_hz > ESPNowGlobalConfig::RC_STREAM_MAX_RATE_HZ) rate_hz = ESPNowGlobalConfig::RC_STREAM_MAX_RATE_HZ;
+    
+    if (!rc_timer) {
+        esp_timer_create_args_t args = {};
+        args.callback = &ESPNowManager::onRcTimer;
+        args.arg = this;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "espnow_rc";
+        args.skip_unhandled_events = true;  // Never burst to catch up
+        if (esp_timer_create(&args, &rc_timer) != ESP_OK) {
+            LOG_ERROR("ESPNow", "Failed to create RC stream timer");
+            rc_timer = nullptr;
+            return HAL_ERROR;
+        }
+    }
+    
+    if (rc_stream_running) {
+        esp_timer_stop(rc_timer);
+    }
+    
+    if (esp_timer_start_periodic(rc_timer, 1000000ULL / rate_hz) != ESP_OK) {
+        LOG_ERROR("ESPNow", "Failed to start RC stream timer");
+        rc_stream_running = false;
+        return HAL_ERROR;
+    }
+    
+    rc_stream_running = true;
+    LOG_INFO("ESPNow", "RC stream started at %u Hz", rate_hz);
+    if (!link_task.load(std::memory_order_acquire)) {
+        LOG_WARNING("ESPNow", "RC stream without a link task: frames wait for the next update()");
+    }
+    return HAL_OK;
+}
+
+hal_status_t ESPNowManager::stopRcStream() {
+    if (isAppCaller()) {
+        return postRequest(LinkRequestType::STOP_RC_STREAM);
+    }
+    if (!rc_stream_running) return HAL_OK;
+    
+    esp_timer_stop(rc_timer);
+    rc_stream_running = false;
+    rc_frame_due.store(false, std::memory_order_relaxed);
+    LOG_INFO("ESPNow", "RC stream stopped");
+    return HAL_OK;
+}
+
+void ESPNowManager::setRcChannels(const uint16_t* channels, uint8_t count) {
+    if (!channels) return;
+    if (count > ESPNowMessage::RC_MAX_CHANNELS) count = ESPNowMessage::RC_MAX_CHANNELS;
+    
+    portENTER_CRITICAL(&rc_lock);
+    memcpy(rc_channels, channels, count * sizeof(uint16_t));
+    rc_channel_count = count;
+    portEXIT_CRITICAL(&rc_lock);
+}
+
+void ESPNowManager::onRcTimer(void* arg) {
+    // Runs in the esp_timer task, so it only marks the frame due; link state,
+    // the session and the radio stay with the task that runs update()
+    ESPNowManager* manager = static_cast<ESPNowManager*>(arg);
+    manager->rc_frame_due.store(true, std::memory_order_release);
+    ESPNowLinkTask* task = manager->link_task.load(std::memory_order_acquire);
+    if (task) {
+        task->wake();
+    }
+}
+
+void ESPNowManager::sendRcFrame() {
+    if (current_state != State::PAIRED || !peer_added) return;
+    
+    uint16_t channels[ESPNowMessage::RC_MAX_CHANNELS];
+    portENTER_CRITICAL(&rc_lock);
+    uint8_t count = rc_channel_count;
+    memcpy(channels, rc_channels, count * sizeof(uint16_t));
+    portEXIT_CRITICAL(&rc_lock);
+    
+    if (count == 0) return;
+    
+    ESPNowMessage msg;
+    msg.role = device_role;
+    msg.sequence = primary().tx_sequence++;
+    msg.timestamp = millis();
+    msg.setRcChannels(channels, count, ESPNowGlobalConfig::RC_CHANNEL_BITS);
+    
+    // Own frame outside the coalescer, with an absolute timestamp
+    ESPNowWire::EncoderState wire_state;
+    ESPNowWire::resetEncoder(wire_state);
+    uint8_t frame[ESPNowWire::MAX_FRAME_SIZE];
+    size_t frame_len = ESPNowWire::encode(msg, wire_state, frame, frameCapacity(),
+                                          ESPNowWire::FRAME_FLAG_OUT_OF_BAND);
+    
+    uint8_t sealed[ESPNowWire::MAX_FRAME_SIZE];
+    if (frame_len > 0 && session.isEnabled()) {
+        frame_len = session.seal(frame, frame_len, sealed, sizeof(sealed));
+    }
+    const uint8_t* out = session.isEnabled() ? sealed : frame;
+    
+    if (frame_len > 0 && transport->send(peer_mac_address, out, frame_len) == HAL_OK) {
+        rc_frames_sent++;
+        stats.messages_sent++;
+        primary().stats.messages_sent++;
+        last_tx_time = millis();  // Counts as keepalive
     }
 }
\ No newline at end of file
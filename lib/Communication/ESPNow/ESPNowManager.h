@@ -1,18 +1,29 @@
 #ifndef ESPNOW_MANAGER_H
 #define ESPNOW_MANAGER_H
 
-#include <Arduino.h>
-#include <esp_now.h>
-#include <WiFi.h>
-#include <Preferences.h>
-#include "../../Core/StateManager.h"
+#include "../../Core/Platform.h"
+#include "../../Core/FixedStateMachine.h"
 #include "../../Core/Logger.h"
+#include "../../Core/SPSCQueue.h"
+#include "../../Core/BufferPool.h"
+#include "../../Core/LatencyHistogram.h"
+#include "../../Core/DeadlineTimers.h"
+#include "../../Core/SnapshotBuffer.h"
+#include "../../Config/espnow_config.h"
 #include "../../HAL/Core/hal_types.h"
 #include "ESPNowMessage.h"
 #include "ESPNowConfig.h"
-#include <freertos/FreeRTOS.h>
-#include <freertos/semphr.h>
-#include <queue>
+#include "ESPNowWire.h"
+#include "ESPNowSequence.h"
+#include "ESPNowReliable.h"
+#include "ESPNowPeerTable.h"
+#include "ESPNowTransport.h"
+#include "ESPNowDispatch.h"
+#include "ESPNowSession.h"
+#include "ESPNowChannelSurvey.h"
+#include <atomic>
+
+class ESPNowLinkTask;
 
 class ESPNowManager {
 public:
@@ -24,6 +35,7 @@ public:
         RECONNECTING,
         ERROR
     };
+    static constexpr uint16_t STATE_COUNT = static_cast<uint16_t>(State::ERROR) + 1;
     
     struct Stats {
         uint32_t messages_sent;
@@ -32,14 +44,67 @@ public:
         uint32_t pong_count;
         uint32_t last_ping_time;
         uint32_t last_pong_time;
-        uint32_t latency_ms;
-        int8_t rssi;
+        uint32_t latency_ms;               // last ping round trip, including peer turnaround
+        int8_t rssi;                       // dBm of the pairing peer's last frame, 0 = not reported
+        uint32_t rx_queue_dropped;         // frames dropped because the receive ring was full
+        uint32_t rx_queue_high_watermark;  // deepest receive ring occupancy seen
+        uint32_t rx_pool_exhausted;        // messages dropped because every receive buffer was in use
+        uint32_t rx_invalid;               // frames rejected by the wire decoder
+        uint32_t frames_sent;              // ESP-NOW frames, may carry several messages
+        uint32_t bytes_sent;               // on-air payload bytes
+        uint32_t bytes_received;
+        uint32_t rc_frames_sent;           // sent by the RC stream
+        LatencyHistogram::Summary rtt;     // link round trip, peer turnaround removed
+        LatencyHistogram::Summary one_way; // our ping to peer receive, needs clock_offset_valid
+        int32_t clock_offset_us;           // peer micros() minus ours
+        bool clock_offset_valid;
+        uint32_t rx_lost;                  // sequence numbers never received
+        uint32_t rx_duplicates;            // dropped before reaching the callbacks
+        uint32_t rx_reordered;             // arrived late but delivered
+        uint32_t rx_stale;                 // too late to tell from a duplicate, dropped
+        uint32_t rx_resyncs;               // sequence jumps past MAX_SEQUENCE_GAP (peer restart)
+        uint32_t tx_failed;                // sends the radio reported as not acknowledged
+        uint32_t reliable_sent;
+        uint32_t reliable_delivered;
+        uint32_t reliable_retransmits;
+        uint32_t reliable_failed;          // gave up after RELIABLE_MAX_ATTEMPTS
+        uint32_t reliable_duplicates;      // retransmissions received again and dropped
+        uint32_t rx_unknown_peer;          // frames from MACs not in the peer table
+        uint32_t reconnects;               // link timeouts recovered from
+        uint32_t last_outage_ms;           // last traffic before the timeout until paired again
+        uint32_t fast_reconnects;          // of those, resumed with MSG_RESUME
+        uint32_t keepalives_sent;          // pings sent because the link was otherwise idle
+        uint32_t link_records_piggybacked; // pings and pongs carried in a data frame
+        uint32_t link_failsafes;           // peer silent for LINK_MISS_COUNT keepalive intervals
+        uint32_t last_failsafe_ms;         // last traffic from the peer until the failsafe tripped
+        uint32_t link_requests_dropped;    // app calls lost to a full link task queue
+        uint32_t link_events_dropped;      // callbacks lost to a full app queue
+        uint32_t frames_sealed;            // encrypted frames sent to the pairing peer
+        uint32_t frames_opened;            // encrypted frames received and authenticated
+        uint32_t auth_failures;            // sealed frames or handshakes failing authentication
+        uint32_t replays_rejected;         // authentic frames seen before or too old
+        uint32_t rx_unsealed;              // peer records dropped for arriving unencrypted
+        uint32_t crypto_us;                // spent sealing and opening frames
+        uint8_t channel;                   // radio channel of the link outside a survey
+        uint32_t channel_surveys;
+        uint32_t channel_moves;
+        uint32_t channel_reverts;          // moves undone because the peer wasn't heard
     };
     
-    ESPNowManager(ESPNowConfig::DeviceRole role, const uint8_t* peer_mac);
+    typedef ESPNowPeerTable<ESPNowGlobalConfig::MAX_PEERS>::PeerId PeerId;
+    static constexpr PeerId INVALID_PEER = ESPNowPeerTable<ESPNowGlobalConfig::MAX_PEERS>::INVALID_PEER;
+    
+    // Without a transport the ESP-NOW radio is used (target builds only)
+    ESPNowManager(ESPNowConfig::DeviceRole role, const uint8_t* peer_mac, ESPNowTransport* transport = nullptr);
     ~ESPNowManager();
     
     hal_status_t init();
+    // Before init(); nullptr turns encryption off. Defaults to PAIRING_KEY
+    // when built with ESPNOW_PAIRING_KEY.
+    hal_status_t setPairingKey(const uint8_t* key);
+    bool isEncryptionEnabled() const { return session.isEnabled(); }
+    bool isEncrypted() const { return session.hasTrafficKey(); }  // Traffic to the peer is sealed
+    // With a link task running, update() from the app only runs the queued callbacks
     hal_status_t update(uint32_t delta_ms);
     hal_status_t shutdown();
     hal_status_t startConnection();  // Manual connection start
@@ -47,31 +112,102 @@ public:
     bool isSearching() const { return current_state == State::SEARCHING; }
     
     hal_status_t sendPing();
-    hal_status_t sendPong(uint32_t counter);
+    hal_status_t sendPong(uint32_t counter, uint32_t ping_rx_us = 0);
     hal_status_t sendDisconnect();
     hal_status_t disconnect();  // User-initiated disconnect
-    hal_status_t sendMessage(const ESPNowMessage& msg);  // Made public for sync managers
+    hal_status_t sendMessage(const ESPNowMessage& msg);  // Made public for sync managers; stamps role and sequence
+    hal_status_t flush();  // Send any coalesced messages now (call at end of tick)
+    
+    // Reliable lane: acknowledged by the peer and retransmitted with backoff.
+    // Never blocks; returns HAL_BUSY when every in-flight slot is taken.
+    hal_status_t sendReliable(const ESPNowMessage& msg);
+    hal_status_t sendCommand(ESPNowConfig::CommandId command, uint8_t argument = 0);
+    uint8_t getReliableInFlight() const { return reliable_tx.getInFlight(); }
+    void setCoalescing(bool enabled);
     
     State getState() const { return current_state; }
     const char* getStateString() const;
-    const Stats& getStats() const { return stats; }
+    // Copy published at the end of every update(), so any task can read it
+    // while the link task runs
+    Stats getStats() const { return published.read().stats; }
     bool isPaired() const { return current_state == State::PAIRED; }
     
     void getMacAddress(uint8_t* mac) const;
     void getPeerMacAddress(uint8_t* mac) const;
     
-    // Connection info methods
+    // Connection info methods, from the same snapshot as getStats()
     uint32_t getConnectionUptime() const;
-    uint32_t getLastActivityTime() const { return last_activity_time; }
+    uint32_t getLastActivityTime() const { return published.read().last_activity_time; }
     bool isConnected() const { return current_state == State::PAIRED; }
     bool isConnecting() const { return current_state == State::PAIRING || current_state == State::RECONNECTING; }
-    float getPacketLossRate() const;
+    uint32_t getSessionId() const { return published.read().session_id; }  // 0 until paired with a session-aware base
+    // Paired and heard from the peer within the last LINK_MISS_COUNT keepalive
+    // intervals; the failsafe signal, long before the link is dropped
+    bool isLinkAlive() const { return current_state == State::PAIRED && link_alive; }
+    // How long the caller may sleep before update() has timer work to do;
+    // received frames still need an update() as soon as they arrive. For the
+    // task that runs update(): the link task, when there is one.
+    uint32_t getTimeUntilNextDeadline() const { return timers.timeUntilNext(millis()); }
+    float getPacketLossRate() const { return published.read().loss_pct; }  // Percent since pairing
+    // Windowed receive loss in percent as of the last update(); cheap enough to poll every tick
+    float getPacketLossRate1s() const { return published.read().loss_1s_pct; }
+    float getPacketLossRate10s() const { return published.read().loss_10s_pct; }
+    // Copies, published whenever a pong adds a sample
+    LatencyHistogram getRttHistogram() const { return published_latency.read().rtt; }
+    LatencyHistogram getOneWayHistogram() const { return published_latency.read().one_way; }
+    void resetLatencyStats();  // From the task that runs update()
+    
+    // Handlers for every message type the manager doesn't consume itself.
+    // The pairing peer's messages are dispatched while PAIRED, registered
+    // peers' at any time; handlers get the sending peer. Register them
+    // before starting a link task.
+    ESPNowDispatchTable& getDispatchTable() { return dispatch_table; }
+    
+    // Called once per reliable message when it is acknowledged or given up on
+    typedef void (*DeliveryCallback)(const ESPNowMessage* msg, bool delivered);
+    void setDeliveryCallback(DeliveryCallback callback) { delivery_callback = callback; }
+    
+    // Additional peers beside the pairing peer (e.g. the drone for the base
+    // station). They skip the pairing handshake: traffic from a registered MAC
+    // is accepted directly and dispatched with its PeerId. With a link task,
+    // registerPeer() from the app waits up to LINK_REQUEST_WAIT_MS for the
+    // task to add the peer, and unregisterPeer() is queued like a send.
+    PeerId registerPeer(const uint8_t* mac, ESPNowConfig::DeviceRole role);
+    hal_status_t unregisterPeer(PeerId peer);
+    PeerId findPeer(const uint8_t* mac) const { return peers.find(mac); }
+    PeerId getPrimaryPeer() const { return primary_peer; }
+    const ESPNowPeer* getPeer(PeerId peer) const;
+    uint8_t getPeerCount() const { return published.read().peer_count; }  // As of the last update()
+    hal_status_t sendMessageTo(PeerId peer, const ESPNowMessage& msg);  // Sent immediately, not coalesced
+    
+    // RC channel stream while paired. A high-resolution timer sets the
+    // cadence and wakes the link task, which sends the frame from update().
+    // Meant for use with a link task: without one the frame waits for the
+    // next update() call, at the loop's cadence (warned at start).
+    hal_status_t startRcStream(uint16_t rate_hz = ESPNowGlobalConfig::RC_STREAM_RATE_HZ);
+    hal_status_t stopRcStream();
+    bool isRcStreaming() const { return rc_stream_running; }
+    void setRcChannels(const uint16_t* channels, uint8_t count);  // Safe from any task
+    
+    // Set by ESPNowLinkTask. While attached, sendMessage(), sendMessageTo(),
+    // sendReliable()/sendCommand(), startConnection(), stopConnection(),
+    // disconnect(), setCoalescing() and startRcStream()/stopRcStream() called
+    // from the app task are queued to the link task and return HAL_OK once
+    // queued; callbacks are queued back to the app task.
+    void attachLinkTask(ESPNowLinkTask* task);
+    bool hasLinkTask() const { return link_task.load(std::memory_order_acquire) != nullptr; }
+    
+    // Channel agility (ESPNowChannelSurvey), planned by the base station and
+    // followed by the handheld. Call these from the task that runs update().
+    uint8_t getChannel() const { return link_channel; }
+    bool isChannelPlanPending() const { return channel_plan != ChannelPlan::NONE || channel_confirming; }
+    const ESPNowChannelSurvey& getChannelSurvey() const { return channel_survey; }
+    hal_status_t startChannelSurvey();
+    hal_status_t moveToChannel(uint8_t channel);
     
-    // Message callbacks for sync managers
-    typedef void (*MessageCallback)(const ESPNowMessage* msg);
-    void setScreenSyncCallback(MessageCallback callback) { screen_sync_callback = callback; }
-    void setButtonDataCallback(MessageCallback callback) { button_data_callback = callback; }
-    void setInputEventCallback(MessageCallback callback) { input_event_callback = callback; }
+    // Time allowed per update() for link and bulk traffic; control traffic is never deferred
+    void setProcessBudgetUs(uint32_t budget_us) { process_budget_us = budget_us; }
+    uint32_t getProcessBudgetUs() const { return process_budget_us; }
     
     // Persistence methods
     bool loadSavedPeer();
@@ -81,45 +217,240 @@ public:
     void setAutoReconnect(bool enabled);
     
 private:
+    ESPNowTransport* transport;
     ESPNowConfig::DeviceRole device_role;
-    State current_state;
+    std::atomic<State> current_state;  // Mirror of state_machine for the app task when a link task runs
     uint8_t peer_mac_address[6];
     uint8_t own_mac_address[6];
     
-    StateMachine<State> state_machine;
+    FixedStateMachine<ESPNowManager, State, STATE_COUNT> state_machine;
     Stats stats;
     
-    uint32_t message_sequence;
     uint32_t ping_counter;
     uint32_t last_activity_time;
-    uint32_t state_timer;
     uint32_t connection_start_time;
     
+    // Connection timing: each state arms the deadlines it waits on, and the
+    // handlers only run once one of them has passed
+    enum Timer : uint8_t {
+        TIMER_ANNOUNCE = 0,
+        TIMER_STATE_TIMEOUT,
+        TIMER_STATUS_LOG,
+        TIMER_PING,
+        TIMER_LINK_TIMEOUT,
+        TIMER_RETRY,
+        TIMER_LINK_MISS,
+        TIMER_PONG,
+        TIMER_CHANNEL,
+        TIMER_COUNT
+    };
+    DeadlineTimers<TIMER_COUNT> timers;
+    uint32_t reconnect_attempts;
+    
+    // Adaptive keepalive
+    uint32_t last_tx_time;  // millis() of the last frame to the pairing peer
+    bool link_alive;
+    struct PendingPong {
+        uint32_t counter;
+        uint32_t rx_us;
+        bool valid;
+    };
+    PendingPong pending_pong;           // Held up to PONG_HOLD_MS for a data frame
+    bool link_lost;                     // Set on link timeout, cleared when paired again
+    uint32_t link_lost_activity_time;
+    
+    // Session handed out by the base in the pair response. While it is set,
+    // both ends answer a link timeout with MSG_RESUME to the cached peer
+    // instead of going back through announce and pair request.
+    uint32_t session_id;  // 0 = none
+    uint32_t reconnect_start_time;
+    
+    // Keys of the encrypted session, if enabled. The base remembers the last
+    // resume nonce it answered, so a repeated request gets the same reply.
+    ESPNowSession session;
+    uint8_t peer_nonce[ESPNowSession::NONCE_SIZE];
+    bool has_peer_nonce;
+    
+    // Channel agility. The base station announces each plan, a survey or a
+    // move, CHANNEL_PLAN_LEAD_MS ahead and both ends carry it out at the same
+    // time; the link lives on link_channel in between.
+    enum class ChannelPlan : uint8_t {
+        NONE,
+        SURVEY,
+        MOVE
+    };
+    ESPNowChannelSurvey channel_survey;
+    uint8_t link_channel;
+    ChannelPlan channel_plan;
+    uint8_t channel_plan_id;            // Last one announced or accepted, 0 = none this pairing
+    uint32_t channel_plan_start;        // millis() the plan takes effect
+    uint8_t channel_target;             // MOVE: the new channel
+    uint8_t channel_announcements;      // Copies still to send (base station)
+    bool channel_surveyed;              // A survey ran since pairing
+    uint32_t channel_hold_until;        // No move on measurements alone before this (base station)
+    uint32_t channel_next_survey;       // Nor a survey of a degraded channel nothing beat
+    bool channel_confirming;            // Moved, waiting to hear the peer
+    uint8_t channel_previous;           // Restored if the peer stays silent
+    uint32_t channel_moved_at;
+    int16_t survey_slot;                // Slot the radio is tuned for, -1 = none yet
+    uint8_t survey_probes_sent;
+    uint16_t survey_peer_probes;        // Any at all: the peer took part
+    ESPNowChannelSurvey::SlotSample survey_sample;
+    uint32_t channel_tx_frames;         // Counters at the start of the slot or check interval
+    uint32_t channel_tx_failed;
+    
     bool peer_added;
     bool is_initialized;
     bool auto_reconnect;
+    uint32_t process_budget_us;
     
     Preferences preferences;
     
-    // Message callbacks
-    MessageCallback screen_sync_callback;
-    MessageCallback button_data_callback;
-    MessageCallback input_event_callback;
+    // Latency measurement: send times of outstanding pings, matched by counter
+    struct PingRecord {
+        uint32_t counter;
+        uint32_t send_us;
+        bool pending;
+    };
+    PingRecord ping_history[ESPNowGlobalConfig::PING_HISTORY_SIZE];
+    struct ClockSample {
+        uint32_t delay_us;
+        int32_t offset_us;
+    };
+    ClockSample clock_filter[ESPNowGlobalConfig::CLOCK_FILTER_SIZE];
+    uint8_t clock_filter_count;
+    uint8_t clock_filter_next;
+    LatencyHistogram rtt_histogram;
+    LatencyHistogram one_way_histogram;
+    bool latency_changed;               // Since the histograms were last published
+    
+    // What the getters return to other tasks, published by publishState()
+    struct PublishedState {
+        Stats stats;
+        float loss_pct;
+        float loss_1s_pct;
+        float loss_10s_pct;
+        uint32_t connection_start_time;
+        uint32_t last_activity_time;
+        uint32_t session_id;
+        uint8_t peer_count;
+    };
+    struct PublishedLatency {
+        LatencyHistogram rtt;
+        LatencyHistogram one_way;
+    };
+    SnapshotBuffer<PublishedState> published;
+    SnapshotBuffer<PublishedLatency> published_latency;
+    void publishState();
+    float measureLossRate() const;
+    float measureLossRate1s() const;
+    float measureLossRate10s() const;
+    
+    // Per-peer wire, sequence and reliable-receive state. The pairing peer
+    // always holds primary_peer; its MAC mirrors peer_mac_address.
+    ESPNowPeerTable<ESPNowGlobalConfig::MAX_PEERS> peers;
+    PeerId primary_peer;
+    ESPNowPeer& primary() { return peers.get(primary_peer); }
+    const ESPNowPeer& primary() const { return peers.get(primary_peer); }
+    
+    // Coalesced frame for the pairing peer; the rx counters belong to the Wi-Fi callback
+    ESPNowWire::FrameWriter tx_batch;
+    uint8_t tx_batch_buffer[ESPNowWire::MAX_FRAME_SIZE];
+    uint32_t tx_batch_start_us;
+    bool coalescing_enabled;
+    std::atomic<uint32_t> rx_invalid_count;
+    std::atomic<uint32_t> rx_byte_count;
+    std::atomic<uint32_t> rx_unknown_peer_count;
+    std::atomic<uint32_t> rx_unsealed_count;
     
-    // Thread-safe message queue
+    ESPNowDispatchTable dispatch_table;
+    DeliveryCallback delivery_callback;
+    
+    // Reliable lane. A pending disconnect keeps the radio peer registered
+    // until it is acknowledged or given up on.
+    ESPNowReliable::Sender reliable_tx;
+    bool peer_removal_pending;
+    std::atomic<uint32_t> tx_failed_count;  // Written by the send callback
+    uint32_t tx_failed_seen;
+    
+    // RC stream state; channels are written by the app and read by the owner
+    esp_timer_handle_t rc_timer;
+    std::atomic<bool> rc_stream_running;  // Read by the app task
+    std::atomic<bool> rc_frame_due;       // Set by the timer, cleared by update()
+    portMUX_TYPE rc_lock;
+    uint16_t rc_channels[ESPNowMessage::RC_MAX_CHANNELS];
+    uint8_t rc_channel_count;
+    uint32_t rc_frames_sent;
+    
+    // Peer sequence trackers are advanced by the Wi-Fi callback and read by the owner
+    mutable portMUX_TYPE rx_sequence_lock;
+    
+    // Receive path without copies: the Wi-Fi callback decodes each message
+    // straight into a pooled buffer and passes its index through a lock-free
+    // priority lane; update() hands the handlers a const view and releases it
     struct QueuedMessage {
         uint8_t sender_mac[6];
+        PeerId peer;
+        uint8_t peer_generation;  // The slot may hold another peer by update()
+        uint32_t rx_time_us;  // micros() in the Wi-Fi callback
+        int8_t rssi;          // Of the frame, 0 = not reported
+        bool reliable;        // Sender expects an ACK
         ESPNowMessage message;
     };
-    std::queue<QueuedMessage> message_queue;
-    SemaphoreHandle_t queue_mutex;
+    typedef BufferPool<QueuedMessage, ESPNowGlobalConfig::RX_BUFFER_POOL_SIZE> RxPool;
+    RxPool rx_pool;
+    RxPool::Index rx_claimed;  // Callback side only: claimed but not queued, reused for the next record
+    SPSCQueue<RxPool::Index, ESPNowGlobalConfig::MESSAGE_QUEUE_SIZE> rx_lanes[ESPNowConfig::PRIORITY_COUNT];
     SemaphoreHandle_t state_mutex;
     
-    // Instance management with proper synchronization
-    static ESPNowManager* instance;
-    static SemaphoreHandle_t instance_mutex;
-    static void onDataReceived(const uint8_t* mac_addr, const uint8_t* data, int len);
-    static void onDataSent(const uint8_t* mac_addr, esp_now_send_status_t status);
+    // Link task hand-over, one SPSC queue each way: app calls in, callbacks out
+    enum class LinkRequestType : uint8_t {
+        SEND_MESSAGE,
+        SEND_TO_PEER,
+        SEND_RELIABLE,
+        START_CONNECTION,
+        STOP_CONNECTION,
+        DISCONNECT,
+        SET_COALESCING,
+        START_RC_STREAM,
+        STOP_RC_STREAM,
+        REGISTER_PEER,      // MAC and role in the message data
+        UNREGISTER_PEER
+    };
+    struct LinkRequest {
+        LinkRequestType type;
+        PeerId peer;
+        uint16_t value;     // Rate or flag of the request
+        ESPNowMessage message;
+    };
+    enum class CallbackKind : uint8_t {
+        MESSAGE,
+        DELIVERY
+    };
+    struct LinkEvent {
+        CallbackKind kind;
+        PeerId peer;
+        bool delivered;
+        ESPNowMessage message;
+    };
+    std::atomic<ESPNowLinkTask*> link_task;
+    std::atomic<PeerId> registered_peer;  // Result of the last REGISTER_PEER
+    SPSCQueue<LinkRequest, ESPNowGlobalConfig::LINK_REQUEST_QUEUE_SIZE> link_requests;
+    SPSCQueue<LinkEvent, ESPNowGlobalConfig::LINK_EVENT_QUEUE_SIZE> link_events;
+    bool isAppCaller() const;
+    hal_status_t postRequest(LinkRequestType type, const ESPNowMessage* msg = nullptr, PeerId peer = INVALID_PEER,
+                             uint16_t value = 0);
+    void processRequests();
+    void dispatchCallbacks();
+    void deliverCallback(CallbackKind kind, const ESPNowMessage* msg, PeerId peer = INVALID_PEER,
+                         bool delivered = false);
+    void invokeCallback(CallbackKind kind, const ESPNowMessage* msg, PeerId peer, bool delivered);
+    
+    // Transport handlers, called from the Wi-Fi task on target
+    static void onDataReceived(void* context, const uint8_t* mac_addr, const uint8_t* data, int len, int8_t rssi);
+    static void onDataSent(void* context, const uint8_t* mac_addr, bool delivered);
+    static void onRcTimer(void* arg);
+    void sendRcFrame();
     
     hal_status_t handleUninitialized(uint32_t delta_ms);
     hal_status_t handleSearching(uint32_t delta_ms);
@@ -128,24 +459,80 @@ private:
     hal_status_t handleReconnecting(uint32_t delta_ms);
     hal_status_t handleError(uint32_t delta_ms);
     
-    hal_status_t processMessage(const uint8_t* sender_mac, const ESPNowMessage* msg);
+    hal_status_t processMessage(const uint8_t* sender_mac, const ESPNowMessage* msg, uint32_t rx_time_us,
+                                bool reliable);
+    void processPeerMessage(PeerId peer_id, const ESPNowMessage* msg, uint32_t rx_time_us, bool reliable);
+    void updatePeerStates();
+    void handlePong(const ESPNowMessage* msg, uint32_t rx_time_us);
+    void recordPing(uint32_t counter);
+    hal_status_t sendKeepalive();
+    uint32_t nextKeepaliveTime() const;
+    void piggybackLinkRecords();
+    bool appendToBatch(const ESPNowMessage& msg);
+    hal_status_t transmitFrame(const uint8_t* mac, const ESPNowMessage& msg,
+                               ESPNowWire::EncoderState& wire_state, uint8_t record_flags = 0,
+                               bool seal = true);
+    // Frames to the pairing peer are sealed once the session has a traffic key
+    hal_status_t transmitRaw(const uint8_t* mac, const uint8_t* frame, size_t len, bool seal = true);
+    size_t frameCapacity() const;  // Plain frame bytes that still fit once sealed
+    hal_status_t queueForBatch(const ESPNowMessage& msg, uint8_t record_flags = 0);
+    hal_status_t prepareMessage(const ESPNowMessage& msg, ESPNowMessage& stamped);
+    hal_status_t routeMessage(const ESPNowMessage& msg, uint8_t record_flags);
+    hal_status_t sendAck(PeerId peer_id);
+    void serviceReliable();
+    static void onReliableRetransmit(void* context, const ESPNowMessage& msg);
+    static void onReliableResolved(void* context, const ESPNowMessage& msg, bool delivered);
     hal_status_t sendAnnounce();
     hal_status_t sendPairRequest();
     hal_status_t sendPairResponse();
+    hal_status_t sendResume(bool reply, const uint8_t* echo = nullptr);
+    bool acceptSecureResume(const ESPNowMessage* msg);
+    bool canResume() const {
+        return ESPNowGlobalConfig::ENABLE_FAST_RECONNECT && session_id != 0 &&
+               (!session.isEnabled() || session.hasMasterKey());
+    }
+    uint32_t nextResumeDelay() const;
+    void loadSavedSession();
+    
+    bool isChannelPlanner() const;
+    void resetChannel();                // Home channel, any plan dropped
+    void tuneRadio(uint8_t channel);
+    void announceChannelPlan(ChannelPlan plan, uint8_t channel, uint32_t now);
+    hal_status_t sendChannelPlan(uint32_t now);
+    void acceptChannelPlan(const ESPNowMessage* msg, uint32_t now);
+    void countChannelProbe(const ESPNowMessage* msg);
+    void serviceChannel(uint32_t now);
+    void serviceSurvey(uint32_t now);
+    void finishSurvey(uint32_t now);
+    void checkChannelQuality(uint32_t now);
+    uint32_t txFrameCount() const { return stats.frames_sent + rc_frames_sent; }
     
     hal_status_t addPeer();
     hal_status_t removePeer();
+    hal_status_t addRadioPeer(ESPNowPeer& peer);
     
     bool isMacEqual(const uint8_t* mac1, const uint8_t* mac2) const;
     void transitionToState(State new_state);
+    void applyState(State new_state);   // Caller holds the state mutex; no entry side effects
+    void armStateTimers(State new_state);
+    void onStateChanged(State from, State to);  // Only writer of current_state
     
     // Thread-safe message processing
-    void queueMessage(const uint8_t* sender_mac, const ESPNowMessage* msg);
+    struct DecodeContext {
+        ESPNowManager* manager;
+        const uint8_t* sender_mac;
+        PeerId peer;
+        uint32_t rx_time_us;
+        int8_t rssi;
+        bool sealed;
+    };
+    void receiveFrame(const uint8_t* sender_mac, const uint8_t* data, int len, int8_t rssi);
+    void receivePeerFrame(PeerId peer_id, const uint8_t* sender_mac, const uint8_t* data, int len, int8_t rssi);
+    static ESPNowMessage* onRecordClaim(void* context);
+    static void onRecordDecoded(void* context, const ESPNowMessage& msg, uint8_t record_flags);
+    void queueMessage(const uint8_t* sender_mac, PeerId peer_id, uint32_t rx_time_us, int8_t rssi,
+                      uint8_t record_flags, bool sealed);
     void processMessageQueue();
-    
-    // Instance registration/unregistration
-    static void registerInstance(ESPNowManager* mgr);
-    static void unregisterInstance(ESPNowManager* mgr);
 };
 
 #endif
\ No newline at end of file
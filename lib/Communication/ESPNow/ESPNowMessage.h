@@ -1,25 +1,10 @@
 #ifndef ESPNOW_MESSAGE_H
 #define ESPNOW_MESSAGE_H
 
-#include <Arduino.h>
+#include "../../Core/Platform.h"
 #include <string.h>
 #include "ESPNowConfig.h"
-
-// Simple CRC16 implementation for message validation
-static uint16_t crc16(const uint8_t* data, size_t len) {
-    uint16_t crc = 0xFFFF;
-    for (size_t i = 0; i < len; i++) {
-        crc ^= (uint16_t)data[i] << 8;
-        for (int j = 0; j < 8; j++) {
-            if (crc & 0x8000) {
-                crc = (crc << 1) ^ 0x1021;
-            } else {
-                crc <<= 1;
-            }
-        }
-    }
-    return crc;
-}
+#include "ESPNowCRC.h"
 
 struct ESPNowMessage {
     uint8_t magic;
@@ -28,7 +13,7 @@ struct ESPNowMessage {
     uint32_t sequence;
     uint32_t timestamp;
     uint8_t data[32];
-    uint16_t crc;  // CRC16 of all preceding fields
+    uint16_t crc;  // CRC16 of all preceding fields (legacy wire format only)
     
     ESPNowMessage() : magic(ESPNowConfig::MESSAGE_MAGIC), type(0), role(0), sequence(0), timestamp(0), crc(0) {
         memset(data, 0, sizeof(data));
@@ -48,7 +33,7 @@ struct ESPNowMessage {
     uint16_t calculateCRC() const {
         // Calculate CRC of all fields except the CRC field itself
         size_t crc_offset = offsetof(ESPNowMessage, crc);
-        return crc16(reinterpret_cast<const uint8_t*>(this), crc_offset);
+        return ESPNowCRC::crc16(reinterpret_cast<const uint8_t*>(this), crc_offset);
     }
     
     void updateCRC() {
@@ -61,12 +46,21 @@ struct ESPNowMessage {
         updateCRC();
     }
     
-    void setPongData(uint32_t counter) {
+    // rx_us/tx_us are the responder's micros() when the ping arrived and when
+    // the pong left; the initiator uses them for the NTP-style offset estimate
+    void setPongData(uint32_t counter, uint32_t rx_us = 0, uint32_t tx_us = 0) {
         type = ESPNowConfig::MSG_PONG;
         memcpy(data, &counter, sizeof(counter));
+        memcpy(&data[4], &rx_us, sizeof(rx_us));
+        memcpy(&data[8], &tx_us, sizeof(tx_us));
         updateCRC();
     }
     
+    void getPongTimes(uint32_t& rx_us, uint32_t& tx_us) const {
+        memcpy(&rx_us, &data[4], sizeof(rx_us));
+        memcpy(&tx_us, &data[8], sizeof(tx_us));
+    }
+    
     uint32_t getPingPongCounter() const {
         uint32_t counter = 0;
         memcpy(&counter, data, sizeof(counter));
@@ -139,6 +133,201 @@ struct ESPNowMessage {
         memcpy(&eventData, &data[2], sizeof(eventData));
         return eventData;
     }
+    
+    // RC channel methods
+    // data[0]: channel count (bits 0-4) and 12-bit flag (bit 7), followed by
+    // the channel values packed LSB-first at 11 or 12 bits each
+    static constexpr uint8_t RC_MAX_CHANNELS = 16;
+    static constexpr uint16_t RC_MIN_US = 1000;
+    static constexpr uint16_t RC_MAX_US = 2000;
+    
+    // Fixed-point mapping of a 1000-2000 us pulse onto the full channel range
+    static uint16_t rcValueFromMicros(uint16_t pulse_us, uint8_t bits = 11) {
+        if (pulse_us < RC_MIN_US) pulse_us = RC_MIN_US;
+        if (pulse_us > RC_MAX_US) pulse_us = RC_MAX_US;
+        uint32_t max_value = (1u << bits) - 1;
+        return static_cast<uint16_t>(((pulse_us - RC_MIN_US) * max_value + (RC_MAX_US - RC_MIN_US) / 2) /
+                                     (RC_MAX_US - RC_MIN_US));
+    }
+    
+    static uint16_t rcValueToMicros(uint16_t value, uint8_t bits = 11) {
+        uint32_t max_value = (1u << bits) - 1;
+        return static_cast<uint16_t>(RC_MIN_US + (value * (uint32_t)(RC_MAX_US - RC_MIN_US) + max_value / 2) / max_value);
+    }
+    
+    // No updateCRC(): RC channels are only sent in the compact wire format
+    void setRcChannels(const uint16_t* channels, uint8_t count, uint8_t bits = 11) {
+        type = ESPNowConfig::MSG_RC_CHANNELS;
+        if (count > RC_MAX_CHANNELS) count = RC_MAX_CHANNELS;
+        bits = (bits == 12) ? 12 : 11;
+        
+        memset(data, 0, sizeof(data));
+        data[0] = count | ((bits == 12) ? 0x80 : 0x00);
+        
+        uint16_t mask = (1u << bits) - 1;
+        uint32_t bit_pos = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            uint32_t value = channels[i] & mask;
+            for (uint8_t written = 0; written < bits; ) {
+                uint8_t byte_index = 1 + bit_pos / 8;
+                uint8_t bit_offset = bit_pos % 8;
+                uint8_t chunk = 8 - bit_offset;
+                if (chunk > bits - written) chunk = bits - written;
+                data[byte_index] |= static_cast<uint8_t>(((value >> written) & ((1u << chunk) - 1)) << bit_offset);
+                written += chunk;
+                bit_pos += chunk;
+            }
+        }
+    }
+    
+    uint8_t getRcChannelCount() const {
+        uint8_t count = data[0] & 0x1F;
+        return (count > RC_MAX_CHANNELS) ? RC_MAX_CHANNELS : count;
+    }
+    
+    uint8_t getRcChannelBits() const {
+        return (data[0] & 0x80) ? 12 : 11;
+    }
+    
+    // Returns the number of channels written to out
+    uint8_t getRcChannels(uint16_t* out, uint8_t max_channels) const {
+        uint8_t count = getRcChannelCount();
+        if (count > max_channels) count = max_channels;
+        uint8_t bits = getRcChannelBits();
+        
+        uint32_t bit_pos = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            uint32_t value = 0;
+            for (uint8_t read = 0; read < bits; ) {
+                uint8_t byte_index = 1 + bit_pos / 8;
+                uint8_t bit_offset = bit_pos % 8;
+                uint8_t chunk = 8 - bit_offset;
+                if (chunk > bits - read) chunk = bits - read;
+                value |= static_cast<uint32_t>((data[byte_index] >> bit_offset) & ((1u << chunk) - 1)) << read;
+                read += chunk;
+                bit_pos += chunk;
+            }
+            out[i] = static_cast<uint16_t>(value);
+        }
+        return count;
+    }
+    
+    // Command methods (arm/disarm/mode), sent with ESPNowManager::sendCommand()
+    void setCommand(uint8_t command, uint8_t argument = 0) {
+        type = ESPNowConfig::MSG_COMMAND;
+        data[0] = command;
+        data[1] = argument;
+        updateCRC();
+    }
+    
+    uint8_t getCommandId() const { return data[0]; }
+    uint8_t getCommandArgument() const { return data[1]; }
+    
+    // Selective acknowledgement: bit n of bitmap covers sequence - 1 - n
+    void setAck(uint32_t sequence, uint32_t bitmap) {
+        type = ESPNowConfig::MSG_ACK;
+        memcpy(data, &sequence, sizeof(sequence));
+        memcpy(&data[4], &bitmap, sizeof(bitmap));
+        updateCRC();
+    }
+    
+    void getAck(uint32_t& sequence, uint32_t& bitmap) const {
+        memcpy(&sequence, data, sizeof(sequence));
+        memcpy(&bitmap, &data[4], sizeof(bitmap));
+    }
+    
+    // Channel agility (ESPNowChannelSurvey). A plan takes effect start_in_ms
+    // after it arrives; every copy of an announcement counts down.
+    //   CHANNEL_PLAN:  [op 0] [plan id 1] [channel 2] [dwell ms 3] [starts in ms 4-5] [survey mask 6-7]
+    //   CHANNEL_PROBE: [channel 0] [probe index 1]
+    void setChannelPlan(uint8_t op, uint8_t plan_id, uint8_t channel, uint8_t dwell_ms, uint16_t start_in_ms,
+                        uint16_t survey_mask) {
+        type = ESPNowConfig::MSG_CHANNEL_PLAN;
+        data[0] = op;
+        data[1] = plan_id;
+        data[2] = channel;
+        data[3] = dwell_ms;
+        memcpy(&data[4], &start_in_ms, sizeof(start_in_ms));
+        memcpy(&data[6], &survey_mask, sizeof(survey_mask));
+        updateCRC();
+    }
+    
+    uint8_t getChannelPlanOp() const { return data[0]; }
+    uint8_t getChannelPlanId() const { return data[1]; }
+    uint8_t getChannelPlanChannel() const { return data[2]; }
+    uint8_t getChannelPlanDwell() const { return data[3]; }
+    
+    uint16_t getChannelPlanStartIn() const {
+        uint16_t start_in_ms = 0;
+        memcpy(&start_in_ms, &data[4], sizeof(start_in_ms));
+        return start_in_ms;
+    }
+    
+    uint16_t getChannelPlanMask() const {
+        uint16_t mask = 0;
+        memcpy(&mask, &data[6], sizeof(mask));
+        return mask;
+    }
+    
+    void setChannelProbe(uint8_t channel, uint8_t index) {
+        type = ESPNowConfig::MSG_CHANNEL_PROBE;
+        data[0] = channel;
+        data[1] = index;
+        updateCRC();
+    }
+    
+    uint8_t getProbeChannel() const { return data[0]; }
+    
+    // Session methods: the base hands out a session id in the pair response,
+    // and either side can later resume it with MSG_RESUME. Encrypted sessions
+    // (ESPNowSession) also carry the sender's handshake nonce and a confirm
+    // tag; both stay zero, and off the air, otherwise.
+    //   PAIR_REQUEST:  [nonce 0-7] [confirm 8-15]
+    //   PAIR_RESPONSE: [session 0-3] [nonce 4-11] [confirm 12-19]
+    //   RESUME:        [session 0-3] [reply 4] [nonce 5-12] [echoed nonce 13-20] [confirm 21-28]
+    static constexpr uint8_t HANDSHAKE_NONCE_SIZE = 8;
+    static constexpr uint8_t HANDSHAKE_CONFIRM_SIZE = 8;
+    
+    void setPairRequest(const uint8_t* nonce = nullptr) {
+        type = ESPNowConfig::MSG_PAIR_REQUEST;
+        if (nonce) memcpy(data, nonce, HANDSHAKE_NONCE_SIZE);
+        updateCRC();
+    }
+    
+    void setPairResponse(uint32_t session_id, const uint8_t* nonce = nullptr) {
+        type = ESPNowConfig::MSG_PAIR_RESPONSE;
+        memcpy(data, &session_id, sizeof(session_id));
+        if (nonce) memcpy(&data[4], nonce, HANDSHAKE_NONCE_SIZE);
+        updateCRC();
+    }
+    
+    void setResume(uint32_t session_id, bool reply, const uint8_t* nonce = nullptr,
+                   const uint8_t* echo = nullptr) {
+        type = ESPNowConfig::MSG_RESUME;
+        memcpy(data, &session_id, sizeof(session_id));
+        data[4] = reply ? 1 : 0;
+        if (nonce) memcpy(&data[5], nonce, HANDSHAKE_NONCE_SIZE);
+        if (echo) memcpy(&data[13], echo, HANDSHAKE_NONCE_SIZE);
+        updateCRC();
+    }
+    
+    uint32_t getSessionId() const {
+        uint32_t session_id = 0;
+        memcpy(&session_id, data, sizeof(session_id));
+        return session_id;
+    }
+    
+    bool isResumeReply() const { return data[4] != 0; }
+    const uint8_t* getResumeEcho() const { return &data[13]; }
+    
+    const uint8_t* getHandshakeNonce() const {
+        return &data[type == ESPNowConfig::MSG_PAIR_RESPONSE ? 4 : type == ESPNowConfig::MSG_RESUME ? 5 : 0];
+    }
+    
+    // The confirm tag covers the payload before it
+    uint8_t getHandshakeConfirmOffset() const {
+        return type == ESPNowConfig::MSG_PAIR_RESPONSE ? 12 : type == ESPNowConfig::MSG_RESUME ? 21 : 8;
+    }
 } __attribute__((packed));
 
 #endif
\ No newline at end of file
@@ -0,0 +1,248 @@
+#ifndef ESPNOW_PEER_TABLE_H
+#define ESPNOW_PEER_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+#include "ESPNowWire.h"
+#include "ESPNowSequence.h"
+#include "ESPNowReliable.h"
+
+// Link state tracked for every peer. The primary (pairing) peer follows the
+// manager's handshake state; other peers go ACTIVE on traffic and LOST after
+// CONNECTION_TIMEOUT_MS without any.
+enum class ESPNowPeerState : uint8_t {
+    IDLE = 0,
+    ACTIVE,
+    LOST
+};
+
+struct ESPNowPeerStats {
+    uint32_t messages_sent;
+    uint32_t messages_received;
+    uint32_t bytes_received;
+    uint32_t last_activity_ms;
+};
+
+struct ESPNowPeer {
+    uint8_t mac[6];
+    uint8_t role;
+    uint8_t generation;  // Bumped each time the slot takes a new peer
+    bool in_use;
+    ESPNowPeerState state;
+    bool radio_registered;
+
+    // Receive side, owned by the Wi-Fi callback
+    ESPNowWire::DecoderState rx_wire;
+    SequenceTracker rx_sequence;
+    std::atomic<bool> rx_reset;  // Set by the main loop, applied by the Wi-Fi callback
+    std::atomic<uint32_t> rx_bytes;
+
+    // Send side and message handling, owned by the main loop
+    uint32_t tx_sequence;
+    ESPNowWire::EncoderState tx_wire;
+    ESPNowReliable::Receiver reliable_rx;
+    ESPNowPeerStats stats;
+
+    ESPNowPeer()
+        : role(0)
+        , generation(0)
+        , in_use(false)
+        , state(ESPNowPeerState::IDLE)
+        , radio_registered(false)
+        , rx_sequence(0)
+        , rx_reset(false)
+        , rx_bytes(0)
+        , tx_sequence(0) {
+        memset(mac, 0, sizeof(mac));
+        memset(&stats, 0, sizeof(stats));
+    }
+
+    void reset(const uint8_t* peer_mac, uint8_t peer_role) {
+        memcpy(mac, peer_mac, 6);
+        role = peer_role;
+        state = ESPNowPeerState::IDLE;
+        radio_registered = false;
+        ESPNowWire::resetDecoder(rx_wire);
+        rx_sequence.reset();
+        rx_reset.store(false, std::memory_order_relaxed);
+        rx_bytes.store(0, std::memory_order_relaxed);
+        tx_sequence = 0;
+        ESPNowWire::resetEncoder(tx_wire);
+        reliable_rx.reset();
+        memset(&stats, 0, sizeof(stats));
+    }
+};
+
+// Fixed-size peer table with an open-addressed MAC hash index, so the receive
+// callback finds the sender in O(1) without allocating. Peers are added and
+// removed by the main loop only. The index is published with release stores,
+// so find() is safe from the Wi-Fi callback.
+//
+// The callback holds the peer it is decoding for with pin()/unpin(). A peer
+// removed while pinned leaves the index at once but keeps its slot until the
+// pin is gone, so add() can't clear it under the callback. Anything that
+// keeps a PeerId past the callback (a queued message) keeps the generation
+// too and checks isCurrent(), as the slot may hold another peer by then.
+template<uint8_t MaxPeers>
+class ESPNowPeerTable {
+    static_assert(MaxPeers >= 1 && MaxPeers < 0x7F && (MaxPeers & (MaxPeers - 1)) == 0,
+                  "ESPNowPeerTable size must be a power of two");
+
+public:
+    typedef uint8_t PeerId;
+    static constexpr PeerId INVALID_PEER = 0xFF;
+
+    explicit ESPNowPeerTable(uint32_t max_sequence_gap) {
+        for (uint8_t i = 0; i < MaxPeers; i++) {
+            peers[i].rx_sequence.setMaxGap(max_sequence_gap);
+        }
+        for (uint8_t i = 0; i < INDEX_SIZE; i++) {
+            index[i].store(EMPTY, std::memory_order_relaxed);
+        }
+        for (uint8_t i = 0; i < MaxPeers; i++) {
+            retired[i] = false;
+        }
+        pinned.store(INVALID_PEER, std::memory_order_relaxed);
+    }
+
+    // Returns the existing id if the MAC is already present, INVALID_PEER when full
+    PeerId add(const uint8_t* mac, uint8_t role) {
+        PeerId existing = find(mac);
+        if (existing != INVALID_PEER) return existing;
+
+        reclaim();
+        PeerId id = INVALID_PEER;
+        for (uint8_t i = 0; i < MaxPeers; i++) {
+            if (!peers[i].in_use) {
+                id = i;
+                break;
+            }
+        }
+        if (id == INVALID_PEER) return INVALID_PEER;
+
+        ESPNowPeer& peer = peers[id];
+        peer.reset(mac, role);
+        peer.generation++;
+        peer.in_use = true;
+
+        uint8_t pos = hash(mac);
+        for (uint8_t probe = 0; probe < INDEX_SIZE; probe++) {
+            uint8_t entry = index[pos].load(std::memory_order_relaxed);
+            if (entry == EMPTY || entry == TOMBSTONE) {
+                index[pos].store(static_cast<uint8_t>(id + 1), std::memory_order_release);
+                return id;
+            }
+            pos = (pos + 1) & (INDEX_SIZE - 1);
+        }
+
+        peer.in_use = false;  // Unreachable: the index has twice as many entries as peers
+        return INVALID_PEER;
+    }
+
+    bool remove(PeerId id) {
+        if (!isValid(id)) return false;
+
+        uint8_t pos = hash(peers[id].mac);
+        for (uint8_t probe = 0; probe < INDEX_SIZE; probe++) {
+            uint8_t entry = index[pos].load(std::memory_order_relaxed);
+            if (entry == EMPTY) break;
+            if (entry == id + 1) {
+                index[pos].store(TOMBSTONE, std::memory_order_release);
+                break;
+            }
+            pos = (pos + 1) & (INDEX_SIZE - 1);
+        }
+
+        // Pairs with the fence in pin(): either the callback sees the
+        // tombstone, or this sees its pin and leaves the slot alone
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        retired[id] = true;
+        reclaim();
+        return true;
+    }
+
+    // Wi-Fi callback: finds the sender and keeps its slot from being reused
+    // until unpin(). One pin at a time.
+    PeerId pin(const uint8_t* mac) {
+        PeerId id = find(mac);
+        if (id == INVALID_PEER) return INVALID_PEER;
+
+        pinned.store(id, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // Removed between the two lookups: the slot may already be reclaimed
+        if (find(mac) != id) {
+            unpin();
+            return INVALID_PEER;
+        }
+        return id;
+    }
+
+    void unpin() { pinned.store(INVALID_PEER, std::memory_order_release); }
+
+    PeerId find(const uint8_t* mac) const {
+        if (!mac) return INVALID_PEER;
+
+        uint8_t pos = hash(mac);
+        for (uint8_t probe = 0; probe < INDEX_SIZE; probe++) {
+            uint8_t entry = index[pos].load(std::memory_order_acquire);
+            if (entry == EMPTY) return INVALID_PEER;
+            if (entry != TOMBSTONE && memcmp(peers[entry - 1].mac, mac, 6) == 0) {
+                return static_cast<PeerId>(entry - 1);
+            }
+            pos = (pos + 1) & (INDEX_SIZE - 1);
+        }
+        return INVALID_PEER;
+    }
+
+    bool isValid(PeerId id) const { return id < MaxPeers && peers[id].in_use && !retired[id]; }
+    bool isCurrent(PeerId id, uint8_t generation) const {
+        return isValid(id) && peers[id].generation == generation;
+    }
+
+    ESPNowPeer& get(PeerId id) { return peers[id]; }
+    const ESPNowPeer& get(PeerId id) const { return peers[id]; }
+
+    uint8_t count() const {
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < MaxPeers; i++) {
+            if (isValid(i)) n++;
+        }
+        return n;
+    }
+
+    static constexpr uint8_t capacity() { return MaxPeers; }
+
+private:
+    static constexpr uint8_t INDEX_SIZE = MaxPeers * 2;
+    static constexpr uint8_t EMPTY = 0;
+    static constexpr uint8_t TOMBSTONE = 0xFF;
+
+    ESPNowPeer peers[MaxPeers];
+    std::atomic<uint8_t> index[INDEX_SIZE];  // PeerId + 1, EMPTY or TOMBSTONE
+    bool retired[MaxPeers];                  // Removed, slot still pinned by the callback
+    std::atomic<PeerId> pinned;
+
+    // Frees removed slots the callback no longer holds
+    void reclaim() {
+        PeerId held = pinned.load(std::memory_order_acquire);
+        for (uint8_t i = 0; i < MaxPeers; i++) {
+            if (retired[i] && i != held) {
+                retired[i] = false;
+                peers[i].in_use = false;
+            }
+        }
+    }
+
+    // FNV-1a over the MAC, folded to the index size
+    static uint8_t hash(const uint8_t* mac) {
+        uint32_t h = 2166136261u;
+        for (uint8_t i = 0; i < 6; i++) {
+            h = (h ^ mac[i]) * 16777619u;
+        }
+        return static_cast<uint8_t>((h ^ (h >> 16)) & (INDEX_SIZE - 1));
+    }
+};
+
+#endif
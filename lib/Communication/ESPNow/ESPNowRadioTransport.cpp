@@ -0,0 +1,166 @@
+#include "ESPNowRadioTransport.h"
+
+#ifdef ARDUINO
+
+#include "../../Core/Logger.h"
+
+ESPNowRadioTransport& ESPNowRadioTransport::getInstance() {
+    static ESPNowRadioTransport transport;
+    return transport;
+}
+
+ESPNowRadioTransport::ESPNowRadioTransport()
+    : handler_mutex(xSemaphoreCreateMutex())
+    , receive_handler(nullptr)
+    , send_handler(nullptr)
+    , handler_context(nullptr)
+    , is_started(false)
+    , last_rssi(0) {
+    memset(last_rssi_mac, 0, sizeof(last_rssi_mac));
+}
+
+hal_status_t ESPNowRadioTransport::begin(ReceiveHandler on_receive, SendHandler on_sent, void* context) {
+    if (is_started) {
+        LOG_ERROR("ESPNow", "Radio transport already in use");
+        return HAL_BUSY;
+    }
+
+    WiFi.mode(WIFI_STA);
+    WiFi.disconnect();
+
+    if (esp_now_init() != ESP_OK) {
+        LOG_ERROR("ESPNow", "Failed to initialize ESP-NOW");
+        return HAL_ERROR;
+    }
+
+    if (xSemaphoreTake(handler_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        receive_handler = on_receive;
+        send_handler = on_sent;
+        handler_context = context;
+        xSemaphoreGive(handler_mutex);
+    }
+
+    esp_now_register_recv_cb(onDataReceived);
+    esp_now_register_send_cb(onDataSent);
+
+    wifi_promiscuous_filter_t filter = {};
+    filter.filter_mask = WIFI_PROMIS_FILTER_MASK_MGMT;
+    esp_wifi_set_promiscuous_filter(&filter);
+    esp_wifi_set_promiscuous_rx_cb(onPromiscuous);
+    esp_wifi_set_promiscuous(true);
+    is_started = true;
+    return HAL_OK;
+}
+
+void ESPNowRadioTransport::end() {
+    if (!is_started) return;
+
+    // Wait out a callback that is still running before the owner goes away
+    if (xSemaphoreTake(handler_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        receive_handler = nullptr;
+        send_handler = nullptr;
+        handler_context = nullptr;
+        xSemaphoreGive(handler_mutex);
+    }
+
+    esp_wifi_set_promiscuous(false);
+    esp_wifi_set_promiscuous_rx_cb(nullptr);
+    esp_now_unregister_recv_cb();
+    esp_now_unregister_send_cb();
+    esp_now_deinit();
+    is_started = false;
+}
+
+hal_status_t ESPNowRadioTransport::send(const uint8_t* mac, const uint8_t* data, size_t len) {
+    esp_err_t result = esp_now_send(mac, data, len);
+    if (result != ESP_OK) {
+        LOG_ERROR("ESPNow", "Send failed with error: %d", result);
+        return HAL_ERROR;
+    }
+    return HAL_OK;
+}
+
+hal_status_t ESPNowRadioTransport::addPeer(const uint8_t* mac, uint8_t channel) {
+    esp_now_peer_info_t peer_info = {};
+    memcpy(peer_info.peer_addr, mac, 6);
+    peer_info.channel = channel;
+    peer_info.encrypt = false;
+
+    esp_err_t result = esp_now_add_peer(&peer_info);
+    if (result != ESP_OK) {
+        LOG_ERROR("ESPNow", "Failed to add peer: %d", result);
+        return HAL_ERROR;
+    }
+    return HAL_OK;
+}
+
+hal_status_t ESPNowRadioTransport::removePeer(const uint8_t* mac) {
+    return esp_now_del_peer(mac) == ESP_OK ? HAL_OK : HAL_ERROR;
+}
+
+bool ESPNowRadioTransport::hasPeer(const uint8_t* mac) const {
+    return esp_now_is_peer_exist(mac);
+}
+
+hal_status_t ESPNowRadioTransport::setChannel(uint8_t channel) {
+    esp_err_t result = esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+    if (result != ESP_OK) {
+        LOG_ERROR("ESPNow", "Failed to set channel %u: %d", channel, result);
+        return HAL_ERROR;
+    }
+    return HAL_OK;
+}
+
+uint8_t ESPNowRadioTransport::getChannel() const {
+    uint8_t primary = 0;
+    wifi_second_chan_t secondary;
+    esp_wifi_get_channel(&primary, &secondary);
+    return primary;
+}
+
+void ESPNowRadioTransport::getMacAddress(uint8_t* mac) const {
+    WiFi.macAddress(mac);
+}
+
+void ESPNowRadioTransport::onPromiscuous(void* buffer, wifi_promiscuous_pkt_type_t type) {
+    if (type != WIFI_PKT_MGMT) return;
+
+    // Sender (addr2) sits at offset 10 of the 802.11 header
+    const wifi_promiscuous_pkt_t* packet = static_cast<const wifi_promiscuous_pkt_t*>(buffer);
+    if (packet->rx_ctrl.sig_len < 16) return;
+    ESPNowRadioTransport& transport = getInstance();
+    memcpy(transport.last_rssi_mac, packet->payload + 10, 6);
+    transport.last_rssi = static_cast<int8_t>(packet->rx_ctrl.rssi);
+}
+
+void ESPNowRadioTransport::onDataReceived(const uint8_t* mac_addr, const uint8_t* data, int len) {
+    ESPNowRadioTransport& transport = getInstance();
+
+    // Can't wait in the Wi-Fi task; a frame arriving during begin()/end() is dropped
+    if (xSemaphoreTake(transport.handler_mutex, 0) != pdTRUE) {
+        return;
+    }
+
+    if (transport.receive_handler && data && len > 0) {
+        int8_t rssi = (memcmp(transport.last_rssi_mac, mac_addr, 6) == 0) ? transport.last_rssi : 0;
+        transport.receive_handler(transport.handler_context, mac_addr, data, len, rssi);
+    }
+
+    xSemaphoreGive(transport.handler_mutex);
+}
+
+void ESPNowRadioTransport::onDataSent(const uint8_t* mac_addr, esp_now_send_status_t status) {
+    ESPNowRadioTransport& transport = getInstance();
+
+    if (xSemaphoreTake(transport.handler_mutex, 0) != pdTRUE) {
+        return;
+    }
+
+    if (transport.send_handler) {
+        transport.send_handler(transport.handler_context, mac_addr, status == ESP_NOW_SEND_SUCCESS);
+    }
+
+    xSemaphoreGive(transport.handler_mutex);
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef ESPNOW_RADIO_TRANSPORT_H
+#define ESPNOW_RADIO_TRANSPORT_H
+
+#ifdef ARDUINO
+
+#include <Arduino.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+#include <WiFi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "ESPNowTransport.h"
+
+// ESP-NOW on the station interface. The driver callbacks carry no context,
+// so there is a single instance, shared by whoever owns the radio.
+//
+// The receive callback doesn't report RSSI either. A promiscuous callback
+// for management frames (ESP-NOW frames are vendor action frames) keeps the
+// last one's RSSI and sender, and a received frame takes it if they match.
+class ESPNowRadioTransport : public ESPNowTransport {
+public:
+    static ESPNowRadioTransport& getInstance();
+
+    hal_status_t begin(ReceiveHandler on_receive, SendHandler on_sent, void* context) override;
+    void end() override;
+
+    hal_status_t send(const uint8_t* mac, const uint8_t* data, size_t len) override;
+    hal_status_t addPeer(const uint8_t* mac, uint8_t channel) override;
+    hal_status_t removePeer(const uint8_t* mac) override;
+    bool hasPeer(const uint8_t* mac) const override;
+
+    hal_status_t setChannel(uint8_t channel) override;
+    uint8_t getChannel() const override;
+
+    void getMacAddress(uint8_t* mac) const override;
+
+private:
+    ESPNowRadioTransport();
+
+    // Guards the handlers against end() while a callback is running
+    SemaphoreHandle_t handler_mutex;
+    ReceiveHandler receive_handler;
+    SendHandler send_handler;
+    void* handler_context;
+    bool is_started;
+
+    // Written by the promiscuous callback, read by the receive callback; both run in the Wi-Fi task
+    volatile int8_t last_rssi;
+    uint8_t last_rssi_mac[6];
+
+    static void onPromiscuous(void* buffer, wifi_promiscuous_pkt_type_t type);
+    static void onDataReceived(const uint8_t* mac_addr, const uint8_t* data, int len);
+    static void onDataSent(const uint8_t* mac_addr, esp_now_send_status_t status);
+};
+
+#endif
+
+#endif
@@ -0,0 +1,159 @@
+#include "ESPNowReliable.h"
+
+namespace ESPNowReliable {
+
+Sender::Sender(uint16_t initial_rto_ms, uint16_t max_rto_ms, uint8_t max_attempts)
+    : initial_rto_ms(initial_rto_ms)
+    , max_rto_ms(max_rto_ms)
+    , max_attempts(max_attempts) {
+    for (uint8_t i = 0; i < SLOT_COUNT; i++) {
+        slots[i].in_use = false;
+    }
+    memset(&counters, 0, sizeof(counters));
+}
+
+bool Sender::track(const ESPNowMessage& msg, uint32_t now_ms) {
+    for (uint8_t i = 0; i < SLOT_COUNT; i++) {
+        Slot& slot = slots[i];
+        if (slot.in_use) continue;
+
+        slot.message = msg;
+        slot.rto_ms = initial_rto_ms;
+        slot.next_attempt_ms = now_ms + initial_rto_ms;
+        slot.attempts = 1;
+        slot.in_use = true;
+        counters.sent++;
+        return true;
+    }
+    return false;
+}
+
+void Sender::poll(uint32_t now_ms, TransmitFn transmit, ResolveFn resolve, void* context) {
+    for (uint8_t i = 0; i < SLOT_COUNT; i++) {
+        Slot& slot = slots[i];
+        if (!slot.in_use) continue;
+        if (static_cast<int32_t>(now_ms - slot.next_attempt_ms) < 0) continue;
+
+        if (slot.attempts >= max_attempts) {
+            counters.failed++;
+            release(slot, false, resolve, context);
+            continue;
+        }
+
+        transmit(context, slot.message);
+        slot.attempts++;
+        counters.retransmits++;
+
+        uint32_t next_rto = static_cast<uint32_t>(slot.rto_ms) * 2;
+        slot.rto_ms = static_cast<uint16_t>(next_rto > max_rto_ms ? max_rto_ms : next_rto);
+        slot.next_attempt_ms = now_ms + slot.rto_ms;
+    }
+}
+
+void Sender::expedite(uint32_t now_ms) {
+    for (uint8_t i = 0; i < SLOT_COUNT; i++) {
+        if (slots[i].in_use && slots[i].attempts == 1) {
+            slots[i].next_attempt_ms = now_ms;
+        }
+    }
+}
+
+uint8_t Sender::acknowledge(uint32_t ack_sequence, uint32_t bitmap, ResolveFn resolve, void* context) {
+    uint8_t released = 0;
+    for (uint8_t i = 0; i < SLOT_COUNT; i++) {
+        Slot& slot = slots[i];
+        if (!slot.in_use) continue;
+
+        uint32_t age = ack_sequence - slot.message.sequence;
+        bool acked = (age == 0) ||
+                     (age <= ACK_WINDOW_BITS && (bitmap & (1UL << (age - 1))));
+        if (acked) {
+            counters.delivered++;
+            release(slot, true, resolve, context);
+            released++;
+        }
+    }
+    return released;
+}
+
+void Sender::cancel(ResolveFn resolve, void* context, uint8_t keep_type) {
+    for (uint8_t i = 0; i < SLOT_COUNT; i++) {
+        Slot& slot = slots[i];
+        if (!slot.in_use) continue;
+        if (keep_type != 0 && slot.message.type == keep_type) continue;
+
+        counters.failed++;
+        release(slot, false, resolve, context);
+    }
+}
+
+uint8_t Sender::getInFlight() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < SLOT_COUNT; i++) {
+        if (slots[i].in_use) count++;
+    }
+    return count;
+}
+
+void Sender::release(Slot& slot, bool delivered, ResolveFn resolve, void* context) {
+    // Free the slot first so the callback may send another reliable message
+    ESPNowMessage message = slot.message;
+    slot.in_use = false;
+    if (resolve) {
+        resolve(context, message, delivered);
+    }
+}
+
+Receiver::Receiver() {
+    reset();
+}
+
+void Receiver::reset() {
+    has_base = false;
+    highest = 0;
+    bitmap = 0;
+    duplicates = 0;
+}
+
+bool Receiver::accept(uint32_t sequence) {
+    if (!has_base) {
+        has_base = true;
+        highest = sequence;
+        bitmap = 0;
+        return true;
+    }
+
+    int32_t diff = static_cast<int32_t>(sequence - highest);
+    if (diff > 0) {
+        // The previous newest moves into the bitmap at position shift - 1
+        uint32_t shift = static_cast<uint32_t>(diff);
+        bitmap = (shift >= ACK_WINDOW_BITS) ? 0 : (bitmap << shift);
+        if (shift <= ACK_WINDOW_BITS) {
+            bitmap |= 1UL << (shift - 1);
+        }
+        highest = sequence;
+        return true;
+    }
+
+    if (diff == 0) {
+        duplicates++;
+        return false;
+    }
+
+    uint32_t age = static_cast<uint32_t>(-diff);
+    if (age > ACK_WINDOW_BITS) {
+        // Too old to tell; assume it was already delivered
+        duplicates++;
+        return false;
+    }
+
+    uint32_t bit = 1UL << (age - 1);
+    if (bitmap & bit) {
+        duplicates++;
+        return false;
+    }
+    bitmap |= bit;
+    return true;
+}
+
+}
@@ -0,0 +1,98 @@
+#ifndef ESPNOW_RELIABLE_H
+#define ESPNOW_RELIABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ESPNowMessage.h"
+
+// Opt-in reliable delivery for critical messages (commands, disconnect).
+//
+// The sender keeps each reliable message in one of SLOT_COUNT in-flight slots
+// and retransmits it with the same sequence number and exponential backoff
+// until it is acknowledged or runs out of attempts. Nothing here blocks;
+// poll() is called once per update(). Streams such as RC channels never use
+// this lane, so a lost command can't hold them up.
+//
+// The receiver acknowledges every reliable record with a selective ACK: the
+// newest reliable sequence it has seen plus a bitmap of the 32 before it, so
+// one ACK also repairs earlier lost ACKs. The same window removes duplicates
+// caused by retransmission.
+namespace ESPNowReliable {
+    static constexpr uint8_t ACK_WINDOW_BITS = 32;
+
+    class Sender {
+    public:
+        static constexpr uint8_t SLOT_COUNT = 8;
+
+        typedef void (*TransmitFn)(void* context, const ESPNowMessage& msg);
+        typedef void (*ResolveFn)(void* context, const ESPNowMessage& msg, bool delivered);
+
+        struct Counters {
+            uint32_t sent;
+            uint32_t delivered;
+            uint32_t retransmits;
+            uint32_t failed;
+        };
+
+        Sender(uint16_t initial_rto_ms, uint16_t max_rto_ms, uint8_t max_attempts);
+
+        // Takes a slot for an already-sent message; false when the pool is full
+        bool track(const ESPNowMessage& msg, uint32_t now_ms);
+
+        // Retransmits due messages and resolves those out of attempts
+        void poll(uint32_t now_ms, TransmitFn transmit, ResolveFn resolve, void* context);
+
+        // Retry first transmissions at the next poll (e.g. the radio reported a
+        // failed send); later attempts keep their backoff
+        void expedite(uint32_t now_ms);
+
+        // Returns the number of slots released by this ACK
+        uint8_t acknowledge(uint32_t ack_sequence, uint32_t bitmap, ResolveFn resolve, void* context);
+
+        // Fails every in-flight message except those of keep_type
+        void cancel(ResolveFn resolve, void* context, uint8_t keep_type = 0);
+
+        uint8_t getInFlight() const;
+        bool hasInFlight() const { return getInFlight() > 0; }
+        const Counters& getCounters() const { return counters; }
+
+    private:
+        struct Slot {
+            ESPNowMessage message;
+            uint32_t next_attempt_ms;
+            uint16_t rto_ms;
+            uint8_t attempts;
+            bool in_use;
+        };
+
+        Slot slots[SLOT_COUNT];
+        uint16_t initial_rto_ms;
+        uint16_t max_rto_ms;
+        uint8_t max_attempts;
+        Counters counters;
+
+        void release(Slot& slot, bool delivered, ResolveFn resolve, void* context);
+    };
+
+    class Receiver {
+    public:
+        Receiver();
+
+        void reset();
+
+        // Records a reliable sequence; false if it was already delivered
+        bool accept(uint32_t sequence);
+
+        uint32_t getAckSequence() const { return highest; }
+        uint32_t getAckBitmap() const { return bitmap; }
+        uint32_t getDuplicates() const { return duplicates; }
+
+    private:
+        bool has_base;
+        uint32_t highest;
+        uint32_t bitmap;
+        uint32_t duplicates;
+    };
+}
+
+#endif
@@ -0,0 +1,122 @@
+#include "ESPNowSequence.h"
+#include <string.h>
+
+LossWindow::LossWindow(uint32_t slot_ms)
+    : slot_ms(slot_ms) {
+    reset();
+}
+
+void LossWindow::reset() {
+    memset(slots, 0, sizeof(slots));
+}
+
+void LossWindow::add(uint32_t now_ms, int32_t received, int32_t lost) {
+    uint32_t epoch = now_ms / slot_ms;
+    Slot& slot = slots[epoch % SLOTS];
+    if (slot.epoch != epoch) {
+        slot.epoch = epoch;
+        slot.received = 0;
+        slot.lost = 0;
+    }
+    slot.received += received;
+    slot.lost += lost;
+}
+
+float LossWindow::getLossRate(uint32_t now_ms) const {
+    uint32_t epoch = now_ms / slot_ms;
+    int32_t received = 0;
+    int32_t lost = 0;
+
+    for (uint8_t i = 0; i < SLOTS; i++) {
+        if (epoch - slots[i].epoch < SLOTS) {
+            received += slots[i].received;
+            lost += slots[i].lost;
+        }
+    }
+
+    if (lost <= 0) return 0.0f;
+    return static_cast<float>(lost) / static_cast<float>(received + lost);
+}
+
+SequenceTracker::SequenceTracker(uint32_t max_gap)
+    : max_gap(max_gap)
+    , window_1s(1000 / LossWindow::SLOTS)
+    , window_10s(10000 / LossWindow::SLOTS) {
+    reset();
+}
+
+void SequenceTracker::reset() {
+    has_base = false;
+    highest = 0;
+    seen = 0;
+    memset(&counters, 0, sizeof(counters));
+    window_1s.reset();
+    window_10s.reset();
+}
+
+void SequenceTracker::record(uint32_t now_ms, int32_t received, int32_t lost) {
+    window_1s.add(now_ms, received, lost);
+    window_10s.add(now_ms, received, lost);
+}
+
+void SequenceTracker::restart(uint32_t sequence) {
+    has_base = true;
+    highest = sequence;
+    seen = 1;
+}
+
+SequenceTracker::Result SequenceTracker::check(uint32_t sequence, uint32_t now_ms) {
+    if (!has_base) {
+        restart(sequence);
+        counters.received++;
+        record(now_ms, 1, 0);
+        return Result::ACCEPTED;
+    }
+
+    int32_t diff = static_cast<int32_t>(sequence - highest);
+
+    if (diff > static_cast<int32_t>(max_gap) || -diff > static_cast<int32_t>(max_gap)) {
+        restart(sequence);
+        counters.received++;
+        counters.resyncs++;
+        record(now_ms, 1, 0);
+        return Result::RESYNC;
+    }
+
+    if (diff > 0) {
+        uint32_t gap = static_cast<uint32_t>(diff) - 1;
+        seen = (static_cast<uint32_t>(diff) >= WINDOW_BITS) ? 0 : (seen << diff);
+        seen |= 1;
+        highest = sequence;
+        counters.received++;
+        counters.lost += gap;
+        record(now_ms, 1, static_cast<int32_t>(gap));
+        return Result::ACCEPTED;
+    }
+
+    uint32_t age = static_cast<uint32_t>(-diff);
+    if (age >= WINDOW_BITS) {
+        counters.stale++;
+        return Result::STALE;
+    }
+
+    uint64_t bit = 1ULL << age;
+    if (seen & bit) {
+        counters.duplicates++;
+        return Result::DUPLICATE;
+    }
+
+    // Late arrival for a slot we already counted as lost
+    seen |= bit;
+    counters.received++;
+    counters.reordered++;
+    if (counters.lost > 0) counters.lost--;
+    record(now_ms, 1, -1);
+    return Result::REORDERED;
+}
+
+float SequenceTracker::getLossRate() const {
+    uint32_t expected = counters.received + counters.lost;
+    if (expected == 0) return 0.0f;
+    return static_cast<float>(counters.lost) / static_cast<float>(expected);
+}
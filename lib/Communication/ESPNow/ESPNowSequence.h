@@ -0,0 +1,88 @@
+#ifndef ESPNOW_SEQUENCE_H
+#define ESPNOW_SEQUENCE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Loss rate over a sliding time window, kept as SLOTS fixed-width buckets so
+// both updates and queries are O(SLOTS) with no allocation.
+class LossWindow {
+public:
+    static constexpr uint8_t SLOTS = 10;
+
+    explicit LossWindow(uint32_t slot_ms);
+
+    void reset();
+    void add(uint32_t now_ms, int32_t received, int32_t lost);
+
+    // Fraction of expected messages lost in the window ending at now_ms (0..1),
+    // 0 when nothing was expected
+    float getLossRate(uint32_t now_ms) const;
+    uint32_t getWindowMs() const { return slot_ms * SLOTS; }
+
+private:
+    struct Slot {
+        uint32_t epoch;
+        int32_t received;
+        int32_t lost;  // May go down when a late message fills a gap
+    };
+
+    Slot slots[SLOTS];
+    uint32_t slot_ms;
+};
+
+// Receive-side sequence tracking for one peer. A 64-bit bitmap of the most
+// recent sequence numbers below the highest one seen detects duplicates and
+// reordering. Gaps count as loss, and a late arrival removes its gap again.
+// A jump of more than max_gap in either direction (e.g. a peer reboot)
+// restarts tracking from the new number.
+class SequenceTracker {
+public:
+    enum class Result : uint8_t {
+        ACCEPTED,    // In order (possibly after a gap)
+        REORDERED,   // Late but new, fills an earlier gap
+        RESYNC,      // Out of range, tracking restarted here
+        DUPLICATE,   // Already seen, drop
+        STALE        // Older than the bitmap can tell apart, drop
+    };
+
+    struct Counters {
+        uint32_t received;
+        uint32_t lost;
+        uint32_t duplicates;
+        uint32_t reordered;
+        uint32_t stale;
+        uint32_t resyncs;
+    };
+
+    static constexpr uint32_t WINDOW_BITS = 64;
+
+    explicit SequenceTracker(uint32_t max_gap);
+
+    void reset();
+    void setMaxGap(uint32_t gap) { max_gap = gap; }
+    Result check(uint32_t sequence, uint32_t now_ms);
+
+    static bool shouldDeliver(Result result) {
+        return result != Result::DUPLICATE && result != Result::STALE;
+    }
+
+    const Counters& getCounters() const { return counters; }
+    float getLossRate() const;  // Since the last reset, 0..1
+    float getLossRate1s(uint32_t now_ms) const { return window_1s.getLossRate(now_ms); }
+    float getLossRate10s(uint32_t now_ms) const { return window_10s.getLossRate(now_ms); }
+
+private:
+    uint32_t max_gap;
+    bool has_base;
+    uint32_t highest;
+    uint64_t seen;  // bit n set = (highest - n) received
+    Counters counters;
+    LossWindow window_1s;
+    LossWindow window_10s;
+
+    void record(uint32_t now_ms, int32_t received, int32_t lost);
+    void restart(uint32_t sequence);
+};
+
+#endif
@@ -0,0 +1,258 @@
+#include "ESPNowSession.h"
+
+namespace {
+    void frameNonce(uint8_t sender_role, uint32_t counter, uint8_t* nonce) {
+        memset(nonce, 0, ESPNowCrypto::NONCE_SIZE);
+        nonce[0] = sender_role;
+        nonce[8] = counter & 0xFF;
+        nonce[9] = (counter >> 8) & 0xFF;
+        nonce[10] = (counter >> 16) & 0xFF;
+        nonce[11] = (counter >> 24) & 0xFF;
+    }
+
+    // Sender role and message type keep the tags of different messages apart,
+    // the sender's fresh nonce those of repeated ones
+    void confirmTag(const ESPNowMessage& msg, const uint8_t* key, uint8_t* tag) {
+        uint8_t nonce[ESPNowCrypto::NONCE_SIZE] = {0};
+        nonce[0] = msg.role;
+        nonce[1] = msg.type;
+        memcpy(nonce + 4, msg.getHandshakeNonce(), ESPNowSession::NONCE_SIZE);
+        ESPNowCrypto::seal(key, nonce, msg.data, msg.getHandshakeConfirmOffset(), nullptr, 0, tag);
+    }
+}
+
+ESPNowSession::ESPNowSession()
+    : enabled(false)
+    , has_master(false)
+    , active(-1)
+    , generation(0)
+    , rx_generation(0)
+    , rx_window(MAX_COUNTER)
+    , frames_sealed(0)
+    , frames_opened(0)
+    , auth_failures(0)
+    , replays_rejected(0)
+    , crypto_us(0) {
+    memset(pairing_key, 0, sizeof(pairing_key));
+    memset(master_key, 0, sizeof(master_key));
+    memset(local_nonce, 0, sizeof(local_nonce));
+    memset(installed_nonces, 0, sizeof(installed_nonces));
+    for (TrafficKey& slot : slots) {
+        memset(slot.key, 0, sizeof(slot.key));
+        slot.tx_counter.store(0, std::memory_order_relaxed);
+        slot.generation.store(1, std::memory_order_relaxed);
+    }
+}
+
+ESPNowSession::~ESPNowSession() {
+    clear();
+    ESPNowCrypto::wipe(pairing_key, sizeof(pairing_key));
+}
+
+void ESPNowSession::setPairingKey(const uint8_t* key) {
+    clear();
+    enabled = (key != nullptr);
+    if (key) {
+        memcpy(pairing_key, key, KEY_SIZE);
+    } else {
+        ESPNowCrypto::wipe(pairing_key, sizeof(pairing_key));
+    }
+}
+
+bool ESPNowSession::isPairingKeyZero() const {
+    static const uint8_t zero[KEY_SIZE] = {0};
+    return memcmp(pairing_key, zero, KEY_SIZE) == 0;
+}
+
+void ESPNowSession::clear() {
+    active.store(-1, std::memory_order_release);
+    for (TrafficKey& slot : slots) {
+        beginRewrite(slot);
+        ESPNowCrypto::wipe(slot.key, sizeof(slot.key));
+    }
+    ESPNowCrypto::wipe(master_key, sizeof(master_key));
+    has_master = false;
+}
+
+void ESPNowSession::newLocalNonce() {
+    for (size_t i = 0; i < NONCE_SIZE; i += 4) {
+        uint32_t value = Platform::randomU32();
+        memcpy(local_nonce + i, &value, 4);
+    }
+}
+
+void ESPNowSession::deriveMasterKey(const uint8_t* handheld_nonce, const uint8_t* base_nonce,
+                                    uint8_t* out) const {
+    uint8_t input[ESPNowCrypto::HCHACHA_INPUT_SIZE];
+    memcpy(input, handheld_nonce, NONCE_SIZE);
+    memcpy(input + NONCE_SIZE, base_nonce, NONCE_SIZE);
+    ESPNowCrypto::hchacha20(pairing_key, input, out);
+}
+
+void ESPNowSession::setMasterKey(const uint8_t* key) {
+    memcpy(master_key, key, KEY_SIZE);
+    memset(installed_nonces, 0, sizeof(installed_nonces));
+    has_master = true;
+}
+
+void ESPNowSession::installTrafficKey(const uint8_t* handheld_nonce, const uint8_t* base_nonce) {
+    uint8_t input[ESPNowCrypto::HCHACHA_INPUT_SIZE];
+    memcpy(input, handheld_nonce, NONCE_SIZE);
+    memcpy(input + NONCE_SIZE, base_nonce, NONCE_SIZE);
+    if (hasTrafficKey() && memcmp(input, installed_nonces, sizeof(input)) == 0) {
+        return;
+    }
+    memcpy(installed_nonces, input, sizeof(input));
+
+    TrafficKey& slot = slots[active.load(std::memory_order_relaxed) == 0 ? 1 : 0];
+    beginRewrite(slot);
+    ESPNowCrypto::hchacha20(master_key, input, slot.key);
+    slot.tx_counter.store(0, std::memory_order_relaxed);
+    generation += 2;
+    slot.generation.store(generation, std::memory_order_release);
+
+    active.store(static_cast<int8_t>(&slot - slots), std::memory_order_release);
+}
+
+void ESPNowSession::beginRewrite(TrafficKey& slot) {
+    slot.generation.store(slot.generation.load(std::memory_order_relaxed) | 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+bool ESPNowSession::copyKey(const TrafficKey& slot, uint32_t generation, uint8_t* key) {
+    if (generation & 1) {
+        return false;
+    }
+    memcpy(key, slot.key, KEY_SIZE);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.generation.load(std::memory_order_relaxed) == generation;
+}
+
+void ESPNowSession::sign(ESPNowMessage& msg, const uint8_t* key) {
+    uint8_t tag[ESPNowCrypto::TAG_SIZE];
+    confirmTag(msg, key, tag);
+    memcpy(&msg.data[msg.getHandshakeConfirmOffset()], tag, ESPNowMessage::HANDSHAKE_CONFIRM_SIZE);
+    msg.updateCRC();
+}
+
+bool ESPNowSession::verify(const ESPNowMessage& msg, const uint8_t* key) {
+    uint8_t tag[ESPNowCrypto::TAG_SIZE];
+    confirmTag(msg, key, tag);
+    return ESPNowCrypto::equal(tag, &msg.data[msg.getHandshakeConfirmOffset()],
+                               ESPNowMessage::HANDSHAKE_CONFIRM_SIZE);
+}
+
+bool ESPNowSession::isSealed(const uint8_t* frame, size_t len) {
+    return len > ESPNowWire::FRAME_HEADER_SIZE && frame[0] == ESPNowWire::FRAME_MAGIC &&
+           (frame[1] >> 4) == ESPNowWire::WIRE_VERSION && (frame[1] & ESPNowWire::FRAME_FLAG_SEALED);
+}
+
+size_t ESPNowSession::seal(const uint8_t* frame, size_t len, uint8_t* out, size_t out_size) {
+    int8_t index = active.load(std::memory_order_acquire);
+    if (index < 0 || len <= ESPNowWire::FRAME_HEADER_SIZE + ESPNowWire::FRAME_TRAILER_SIZE) {
+        return 0;
+    }
+    size_t records_len = len - ESPNowWire::FRAME_HEADER_SIZE - ESPNowWire::FRAME_TRAILER_SIZE;
+    size_t sealed_len = SEALED_HEADER_SIZE + records_len + TAG_SIZE;
+    if (sealed_len > out_size) {
+        return 0;
+    }
+
+    uint32_t start_us = micros();
+    TrafficKey& slot = slots[index];
+    uint32_t slot_generation = slot.generation.load(std::memory_order_acquire);
+    uint32_t counter = slot.tx_counter.fetch_add(1, std::memory_order_relaxed);
+    uint8_t key[KEY_SIZE];
+    if (!copyKey(slot, slot_generation, key)) {
+        return 0;  // Two installs overtook this call
+    }
+    if (counter > MAX_COUNTER) {
+        ESPNowCrypto::wipe(key, sizeof(key));
+        return 0;  // Worn out; the link drops and the resume brings a new key
+    }
+
+    out[0] = frame[0];
+    out[1] = frame[1] | ESPNowWire::FRAME_FLAG_SEALED;
+    out[2] = frame[2];
+    out[3] = counter & 0xFF;
+    out[4] = (counter >> 8) & 0xFF;
+    out[5] = (counter >> 16) & 0xFF;
+    out[6] = (counter >> 24) & 0xFF;
+    memcpy(out + SEALED_HEADER_SIZE, frame + ESPNowWire::FRAME_HEADER_SIZE, records_len);
+
+    uint8_t nonce[ESPNowCrypto::NONCE_SIZE];
+    uint8_t tag[ESPNowCrypto::TAG_SIZE];
+    frameNonce(frame[2], counter, nonce);
+    ESPNowCrypto::seal(key, nonce, out, SEALED_HEADER_SIZE, out + SEALED_HEADER_SIZE, records_len, tag);
+    ESPNowCrypto::wipe(key, sizeof(key));
+    memcpy(out + SEALED_HEADER_SIZE + records_len, tag, TAG_SIZE);
+
+    frames_sealed.fetch_add(1, std::memory_order_relaxed);
+    crypto_us.fetch_add(micros() - start_us, std::memory_order_relaxed);
+    return sealed_len;
+}
+
+size_t ESPNowSession::open(const uint8_t* frame, size_t len, uint8_t peer_role, uint8_t* out,
+                           size_t out_size, uint32_t now_ms) {
+    int8_t index = active.load(std::memory_order_acquire);
+    // A frame with our own role would be one of ours reflected back
+    if (index < 0 || !isSealed(frame, len) || len <= SEALED_HEADER_SIZE + TAG_SIZE ||
+        len > ESPNowWire::MAX_FRAME_SIZE || frame[2] != peer_role) {
+        auth_failures.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    size_t records_len = len - SEALED_HEADER_SIZE - TAG_SIZE;
+    if (ESPNowWire::FRAME_HEADER_SIZE + records_len > out_size) {
+        return 0;
+    }
+
+    uint32_t start_us = micros();
+    const TrafficKey& slot = slots[index];
+    uint32_t slot_generation = slot.generation.load(std::memory_order_acquire);
+    uint8_t key[KEY_SIZE];
+    if (!copyKey(slot, slot_generation, key)) {
+        return 0;
+    }
+    uint32_t counter = static_cast<uint32_t>(frame[3]) | (static_cast<uint32_t>(frame[4]) << 8) |
+                       (static_cast<uint32_t>(frame[5]) << 16) | (static_cast<uint32_t>(frame[6]) << 24);
+
+    uint8_t nonce[ESPNowCrypto::NONCE_SIZE];
+    frameNonce(frame[2], counter, nonce);
+    uint8_t* records = out + ESPNowWire::FRAME_HEADER_SIZE;
+    memcpy(records, frame + SEALED_HEADER_SIZE, records_len);
+    bool authentic = ESPNowCrypto::open(key, nonce, frame, SEALED_HEADER_SIZE, records, records_len,
+                                        frame + SEALED_HEADER_SIZE + records_len, TAG_SIZE);
+    ESPNowCrypto::wipe(key, sizeof(key));
+    crypto_us.fetch_add(micros() - start_us, std::memory_order_relaxed);
+    if (!authentic) {
+        auth_failures.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    // Only authentic counters move the window
+    if (slot_generation != rx_generation) {
+        rx_window.reset();
+        rx_generation = slot_generation;
+    }
+    SequenceTracker::Result result = rx_window.check(counter, now_ms);
+    if (!SequenceTracker::shouldDeliver(result) || result == SequenceTracker::Result::RESYNC) {
+        replays_rejected.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    out[0] = frame[0];
+    out[1] = frame[1] & ~ESPNowWire::FRAME_FLAG_SEALED;
+    out[2] = frame[2];
+    frames_opened.fetch_add(1, std::memory_order_relaxed);
+    return ESPNowWire::FRAME_HEADER_SIZE + records_len;
+}
+
+ESPNowSession::Stats ESPNowSession::getStats() const {
+    Stats stats;
+    stats.frames_sealed = frames_sealed.load(std::memory_order_relaxed);
+    stats.frames_opened = frames_opened.load(std::memory_order_relaxed);
+    stats.auth_failures = auth_failures.load(std::memory_order_relaxed);
+    stats.replays_rejected = replays_rejected.load(std::memory_order_relaxed);
+    stats.crypto_us = crypto_us.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,133 @@
+#ifndef ESPNOW_SESSION_H
+#define ESPNOW_SESSION_H
+
+#include "../../Core/Platform.h"
+#include "../../Config/espnow_config.h"
+#include "ESPNowMessage.h"
+#include "ESPNowWire.h"
+#include "ESPNowSequence.h"
+#include "ESPNowCrypto.h"
+#include <atomic>
+
+// Encrypted, authenticated session with the pairing peer.
+//
+// Both ends share a pairing key. Pairing is the only key exchange: each side
+// contributes a fresh nonce and the session master key is
+// HChaCha20(pairing key, handheld nonce | base nonce). The master key is
+// cached with the session id, so a resume just swaps two new nonces and
+// derives a new traffic key from it: no per-packet handshake, and nothing
+// but a hash per key.
+//
+// Sealed frame, in place of a plain frame's CRC:
+//   [FRAME_MAGIC] [version | flags | FRAME_FLAG_SEALED] [role] [counter u32 LE]
+//   [records, ChaCha20] [Poly1305 tag, AUTH_TAG_SIZE bytes]
+// The header and counter are authenticated too. The AEAD nonce is the
+// sender's role and the counter, so the two directions never share one.
+// Counters of authentic frames go through a SequenceTracker: repeats and
+// anything older than its 64-frame window are dropped as replays.
+//
+// Handshake messages travel unsealed with a confirm tag (an AEAD tag over
+// their payload): the pair request is keyed by the pairing key, the pair
+// response by the new master key, a resume by the cached one.
+//
+// seal() runs on the main loop or link task and in the RC stream timer,
+// open() in the Wi-Fi callback, everything else on the main loop or link
+// task. Traffic keys are double-buffered, so installing a new one leaves
+// the slot in use alone. The install after that reuses it, though, so each
+// slot has a generation that is odd while the slot is rewritten: seal() and
+// open() take their counter and a copy of the key, then check the generation
+// didn't move, and drop the frame if it did rather than use a torn key or a
+// counter of the new one.
+class ESPNowSession {
+public:
+    static constexpr size_t KEY_SIZE = ESPNowCrypto::KEY_SIZE;
+    static constexpr size_t NONCE_SIZE = ESPNowMessage::HANDSHAKE_NONCE_SIZE;
+    static constexpr size_t COUNTER_SIZE = 4;
+    static constexpr size_t TAG_SIZE = ESPNowGlobalConfig::AUTH_TAG_SIZE;
+    static constexpr size_t SEALED_HEADER_SIZE = ESPNowWire::FRAME_HEADER_SIZE + COUNTER_SIZE;
+    // Bytes a sealed frame adds to the plain one
+    static constexpr size_t OVERHEAD = COUNTER_SIZE + TAG_SIZE - ESPNowWire::FRAME_TRAILER_SIZE;
+    static constexpr uint32_t MAX_COUNTER = 0x7FFFFFFF;  // Frames per traffic key
+
+    static_assert(TAG_SIZE >= 4 && TAG_SIZE <= ESPNowCrypto::TAG_SIZE, "AUTH_TAG_SIZE must be 4..16");
+
+    struct Stats {
+        uint32_t frames_sealed;
+        uint32_t frames_opened;
+        uint32_t auth_failures;     // Sealed frames or handshakes failing their tag
+        uint32_t replays_rejected;  // Authentic, but already seen or too old
+        uint32_t crypto_us;         // Spent in seal() and open()
+    };
+
+    ESPNowSession();
+    ~ESPNowSession();
+
+    // nullptr turns encryption off. Drops every derived key.
+    void setPairingKey(const uint8_t* key);
+    bool isEnabled() const { return enabled; }
+    bool isPairingKeyZero() const;
+    bool hasMasterKey() const { return has_master; }
+    bool hasTrafficKey() const { return active.load(std::memory_order_acquire) >= 0; }
+    void clear();  // Drops the master and traffic keys
+
+    // Handshake
+    void newLocalNonce();
+    const uint8_t* getLocalNonce() const { return local_nonce; }
+    const uint8_t* getPairingKey() const { return pairing_key; }
+    const uint8_t* getMasterKey() const { return master_key; }
+    void deriveMasterKey(const uint8_t* handheld_nonce, const uint8_t* base_nonce, uint8_t* out) const;
+    void setMasterKey(const uint8_t* key);
+    // New traffic key from the master key; sent counters and the replay window
+    // restart. The same nonces again are ignored, so a counter never restarts
+    // under the same key.
+    void installTrafficKey(const uint8_t* handheld_nonce, const uint8_t* base_nonce);
+
+    // Confirm tag of a handshake message, keyed as described above
+    static void sign(ESPNowMessage& msg, const uint8_t* key);
+    static bool verify(const ESPNowMessage& msg, const uint8_t* key);
+    void recordAuthFailure() { auth_failures.fetch_add(1, std::memory_order_relaxed); }
+
+    // Frames. seal() takes a finished plain frame and returns the sealed
+    // length, 0 without a traffic key. open() checks a sealed frame from
+    // peer_role and writes the plain header and records to out, for
+    // ESPNowWire::decodeOpenedFrameInto(); 0 if it is rejected.
+    static bool isSealed(const uint8_t* frame, size_t len);
+    size_t seal(const uint8_t* frame, size_t len, uint8_t* out, size_t out_size);
+    size_t open(const uint8_t* frame, size_t len, uint8_t peer_role, uint8_t* out, size_t out_size,
+                uint32_t now_ms);
+
+    Stats getStats() const;
+
+private:
+    struct TrafficKey {
+        uint8_t key[KEY_SIZE];
+        std::atomic<uint32_t> tx_counter;
+        std::atomic<uint32_t> generation;  // Odd while rewritten or cleared
+    };
+
+    bool enabled;
+    bool has_master;
+    uint8_t pairing_key[KEY_SIZE];
+    uint8_t master_key[KEY_SIZE];
+    uint8_t local_nonce[NONCE_SIZE];
+    TrafficKey slots[2];
+    uint8_t installed_nonces[2 * NONCE_SIZE];
+    std::atomic<int8_t> active;  // Slot in use, -1 = none
+    uint32_t generation;         // Of the last installed key, always even
+
+    static void beginRewrite(TrafficKey& slot);
+    // Copies the slot's key; false if it was rewritten since generation was read
+    static bool copyKey(const TrafficKey& slot, uint32_t generation, uint8_t* key);
+
+    // Wi-Fi callback side
+    uint32_t rx_generation;
+    SequenceTracker rx_window;
+
+    std::atomic<uint32_t> frames_sealed;
+    std::atomic<uint32_t> frames_opened;
+    std::atomic<uint32_t> auth_failures;
+    std::atomic<uint32_t> replays_rejected;
+    std::atomic<uint32_t> crypto_us;
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef ESPNOW_TRANSPORT_H
+#define ESPNOW_TRANSPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../../HAL/Core/hal_types.h"
+
+// Raw frame transport under ESPNowManager. ESPNowRadioTransport drives the
+// ESP-NOW radio on target; SimRadioTransport attaches to a SimRadioMedium so
+// several managers can exchange frames in one host process.
+//
+// Handlers may be called from another task (the Wi-Fi task on target) and
+// must not block. rssi is the frame's signal strength in dBm, 0 if unknown.
+class ESPNowTransport {
+public:
+    typedef void (*ReceiveHandler)(void* context, const uint8_t* mac, const uint8_t* data, int len, int8_t rssi);
+    typedef void (*SendHandler)(void* context, const uint8_t* mac, bool delivered);
+
+    virtual ~ESPNowTransport() {}
+
+    virtual hal_status_t begin(ReceiveHandler on_receive, SendHandler on_sent, void* context) = 0;
+    virtual void end() = 0;
+
+    // Unicast destinations must have been added as peers first
+    virtual hal_status_t send(const uint8_t* mac, const uint8_t* data, size_t len) = 0;
+    virtual hal_status_t addPeer(const uint8_t* mac, uint8_t channel) = 0;
+    virtual hal_status_t removePeer(const uint8_t* mac) = 0;
+    virtual bool hasPeer(const uint8_t* mac) const = 0;
+
+    // Radio channel (1-13). Peers added on ESPNowConfig::PEER_CHANNEL_CURRENT
+    // move with it; frames in flight on the old channel are lost.
+    virtual hal_status_t setChannel(uint8_t channel) = 0;
+    virtual uint8_t getChannel() const = 0;
+
+    virtual void getMacAddress(uint8_t* mac) const = 0;
+};
+
+#endif
@@ -0,0 +1,286 @@
+#include "ESPNowWire.h"
+#include "ESPNowCRC.h"
+
+namespace ESPNowWire {
+
+namespace {
+    size_t varintSize(uint32_t value) {
+        size_t size = 1;
+        while (value >= 0x80) {
+            value >>= 7;
+            size++;
+        }
+        return size;
+    }
+
+    size_t writeVarint(uint8_t* out, uint32_t value) {
+        size_t n = 0;
+        while (value >= 0x80) {
+            out[n++] = static_cast<uint8_t>(value | 0x80);
+            value >>= 7;
+        }
+        out[n++] = static_cast<uint8_t>(value);
+        return n;
+    }
+
+    bool readVarint(const uint8_t* data, size_t len, size_t& pos, uint32_t& value) {
+        value = 0;
+        for (uint8_t shift = 0; shift < 35; shift += 7) {
+            if (pos >= len) return false;
+            uint8_t byte = data[pos++];
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    // Variable payloads are sent without their trailing zero padding
+    uint8_t payloadLength(const ESPNowMessage& msg) {
+        uint8_t fixed = payloadSize(msg.type);
+        if (fixed != PAYLOAD_VARIABLE) return fixed;
+
+        uint8_t len = sizeof(msg.data);
+        while (len > 0 && msg.data[len - 1] == 0) {
+            len--;
+        }
+        return len;
+    }
+
+    size_t maxRecordSize(const ESPNowMessage& msg) {
+        bool variable = payloadSize(msg.type) == PAYLOAD_VARIABLE;
+        return 1 + varintSize(msg.sequence) + 5 + (variable ? 1 : 0) + payloadLength(msg);
+    }
+}
+
+uint8_t payloadSize(uint8_t type) {
+    switch (type) {
+        case ESPNowConfig::MSG_ANNOUNCE:
+        case ESPNowConfig::MSG_DISCONNECT:
+        case ESPNowConfig::MSG_KEEPALIVE:
+            return 0;
+        case ESPNowConfig::MSG_PING:
+            return 4;   // counter
+        case ESPNowConfig::MSG_PONG:
+            return 12;  // counter, responder rx/tx micros
+        case ESPNowConfig::MSG_BUTTON_DATA:
+            return 5;   // states + timestamp
+        case ESPNowConfig::MSG_INPUT_EVENT:
+            return 4;   // event, button, data
+        case ESPNowConfig::MSG_COMMAND:
+            return 2;   // command, argument
+        case ESPNowConfig::MSG_ACK:
+            return 8;   // sequence, selective ack bitmap
+        default:
+            return PAYLOAD_VARIABLE;
+    }
+}
+
+void resetEncoder(EncoderState& state) {
+    state.last_timestamp = 0;
+    state.records_since_keyframe = 0;
+    state.has_base = false;
+}
+
+void resetDecoder(DecoderState& state) {
+    state.last_timestamp = 0;
+    state.has_base = false;
+}
+
+FrameWriter::FrameWriter()
+    : buffer(nullptr)
+    , capacity(0)
+    , length(0)
+    , record_count(0) {
+}
+
+void FrameWriter::begin(uint8_t* out, size_t out_size, uint8_t role, uint8_t frame_flags) {
+    buffer = out;
+    capacity = (out_size < MAX_FRAME_SIZE) ? out_size : MAX_FRAME_SIZE;
+    length = 0;
+    record_count = 0;
+
+    if (!buffer || capacity < FRAME_HEADER_SIZE + FRAME_TRAILER_SIZE) {
+        capacity = 0;
+        return;
+    }
+
+    buffer[0] = FRAME_MAGIC;
+    buffer[1] = static_cast<uint8_t>((WIRE_VERSION << 4) | (frame_flags & 0x0F));
+    buffer[2] = role;
+    length = FRAME_HEADER_SIZE;
+}
+
+bool FrameWriter::fits(const ESPNowMessage& msg) const {
+    return capacity > 0 && length + maxRecordSize(msg) + FRAME_TRAILER_SIZE <= capacity;
+}
+
+bool FrameWriter::append(const ESPNowMessage& msg, EncoderState& state, uint8_t record_flags) {
+    if (!fits(msg) || (msg.type & ~RECORD_TYPE_MASK)) {
+        return false;
+    }
+
+    bool keyframe = !state.has_base ||
+                    state.records_since_keyframe >= TIMESTAMP_KEYFRAME_INTERVAL ||
+                    msg.timestamp < state.last_timestamp;
+    uint32_t timestamp_field = keyframe ? msg.timestamp : msg.timestamp - state.last_timestamp;
+
+    uint8_t* out = buffer + length;
+    size_t n = 0;
+    out[n++] = static_cast<uint8_t>(msg.type | (record_flags & RECORD_FLAG_RELIABLE) |
+                                    (keyframe ? RECORD_FLAG_ABS_TIMESTAMP : 0));
+    n += writeVarint(out + n, msg.sequence);
+    n += writeVarint(out + n, timestamp_field);
+
+    uint8_t payload_len = payloadLength(msg);
+    if (payloadSize(msg.type) == PAYLOAD_VARIABLE) {
+        out[n++] = payload_len;
+    }
+    memcpy(out + n, msg.data, payload_len);
+    n += payload_len;
+
+    length += n;
+    record_count++;
+
+    state.last_timestamp = msg.timestamp;
+    state.records_since_keyframe = keyframe ? 0 : state.records_since_keyframe + 1;
+    state.has_base = true;
+    return true;
+}
+
+size_t FrameWriter::finish() {
+    if (record_count == 0 || length + FRAME_TRAILER_SIZE > capacity) {
+        return 0;
+    }
+
+    uint16_t crc = ESPNowCRC::crc16(buffer, length);
+    buffer[length++] = static_cast<uint8_t>(crc & 0xFF);
+    buffer[length++] = static_cast<uint8_t>(crc >> 8);
+    return length;
+}
+
+size_t encode(const ESPNowMessage& msg, EncoderState& state, uint8_t* out, size_t out_size,
+              uint8_t frame_flags, uint8_t record_flags) {
+    FrameWriter writer;
+    writer.begin(out, out_size, msg.role, frame_flags);
+    if (!writer.append(msg, state, record_flags)) {
+        return 0;
+    }
+    return writer.finish();
+}
+
+bool isLegacyFrame(const uint8_t* data, size_t len) {
+    return data && len == sizeof(ESPNowMessage) && data[0] == ESPNowConfig::MESSAGE_MAGIC;
+}
+
+namespace {
+    // Adapts a RecordSink to decodeFrameInto() with one message on the stack
+    struct SinkAdapter {
+        RecordSink sink;
+        void* context;
+        ESPNowMessage msg;
+    };
+
+    ESPNowMessage* claimAdapterMessage(void* context) {
+        return &static_cast<SinkAdapter*>(context)->msg;
+    }
+
+    void commitToSink(void* context, const ESPNowMessage& msg, uint8_t record_flags) {
+        SinkAdapter* adapter = static_cast<SinkAdapter*>(context);
+        adapter->sink(adapter->context, msg, record_flags);
+    }
+}
+
+size_t decodeFrame(const uint8_t* data, size_t len, DecoderState& state,
+                   RecordSink sink, void* context) {
+    if (!sink) return 0;
+
+    SinkAdapter adapter;
+    adapter.sink = sink;
+    adapter.context = context;
+    return decodeFrameInto(data, len, state, &claimAdapterMessage, &commitToSink, &adapter);
+}
+
+size_t decodeFrameInto(const uint8_t* data, size_t len, DecoderState& state,
+                       RecordClaim claim, RecordCommit commit, void* context) {
+    if (!data || !claim || !commit) return 0;
+
+    if (isLegacyFrame(data, len)) {
+        ESPNowMessage* msg = claim(context);
+        if (!msg) return 0;
+        memcpy(msg, data, sizeof(ESPNowMessage));
+        if (!msg->isValid()) return 0;
+        commit(context, *msg, 0);
+        return 1;
+    }
+
+    if (len < FRAME_HEADER_SIZE + FRAME_TRAILER_SIZE + 1 || len > MAX_FRAME_SIZE) return 0;
+    if (data[0] != FRAME_MAGIC || (data[1] >> 4) != WIRE_VERSION) return 0;
+    if (data[1] & FRAME_FLAG_SEALED) return 0;
+
+    size_t body_len = len - FRAME_TRAILER_SIZE;
+    uint16_t expected = static_cast<uint16_t>(data[body_len] | (data[body_len + 1] << 8));
+    if (ESPNowCRC::crc16(data, body_len) != expected) return 0;
+
+    return decodeOpenedFrameInto(data, body_len, state, claim, commit, context);
+}
+
+size_t decodeOpenedFrameInto(const uint8_t* data, size_t body_len, DecoderState& state,
+                             RecordClaim claim, RecordCommit commit, void* context) {
+    if (!data || !claim || !commit || body_len <= FRAME_HEADER_SIZE) return 0;
+
+    uint8_t role = data[2];
+    size_t pos = FRAME_HEADER_SIZE;
+
+    // Out-of-band frames must not disturb the in-band delta chain
+    DecoderState out_of_band_state = state;
+    DecoderState& ts_state = (data[1] & FRAME_FLAG_OUT_OF_BAND) ? out_of_band_state : state;
+    size_t delivered = 0;
+
+    while (pos < body_len) {
+        ESPNowMessage* msg = claim(context);
+        if (!msg) return delivered;
+
+        uint8_t type_byte = data[pos++];
+        msg->magic = ESPNowConfig::MESSAGE_MAGIC;
+        msg->type = type_byte & RECORD_TYPE_MASK;
+        msg->role = role;
+
+        uint32_t sequence = 0;
+        uint32_t timestamp_field = 0;
+        if (!readVarint(data, body_len, pos, sequence) ||
+            !readVarint(data, body_len, pos, timestamp_field)) {
+            return delivered;
+        }
+        msg->sequence = sequence;
+
+        if (type_byte & RECORD_FLAG_ABS_TIMESTAMP) {
+            msg->timestamp = timestamp_field;
+        } else {
+            msg->timestamp = ts_state.last_timestamp + timestamp_field;
+        }
+        ts_state.last_timestamp = msg->timestamp;
+        ts_state.has_base = true;
+
+        uint8_t payload_len = payloadSize(msg->type);
+        if (payload_len == PAYLOAD_VARIABLE) {
+            if (pos >= body_len) return delivered;
+            payload_len = data[pos++];
+        }
+        if (payload_len > sizeof(msg->data) || pos + payload_len > body_len) {
+            return delivered;
+        }
+        // The buffer may be reused, so the unsent tail is cleared too
+        memcpy(msg->data, data + pos, payload_len);
+        memset(msg->data + payload_len, 0, sizeof(msg->data) - payload_len);
+        pos += payload_len;
+
+        // Compact records are covered by the frame CRC or tag; msg->crc is left unset
+        msg->crc = 0;
+        commit(context, *msg, type_byte & RECORD_FLAG_RELIABLE);
+        delivered++;
+    }
+
+    return delivered;
+}
+
+}
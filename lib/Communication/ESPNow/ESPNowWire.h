@@ -0,0 +1,114 @@
+#ifndef ESPNOW_WIRE_H
+#define ESPNOW_WIRE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ESPNowMessage.h"
+
+// Compact, versioned on-air framing for ESPNowMessage.
+//
+// Frame:   [FRAME_MAGIC] [version:4 | flags:4] [role] record... [crc16 LE]
+// Record:  [type | record flags] [varint sequence] [varint timestamp]
+//          [payload length, only for variable-size types] [payload]
+//
+// The timestamp is a delta from the previous record sent to the same peer,
+// with an absolute keyframe every TIMESTAMP_KEYFRAME_INTERVAL records. After
+// a lost frame the receiver estimates timestamps from its last known base
+// until the next keyframe.
+//
+// Sealed frames (FRAME_FLAG_SEALED) carry the same records encrypted, with a
+// counter and an authentication tag in place of the CRC; see ESPNowSession.
+//
+// Frames flagged FRAME_FLAG_OUT_OF_BAND (e.g. the timer-driven RC stream) use
+// absolute timestamps and leave the receiver's delta base untouched.
+//
+// Legacy frames (the packed 47-byte ESPNowMessage) start with
+// ESPNowConfig::MESSAGE_MAGIC and are still accepted by decodeFrame().
+namespace ESPNowWire {
+    static constexpr uint8_t FRAME_MAGIC = 0xAC;
+    static constexpr uint8_t WIRE_VERSION = 2;          // 2: variable-size handshake payloads
+    static constexpr size_t MAX_FRAME_SIZE = 250;       // ESP-NOW payload limit
+    static constexpr size_t FRAME_HEADER_SIZE = 3;
+    static constexpr size_t FRAME_TRAILER_SIZE = 2;
+    static constexpr size_t MAX_RECORD_SIZE = 1 + 5 + 5 + 1 + sizeof(ESPNowMessage::data);
+    static constexpr uint8_t TIMESTAMP_KEYFRAME_INTERVAL = 16;
+
+    // Frame flags carried in the low nibble of the version byte
+    static constexpr uint8_t FRAME_FLAG_OUT_OF_BAND = 0x01;
+    static constexpr uint8_t FRAME_FLAG_SEALED = 0x02;      // Encrypted by ESPNowSession, no CRC
+
+    // Record flags carried in the upper bits of the type byte
+    static constexpr uint8_t RECORD_FLAG_ABS_TIMESTAMP = 0x80;
+    static constexpr uint8_t RECORD_FLAG_RELIABLE = 0x40;       // Receiver must acknowledge
+    static constexpr uint8_t RECORD_TYPE_MASK = 0x3F;
+
+    static constexpr uint8_t PAYLOAD_VARIABLE = 0xFF;
+
+    // Payload bytes for fixed-size message types, PAYLOAD_VARIABLE otherwise
+    uint8_t payloadSize(uint8_t type);
+
+    struct EncoderState {
+        uint32_t last_timestamp;
+        uint8_t records_since_keyframe;
+        bool has_base;
+    };
+
+    struct DecoderState {
+        uint32_t last_timestamp;
+        bool has_base;
+    };
+
+    void resetEncoder(EncoderState& state);
+    void resetDecoder(DecoderState& state);
+
+    // Builds one frame out of one or more records
+    class FrameWriter {
+    public:
+        FrameWriter();
+
+        void begin(uint8_t* buffer, size_t capacity, uint8_t role, uint8_t frame_flags = 0);
+        bool append(const ESPNowMessage& msg, EncoderState& state, uint8_t record_flags = 0);
+        size_t finish();  // Appends the CRC, returns the frame length
+
+        bool fits(const ESPNowMessage& msg) const;
+        size_t getLength() const { return length; }
+        uint8_t getRecordCount() const { return record_count; }
+        bool isEmpty() const { return record_count == 0; }
+
+    private:
+        uint8_t* buffer;
+        size_t capacity;
+        size_t length;
+        uint8_t record_count;
+    };
+
+    // Single-message convenience wrapper around FrameWriter
+    size_t encode(const ESPNowMessage& msg, EncoderState& state, uint8_t* out, size_t out_size,
+                  uint8_t frame_flags = 0, uint8_t record_flags = 0);
+
+    // Called once per decoded message with its RECORD_FLAG_RELIABLE bit (0 for legacy frames)
+    typedef void (*RecordSink)(void* context, const ESPNowMessage& msg, uint8_t record_flags);
+
+    // Decodes a compact or legacy frame. Returns the number of messages
+    // delivered to the sink, 0 if the frame is malformed or fails its CRC.
+    size_t decodeFrame(const uint8_t* data, size_t len, DecoderState& state,
+                       RecordSink sink, void* context);
+
+    // Same, but each record is written straight into a buffer the caller
+    // provides: claim() returns where the next message goes (nullptr stops
+    // decoding) and commit() gets it once complete. A claimed buffer that is
+    // never committed holds a partial record; the caller reuses it.
+    typedef ESPNowMessage* (*RecordClaim)(void* context);
+    typedef void (*RecordCommit)(void* context, const ESPNowMessage& msg, uint8_t record_flags);
+    size_t decodeFrameInto(const uint8_t* data, size_t len, DecoderState& state,
+                           RecordClaim claim, RecordCommit commit, void* context);
+
+    // Decodes the header and records of a frame whose integrity was already
+    // checked (e.g. opened by ESPNowSession); body_len excludes any trailer
+    size_t decodeOpenedFrameInto(const uint8_t* data, size_t body_len, DecoderState& state,
+                                 RecordClaim claim, RecordCommit commit, void* context);
+
+    bool isLegacyFrame(const uint8_t* data, size_t len);
+}
+
+#endif
@@ -0,0 +1,119 @@
+#include "SimChannelBenchmark.h"
+
+#ifndef ARDUINO
+
+#include "ESPNowManager.h"
+
+namespace {
+    const uint8_t BENCH_BASE_MAC[6] = {0x02, 0x00, 0x00, 0x00, 0x20, 0x01};
+    const uint8_t BENCH_HANDHELD_MAC[6] = {0x02, 0x00, 0x00, 0x00, 0x20, 0x02};
+    const uint32_t TICK_US = 1000;
+    const uint32_t PAIRING_LIMIT_MS = 10000;
+
+    struct ButtonCounter {
+        uint32_t received;
+        void onButtons(const ESPNowPayload::ButtonData&, ESPNowManager::PeerId) { received++; }
+    };
+
+    void tick(SimRadioMedium& medium, ESPNowManager& base, ESPNowManager& handheld) {
+        Platform::advanceUs(TICK_US);
+        medium.poll(Platform::nowUs());
+        base.update(TICK_US / 1000);
+        handheld.update(TICK_US / 1000);
+    }
+}
+
+namespace SimChannelBenchmark {
+
+Config defaultConfig() {
+    Config config = {};
+    config.duration_ms = 15000;
+    config.send_interval_ms = 10;
+    config.seed = 1;
+    config.pairing_key = ESPNowGlobalConfig::ENABLE_ENCRYPTION ? ESPNowGlobalConfig::PAIRING_KEY : nullptr;
+    config.link = SimRadioMedium::idealLink();
+
+    config.events[0].at_ms = 0;
+    config.events[0].channel = 6;
+    config.events[0].profile.loss_rate = 0.3f;
+    config.events[0].profile.rssi = -80;
+    config.events[1].at_ms = 3000;
+    config.events[1].channel = ESPNowConfig::CHANNEL;
+    config.events[1].profile.loss_rate = 0.6f;
+    config.events[1].profile.rssi = -75;
+    config.event_count = 2;
+    return config;
+}
+
+Result run(const Config& config) {
+    Result result = {};
+
+    SimRadioMedium medium(config.seed);
+    medium.setLinkConfig(config.link);
+    SimRadioTransport base_radio(medium, BENCH_BASE_MAC);
+    SimRadioTransport handheld_radio(medium, BENCH_HANDHELD_MAC);
+    ESPNowManager base(ESPNowConfig::ROLE_BASE_STATION, BENCH_HANDHELD_MAC, &base_radio);
+    ESPNowManager handheld(ESPNowConfig::ROLE_HANDHELD, BENCH_BASE_MAC, &handheld_radio);
+    base.setPairingKey(config.pairing_key);
+    handheld.setPairingKey(config.pairing_key);
+
+    ButtonCounter counter = {};
+    base.getDispatchTable().on<ESPNowPayload::ButtonData, ButtonCounter, &ButtonCounter::onButtons>(&counter);
+
+    if (base.init() != HAL_OK || handheld.init() != HAL_OK) {
+        return result;
+    }
+    handheld.startConnection();
+
+    for (uint32_t ms = 0; ms < PAIRING_LIMIT_MS && !(base.isPaired() && handheld.isPaired()); ms++) {
+        tick(medium, base, handheld);
+    }
+    if (!(base.isPaired() && handheld.isPaired())) {
+        return result;
+    }
+    result.paired = true;
+
+    uint8_t event_count = config.event_count < MAX_EVENTS ? config.event_count : MAX_EVENTS;
+    uint8_t next_event = 0;
+    uint8_t channel = base.getChannel();
+    for (uint32_t ms = 0; ms < config.duration_ms; ms++) {
+        while (next_event < event_count && config.events[next_event].at_ms <= ms) {
+            medium.setChannelProfile(config.events[next_event].channel, config.events[next_event].profile);
+            next_event++;
+        }
+        if (config.send_interval_ms > 0 && ms % config.send_interval_ms == 0) {
+            ESPNowMessage msg;
+            msg.setButtonData(static_cast<uint8_t>(result.sent));
+            if (handheld.sendMessage(msg) == HAL_OK) {
+                result.sent++;
+            }
+        }
+        tick(medium, base, handheld);
+
+        if (base.getChannel() != channel) {
+            channel = base.getChannel();
+            result.last_move_ms = ms;
+        }
+    }
+
+    // Stragglers still on the medium
+    for (uint32_t ms = 0; ms < 100; ms++) {
+        tick(medium, base, handheld);
+    }
+
+    ESPNowManager::Stats stats = base.getStats();
+    result.final_channel = base.getChannel();
+    result.channels_agree = base.getChannel() == handheld.getChannel();
+    result.surveys = stats.channel_surveys;
+    result.moves = stats.channel_moves;
+    result.reverts = stats.channel_reverts;
+    result.delivered = counter.received;
+
+    base.shutdown();
+    handheld.shutdown();
+    return result;
+}
+
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef SIM_CHANNEL_BENCHMARK_H
+#define SIM_CHANNEL_BENCHMARK_H
+
+#include "../../Core/Platform.h"
+
+#ifndef ARDUINO
+
+#include "SimRadioMedium.h"
+
+// Channel agility on the simulated medium. A base station and a handheld
+// pair on the home channel while the handheld sends button data; scripted
+// interference then changes the channel profiles during the run, and the
+// result shows where the link ended up, how often it surveyed and moved, and
+// how much of the handheld's traffic got through.
+namespace SimChannelBenchmark {
+    static constexpr uint8_t MAX_EVENTS = 8;
+
+    // From at_ms after pairing on, channel has this profile
+    struct Interference {
+        uint32_t at_ms;
+        uint8_t channel;
+        SimRadioMedium::ChannelProfile profile;
+    };
+
+    struct Config {
+        uint32_t duration_ms;       // After pairing
+        uint32_t send_interval_ms;  // Handheld button data
+        uint32_t seed;
+        const uint8_t* pairing_key; // Both ends, nullptr = unencrypted
+        SimRadioMedium::LinkConfig link;
+        Interference events[MAX_EVENTS];
+        uint8_t event_count;
+    };
+
+    struct Result {
+        bool paired;
+        bool channels_agree;        // Both ends on the same channel at the end
+        uint8_t final_channel;      // Base station's
+        uint32_t last_move_ms;      // After pairing, 0 = never moved
+        uint32_t surveys;           // Base station's stats
+        uint32_t moves;
+        uint32_t reverts;
+        uint32_t sent;              // Button data from the handheld
+        uint32_t delivered;
+    };
+
+    // Home channel jammed 3 s in, channel 6 poor throughout
+    Config defaultConfig();
+    Result run(const Config& config);
+}
+
+#endif
+
+#endif
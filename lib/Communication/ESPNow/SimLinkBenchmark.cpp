@@ -0,0 +1,100 @@
+#include "SimLinkBenchmark.h"
+
+#ifndef ARDUINO
+
+#include "ESPNowManager.h"
+#include <chrono>
+
+namespace {
+    const uint8_t BENCH_BASE_MAC[6] = {0x02, 0x00, 0x00, 0x00, 0x20, 0x01};
+    const uint8_t BENCH_HANDHELD_MAC[6] = {0x02, 0x00, 0x00, 0x00, 0x20, 0x02};
+    const uint32_t PAIRING_LIMIT_MS = 10000;
+
+    // Same order as an app tick: manager update, benchmark, end-of-tick flush
+    void tick(SimRadioMedium& medium, uint32_t tick_us,
+              ESPNowManager& base, ESPNowManager& handheld,
+              ESPNowBenchmark& responder, ESPNowBenchmark& initiator) {
+        Platform::advanceUs(tick_us);
+        medium.poll(Platform::nowUs());
+        base.update(tick_us / 1000);
+        handheld.update(tick_us / 1000);
+        responder.update();
+        initiator.update();
+        base.flush();
+        handheld.flush();
+    }
+
+    uint64_t steadyClockNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+namespace SimLinkBenchmark {
+
+Config defaultConfig() {
+    Config config = {};
+    config.benchmark = ESPNowBenchmark::defaultConfig();
+    config.benchmark.source = "sim";
+    config.benchmark.crypto_iterations = 0;  // Simulated clock; see printCryptoCost()
+    config.seed = 1;
+    config.tick_us = 1000;
+    config.pairing_key = ESPNowGlobalConfig::ENABLE_ENCRYPTION ? ESPNowGlobalConfig::PAIRING_KEY : nullptr;
+    config.link = SimRadioMedium::idealLink();
+    return config;
+}
+
+Result run(const Config& config) {
+    Result result = {};
+    uint32_t tick_us = config.tick_us ? config.tick_us : 1000;
+
+    SimRadioMedium medium(config.seed);
+    medium.setLinkConfig(config.link);
+    SimRadioTransport base_radio(medium, BENCH_BASE_MAC);
+    SimRadioTransport handheld_radio(medium, BENCH_HANDHELD_MAC);
+    ESPNowManager base(ESPNowConfig::ROLE_BASE_STATION, BENCH_HANDHELD_MAC, &base_radio);
+    ESPNowManager handheld(ESPNowConfig::ROLE_HANDHELD, BENCH_BASE_MAC, &handheld_radio);
+    base.setPairingKey(config.pairing_key);
+    handheld.setPairingKey(config.pairing_key);
+
+    if (base.init() != HAL_OK || handheld.init() != HAL_OK) {
+        return result;
+    }
+    ESPNowBenchmark responder(base);
+    ESPNowBenchmark initiator(handheld);
+    handheld.startConnection();
+
+    for (uint32_t us = 0; us < PAIRING_LIMIT_MS * 1000 && !(base.isPaired() && handheld.isPaired()); us += tick_us) {
+        tick(medium, tick_us, base, handheld, responder, initiator);
+    }
+    if (!(base.isPaired() && handheld.isPaired())) {
+        base.shutdown();
+        handheld.shutdown();
+        return result;
+    }
+    result.paired = true;
+
+    if (initiator.start(config.benchmark) == HAL_OK) {
+        while (initiator.isRunning()) {
+            tick(medium, tick_us, base, handheld, responder, initiator);
+        }
+    }
+
+    result.step_count = initiator.getResultCount();
+    result.completed = initiator.getStepCount() > 0 && result.step_count == initiator.getStepCount();
+    for (uint8_t i = 0; i < result.step_count; i++) {
+        result.steps[i] = initiator.getResult(i);
+    }
+
+    base.shutdown();
+    handheld.shutdown();
+    return result;
+}
+
+void printCryptoCost(uint16_t iterations) {
+    ESPNowBenchmark::printCryptoCost("sim", iterations, &steadyClockNs);
+}
+
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef SIM_LINK_BENCHMARK_H
+#define SIM_LINK_BENCHMARK_H
+
+#include "../../Core/Platform.h"
+
+#ifndef ARDUINO
+
+#include "SimRadioMedium.h"
+#include "ESPNowBenchmark.h"
+
+// ESPNowBenchmark on the simulated medium: a base station and a handheld
+// pair, and the handheld runs the sweep against the base station. Rows go
+// to stdout in the same CSV format as on hardware, with source "sim", so
+// both can be compared directly. Latencies come from the medium's link
+// model plus up to one tick of update latency on each end. Simulated time
+// doesn't move during a call, so cpu_us_per_msg and crypto_us_per_frame are
+// always 0 here; printCryptoCost() measures the session with a real clock.
+namespace SimLinkBenchmark {
+    struct Config {
+        ESPNowBenchmark::Config benchmark;
+        uint32_t seed;
+        uint32_t tick_us;           // Update period of both managers
+        const uint8_t* pairing_key; // Both ends, nullptr = unencrypted
+        SimRadioMedium::LinkConfig link;
+    };
+
+    struct Result {
+        bool paired;
+        bool completed;             // Every step ran
+        uint8_t step_count;
+        ESPNowBenchmark::Result steps[ESPNowBenchmark::MAX_STEPS];
+    };
+
+    Config defaultConfig();
+    Result run(const Config& config);
+
+    // ESPNowBenchmark::printCryptoCost() timed with the host's steady clock
+    void printCryptoCost(uint16_t iterations = ESPNowGlobalConfig::BENCHMARK_CRYPTO_ITERATIONS);
+}
+
+#endif
+
+#endif
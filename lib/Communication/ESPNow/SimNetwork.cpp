@@ -0,0 +1,95 @@
+#include "SimNetwork.h"
+
+#ifndef ARDUINO
+
+#include <thread>
+
+const uint8_t SimNetwork::BASE_MAC[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+const uint8_t SimNetwork::HANDHELD_MAC[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x02};
+const uint8_t SimNetwork::DRONE_MAC[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x03};
+const uint8_t SimNetwork::SPARE_MAC[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x04};
+const uint8_t SimNetwork::NO_MAC[6] = {0};
+
+SimNetwork::SimNetwork(uint32_t seed)
+    : medium(seed)
+    , nodes()
+    , node_count(0)
+    , pacing_us(0) {
+}
+
+SimNetwork::~SimNetwork() {
+    // Managers first: shutting down still talks to the radio
+    for (uint8_t i = node_count; i > 0; i--) {
+        delete nodes[i - 1].manager;
+    }
+    for (uint8_t i = node_count; i > 0; i--) {
+        delete nodes[i - 1].radio;
+    }
+}
+
+ESPNowManager* SimNetwork::addNode(const uint8_t* mac, ESPNowConfig::DeviceRole role, const uint8_t* peer_mac) {
+    if (node_count >= MAX_NODES) {
+        return nullptr;
+    }
+    Node& node = nodes[node_count++];
+    node.radio = new SimRadioTransport(medium, mac);
+    node.manager = new ESPNowManager(role, peer_mac ? peer_mac : NO_MAC, node.radio);
+    node.update_interval_ms = 1;
+    return node.manager;
+}
+
+hal_status_t SimNetwork::initAll() {
+    for (uint8_t i = 0; i < node_count; i++) {
+        hal_status_t status = nodes[i].manager->init();
+        if (status != HAL_OK) {
+            return status;
+        }
+    }
+    return HAL_OK;
+}
+
+SimRadioTransport& SimNetwork::getRadio(const ESPNowManager& node) {
+    return *find(node)->radio;
+}
+
+void SimNetwork::setUpdateInterval(const ESPNowManager& node, uint32_t interval_ms) {
+    find(node)->update_interval_ms = interval_ms;
+}
+
+void SimNetwork::tick(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+        Platform::advanceUs(1000);
+        uint64_t now_us = Platform::nowUs();
+        medium.poll(now_us);
+        for (uint8_t n = 0; n < node_count; n++) {
+            uint32_t interval_ms = nodes[n].update_interval_ms;
+            if (interval_ms > 0 && now_us / 1000 % interval_ms == 0) {
+                nodes[n].manager->update(interval_ms);
+            }
+        }
+        if (pacing_us > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(pacing_us));
+        }
+    }
+}
+
+int32_t SimNetwork::pair(const ESPNowManager& a, const ESPNowManager& b, uint32_t timeout_ms) {
+    for (uint32_t ms = 0; ms < timeout_ms; ms++) {
+        if (a.isPaired() && b.isPaired()) {
+            return static_cast<int32_t>(ms);
+        }
+        tick();
+    }
+    return -1;
+}
+
+SimNetwork::Node* SimNetwork::find(const ESPNowManager& manager) {
+    for (uint8_t i = 0; i < node_count; i++) {
+        if (nodes[i].manager == &manager) {
+            return &nodes[i];
+        }
+    }
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef SIM_NETWORK_H
+#define SIM_NETWORK_H
+
+#include "../../Core/Platform.h"
+
+#ifndef ARDUINO
+
+#include "SimRadioMedium.h"
+#include "ESPNowManager.h"
+
+// ESP-NOW nodes on one SimRadioMedium for host tests. Each node added is a
+// SimRadioTransport and an ESPNowManager with that MAC, role and pairing
+// peer. tick() moves the simulated clock a millisecond at a time, delivers
+// what the medium has due and updates the nodes in the order they were
+// added, every millisecond unless setUpdateInterval() says otherwise.
+//
+// Nodes whose update() runs on an ESPNowLinkTask thread need the clock to
+// move no faster than they keep up with: setPacingUs() sleeps that long in
+// real time after every simulated millisecond.
+class SimNetwork {
+public:
+    static constexpr uint8_t MAX_NODES = SimRadioMedium::MAX_NODES;
+
+    // Locally administered addresses the test nodes use
+    static const uint8_t BASE_MAC[6];
+    static const uint8_t HANDHELD_MAC[6];
+    static const uint8_t DRONE_MAC[6];
+    static const uint8_t SPARE_MAC[6];
+    static const uint8_t NO_MAC[6];     // No pairing peer
+
+    explicit SimNetwork(uint32_t seed = 1);
+    ~SimNetwork();
+    SimNetwork(const SimNetwork&) = delete;
+    SimNetwork& operator=(const SimNetwork&) = delete;
+
+    // Not initialized; nullptr when the medium is full
+    ESPNowManager* addNode(const uint8_t* mac, ESPNowConfig::DeviceRole role, const uint8_t* peer_mac = NO_MAC);
+    // The usual nodes, paired base station and handheld plus drones that
+    // only talk to registered peers; fewer than MAX_NODES in all
+    ESPNowManager& addBaseStation() { return *addNode(BASE_MAC, ESPNowConfig::ROLE_BASE_STATION, HANDHELD_MAC); }
+    ESPNowManager& addHandheld() { return *addNode(HANDHELD_MAC, ESPNowConfig::ROLE_HANDHELD, BASE_MAC); }
+    ESPNowManager& addDrone(const uint8_t* mac = DRONE_MAC) { return *addNode(mac, ESPNowConfig::ROLE_DRONE); }
+    hal_status_t initAll();
+
+    SimRadioMedium& getMedium() { return medium; }
+    SimRadioTransport& getRadio(const ESPNowManager& node);
+
+    // update(interval_ms) every interval_ms instead of every millisecond,
+    // e.g. an app loop held up by display redraws; 0 = never
+    void setUpdateInterval(const ESPNowManager& node, uint32_t interval_ms);
+    void setPacingUs(uint32_t real_us) { pacing_us = real_us; }
+
+    void tick(uint32_t ms = 1);
+
+    // Ticks until the condition holds; false on timeout
+    template<typename Condition>
+    bool tickUntil(Condition condition, uint32_t timeout_ms) {
+        for (uint32_t ms = 0; ms < timeout_ms; ms++) {
+            if (condition()) return true;
+            tick();
+        }
+        return condition();
+    }
+
+    // ms until both are paired, or -1
+    int32_t pair(const ESPNowManager& a, const ESPNowManager& b, uint32_t timeout_ms);
+
+private:
+    struct Node {
+        SimRadioTransport* radio;
+        ESPNowManager* manager;
+        uint32_t update_interval_ms;
+    };
+
+    SimRadioMedium medium;
+    Node nodes[MAX_NODES];
+    uint8_t node_count;
+    uint32_t pacing_us;
+
+    Node* find(const ESPNowManager& manager);
+};
+
+#endif
+
+#endif
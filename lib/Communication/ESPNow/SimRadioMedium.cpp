@@ -0,0 +1,331 @@
+#include "SimRadioMedium.h"
+
+#ifndef ARDUINO
+
+namespace {
+    const uint8_t BROADCAST_MAC[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+}
+
+SimRadioMedium::SimRadioMedium(uint32_t seed)
+    : link(idealLink())
+    , rng_state(seed ? seed : 1)
+    , next_order(0)
+    , pending_count(0) {
+    memset(&stats, 0, sizeof(stats));
+    memset(channel_free_us, 0, sizeof(channel_free_us));
+    for (uint8_t channel = 0; channel <= MAX_CHANNEL; channel++) {
+        profiles[channel].loss_rate = 0.0f;
+        profiles[channel].rssi = -50;
+    }
+    memset(last_due_us, 0, sizeof(last_due_us));
+    for (uint8_t i = 0; i < MAX_NODES; i++) {
+        nodes[i] = nullptr;
+        node_enabled[i] = true;
+    }
+    for (size_t i = 0; i < MAX_PENDING; i++) {
+        pending[i].in_use = false;
+    }
+}
+
+SimRadioMedium::LinkConfig SimRadioMedium::idealLink() {
+    LinkConfig config = {};
+    config.latency_us = 200;
+    config.bandwidth_bps = 1000000;
+    return config;
+}
+
+void SimRadioMedium::setChannelProfile(uint8_t channel, const ChannelProfile& profile) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    if (channel >= 1 && channel <= MAX_CHANNEL) {
+        profiles[channel] = profile;
+    }
+}
+
+SimRadioMedium::ChannelProfile SimRadioMedium::getChannelProfile(uint8_t channel) const {
+    return profiles[(channel >= 1 && channel <= MAX_CHANNEL) ? channel : 0];
+}
+
+void SimRadioMedium::setNodeEnabled(const uint8_t* mac, bool enabled) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    int8_t node = findNode(mac);
+    if (node >= 0) {
+        node_enabled[node] = enabled;
+    }
+}
+
+void SimRadioMedium::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool SimRadioMedium::attach(SimRadioTransport* node) {
+    for (uint8_t i = 0; i < MAX_NODES; i++) {
+        if (nodes[i] == node) return true;
+    }
+    for (uint8_t i = 0; i < MAX_NODES; i++) {
+        if (!nodes[i]) {
+            nodes[i] = node;
+            node_enabled[i] = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+void SimRadioMedium::detach(SimRadioTransport* node) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    for (uint8_t i = 0; i < MAX_NODES; i++) {
+        if (nodes[i] != node) continue;
+
+        nodes[i] = nullptr;
+        for (size_t e = 0; e < MAX_PENDING; e++) {
+            if (pending[e].in_use && (pending[e].from == i || pending[e].to == i)) {
+                pending[e].in_use = false;
+                pending_count--;
+            }
+        }
+        return;
+    }
+}
+
+int8_t SimRadioMedium::findNode(const uint8_t* mac) const {
+    for (uint8_t i = 0; i < MAX_NODES; i++) {
+        if (nodes[i] && memcmp(nodes[i]->own_mac, mac, 6) == 0) {
+            return static_cast<int8_t>(i);
+        }
+    }
+    return -1;
+}
+
+hal_status_t SimRadioMedium::transmit(SimRadioTransport* sender, const uint8_t* mac, const uint8_t* data,
+                                      size_t len, uint64_t now_us) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    int8_t from = findNode(sender->own_mac);
+    if (from < 0 || len == 0 || len > ESPNowWire::MAX_FRAME_SIZE) {
+        return HAL_ERROR;
+    }
+    stats.frames_sent++;
+
+    // Shared channel: wait for it to be free, then occupy it for the airtime
+    uint8_t channel = sender->channel;
+    const ChannelProfile& profile = profiles[channel];
+    uint64_t airtime_us = link.bandwidth_bps ? (static_cast<uint64_t>(len) * 8 * 1000000) / link.bandwidth_bps : 0;
+    uint64_t& channel_free = channel_free_us[channel];
+    uint64_t start_us = (channel_free > now_us) ? channel_free : now_us;
+    channel_free = start_us + airtime_us;
+
+    bool broadcast = memcmp(mac, BROADCAST_MAC, 6) == 0;
+    bool delivered_any = false;
+
+    for (uint8_t to = 0; to < MAX_NODES; to++) {
+        if (!nodes[to] || to == from) continue;
+        if (!broadcast && memcmp(nodes[to]->own_mac, mac, 6) != 0) continue;
+
+        if (!node_enabled[from] || !node_enabled[to] || nodes[to]->channel != channel ||
+            chance(link.loss_rate) || chance(profile.loss_rate)) {
+            stats.frames_lost++;
+            continue;
+        }
+
+        uint64_t due_us = channel_free + link.latency_us;
+        if (link.jitter_us) {
+            due_us += nextRandom() % (link.jitter_us + 1);
+        }
+
+        if (chance(link.reorder_rate)) {
+            due_us += link.reorder_delay_us;
+            stats.frames_reordered++;
+        } else {
+            // In-order frames never overtake earlier ones on the same pair
+            if (due_us < last_due_us[from][to]) due_us = last_due_us[from][to];
+            last_due_us[from][to] = due_us;
+        }
+
+        if (schedule(EventKind::FRAME, channel, static_cast<uint8_t>(from), to, due_us, true, data, len)) {
+            delivered_any = true;
+        }
+    }
+
+    // Unicast gets the MAC-layer ack outcome once the ack would have come back
+    if (!broadcast) {
+        uint64_t report_us = channel_free + 2 * link.latency_us;
+        schedule(EventKind::SEND_REPORT, channel, static_cast<uint8_t>(from), static_cast<uint8_t>(from), report_us,
+                 delivered_any, mac, 6);
+    }
+    return HAL_OK;
+}
+
+bool SimRadioMedium::schedule(EventKind kind, uint8_t channel, uint8_t from, uint8_t to, uint64_t due_us,
+                              bool delivered, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < MAX_PENDING; i++) {
+        Event& event = pending[i];
+        if (event.in_use) continue;
+
+        event.in_use = true;
+        event.kind = kind;
+        event.delivered = delivered;
+        event.channel = channel;
+        event.from = from;
+        event.to = to;
+        event.due_us = due_us;
+        event.order = next_order++;
+        event.length = static_cast<uint8_t>(len);
+        if (data && len) {
+            memcpy(event.data, data, len);
+        }
+        pending_count++;
+        return true;
+    }
+
+    stats.frames_dropped++;
+    return false;
+}
+
+size_t SimRadioMedium::poll(uint64_t now_us) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    size_t handled = 0;
+
+    while (pending_count > 0) {
+        // Earliest due event; handlers may send, which schedules more
+        Event* next = nullptr;
+        for (size_t i = 0; i < MAX_PENDING; i++) {
+            Event& event = pending[i];
+            if (!event.in_use || event.due_us > now_us) continue;
+            if (!next || event.due_us < next->due_us ||
+                (event.due_us == next->due_us && static_cast<int32_t>(event.order - next->order) < 0)) {
+                next = &event;
+            }
+        }
+        if (!next) break;
+
+        Event event = *next;
+        next->in_use = false;
+        pending_count--;
+        handled++;
+
+        SimRadioTransport* node = nodes[event.to];
+        if (!node || !node->is_started) continue;
+
+        if (event.kind == EventKind::FRAME) {
+            // The receiver hopped away while the frame was in the air
+            if (node->channel != event.channel) {
+                stats.frames_lost++;
+                continue;
+            }
+            stats.frames_delivered++;
+            stats.bytes_delivered += event.length;
+            if (node->receive_handler) {
+                node->receive_handler(node->handler_context, nodes[event.from] ? nodes[event.from]->own_mac : BROADCAST_MAC,
+                                      event.data, event.length, profiles[event.channel].rssi);
+            }
+        } else if (node->send_handler) {
+            node->send_handler(node->handler_context, event.data, event.delivered);  // Destination MAC
+        }
+    }
+
+    return handled;
+}
+
+uint32_t SimRadioMedium::nextRandom() {
+    // xorshift32
+    uint32_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rng_state = x;
+    return x;
+}
+
+bool SimRadioMedium::chance(float rate) {
+    if (rate <= 0.0f) return false;
+    if (rate >= 1.0f) return true;
+    return (nextRandom() >> 8) < static_cast<uint32_t>(rate * 16777216.0f);
+}
+
+SimRadioTransport::SimRadioTransport(SimRadioMedium& medium, const uint8_t* mac)
+    : medium(medium)
+    , radio_peer_count(0)
+    , channel(ESPNowConfig::CHANNEL)
+    , receive_handler(nullptr)
+    , send_handler(nullptr)
+    , handler_context(nullptr)
+    , is_started(false) {
+    memcpy(own_mac, mac, 6);
+    memset(radio_peers, 0, sizeof(radio_peers));
+    medium.attach(this);
+}
+
+SimRadioTransport::~SimRadioTransport() {
+    medium.detach(this);
+}
+
+hal_status_t SimRadioTransport::begin(ReceiveHandler on_receive, SendHandler on_sent, void* context) {
+    if (is_started) return HAL_BUSY;
+
+    receive_handler = on_receive;
+    send_handler = on_sent;
+    handler_context = context;
+    is_started = true;
+    return HAL_OK;
+}
+
+void SimRadioTransport::end() {
+    receive_handler = nullptr;
+    send_handler = nullptr;
+    handler_context = nullptr;
+    radio_peer_count = 0;
+    is_started = false;
+}
+
+hal_status_t SimRadioTransport::send(const uint8_t* mac, const uint8_t* data, size_t len) {
+    if (!is_started || !mac || !data) return HAL_ERROR;
+
+    // Same rule as the driver: unicast needs a registered peer
+    if (memcmp(mac, BROADCAST_MAC, 6) != 0 && findRadioPeer(mac) < 0) {
+        return HAL_ERROR;
+    }
+    return medium.transmit(this, mac, data, len, Platform::nowUs());
+}
+
+hal_status_t SimRadioTransport::addPeer(const uint8_t* mac, uint8_t) {
+    if (findRadioPeer(mac) >= 0) return HAL_ERROR;  // esp_now_add_peer() rejects duplicates
+    if (radio_peer_count >= MAX_RADIO_PEERS) return HAL_ERROR;
+
+    memcpy(radio_peers[radio_peer_count++], mac, 6);
+    return HAL_OK;
+}
+
+hal_status_t SimRadioTransport::removePeer(const uint8_t* mac) {
+    int8_t index = findRadioPeer(mac);
+    if (index < 0) return HAL_ERROR;
+
+    radio_peer_count--;
+    memcpy(radio_peers[index], radio_peers[radio_peer_count], 6);
+    return HAL_OK;
+}
+
+bool SimRadioTransport::hasPeer(const uint8_t* mac) const {
+    return findRadioPeer(mac) >= 0;
+}
+
+hal_status_t SimRadioTransport::setChannel(uint8_t new_channel) {
+    if (new_channel < 1 || new_channel > SimRadioMedium::MAX_CHANNEL) return HAL_INVALID_PARAM;
+
+    std::lock_guard<std::recursive_mutex> guard(medium.lock);
+    channel = new_channel;
+    return HAL_OK;
+}
+
+void SimRadioTransport::getMacAddress(uint8_t* mac) const {
+    memcpy(mac, own_mac, 6);
+}
+
+int8_t SimRadioTransport::findRadioPeer(const uint8_t* mac) const {
+    for (uint8_t i = 0; i < radio_peer_count; i++) {
+        if (memcmp(radio_peers[i], mac, 6) == 0) {
+            return static_cast<int8_t>(i);
+        }
+    }
+    return -1;
+}
+
+#endif
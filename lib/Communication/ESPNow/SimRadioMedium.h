@@ -0,0 +1,167 @@
+#ifndef SIM_RADIO_MEDIUM_H
+#define SIM_RADIO_MEDIUM_H
+
+#include "../../Core/Platform.h"
+
+#ifndef ARDUINO
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ESPNowTransport.h"
+#include "ESPNowWire.h"
+#include <mutex>
+
+class SimRadioTransport;
+
+// In-process radio channel for host tests and load generation. Frames sent
+// by one SimRadioTransport are delivered to the others from poll(), after
+// the configured airtime, latency and jitter. The channel is shared: a frame
+// occupies it for its airtime at bandwidth_bps, so bursts queue up.
+//
+// Delivery is FIFO per sender/receiver pair unless a frame is picked for
+// reordering, which holds it back by an extra reorder_delay_us. Unicast
+// senders get a send callback with the outcome, as the ESP-NOW MAC-layer ack
+// would report it. All randomness comes from a seeded generator, so a run
+// with the same seed and inputs is reproducible.
+//
+// Every node listens on one radio channel, and only hears frames sent on it.
+// Each channel has its own airtime and a ChannelProfile whose loss comes on
+// top of the link's; changing the profiles during a run scripts interference.
+//
+// Sends and poll() may come from different threads (ESPNowLinkTask on the
+// host); the medium serializes them.
+class SimRadioMedium {
+public:
+    struct LinkConfig {
+        uint32_t latency_us;
+        uint32_t jitter_us;         // Uniform, added to latency
+        float loss_rate;            // 0..1, per frame and receiver
+        float reorder_rate;         // 0..1
+        uint32_t reorder_delay_us;
+        uint32_t bandwidth_bps;     // 0 = unlimited
+    };
+
+    struct ChannelProfile {
+        float loss_rate;            // 0..1, added to LinkConfig::loss_rate
+        int8_t rssi;                // dBm reported with every frame received on the channel
+    };
+
+    struct Stats {
+        uint32_t frames_sent;
+        uint32_t frames_delivered;
+        uint32_t frames_lost;
+        uint32_t frames_reordered;
+        uint32_t frames_dropped;    // Medium queue full
+        uint32_t bytes_delivered;
+    };
+
+    static constexpr uint8_t MAX_NODES = 8;
+    static constexpr size_t MAX_PENDING = 512;
+    static constexpr uint8_t MAX_CHANNEL = 14;
+
+    explicit SimRadioMedium(uint32_t seed = 1);
+
+    void setLinkConfig(const LinkConfig& config) { link = config; }
+    const LinkConfig& getLinkConfig() const { return link; }
+    static LinkConfig idealLink();  // 1 Mbps, 200 us latency, no loss
+
+    // Channels 1..MAX_CHANNEL; all start without extra loss at -50 dBm
+    void setChannelProfile(uint8_t channel, const ChannelProfile& profile);
+    ChannelProfile getChannelProfile(uint8_t channel) const;
+
+    // A disabled node neither sends nor receives, e.g. to model an RF dropout
+    void setNodeEnabled(const uint8_t* mac, bool enabled);
+
+    // Delivers every frame and send report due at or before now_us
+    size_t poll(uint64_t now_us);
+    size_t getPendingCount() const { return pending_count; }
+
+    const Stats& getStats() const { return stats; }
+    void resetStats();
+
+private:
+    friend class SimRadioTransport;
+
+    enum class EventKind : uint8_t {
+        FRAME,
+        SEND_REPORT
+    };
+
+    struct Event {
+        bool in_use;
+        EventKind kind;
+        bool delivered;             // SEND_REPORT outcome; data holds the destination MAC
+        uint8_t channel;
+        uint8_t from;
+        uint8_t to;
+        uint64_t due_us;
+        uint32_t order;             // Tie-break for equal due times
+        uint8_t length;
+        uint8_t data[ESPNowWire::MAX_FRAME_SIZE];
+    };
+
+    LinkConfig link;
+    Stats stats;
+    uint32_t rng_state;
+    uint32_t next_order;
+    uint64_t channel_free_us[MAX_CHANNEL + 1];
+    ChannelProfile profiles[MAX_CHANNEL + 1];
+    uint64_t last_due_us[MAX_NODES][MAX_NODES];
+    SimRadioTransport* nodes[MAX_NODES];
+    bool node_enabled[MAX_NODES];
+    Event pending[MAX_PENDING];
+    size_t pending_count;
+    std::recursive_mutex lock;  // Recursive: handlers run from poll() may send
+
+    bool attach(SimRadioTransport* node);
+    void detach(SimRadioTransport* node);
+    int8_t findNode(const uint8_t* mac) const;
+    hal_status_t transmit(SimRadioTransport* sender, const uint8_t* mac, const uint8_t* data, size_t len,
+                          uint64_t now_us);
+    bool schedule(EventKind kind, uint8_t channel, uint8_t from, uint8_t to, uint64_t due_us, bool delivered,
+                  const uint8_t* data, size_t len);
+    uint32_t nextRandom();
+    bool chance(float rate);
+};
+
+// Transport for one simulated node. Sends take the time from
+// Platform::nowUs() on host builds, so the medium follows the simulated clock.
+class SimRadioTransport : public ESPNowTransport {
+public:
+    SimRadioTransport(SimRadioMedium& medium, const uint8_t* mac);
+    ~SimRadioTransport() override;
+
+    hal_status_t begin(ReceiveHandler on_receive, SendHandler on_sent, void* context) override;
+    void end() override;
+
+    hal_status_t send(const uint8_t* mac, const uint8_t* data, size_t len) override;
+    hal_status_t addPeer(const uint8_t* mac, uint8_t channel) override;
+    hal_status_t removePeer(const uint8_t* mac) override;
+    bool hasPeer(const uint8_t* mac) const override;
+
+    hal_status_t setChannel(uint8_t channel) override;
+    uint8_t getChannel() const override { return channel; }
+
+    void getMacAddress(uint8_t* mac) const override;
+
+private:
+    friend class SimRadioMedium;
+
+    static constexpr uint8_t MAX_RADIO_PEERS = 20;  // ESP-NOW limit
+
+    SimRadioMedium& medium;
+    uint8_t own_mac[6];
+    uint8_t radio_peers[MAX_RADIO_PEERS][6];
+    uint8_t radio_peer_count;
+    uint8_t channel;
+    ReceiveHandler receive_handler;
+    SendHandler send_handler;
+    void* handler_context;
+    bool is_started;
+
+    int8_t findRadioPeer(const uint8_t* mac) const;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,99 @@
+#include "SimRecoveryBenchmark.h"
+
+#ifndef ARDUINO
+
+#include "ESPNowManager.h"
+
+namespace {
+    const uint8_t BENCH_BASE_MAC[6] = {0x02, 0x00, 0x00, 0x00, 0x10, 0x01};
+    const uint8_t BENCH_HANDHELD_MAC[6] = {0x02, 0x00, 0x00, 0x00, 0x10, 0x02};
+    const uint32_t TICK_US = 1000;
+    const uint32_t PAIRING_LIMIT_MS = 10000;
+
+    void tick(SimRadioMedium& medium, ESPNowManager& base, ESPNowManager& handheld) {
+        Platform::advanceUs(TICK_US);
+        medium.poll(Platform::nowUs());
+        base.update(TICK_US / 1000);
+        handheld.update(TICK_US / 1000);
+    }
+}
+
+namespace SimRecoveryBenchmark {
+
+Config defaultConfig(uint32_t outage_ms) {
+    Config config = {};
+    config.outage_ms = outage_ms;
+    config.settle_ms = 2000;
+    config.give_up_ms = 30000;
+    config.seed = 1;
+    config.restart_handheld = true;
+    config.pairing_key = ESPNowGlobalConfig::ENABLE_ENCRYPTION ? ESPNowGlobalConfig::PAIRING_KEY : nullptr;
+    config.link = SimRadioMedium::idealLink();
+    return config;
+}
+
+Result run(const Config& config) {
+    Result result = {};
+
+    SimRadioMedium medium(config.seed);
+    medium.setLinkConfig(config.link);
+    SimRadioTransport base_radio(medium, BENCH_BASE_MAC);
+    SimRadioTransport handheld_radio(medium, BENCH_HANDHELD_MAC);
+    ESPNowManager base(ESPNowConfig::ROLE_BASE_STATION, BENCH_HANDHELD_MAC, &base_radio);
+    ESPNowManager handheld(ESPNowConfig::ROLE_HANDHELD, BENCH_BASE_MAC, &handheld_radio);
+    base.setPairingKey(config.pairing_key);
+    handheld.setPairingKey(config.pairing_key);
+
+    if (base.init() != HAL_OK || handheld.init() != HAL_OK) {
+        return result;
+    }
+    handheld.startConnection();
+
+    for (uint32_t ms = 0; ms < PAIRING_LIMIT_MS && !(base.isPaired() && handheld.isPaired()); ms++) {
+        tick(medium, base, handheld);
+    }
+    if (!(base.isPaired() && handheld.isPaired())) {
+        return result;
+    }
+    result.paired = true;
+
+    for (uint32_t ms = 0; ms < config.settle_ms; ms++) {
+        tick(medium, base, handheld);
+    }
+
+    medium.setNodeEnabled(BENCH_HANDHELD_MAC, false);
+    for (uint32_t ms = 0; ms < config.outage_ms; ms++) {
+        tick(medium, base, handheld);
+    }
+    medium.setNodeEnabled(BENCH_HANDHELD_MAC, true);
+
+    uint32_t fast_before = base.getStats().fast_reconnects + handheld.getStats().fast_reconnects;
+    uint64_t restored_us = Platform::nowUs();
+
+    for (uint32_t ms = 0; ms < config.give_up_ms; ms++) {
+        if (base.isPaired() && handheld.isPaired()) {
+            result.recovered = true;
+            break;
+        }
+        if (config.restart_handheld && handheld.getState() == ESPNowManager::State::UNINITIALIZED) {
+            handheld.startConnection();
+            result.handheld_restarted = true;
+        }
+        tick(medium, base, handheld);
+    }
+
+    if (result.recovered) {
+        result.recover_ms = static_cast<uint32_t>((Platform::nowUs() - restored_us) / 1000);
+        result.link_down_ms = base.getStats().last_outage_ms;
+        result.resumed = base.getStats().fast_reconnects + handheld.getStats().fast_reconnects > fast_before;
+    }
+    result.frames_sent = medium.getStats().frames_sent;
+
+    base.shutdown();
+    handheld.shutdown();
+    return result;
+}
+
+}
+
+#endif
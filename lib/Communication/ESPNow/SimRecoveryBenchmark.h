@@ -0,0 +1,42 @@
+#ifndef SIM_RECOVERY_BENCHMARK_H
+#define SIM_RECOVERY_BENCHMARK_H
+
+#include "../../Core/Platform.h"
+
+#ifndef ARDUINO
+
+#include "SimRadioMedium.h"
+
+// Time-to-recover after an RF dropout, measured on the simulated medium.
+// A base station and a handheld pair, the handheld's radio is switched off
+// for outage_ms and back on, and the run records how long after the radio
+// came back both ends were PAIRED again. Outages shorter than
+// CONNECTION_TIMEOUT_MS never drop the link and recover at once.
+namespace SimRecoveryBenchmark {
+    struct Config {
+        uint32_t outage_ms;
+        uint32_t settle_ms;         // Paired time before the dropout
+        uint32_t give_up_ms;        // After the radio is back
+        uint32_t seed;
+        bool restart_handheld;      // Press connect if the handheld gave up (manual mode)
+        const uint8_t* pairing_key; // Both ends, nullptr = unencrypted
+        SimRadioMedium::LinkConfig link;
+    };
+
+    struct Result {
+        bool paired;                // Initial pairing succeeded
+        bool recovered;
+        uint32_t recover_ms;        // Radio back until both ends PAIRED
+        uint32_t link_down_ms;      // Base station's stats.last_outage_ms
+        bool resumed;               // Recovered through MSG_RESUME
+        bool handheld_restarted;
+        uint32_t frames_sent;       // On the medium during the whole run
+    };
+
+    Config defaultConfig(uint32_t outage_ms);
+    Result run(const Config& config);
+}
+
+#endif
+
+#endif
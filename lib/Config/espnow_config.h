@@ -1,7 +1,7 @@
 #ifndef ESPNOW_CONFIG_H_GLOBAL
 #define ESPNOW_CONFIG_H_GLOBAL
 
-#include <Arduino.h>
+#include "../Core/Platform.h"
 
 namespace ESPNowGlobalConfig {
     // MAC addresses for ESP-NOW pairing
@@ -22,18 +22,135 @@ namespace ESPNowGlobalConfig {
     // Handheld controller MAC address (from .env file)
     static constexpr uint8_t HANDHELD_MAC[6] = HANDHELD_MAC_ARRAY;
     
+    // Drone flight controller MAC address (optional, from .env file). When set,
+    // the base station also accepts telemetry from it.
+    #ifdef DRONE_MAC_ARRAY
+        static constexpr bool HAS_DRONE_PEER = true;
+        static constexpr uint8_t DRONE_MAC[6] = DRONE_MAC_ARRAY;
+    #else
+        static constexpr bool HAS_DRONE_PEER = false;
+        static constexpr uint8_t DRONE_MAC[6] = {0};
+    #endif
+    
     // Broadcast MAC for discovery
     static constexpr uint8_t BROADCAST_MAC[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
     
-    // Security settings
-    static constexpr bool ENABLE_ENCRYPTION = false;  // Set to true for production
-    static constexpr uint8_t PMK_KEY[16] = {0};  // Primary master key for encryption
-    static constexpr uint8_t LMK_KEY[16] = {0};  // Local master key for encryption
+    // Security settings. With ESPNOW_PAIRING_KEY set in .env (the same on
+    // both ends), traffic with the pairing peer is encrypted and authenticated
+    // by ESPNowSession; other peers stay unencrypted.
+    #ifdef ESPNOW_PAIRING_KEY_ARRAY
+        static constexpr bool ENABLE_ENCRYPTION = true;
+        static constexpr uint8_t PAIRING_KEY[32] = ESPNOW_PAIRING_KEY_ARRAY;
+    #else
+        static constexpr bool ENABLE_ENCRYPTION = false;
+        static constexpr uint8_t PAIRING_KEY[32] = {0};
+    #endif
+    static constexpr uint8_t AUTH_TAG_SIZE = 8;  // Truncated Poly1305 tag per sealed frame, 4..16 bytes
     
     // Connection settings
     static constexpr uint32_t MAX_RETRY_COUNT = 5;
     static constexpr uint32_t RETRY_DELAY_MS = 1000;
-    static constexpr uint32_t MESSAGE_QUEUE_SIZE = 32;
+    static constexpr uint32_t MESSAGE_QUEUE_SIZE = 32;  // Per priority lane, power of two
+    static constexpr uint32_t RX_BUFFER_POOL_SIZE = 64; // Received messages in flight, shared by the lanes, power of two
+    static constexpr uint32_t RX_PROCESS_BUDGET_US = 2000;  // Receive processing time per update()
+    static constexpr uint8_t MAX_PEERS = 4;  // Pairing peer included, power of two
+    
+    // Wire format
+    static constexpr bool USE_LEGACY_WIRE_FORMAT = false;  // Send fixed 47-byte frames for old firmware
+    
+    // Send coalescing: messages to the peer are packed into one frame, flushed at
+    // end of tick, when the frame reaches the size threshold or when the oldest
+    // pending message reaches the deadline
+    static constexpr bool ENABLE_TX_COALESCING = true;
+    static constexpr uint32_t TX_COALESCE_FLUSH_BYTES = 200;
+    static constexpr uint32_t TX_COALESCE_DEADLINE_US = 2000;
+    
+    // RC channel stream: a timer sets the cadence and wakes the link task,
+    // which sends each frame as it falls due. The handheld always runs a link
+    // task for this; without one frames go out at the loop() cadence.
+    static constexpr uint16_t RC_STREAM_RATE_HZ = 100;
+    static constexpr uint16_t RC_STREAM_MIN_RATE_HZ = 50;
+    static constexpr uint16_t RC_STREAM_MAX_RATE_HZ = 250;
+    static constexpr uint8_t RC_CHANNEL_BITS = 11;  // 11 or 12
+    
+    // Reliable lane for commands and disconnect: retransmit after RTO, doubling
+    // up to the cap, until acknowledged or MAX_ATTEMPTS sends have been made
+    static constexpr bool ENABLE_RELIABLE_LANE = true;
+    static constexpr uint16_t RELIABLE_INITIAL_RTO_MS = 30;
+    static constexpr uint16_t RELIABLE_MAX_RTO_MS = 240;
+    static constexpr uint8_t RELIABLE_MAX_ATTEMPTS = 5;
+    
+    // Fast reconnect: after a link timeout both ends resume the cached session
+    // directly with MSG_RESUME. Retries start at FAST_RECONNECT_INITIAL_MS and
+    // double up to FAST_RECONNECT_STEP_MS, then repeat at that step until
+    // FAST_RECONNECT_WINDOW_MS has passed and normal pairing takes over.
+    static constexpr bool ENABLE_FAST_RECONNECT = true;
+    static constexpr uint16_t FAST_RECONNECT_INITIAL_MS = 4;
+    static constexpr uint16_t FAST_RECONNECT_STEP_MS = 250;
+    static constexpr uint32_t FAST_RECONNECT_WINDOW_MS = 10000;
+    
+    // Link task: run ESPNowManager::update() in its own pinned task instead of
+    // loop(). The Arduino loop runs on core 1 at priority 1. The handheld
+    // runs one regardless, since its RC stream is sent from it.
+    static constexpr bool ENABLE_LINK_TASK = false;
+    static constexpr uint8_t LINK_TASK_PRIORITY = 5;
+    static constexpr int8_t LINK_TASK_CORE = 0;             // With the Wi-Fi task; -1 = either core
+    static constexpr uint32_t LINK_TASK_STACK_SIZE = 4096;
+    static constexpr uint32_t LINK_TASK_MAX_SLEEP_MS = 5;   // Bounds reliable-lane and coalescing latency
+    static constexpr uint32_t LINK_REQUEST_QUEUE_SIZE = 16; // App to link task, power of two
+    static constexpr uint32_t LINK_EVENT_QUEUE_SIZE = 32;   // Callbacks back to the app, power of two
+    static constexpr uint32_t LINK_REQUEST_WAIT_MS = 100;   // App calls that need the link task's answer
+    
+    // Adaptive keepalive: a ping only goes out after KEEPALIVE_IDLE_MS without
+    // sending anything to the pairing peer, from either end. RTT probes and
+    // pong replies ride along in outgoing data frames when there are any.
+    // The link counts as lost (failsafe) after LINK_MISS_COUNT keepalive
+    // intervals without hearing the peer; re-pairing still waits for
+    // ESPNowConfig::CONNECTION_TIMEOUT_MS.
+    static constexpr bool ENABLE_ADAPTIVE_KEEPALIVE = true;
+    static constexpr uint32_t KEEPALIVE_IDLE_MS = 50;
+    static constexpr uint8_t LINK_MISS_COUNT = 3;           // 150 ms failsafe plus update latency
+    static constexpr uint32_t RTT_PROBE_INTERVAL_MS = 1000; // Piggybacked; sent alone at twice this
+    static constexpr uint32_t PONG_HOLD_MS = 10;            // Wait for a data frame to carry the pong
+    
+    // Channel agility (ESPNowChannelSurvey). Discovery, pairing and resume
+    // always use ESPNowConfig::CHANNEL. Once paired, the base station has
+    // both ends hop through CHANNEL_SURVEY_MASK together, measures loss and
+    // RSSI on each channel and moves the link to the best one. Loss above
+    // CHANNEL_DEGRADED_LOSS_PCT for CHANNEL_DEGRADED_MS starts another survey.
+    // A move the peer doesn't follow within CHANNEL_CONFIRM_MS is undone.
+    // After a survey or move the link stays put for CHANNEL_HOLD_MS unless
+    // the channel degrades, and a degraded channel nothing beat isn't
+    // surveyed again before then.
+    // Off while other peers (the drone) are registered; they wouldn't follow.
+    static constexpr bool ENABLE_CHANNEL_AGILITY = true;
+    static constexpr uint16_t CHANNEL_SURVEY_MASK = 0x0FFE;     // Bit n = channel n, here 1-11 (legal everywhere)
+    static constexpr uint8_t CHANNEL_SURVEY_DWELL_MS = 30;      // Per slot, well below the failsafe
+    static constexpr uint8_t CHANNEL_SURVEY_GUARD_MS = 5;       // No probes this close to a hop
+    static constexpr uint8_t CHANNEL_SURVEY_PROBES = 4;         // Per end and slot
+    static constexpr uint32_t CHANNEL_SURVEY_DELAY_MS = 500;    // After pairing
+    static constexpr uint32_t CHANNEL_PLAN_LEAD_MS = 60;        // Announced this far ahead
+    static constexpr uint8_t CHANNEL_PLAN_REPEATS = 5;          // Copies of the announcement, for lossy channels
+    static constexpr uint32_t CHANNEL_CHECK_INTERVAL_MS = 250;
+    static constexpr float CHANNEL_DEGRADED_LOSS_PCT = 20.0f;
+    static constexpr uint32_t CHANNEL_DEGRADED_MS = 2000;
+    static constexpr float CHANNEL_SWITCH_MARGIN_PCT = 10.0f;   // A new channel must be this much better
+    static constexpr uint32_t CHANNEL_HOLD_MS = 10000;          // Also how long a failed move's channel is avoided
+    static constexpr uint32_t CHANNEL_CONFIRM_MS = 120;
+    static constexpr uint32_t CHANNEL_RESULT_MAX_AGE_MS = 60000;
+
+    // Link benchmark (ESPNowBenchmark): every payload size at every rate,
+    // sizes and rates are set in ESPNowBenchmark::defaultConfig()
+    static constexpr uint32_t BENCHMARK_STEP_MS = 2000;
+    static constexpr uint32_t BENCHMARK_DRAIN_MS = 300;     // Wait for the peer's report
+    static constexpr uint8_t BENCHMARK_ECHO_EVERY = 4;      // Every Nth message is echoed for RTT
+    static constexpr uint16_t BENCHMARK_MAX_BURST = 16;     // Catch-up sends per update
+    static constexpr uint16_t BENCHMARK_CRYPTO_ITERATIONS = 200;  // Seals and opens per frame size
+    
+    // Latency measurement
+    static constexpr uint8_t PING_HISTORY_SIZE = 8;     // Outstanding pings matched by counter
+    static constexpr uint8_t CLOCK_FILTER_SIZE = 8;     // Offset taken from the lowest-delay sample
+    static constexpr uint8_t CLOCK_FILTER_MIN_SAMPLES = 4;
     
     // Validation settings
     static constexpr bool ENABLE_CRC_CHECK = true;
@@ -1,5 +1,6 @@
 #include "AppFramework.h"
 #include "Logger.h"
+#include "Constants.h"
 
 AppFramework::AppFramework(const char* app_name, hal_board_type_t board_type)
     : app_name(app_name)
@@ -47,6 +48,9 @@ hal_status_t AppFramework::initialize() {
         return onError(status);
     }
     
+    // Tasks registered during a slow init would all start out late
+    scheduler.start();
+    
     initialized = true;
     setState(AppState::IDLE);
     LOG_INFO(app_name, "Application initialized successfully");
@@ -63,7 +67,10 @@ hal_status_t AppFramework::update() {
         return HAL_ERROR;
     }
     
-    hal_status_t status = onUpdate(delta_ms);
+    hal_status_t status = scheduler.runDue();
+    if (status == HAL_OK) {
+        status = onUpdate(delta_ms);
+    }
     if (status != HAL_OK) {
         LOG_ERROR(app_name, "Update failed: %d", status);
         setState(AppState::ERROR);
@@ -73,6 +80,15 @@ hal_status_t AppFramework::update() {
     return HAL_OK;
 }
 
+void AppFramework::sleepUntilNextTask() {
+    // Without tasks, or with them halted by an error, poll at the old rate
+    if (scheduler.getTaskCount() == 0 || current_state == AppState::ERROR) {
+        delay(Constants::Timing::INPUT_POLL_INTERVAL_MS);
+        return;
+    }
+    scheduler.sleepUntilNext();
+}
+
 hal_status_t AppFramework::shutdown() {
     LOG_INFO(app_name, "Shutting down application");
     setState(AppState::SHUTDOWN);
@@ -1,8 +1,9 @@
 #ifndef APP_FRAMEWORK_H
 #define APP_FRAMEWORK_H
 
-#include <Arduino.h>
+#include "Platform.h"
 #include "../HAL/Core/hal_types.h"
+#include "TaskScheduler.h"
 
 enum class AppState {
     UNINITIALIZED,
@@ -19,15 +20,19 @@ public:
     virtual ~AppFramework() = default;
     
     hal_status_t run();
+    // Call from loop() after run(): sleeps until the next task is released
+    void sleepUntilNextTask();
     
     AppState getState() const { return current_state; }
     const char* getAppName() const { return app_name; }
     uint32_t getUptime() const { return millis() - start_time; }
+    const TaskScheduler& getScheduler() const { return scheduler; }
     
 protected:
     virtual hal_status_t onInitialize() = 0;
     virtual hal_status_t onStart() { return HAL_OK; }
-    virtual hal_status_t onUpdate(uint32_t delta_ms) = 0;
+    // Once per run(), after the scheduler's due tasks
+    virtual hal_status_t onUpdate(uint32_t) { return HAL_OK; }
     virtual hal_status_t onShutdown() { return HAL_OK; }
     virtual hal_status_t onError(hal_status_t error) { return error; }
     
@@ -38,6 +43,7 @@ protected:
     hal_board_type_t board_type;
     AppState current_state;
     AppState previous_state;
+    TaskScheduler scheduler;        // Periodic work, registered in onInitialize()
     
 private:
     uint32_t start_time;
@@ -4,7 +4,7 @@
 #include "../HAL/Display/display_interface.h"
 #include "../HAL/Input/input_interface.h"
 #include "../HAL/Core/hal_types.h"
-#include <Arduino.h>
+#include "Platform.h"
 
 class AppScreen {
 public:
@@ -31,18 +31,18 @@ public:
         is_active = false;
     }
     
-    virtual void onUpdate(uint32_t delta_ms) {
+    virtual void onUpdate(uint32_t) {
     }
     
     virtual void onDraw(display_instance_t* display) = 0;
     
-    virtual void onButtonPress(uint8_t button_id) {
+    virtual void onButtonPress(uint8_t) {
     }
     
-    virtual void onButtonRelease(uint8_t button_id) {
+    virtual void onButtonRelease(uint8_t) {
     }
     
-    virtual void onInput(input_instance_t* input) {
+    virtual void onInput(input_instance_t*) {
     }
     
     void requestRedraw() { needs_redraw = true; }
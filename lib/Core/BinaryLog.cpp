@@ -0,0 +1,344 @@
+#include "BinaryLog.h"
+
+namespace BinaryLog {
+
+namespace {
+    const MessageInfo MESSAGES[] = {
+#define LOG_MESSAGE(id, level, tag, format) {#id, LogLevel::LOG_LEVEL_##level, tag, format},
+#include "LogMessages.def"
+#undef LOG_MESSAGE
+    };
+    static_assert(sizeof(MESSAGES) / sizeof(MESSAGES[0]) == static_cast<size_t>(MessageId::MESSAGE_COUNT),
+                  "Message table out of step with MessageId");
+
+    struct Arg {
+        uint8_t type;
+        int64_t i;
+        uint64_t u;
+        double f;
+        char s[Constants::Logging::MAX_STRING_ARG + 1];
+    };
+
+    class Reader {
+    public:
+        Reader(const uint8_t* data, size_t length) : pos(data), end(data + length) {}
+
+        bool next(Arg& arg) {
+            if (pos >= end) {
+                return false;
+            }
+            arg.type = *pos++;
+            switch (arg.type) {
+                case ARG_I32: return takeSigned<int32_t>(arg);
+                case ARG_U32: return takeUnsigned<uint32_t>(arg);
+                case ARG_I64: return takeSigned<int64_t>(arg);
+                case ARG_U64: return takeUnsigned<uint64_t>(arg);
+                case ARG_PTR: return takeUnsigned<uint64_t>(arg);
+                case ARG_F32: return takeFloat<float>(arg);
+                case ARG_F64: return takeFloat<double>(arg);
+                case ARG_STR: {
+                    if (pos >= end) return false;
+                    size_t length = *pos++;
+                    if (length > Constants::Logging::MAX_STRING_ARG || !take(arg.s, length)) return false;
+                    arg.s[length] = '\0';
+                    return true;
+                }
+                default:
+                    pos = end;
+                    return false;
+            }
+        }
+
+    private:
+        const uint8_t* pos;
+        const uint8_t* end;
+
+        template<typename T>
+        bool takeSigned(Arg& arg) {
+            T v;
+            if (!take(&v, sizeof(v))) return false;
+            arg.i = v;
+            arg.u = static_cast<uint64_t>(arg.i);
+            arg.f = static_cast<double>(v);
+            return true;
+        }
+
+        template<typename T>
+        bool takeUnsigned(Arg& arg) {
+            T v;
+            if (!take(&v, sizeof(v))) return false;
+            arg.u = v;
+            arg.i = static_cast<int64_t>(arg.u);
+            arg.f = static_cast<double>(v);
+            return true;
+        }
+
+        template<typename T>
+        bool takeFloat(Arg& arg) {
+            T v;
+            if (!take(&v, sizeof(v))) return false;
+            arg.f = v;
+            arg.i = static_cast<int64_t>(v);
+            arg.u = static_cast<uint64_t>(arg.i);
+            return true;
+        }
+
+        bool take(void* out, size_t size) {
+            if (static_cast<size_t>(end - pos) < size) {
+                pos = end;
+                return false;
+            }
+            memcpy(out, pos, size);
+            pos += size;
+            return true;
+        }
+    };
+
+    void append(char* line, size_t size, size_t& length, const char* format, ...) {
+        if (length + 1 >= size) {
+            return;
+        }
+        va_list args;
+        va_start(args, format);
+        int written = vsnprintf(line + length, size - length, format, args);
+        va_end(args);
+        if (written > 0) {
+            length += static_cast<size_t>(written);
+            if (length >= size) {
+                length = size - 1;
+            }
+        }
+    }
+
+    // One conversion of the message format, with its length modifier
+    // replaced by the one matching how the argument was stored. '*' widths
+    // aren't supported and are left out.
+    void appendConversion(char* line, size_t size, size_t& length, const char* spec, size_t spec_length,
+                          char conversion, Reader& reader) {
+        Arg arg;
+        if (!reader.next(arg)) {
+            append(line, size, length, "?");
+            return;
+        }
+
+        char format[24];
+        size_t n = 0;
+        for (size_t i = 0; i < spec_length && n < 16; i++) {
+            char c = spec[i];
+            if (!strchr("hlLzjtq*", c)) {
+                format[n++] = c;
+            }
+        }
+
+        switch (conversion) {
+            case 'd': case 'i':
+                format[n++] = 'l'; format[n++] = 'l'; format[n++] = conversion; format[n] = '\0';
+                append(line, size, length, format, (long long)arg.i);
+                break;
+            case 'u': case 'x': case 'X': case 'o':
+                format[n++] = 'l'; format[n++] = 'l'; format[n++] = conversion; format[n] = '\0';
+                append(line, size, length, format, (unsigned long long)arg.u);
+                break;
+            case 'c':
+                format[n++] = 'c'; format[n] = '\0';
+                append(line, size, length, format, (int)arg.i);
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                format[n++] = conversion; format[n] = '\0';
+                append(line, size, length, format, arg.f);
+                break;
+            case 's':
+                format[n++] = 's'; format[n] = '\0';
+                append(line, size, length, format, arg.type == ARG_STR ? arg.s : "?");
+                break;
+            case 'p':
+                append(line, size, length, "0x%llx", (unsigned long long)arg.u);
+                break;
+            default:
+                append(line, size, length, "?");
+                break;
+        }
+    }
+}
+
+const MessageInfo* findMessage(uint16_t id) {
+    return id < static_cast<uint16_t>(MessageId::MESSAGE_COUNT) ? &MESSAGES[id] : nullptr;
+}
+
+size_t formatRecord(const uint8_t* record, size_t length, char* line, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    line[0] = '\0';
+    size_t out = 0;
+    if (length < HEADER_SIZE) {
+        append(line, size, out, "<short log record, %u bytes>", (unsigned)length);
+        return out;
+    }
+
+    uint16_t id;
+    uint32_t timestamp_ms;
+    memcpy(&id, record, sizeof(id));
+    memcpy(&timestamp_ms, record + 2, sizeof(timestamp_ms));
+
+    const MessageInfo* message = findMessage(id);
+    LogLevel level = message ? message->level : LogLevel::LOG_LEVEL_NONE;
+    append(line, size, out, "%6u.%03u [%s] ", (unsigned)(timestamp_ms / 1000), (unsigned)(timestamp_ms % 1000),
+           Logger::levelToString(level));
+    if (!message) {
+        append(line, size, out, "<unknown log message %u>", (unsigned)id);
+        return out;
+    }
+    append(line, size, out, "[%s] ", message->tag);
+
+    Reader reader(record + HEADER_SIZE, length - HEADER_SIZE);
+    const char* p = message->format;
+    while (*p && out + 1 < size) {
+        if (*p != '%') {
+            line[out++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            line[out++] = '%';
+            p += 2;
+            continue;
+        }
+
+        // Flags, width, precision and length up to the conversion character
+        const char* spec = p++;
+        while (*p && strchr("-+ #0123456789.*hlLzjtq", *p)) {
+            p++;
+        }
+        if (!*p) {
+            break;
+        }
+        appendConversion(line, size, out, spec, static_cast<size_t>(p - spec), *p, reader);
+        p++;
+    }
+    line[out] = '\0';
+    return out;
+}
+
+uint8_t crc8(const uint8_t* data, size_t length, uint8_t crc) {
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x07) : static_cast<uint8_t>(crc << 1);
+        }
+    }
+    return crc;
+}
+
+size_t encodeFrame(const uint8_t* record, size_t length, uint8_t* frame, size_t size) {
+    if (length > 255 || size < length + FRAME_OVERHEAD) {
+        return 0;
+    }
+    frame[0] = FRAME_SYNC_0;
+    frame[1] = FRAME_SYNC_1;
+    frame[2] = static_cast<uint8_t>(length);
+    memcpy(frame + 3, record, length);
+    frame[3 + length] = crc8(frame + 2, length + 1);
+    return length + FRAME_OVERHEAD;
+}
+
+StreamDecoder::StreamDecoder(LineHandler handler, void* context)
+    : handler(handler)
+    , context(context)
+    , text()
+    , text_length(0)
+    , frame()
+    , frame_length(0)
+    , frames(0)
+    , bad_frames(0) {
+}
+
+void StreamDecoder::feed(const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (frame_length > 0) {
+            feedFrame(data[i]);
+        } else {
+            feedText(data[i]);
+        }
+    }
+}
+
+void StreamDecoder::finish() {
+    while (frame_length > 0) {
+        rejectFrame();
+    }
+    flushText();
+}
+
+void StreamDecoder::feedText(uint8_t byte) {
+    if (byte == FRAME_SYNC_0) {
+        frame[0] = byte;
+        frame_length = 1;
+        return;
+    }
+    if (byte == '\n') {
+        flushText();
+        return;
+    }
+    appendText(byte);
+}
+
+// Control characters (\r, or bytes of a corrupt frame) are left out
+void StreamDecoder::appendText(uint8_t byte) {
+    if ((byte >= 0x20 || byte == '\t') && text_length + 1 < sizeof(text)) {
+        text[text_length++] = static_cast<char>(byte);
+    }
+}
+
+void StreamDecoder::feedFrame(uint8_t byte) {
+    frame[frame_length++] = byte;
+    if (frame_length == 2 && byte != FRAME_SYNC_1) {
+        rejectFrame();
+        return;
+    }
+    if (frame_length == 3 && (byte < HEADER_SIZE || byte > Constants::Logging::MAX_RECORD_SIZE)) {
+        rejectFrame();
+        return;
+    }
+    if (frame_length < 3 || frame_length < static_cast<size_t>(frame[2]) + FRAME_OVERHEAD) {
+        return;
+    }
+
+    size_t record_length = frame[2];
+    if (crc8(frame + 2, record_length + 1) != frame[3 + record_length]) {
+        rejectFrame();
+        return;
+    }
+
+    // Text interrupted by a frame comes out as its own line first
+    flushText();
+    char line[Constants::Logging::MAX_LINE_LENGTH];
+    formatRecord(frame + 3, record_length, line, sizeof(line));
+    handler(line, context);
+    frames++;
+    frame_length = 0;
+}
+
+void StreamDecoder::flushText() {
+    if (text_length == 0) {
+        return;
+    }
+    text[text_length] = '\0';
+    handler(text, context);
+    text_length = 0;
+}
+
+// Not a frame after all: the first byte was text, the rest is scanned again
+void StreamDecoder::rejectFrame() {
+    if (frame_length >= 3) {
+        bad_frames++;
+    }
+    uint8_t pending[sizeof(frame)];
+    size_t pending_length = frame_length - 1;
+    memcpy(pending, frame + 1, pending_length);
+    frame_length = 0;
+
+    appendText(frame[0]);
+    feed(pending, pending_length);
+}
+
+}
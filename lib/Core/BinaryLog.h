@@ -0,0 +1,193 @@
+#ifndef BINARY_LOG_H
+#define BINARY_LOG_H
+
+#include "Platform.h"
+#include "Logger.h"
+#include "Constants.h"
+#include <type_traits>
+
+// Deferred-formatting log records for hot paths. LOG_BIN(id, args...) looks
+// up a message from LogMessages.def and stores its ID, the log timestamp
+// and the raw argument bytes; no printf runs on the caller. The record goes
+// through Logger::logRecord(), so in async mode it is one ring write and
+// the drain task formats it (or, with Logger::setBinaryOutput(), sends it
+// as a frame for the host decoder in src/log_decoder). Without async mode
+// it is formatted right away.
+//
+// Record: message ID (2 bytes), milliseconds since Logger::init() (4
+// bytes), then per argument a type byte and the value, little-endian.
+// Strings are copied, at most Constants::Logging::MAX_STRING_ARG
+// characters. Arguments that don't fit MAX_RECORD_SIZE are left out and
+// decode as "?". The decoder applies the format's conversions to the
+// stored values, so "%lu" given a uint32_t still prints right.
+//
+// Serial frame: FRAME_SYNC_0, FRAME_SYNC_1, record length, record, CRC-8
+// of the length and record. Text lines can sit between frames.
+namespace BinaryLog {
+    enum class MessageId : uint16_t {
+#define LOG_MESSAGE(id, level, tag, format) id,
+#include "LogMessages.def"
+#undef LOG_MESSAGE
+        MESSAGE_COUNT
+    };
+
+    struct MessageInfo {
+        const char* name;
+        LogLevel level;
+        const char* tag;
+        const char* format;
+    };
+
+    constexpr LogLevel levelOf(MessageId id) {
+        switch (id) {
+#define LOG_MESSAGE(id, level, tag, format) case MessageId::id: return LogLevel::LOG_LEVEL_##level;
+#include "LogMessages.def"
+#undef LOG_MESSAGE
+            default: return LogLevel::LOG_LEVEL_NONE;
+        }
+    }
+
+    const MessageInfo* findMessage(uint16_t id);  // nullptr if unknown
+
+    enum ArgType : uint8_t {
+        ARG_I32 = 1,
+        ARG_U32,
+        ARG_I64,
+        ARG_U64,
+        ARG_F32,
+        ARG_F64,
+        ARG_STR,    // Length byte, then the characters
+        ARG_PTR     // 8 bytes
+    };
+
+    constexpr size_t HEADER_SIZE = 6;
+    constexpr uint8_t FRAME_SYNC_0 = 0xA5;
+    constexpr uint8_t FRAME_SYNC_1 = 0x5A;
+    constexpr size_t FRAME_OVERHEAD = 4;
+    static_assert(Constants::Logging::MAX_RECORD_SIZE <= 255, "Record length must fit the frame's length byte");
+
+    // Text line as Logger would have printed it, returns its length
+    size_t formatRecord(const uint8_t* record, size_t length, char* line, size_t size);
+    // 0 if the frame doesn't fit
+    size_t encodeFrame(const uint8_t* record, size_t length, uint8_t* frame, size_t size);
+    uint8_t crc8(const uint8_t* data, size_t length, uint8_t crc = 0);
+
+    // Splits a captured serial stream into text lines, decoding frames on
+    // the way. Frames failing the CRC are passed on as text.
+    class StreamDecoder {
+    public:
+        using LineHandler = void (*)(const char* line, void* context);
+
+        StreamDecoder(LineHandler handler, void* context);
+
+        void feed(const uint8_t* data, size_t length);
+        void finish();  // Emits a last line without a newline
+
+        uint32_t getFrameCount() const { return frames; }
+        uint32_t getBadFrameCount() const { return bad_frames; }
+
+    private:
+        LineHandler handler;
+        void* context;
+        char text[Constants::Logging::MAX_LINE_LENGTH];
+        size_t text_length;
+        uint8_t frame[Constants::Logging::MAX_RECORD_SIZE + FRAME_OVERHEAD];
+        size_t frame_length;
+        uint32_t frames;
+        uint32_t bad_frames;
+
+        void feedText(uint8_t byte);
+        void appendText(uint8_t byte);
+        void feedFrame(uint8_t byte);
+        void flushText();
+        void rejectFrame();
+    };
+
+    namespace Detail {
+        struct Writer {
+            uint8_t* pos;
+            uint8_t* end;
+
+            bool put(ArgType type, const void* value, size_t size) {
+                if (static_cast<size_t>(end - pos) < size + 1) {
+                    end = pos;  // Later arguments are dropped too, keeping the order
+                    return false;
+                }
+                *pos++ = type;
+                memcpy(pos, value, size);
+                pos += size;
+                return true;
+            }
+        };
+
+        template<typename T>
+        typename std::enable_if<std::is_integral<T>::value && sizeof(T) <= 4>::type
+        pack(Writer& writer, T value) {
+            if (std::is_signed<T>::value) {
+                int32_t v = static_cast<int32_t>(value);
+                writer.put(ARG_I32, &v, sizeof(v));
+            } else {
+                uint32_t v = static_cast<uint32_t>(value);
+                writer.put(ARG_U32, &v, sizeof(v));
+            }
+        }
+
+        template<typename T>
+        typename std::enable_if<std::is_integral<T>::value && (sizeof(T) > 4)>::type
+        pack(Writer& writer, T value) {
+            if (std::is_signed<T>::value) {
+                int64_t v = static_cast<int64_t>(value);
+                writer.put(ARG_I64, &v, sizeof(v));
+            } else {
+                uint64_t v = static_cast<uint64_t>(value);
+                writer.put(ARG_U64, &v, sizeof(v));
+            }
+        }
+
+        inline void pack(Writer& writer, float value) { writer.put(ARG_F32, &value, sizeof(value)); }
+        inline void pack(Writer& writer, double value) { writer.put(ARG_F64, &value, sizeof(value)); }
+
+        inline void pack(Writer& writer, const char* value) {
+            if (!value) value = "(null)";
+            size_t length = strnlen(value, Constants::Logging::MAX_STRING_ARG);
+            if (static_cast<size_t>(writer.end - writer.pos) < length + 2) {
+                writer.end = writer.pos;
+                return;
+            }
+            *writer.pos++ = ARG_STR;
+            *writer.pos++ = static_cast<uint8_t>(length);
+            memcpy(writer.pos, value, length);
+            writer.pos += length;
+        }
+
+        template<typename T>
+        void pack(Writer& writer, const T* value) {
+            uint64_t v = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value));
+            writer.put(ARG_PTR, &v, sizeof(v));
+        }
+    }
+
+    template<MessageId Id, typename... Args>
+    inline void log(const Args&... args) {
+        constexpr LogLevel level = levelOf(Id);
+        if (!Logger::isEnabled(level)) {
+            return;
+        }
+
+        uint8_t record[Constants::Logging::MAX_RECORD_SIZE];
+        uint16_t id = static_cast<uint16_t>(Id);
+        uint32_t timestamp_ms = Logger::getUptimeMs();
+        memcpy(record, &id, sizeof(id));
+        memcpy(record + 2, &timestamp_ms, sizeof(timestamp_ms));
+
+        Detail::Writer writer = {record + HEADER_SIZE, record + sizeof(record)};
+        int expand[] = {0, (Detail::pack(writer, args), 0)...};
+        (void)expand;
+
+        Logger::logRecord(level, record, static_cast<size_t>(writer.pos - record));
+    }
+}
+
+#define LOG_BIN(id, ...) BinaryLog::log<BinaryLog::MessageId::id>(__VA_ARGS__)
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "SPSCQueue.h"
+
+// Fixed set of preallocated buffers passed between two contexts by index.
+// One context claims buffers and fills them (e.g. the Wi-Fi callback), the
+// other reads and releases them (e.g. the main loop). Free indices travel
+// back through an SPSCQueue, so claim() and release() never lock or
+// allocate, but each must stay on its own side.
+template<typename T, size_t Count>
+class BufferPool {
+    static_assert(Count <= 0x8000, "BufferPool indices are 16 bits");
+
+public:
+    typedef uint16_t Index;
+    static constexpr Index INVALID_INDEX = 0xFFFF;
+
+    BufferPool() : exhausted(0) {
+        for (size_t i = 0; i < Count; i++) {
+            free_list.push(static_cast<Index>(i));
+        }
+    }
+
+    // Claiming side. Returns INVALID_INDEX (and counts it) when every buffer is out.
+    Index claim() {
+        Index index;
+        if (!free_list.pop(index)) {
+            exhausted.fetch_add(1, std::memory_order_relaxed);
+            return INVALID_INDEX;
+        }
+        return index;
+    }
+
+    // Releasing side; the buffer must not be touched afterwards
+    void release(Index index) { free_list.push(index); }
+
+    T& operator[](Index index) { return buffers[index]; }
+    const T& operator[](Index index) const { return buffers[index]; }
+
+    size_t available() const { return free_list.size(); }
+    static constexpr size_t capacity() { return Count; }
+    uint32_t getExhaustedCount() const { return exhausted.load(std::memory_order_relaxed); }
+
+private:
+    T buffers[Count];
+    SPSCQueue<Index, Count> free_list;
+    std::atomic<uint32_t> exhausted;
+};
+
+#endif
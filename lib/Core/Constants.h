@@ -20,6 +20,52 @@ namespace Constants {
         constexpr uint32_t STATE_TRANSITION_DELAY_MS = 100;
     }
     
+    // Periodic tasks run by AppFramework's TaskScheduler
+    namespace Tasks {
+        constexpr uint32_t LINK_RATE_HZ = 250;
+        constexpr uint32_t INPUT_RATE_HZ = 1000 / Timing::INPUT_POLL_INTERVAL_MS;  // Buttons debounce over 50 ms
+        constexpr uint32_t CONTROL_RATE_HZ = 100;       // State machines
+        constexpr uint32_t TELEMETRY_RATE_HZ = 10;
+        constexpr uint32_t DISPLAY_RATE_HZ = 1000 / Timing::DISPLAY_UPDATE_INTERVAL_MS;
+        constexpr uint32_t MONITOR_RATE_HZ = 1;
+        
+        // Higher runs first when several are due
+        constexpr uint8_t LINK_PRIORITY = 4;
+        constexpr uint8_t INPUT_PRIORITY = 3;
+        constexpr uint8_t CONTROL_PRIORITY = 2;
+        constexpr uint8_t DISPLAY_PRIORITY = 1;
+        constexpr uint8_t MONITOR_PRIORITY = 0;
+        
+        // Phases keep the slow tasks off the fast ones' releases
+        constexpr uint32_t CONTROL_PHASE_US = 500;
+        constexpr uint32_t DISPLAY_PHASE_US = 1500;
+        constexpr uint32_t MONITOR_PHASE_US = 2500;
+    }
+    
+    // Asynchronous logging (Logger::startAsync): callers format their line
+    // into a ring, a low-priority task writes it to Serial
+    namespace Logging {
+        constexpr bool ASYNC_ENABLED = true;
+        constexpr uint32_t ASYNC_BUFFER_SIZE = 8192;    // Bytes, power of two
+        constexpr uint32_t MAX_LINE_LENGTH = 288;       // Longer lines are cut
+        constexpr uint8_t DRAIN_TASK_PRIORITY = 0;      // Below loop(), runs when it sleeps
+        constexpr int8_t DRAIN_TASK_CORE = -1;          // -1 = either core
+        constexpr uint32_t DRAIN_TASK_STACK_SIZE = 3072;
+        constexpr uint32_t DRAIN_INTERVAL_MS = 10;
+        
+        // Binary records (LOG_BIN) are formatted by the drain task, or with
+        // BINARY_SERIAL_OUTPUT sent as frames for the host decoder
+        // (log_decoder environment). Logger::setBinaryOutput() overrides it.
+        constexpr bool BINARY_SERIAL_OUTPUT = false;
+        constexpr uint32_t MAX_RECORD_SIZE = 96;        // Bytes per record, arguments beyond are left out
+        constexpr uint8_t MAX_STRING_ARG = 31;          // Characters kept of a string argument
+        
+        // A line is dropped when it would fill the ring beyond this share
+        // for its level, DEBUG to CRITICAL, so chatty levels can't crowd out
+        // errors
+        constexpr uint8_t DROP_FILL_PCT[] = {50, 75, 90, 100, 100};
+    }
+    
     namespace Hardware {
         constexpr uint8_t DEFAULT_LED_PIN = 2;
         constexpr uint8_t LED_BUILTIN_ESP32 = 2;
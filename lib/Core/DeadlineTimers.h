@@ -0,0 +1,70 @@
+#ifndef DEADLINE_TIMERS_H
+#define DEADLINE_TIMERS_H
+
+#include <stdint.h>
+
+// Small fixed set of one-shot deadlines, indexed by an owner-defined enum.
+// States arm the deadlines they wait on, and the owner only runs its state
+// handlers once one of them has passed, so a state waiting on nothing costs
+// nothing per tick. Times are millis() values and compare wrap-safe.
+template<uint8_t Count>
+class DeadlineTimers {
+    static_assert(Count >= 1 && Count <= 32, "DeadlineTimers supports up to 32 deadlines");
+
+public:
+    DeadlineTimers() : armed(0) {
+        for (uint8_t i = 0; i < Count; i++) {
+            deadlines[i] = 0;
+        }
+    }
+
+    void arm(uint8_t id, uint32_t at_ms) {
+        deadlines[id] = at_ms;
+        armed |= bit(id);
+    }
+
+    void cancel(uint8_t id) { armed &= ~bit(id); }
+    void cancelAll() { armed = 0; }
+    bool isArmed(uint8_t id) const { return (armed & bit(id)) != 0; }
+    uint32_t getDeadline(uint8_t id) const { return deadlines[id]; }
+
+    // True once when the deadline has passed; it is disarmed at the same time
+    bool expire(uint8_t id, uint32_t now_ms) {
+        if (!isArmed(id) || !reached(deadlines[id], now_ms)) {
+            return false;
+        }
+        armed &= ~bit(id);
+        return true;
+    }
+
+    bool anyDue(uint32_t now_ms) const {
+        for (uint8_t i = 0; i < Count; i++) {
+            if (isArmed(i) && reached(deadlines[i], now_ms)) return true;
+        }
+        return false;
+    }
+
+    // Milliseconds until the earliest armed deadline, 0 if one is due,
+    // UINT32_MAX when nothing is armed
+    uint32_t timeUntilNext(uint32_t now_ms) const {
+        uint32_t shortest = UINT32_MAX;
+        for (uint8_t i = 0; i < Count; i++) {
+            if (!isArmed(i)) continue;
+            if (reached(deadlines[i], now_ms)) return 0;
+            uint32_t remaining = deadlines[i] - now_ms;
+            if (remaining < shortest) shortest = remaining;
+        }
+        return shortest;
+    }
+
+private:
+    uint32_t deadlines[Count];
+    uint32_t armed;
+
+    static uint32_t bit(uint8_t id) { return 1UL << id; }
+    static bool reached(uint32_t deadline_ms, uint32_t now_ms) {
+        return static_cast<int32_t>(now_ms - deadline_ms) >= 0;
+    }
+};
+
+#endif
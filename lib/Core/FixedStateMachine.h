@@ -0,0 +1,170 @@
+#ifndef FIXED_STATE_MACHINE_H
+#define FIXED_STATE_MACHINE_H
+
+#include "Platform.h"
+#include "Logger.h"
+#include "../HAL/Core/hal_types.h"
+
+// StateMachine<T> without the map and the std::functions: Count states in
+// an array indexed by the enum value, handlers are member functions of
+// Owner. Behaves like StateManager (enter, update and exit handlers, a
+// transition asked for during another one runs once that one is done, state
+// time), but update() and getCurrentStateName() are an array index, and
+// nothing is allocated after construction.
+template<typename Owner, typename T, uint16_t Count>
+class FixedStateMachine {
+    static_assert(Count >= 1 && Count < 0xFFFF, "FixedStateMachine supports 1 to 65534 states");
+
+public:
+    using Handler = hal_status_t (Owner::*)(uint32_t delta_ms);
+    using TransitionHandler = void (Owner::*)(T from, T to);
+
+    struct State {
+        const char* name;
+        Handler onEnter;
+        Handler onUpdate;
+        Handler onExit;
+    };
+
+    FixedStateMachine(const char* name, Owner* owner)
+        : manager_name(name)
+        , owner(owner)
+        , current_state(INVALID_INDEX)
+        , previous_state(INVALID_INDEX)
+        , pending_state(INVALID_INDEX)
+        , state_time(0)
+        , in_transition(false)
+        , transition_handler(nullptr)
+        , states() {
+    }
+
+    hal_status_t registerState(T state, const char* name, Handler onUpdate) {
+        State def = {name, nullptr, onUpdate, nullptr};
+        return registerState(state, def);
+    }
+
+    hal_status_t registerState(T state, const State& def) {
+        uint16_t index = indexOf(state);
+        if (index >= Count || !def.name) {
+            LOG_ERROR(manager_name, "Cannot register state %u", index);
+            return HAL_INVALID_PARAM;
+        }
+        if (states[index].name) {
+            LOG_WARNING(manager_name, "State %u already registered", index);
+            return HAL_ERROR;
+        }
+
+        states[index] = def;
+        LOG_DEBUG(manager_name, "Registered state %u: %s", index, def.name);
+        return HAL_OK;
+    }
+
+    hal_status_t transitionTo(T new_state) {
+        uint16_t index = indexOf(new_state);
+        if (in_transition) {
+            LOG_WARNING(manager_name, "Already in transition, deferring to state %u", index);
+            pending_state = index;
+            return HAL_BUSY;
+        }
+
+        if (!hasIndex(index)) {
+            LOG_ERROR(manager_name, "Invalid state transition to %u", index);
+            return HAL_INVALID_PARAM;
+        }
+
+        if (current_state == index) {
+            return HAL_OK;
+        }
+
+        in_transition = true;
+        pending_state = index;
+
+        hal_status_t status = executeTransition();
+
+        in_transition = false;
+
+        if (status == HAL_OK && pending_state != current_state && pending_state != INVALID_INDEX) {
+            T deferred = static_cast<T>(pending_state);
+            pending_state = INVALID_INDEX;
+            return transitionTo(deferred);
+        }
+
+        pending_state = INVALID_INDEX;
+        return status;
+    }
+
+    hal_status_t update(uint32_t delta_ms) {
+        if (current_state == INVALID_INDEX) {
+            return HAL_NOT_INITIALIZED;
+        }
+
+        state_time += delta_ms;
+
+        Handler handler = states[current_state].onUpdate;
+        return handler ? (owner->*handler)(delta_ms) : HAL_OK;
+    }
+
+    // Before the first transition, the state with value 0
+    T getCurrentState() const { return static_cast<T>(current_state == INVALID_INDEX ? 0 : current_state); }
+    T getPreviousState() const { return static_cast<T>(previous_state == INVALID_INDEX ? 0 : previous_state); }
+    const char* getCurrentStateName() const {
+        return current_state == INVALID_INDEX ? "INVALID" : states[current_state].name;
+    }
+    uint32_t getStateTime() const { return state_time; }
+
+    bool isInState(T state) const { return indexOf(state) == current_state; }
+    bool hasState(T state) const { return hasIndex(indexOf(state)); }
+
+    void setTransitionHandler(TransitionHandler handler) { transition_handler = handler; }
+
+private:
+    static constexpr uint16_t INVALID_INDEX = 0xFFFF;
+
+    const char* manager_name;
+    Owner* owner;
+    uint16_t current_state;
+    uint16_t previous_state;
+    uint16_t pending_state;
+    uint32_t state_time;
+    bool in_transition;
+    TransitionHandler transition_handler;
+    State states[Count];
+
+    static uint16_t indexOf(T state) { return static_cast<uint16_t>(state); }
+    bool hasIndex(uint16_t index) const { return index < Count && states[index].name; }
+
+    hal_status_t executeTransition() {
+        if (current_state != INVALID_INDEX && states[current_state].onExit) {
+            LOG_DEBUG(manager_name, "Exiting state %s", states[current_state].name);
+            hal_status_t status = (owner->*states[current_state].onExit)(state_time);
+            if (status != HAL_OK) {
+                LOG_ERROR(manager_name, "Failed to exit state %s", states[current_state].name);
+                return status;
+            }
+        }
+
+        previous_state = current_state;
+        current_state = pending_state;
+        state_time = 0;
+
+        const State& entered = states[current_state];
+        LOG_INFO(manager_name, "Transitioning to state %s", entered.name);
+
+        if (entered.onEnter) {
+            hal_status_t status = (owner->*entered.onEnter)(0);
+            if (status != HAL_OK) {
+                LOG_ERROR(manager_name, "Failed to enter state %s", entered.name);
+                current_state = previous_state;
+                return status;
+            }
+        }
+
+        if (transition_handler) {
+            (owner->*transition_handler)(static_cast<T>(previous_state), static_cast<T>(current_state));
+        }
+
+        return HAL_OK;
+    }
+};
+
+#endif
@@ -0,0 +1,407 @@
+#ifndef HIERARCHICAL_STATE_MACHINE_H
+#define HIERARCHICAL_STATE_MACHINE_H
+
+#include "Platform.h"
+#include "Logger.h"
+#include "../HAL/Core/hal_types.h"
+
+// Event-driven hierarchical state machine, allocation free like
+// FixedStateMachine.
+//
+// States may have a parent; the machine always rests in a leaf, and the leaf
+// plus its ancestors are the active states. Transitions come from a table
+// the owner declares as a static const array: on an event the leaf's rows
+// are tried first, then its parent's and so on, and the first row whose
+// guard passes fires. A row on a superstate therefore covers every state
+// inside it, e.g. one "airborne -> emergency" row for all flight phases.
+//
+// A transition exits from the leaf up to the closest state shared with the
+// target, runs the row's action, then enters down to the target, which has
+// to be a leaf. Events are queued; one posted by a handler or action runs
+// after the current transition has completed, never inside it. Each call
+// handles at most QueueSize events and the hierarchy is at most MAX_DEPTH
+// deep, so a call takes bounded time. Every transition is recorded in a
+// ring of the last TraceSize.
+//
+// Not thread safe: post events from the task that updates the machine.
+template<typename Owner, typename S, typename E, uint16_t StateCount,
+         uint8_t QueueSize = 8, uint8_t TraceSize = 16>
+class HierarchicalStateMachine {
+    static_assert(StateCount >= 1 && StateCount < 0xFFFF, "HierarchicalStateMachine supports 1 to 65534 states");
+    static_assert(QueueSize >= 1 && TraceSize >= 1, "Queue and trace need room for one entry");
+
+public:
+    using Handler = hal_status_t (Owner::*)(uint32_t delta_ms);
+    using Guard = bool (Owner::*)() const;
+    using Action = void (Owner::*)();
+
+    static constexpr uint8_t MAX_DEPTH = 8;
+    static constexpr S TOP = static_cast<S>(0xFFFF);   // Parent of the outermost states
+
+    struct State {
+        const char* name;
+        S parent;
+        Handler onEnter;
+        Handler onUpdate;           // Outer states first, every update()
+        Handler onExit;
+    };
+
+    struct Transition {
+        S from;                     // Leaf or superstate
+        E event;
+        S to;                       // Leaf
+        Guard guard;                // nullptr = always
+        Action action;              // Between the exits and the entries
+    };
+
+    struct TraceEntry {
+        uint32_t time_ms;
+        S from;                     // TOP for start()
+        S to;
+        E event;
+    };
+
+    struct Stats {
+        uint32_t transitions;
+        uint32_t unhandled;         // No row matched, or every guard refused
+        uint32_t dropped;           // Queue full
+    };
+
+    HierarchicalStateMachine(const char* name, Owner* owner)
+        : machine_name(name)
+        , owner(owner)
+        , states()
+        , table(nullptr)
+        , table_size(0)
+        , current_state(INVALID_INDEX)
+        , state_time(0)
+        , processing(false)
+        , queue_head(0)
+        , queue_count(0)
+        , trace_next(0)
+        , trace_count(0)
+        , stats() {
+    }
+
+    hal_status_t registerState(S state, const State& def) {
+        uint16_t index = indexOf(state);
+        if (index >= StateCount || !def.name || (def.parent != TOP && indexOf(def.parent) >= StateCount)) {
+            LOG_ERROR(machine_name, "Cannot register state %u", index);
+            return HAL_INVALID_PARAM;
+        }
+        if (states[index].name) {
+            LOG_WARNING(machine_name, "State %u already registered", index);
+            return HAL_ERROR;
+        }
+
+        states[index] = def;
+        LOG_DEBUG(machine_name, "Registered state %u: %s", index, def.name);
+        return HAL_OK;
+    }
+
+    hal_status_t registerState(S state, const char* name, S parent, Handler onUpdate) {
+        State def = {name, parent, nullptr, onUpdate, nullptr};
+        return registerState(state, def);
+    }
+
+    // The table has to outlive the machine; rows are checked here so a bad
+    // one is found at start-up instead of on its event
+    template<size_t N>
+    hal_status_t setTransitions(const Transition (&rows)[N]) {
+        static_assert(N >= 1 && N <= 255, "Transition table needs 1 to 255 rows");
+        for (size_t i = 0; i < N; i++) {
+            if (!hasIndex(indexOf(rows[i].from)) || !isLeaf(indexOf(rows[i].to))) {
+                LOG_ERROR(machine_name, "Transition row %u: bad source or target", static_cast<unsigned>(i));
+                return HAL_INVALID_PARAM;
+            }
+        }
+        for (uint16_t i = 0; i < StateCount; i++) {
+            if (states[i].name && depthOf(i) > MAX_DEPTH) {
+                LOG_ERROR(machine_name, "State %s nested deeper than %u", states[i].name, MAX_DEPTH);
+                return HAL_INVALID_PARAM;
+            }
+        }
+        table = rows;
+        table_size = static_cast<uint8_t>(N);
+        return HAL_OK;
+    }
+
+    // Enters the initial leaf from the outside in
+    hal_status_t start(S initial) {
+        uint16_t index = indexOf(initial);
+        if (current_state != INVALID_INDEX || !isLeaf(index)) {
+            LOG_ERROR(machine_name, "Cannot start in state %u", index);
+            return HAL_INVALID_PARAM;
+        }
+
+        processing = true;
+        hal_status_t status = enterFrom(INVALID_INDEX, index);
+        current_state = index;
+        state_time = 0;
+        record(TOP, initial, static_cast<E>(0));
+        processing = false;
+
+        hal_status_t queued = processEvents();
+        return status != HAL_OK ? status : queued;
+    }
+
+    // HAL_BUSY when the queue is full; the event is dropped
+    hal_status_t post(E event) {
+        if (queue_count >= QueueSize) {
+            stats.dropped++;
+            LOG_WARNING(machine_name, "Event queue full, dropped event %u", static_cast<unsigned>(event));
+            return HAL_BUSY;
+        }
+        queue[(queue_head + queue_count) % QueueSize] = event;
+        queue_count++;
+        return HAL_OK;
+    }
+
+    // post() and handle it now, unless called from a handler or action
+    hal_status_t dispatch(E event) {
+        hal_status_t status = post(event);
+        if (status != HAL_OK || processing) {
+            return status;
+        }
+        return processEvents();
+    }
+
+    // Queued events, then the update handlers of the active states, then
+    // whatever those posted
+    hal_status_t update(uint32_t delta_ms) {
+        if (current_state == INVALID_INDEX) {
+            return HAL_NOT_INITIALIZED;
+        }
+
+        hal_status_t result = processEvents();
+        state_time += delta_ms;
+
+        uint16_t path[MAX_DEPTH];
+        uint8_t depth = pathTo(current_state, path);
+        processing = true;
+        for (uint8_t i = depth; i > 0; i--) {
+            Handler handler = states[path[i - 1]].onUpdate;
+            if (handler) {
+                hal_status_t status = (owner->*handler)(delta_ms);
+                if (status != HAL_OK && result == HAL_OK) {
+                    result = status;
+                }
+            }
+        }
+        processing = false;
+
+        hal_status_t status = processEvents();
+        return result != HAL_OK ? result : status;
+    }
+
+    S getCurrentState() const { return static_cast<S>(current_state == INVALID_INDEX ? 0 : current_state); }
+    const char* getCurrentStateName() const {
+        return current_state == INVALID_INDEX ? "INVALID" : states[current_state].name;
+    }
+    const char* getStateName(S state) const {
+        return hasIndex(indexOf(state)) ? states[indexOf(state)].name : "UNKNOWN";
+    }
+    uint32_t getStateTime() const { return state_time; }  // In the current leaf
+
+    // True for the current leaf and every superstate around it
+    bool isInState(S state) const {
+        uint16_t target = indexOf(state);
+        for (uint16_t i = current_state; i != INVALID_INDEX; i = parentOf(i)) {
+            if (i == target) return true;
+        }
+        return false;
+    }
+
+    Stats getStats() const { return stats; }
+
+    // Oldest first
+    uint8_t getTraceCount() const { return trace_count; }
+    TraceEntry getTrace(uint8_t i) const {
+        return trace[(trace_next + TraceSize - trace_count + i) % TraceSize];
+    }
+    void logTrace() const {
+        for (uint8_t i = 0; i < trace_count; i++) {
+            TraceEntry entry = getTrace(i);
+            LOG_INFO(machine_name, "%8lu ms  %s -> %s (event %u)",
+                     static_cast<unsigned long>(entry.time_ms),
+                     entry.from == TOP ? "start" : getStateName(entry.from),
+                     getStateName(entry.to), static_cast<unsigned>(entry.event));
+        }
+    }
+
+private:
+    static constexpr uint16_t INVALID_INDEX = 0xFFFF;
+
+    const char* machine_name;
+    Owner* owner;
+    State states[StateCount];
+    const Transition* table;
+    uint8_t table_size;
+
+    uint16_t current_state;
+    uint32_t state_time;
+    bool processing;
+
+    E queue[QueueSize];
+    uint8_t queue_head;
+    uint8_t queue_count;
+
+    TraceEntry trace[TraceSize];
+    uint8_t trace_next;
+    uint8_t trace_count;
+
+    Stats stats;
+
+    static uint16_t indexOf(S state) { return static_cast<uint16_t>(state); }
+    bool hasIndex(uint16_t index) const { return index < StateCount && states[index].name; }
+    uint16_t parentOf(uint16_t index) const {
+        return states[index].parent == TOP ? INVALID_INDEX : indexOf(states[index].parent);
+    }
+
+    bool isLeaf(uint16_t index) const {
+        if (!hasIndex(index)) return false;
+        for (uint16_t i = 0; i < StateCount; i++) {
+            if (states[i].name && states[i].parent != TOP && indexOf(states[i].parent) == index) return false;
+        }
+        return true;
+    }
+
+    uint8_t depthOf(uint16_t index) const {
+        uint8_t depth = 0;
+        for (uint16_t i = index; i != INVALID_INDEX && depth <= MAX_DEPTH; i = parentOf(i)) {
+            depth++;
+        }
+        return depth;
+    }
+
+    // Leaf first, outermost last
+    uint8_t pathTo(uint16_t index, uint16_t* path) const {
+        uint8_t depth = 0;
+        for (uint16_t i = index; i != INVALID_INDEX && depth < MAX_DEPTH; i = parentOf(i)) {
+            path[depth++] = i;
+        }
+        return depth;
+    }
+
+    hal_status_t processEvents() {
+        if (processing) {
+            return HAL_OK;
+        }
+        processing = true;
+        hal_status_t result = HAL_OK;
+        // Events posted meanwhile wait for the next call beyond this bound
+        for (uint8_t handled = 0; queue_count > 0 && handled < QueueSize; handled++) {
+            E event = queue[queue_head];
+            queue_head = (queue_head + 1) % QueueSize;
+            queue_count--;
+
+            hal_status_t status = handleEvent(event);
+            if (status != HAL_OK && result == HAL_OK) {
+                result = status;
+            }
+        }
+        processing = false;
+        return result;
+    }
+
+    hal_status_t handleEvent(E event) {
+        if (current_state == INVALID_INDEX) {
+            return HAL_NOT_INITIALIZED;
+        }
+
+        for (uint16_t level = current_state; level != INVALID_INDEX; level = parentOf(level)) {
+            for (uint8_t i = 0; i < table_size; i++) {
+                const Transition& row = table[i];
+                if (row.event != event || indexOf(row.from) != level) continue;
+                if (row.guard && !(owner->*row.guard)()) continue;
+                return execute(row, event);
+            }
+        }
+
+        stats.unhandled++;
+        LOG_DEBUG(machine_name, "Event %u not handled in %s", static_cast<unsigned>(event),
+                  states[current_state].name);
+        return HAL_OK;
+    }
+
+    hal_status_t execute(const Transition& row, E event) {
+        uint16_t target = indexOf(row.to);
+        uint16_t target_path[MAX_DEPTH];
+        uint8_t target_depth = pathTo(target, target_path);
+
+        // Closest active state that also contains the target; a transition
+        // to the current leaf leaves and re-enters it
+        uint16_t common = INVALID_INDEX;
+        for (uint16_t i = (target == current_state) ? parentOf(current_state) : current_state;
+             i != INVALID_INDEX && common == INVALID_INDEX; i = parentOf(i)) {
+            for (uint8_t j = 0; j < target_depth; j++) {
+                if (target_path[j] == i) {
+                    common = i;
+                    break;
+                }
+            }
+        }
+
+        hal_status_t result = HAL_OK;
+        for (uint16_t i = current_state; i != common; i = parentOf(i)) {
+            if (states[i].onExit) {
+                LOG_DEBUG(machine_name, "Exiting state %s", states[i].name);
+                hal_status_t status = (owner->*states[i].onExit)(state_time);
+                if (status != HAL_OK && result == HAL_OK) {
+                    LOG_ERROR(machine_name, "Failed to exit state %s", states[i].name);
+                    result = status;
+                }
+            }
+        }
+
+        if (row.action) {
+            (owner->*row.action)();
+        }
+
+        S from = static_cast<S>(current_state);
+        hal_status_t status = enterFrom(common, target);
+        current_state = target;
+        state_time = 0;
+        stats.transitions++;
+        record(from, row.to, event);
+        LOG_INFO(machine_name, "Transitioning to state %s", states[target].name);
+
+        return result != HAL_OK ? result : status;
+    }
+
+    // Entry handlers below common down to the leaf, outermost first. Errors
+    // are reported but can't stop the transition: a failsafe must complete.
+    hal_status_t enterFrom(uint16_t common, uint16_t leaf) {
+        uint16_t path[MAX_DEPTH];
+        uint8_t depth = pathTo(leaf, path);
+        uint8_t count = 0;
+        while (count < depth && path[count] != common) {
+            count++;
+        }
+
+        hal_status_t result = HAL_OK;
+        for (uint8_t i = count; i > 0; i--) {
+            const State& state = states[path[i - 1]];
+            if (state.onEnter) {
+                hal_status_t status = (owner->*state.onEnter)(0);
+                if (status != HAL_OK && result == HAL_OK) {
+                    LOG_ERROR(machine_name, "Failed to enter state %s", state.name);
+                    result = status;
+                }
+            }
+        }
+        return result;
+    }
+
+    void record(S from, S to, E event) {
+        TraceEntry& entry = trace[trace_next];
+        entry.time_ms = millis();
+        entry.from = from;
+        entry.to = to;
+        entry.event = event;
+        trace_next = (trace_next + 1) % TraceSize;
+        if (trace_count < TraceSize) trace_count++;
+    }
+};
+
+#endif
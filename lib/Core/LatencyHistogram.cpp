@@ -0,0 +1,83 @@
+#include "LatencyHistogram.h"
+#include <string.h>
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::reset() {
+    memset(buckets, 0, sizeof(buckets));
+    count = 0;
+    sum = 0;
+    min_value = UINT32_MAX;
+    max_value = 0;
+    last_value = 0;
+    jitter_x16 = 0;
+}
+
+size_t LatencyHistogram::bucketIndex(uint32_t value_us) {
+    if (value_us > MAX_TRACKABLE_US) value_us = MAX_TRACKABLE_US;
+    if (value_us < SUB_BUCKETS) return value_us;
+
+    uint32_t exponent = 31 - __builtin_clz(value_us);
+    uint32_t sub = (value_us >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+uint32_t LatencyHistogram::bucketUpperBound(size_t index) {
+    if (index < SUB_BUCKETS) return static_cast<uint32_t>(index);
+
+    uint32_t exponent = static_cast<uint32_t>(index / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+    uint32_t sub = static_cast<uint32_t>(index % SUB_BUCKETS);
+    uint32_t width = 1u << (exponent - SUB_BUCKET_BITS);
+    return (SUB_BUCKETS + sub) * width + width - 1;
+}
+
+void LatencyHistogram::record(uint32_t value_us) {
+    if (value_us > MAX_TRACKABLE_US) value_us = MAX_TRACKABLE_US;
+
+    buckets[bucketIndex(value_us)]++;
+    sum += value_us;
+    if (value_us < min_value) min_value = value_us;
+    if (value_us > max_value) max_value = value_us;
+
+    if (count > 0) {
+        uint32_t delta = (value_us > last_value) ? value_us - last_value : last_value - value_us;
+        // J += (|D| - J) / 16, kept in 1/16 us units
+        int32_t step = static_cast<int32_t>(delta) - static_cast<int32_t>(jitter_x16 >> 4);
+        jitter_x16 = static_cast<uint32_t>(static_cast<int32_t>(jitter_x16) + step);
+    }
+    last_value = value_us;
+    count++;
+}
+
+uint32_t LatencyHistogram::getPercentile(float percentile) const {
+    if (count == 0) return 0;
+    if (percentile < 0.0f) percentile = 0.0f;
+    if (percentile > 100.0f) percentile = 100.0f;
+
+    uint32_t target = static_cast<uint32_t>(percentile / 100.0f * count + 0.5f);
+    if (target == 0) target = 1;
+
+    uint32_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        seen += buckets[i];
+        if (seen >= target) {
+            // Never report past the largest sample actually seen
+            uint32_t upper = bucketUpperBound(i);
+            return (upper < max_value) ? upper : max_value;
+        }
+    }
+    return max_value;
+}
+
+void LatencyHistogram::summarize(Summary& out) const {
+    out.count = count;
+    out.min_us = getMin();
+    out.mean_us = getMean();
+    out.p50_us = getPercentile(50.0f);
+    out.p95_us = getPercentile(95.0f);
+    out.p99_us = getPercentile(99.0f);
+    out.max_us = max_value;
+    out.jitter_us = getJitter();
+}
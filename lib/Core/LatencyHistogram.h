@@ -0,0 +1,61 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Fixed-size, log-bucketed histogram for microsecond latencies (HDR style).
+// Values below 8 us get exact buckets; above that every power of two is split
+// into 8 sub-buckets, so any reported percentile is within 12.5% of the true
+// value. Values are clamped to MAX_TRACKABLE_US (~16.7 s).
+//
+// Jitter is the RFC 3550 smoothed mean deviation between consecutive samples.
+class LatencyHistogram {
+public:
+    static constexpr uint8_t SUB_BUCKET_BITS = 3;
+    static constexpr uint32_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr uint8_t MAX_EXPONENT = 23;
+    static constexpr uint32_t MAX_TRACKABLE_US = (1u << (MAX_EXPONENT + 1)) - 1;
+    static constexpr size_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    struct Summary {
+        uint32_t count;
+        uint32_t min_us;
+        uint32_t mean_us;
+        uint32_t p50_us;
+        uint32_t p95_us;
+        uint32_t p99_us;
+        uint32_t max_us;
+        uint32_t jitter_us;
+    };
+
+    LatencyHistogram();
+
+    void reset();
+    void record(uint32_t value_us);
+
+    uint32_t getCount() const { return count; }
+    uint32_t getMin() const { return count ? min_value : 0; }
+    uint32_t getMax() const { return max_value; }
+    uint32_t getMean() const { return count ? static_cast<uint32_t>(sum / count) : 0; }
+    uint32_t getJitter() const { return jitter_x16 >> 4; }
+
+    // percentile in [0, 100]; returns the upper edge of the matching bucket
+    uint32_t getPercentile(float percentile) const;
+
+    void summarize(Summary& out) const;
+
+    static size_t bucketIndex(uint32_t value_us);
+    static uint32_t bucketUpperBound(size_t index);
+
+private:
+    uint32_t buckets[BUCKET_COUNT];
+    uint32_t count;
+    uint64_t sum;
+    uint32_t min_value;
+    uint32_t max_value;
+    uint32_t last_value;
+    uint32_t jitter_x16;  // Fixed point, 4 fractional bits
+};
+
+#endif
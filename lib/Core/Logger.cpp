@@ -1,9 +1,43 @@
 #include "Logger.h"
+#include "Constants.h"
+#include "MPSCByteRing.h"
+#include "BinaryLog.h"
+
+#ifndef ARDUINO
+#include <chrono>
+#include <thread>
+#endif
 
 LogLevel Logger::current_level = LogLevel::LOG_LEVEL_INFO;
 bool Logger::initialized = false;
 uint32_t Logger::init_time = 0;
 
+namespace {
+    constexpr uint8_t LEVEL_COUNT = static_cast<uint8_t>(LogLevel::LOG_LEVEL_NONE);
+    constexpr uint8_t RECORD_FLAG = 0x80;  // Ring tag bit: BinaryLog record, not text
+    static_assert(sizeof(Constants::Logging::DROP_FILL_PCT) == LEVEL_COUNT,
+                  "DROP_FILL_PCT needs one entry per level");
+    
+    MPSCByteRing<Constants::Logging::ASYNC_BUFFER_SIZE> async_ring;
+    std::atomic<bool> async_enabled(false);
+    std::atomic<bool> drain_running(false);
+    std::atomic<bool> drain_stop(false);
+    std::atomic<uint32_t> lines_written(0);
+    std::atomic<uint32_t> lines_dropped[LEVEL_COUNT];
+    std::atomic<bool> binary_output(Constants::Logging::BINARY_SERIAL_OUTPUT);  // Read by the drain task
+    uint32_t reported_drops = 0;
+    uint8_t drop_fill_pct[LEVEL_COUNT] = {
+        Constants::Logging::DROP_FILL_PCT[0], Constants::Logging::DROP_FILL_PCT[1],
+        Constants::Logging::DROP_FILL_PCT[2], Constants::Logging::DROP_FILL_PCT[3],
+        Constants::Logging::DROP_FILL_PCT[4]
+    };
+#ifdef ARDUINO
+    TaskHandle_t drain_handle = nullptr;
+#else
+    std::thread drain_thread;
+#endif
+}
+
 void Logger::init(uint32_t baud_rate, uint32_t timeout_ms) {
     if (initialized) {
         return;
@@ -49,7 +83,27 @@ void Logger::logRaw(const char* message) {
     if (!initialized) {
         return;
     }
-    Serial.println(message);
+    writeLine(LogLevel::LOG_LEVEL_INFO, message, strlen(message));
+}
+
+void Logger::logRecord(LogLevel level, const uint8_t* record, size_t length) {
+    if (!isEnabled(level)) {
+        return;
+    }
+    
+    if (async_enabled.load(std::memory_order_acquire)) {
+        uint8_t index = static_cast<uint8_t>(level);
+        size_t limit = async_ring.capacity() * drop_fill_pct[index] / 100;
+        if (!async_ring.write(record, length, index | RECORD_FLAG, limit)) {
+            lines_dropped[index].fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+    writeRecord(record, length);
+}
+
+void Logger::setBinaryOutput(bool enabled) {
+    binary_output.store(enabled, std::memory_order_relaxed);
 }
 
 void Logger::debug(const char* tag, const char* format, ...) {
@@ -119,29 +173,196 @@ const char* Logger::levelToString(LogLevel level) {
 }
 
 void Logger::vlog(LogLevel level, const char* tag, const char* format, va_list args) {
-    printTimestamp();
+    char line[Constants::Logging::MAX_LINE_LENGTH];
+    size_t length = vformatLine(line, sizeof(line), level, tag, format, args);
+    writeLine(level, line, length);
+}
+
+size_t Logger::vformatLine(char* line, size_t size, LogLevel level, const char* tag,
+                           const char* format, va_list args) {
+    uint32_t elapsed = millis() - init_time;
+    uint32_t seconds = elapsed / 1000;
+    uint32_t ms = elapsed % 1000;
+    
+    int written = snprintf(line, size, "%6u.%03u [%s] ", (unsigned)seconds, (unsigned)ms, levelToString(level));
+    size_t length = (written < 0) ? 0 : (size_t)written;
+    if (tag != nullptr && length < size) {
+        written = snprintf(line + length, size - length, "[%s] ", tag);
+        length += (written < 0) ? 0 : (size_t)written;
+    }
+    if (length < size) {
+        written = vsnprintf(line + length, size - length, format, args);
+        length += (written < 0) ? 0 : (size_t)written;
+    }
+    return (length < size) ? length : size - 1;
+}
+
+size_t Logger::formatLine(char* line, size_t size, LogLevel level, const char* tag,
+                          const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    size_t length = vformatLine(line, size, level, tag, format, args);
+    va_end(args);
+    return length;
+}
+
+// The only place log output is produced. In async mode this is the hot
+// path: bounded formatting is already done, one ring write remains.
+void Logger::writeLine(LogLevel level, const char* line, size_t length) {
+    if (async_enabled.load(std::memory_order_acquire)) {
+        uint8_t index = static_cast<uint8_t>(level);
+        size_t limit = async_ring.capacity() * drop_fill_pct[index] / 100;
+        if (!async_ring.write(line, length, index, limit)) {
+            lines_dropped[index].fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+    Serial.println(line);
+}
+
+// Formatting deferred from the caller happens here, or on the host
+void Logger::writeRecord(const uint8_t* record, size_t length) {
+    if (binary_output.load(std::memory_order_relaxed)) {
+        uint8_t frame[Constants::Logging::MAX_RECORD_SIZE + BinaryLog::FRAME_OVERHEAD];
+        size_t frame_length = BinaryLog::encodeFrame(record, length, frame, sizeof(frame));
+        if (frame_length > 0) {
+            Serial.write(frame, frame_length);
+        }
+        return;
+    }
+    
+    char line[Constants::Logging::MAX_LINE_LENGTH];
+    BinaryLog::formatRecord(record, length, line, sizeof(line));
+    Serial.println(line);
+}
+
+bool Logger::startAsync() {
+    if (!initialized) {
+        return false;
+    }
+    if (async_enabled.load(std::memory_order_acquire)) {
+        return true;
+    }
     
-    Serial.print(F(" ["));
-    Serial.print(levelToString(level));
-    Serial.print(F("] "));
+    drain_stop.store(false, std::memory_order_release);
+    drain_running.store(true, std::memory_order_release);
     
-    if (tag != nullptr) {
-        Serial.print(F("["));
-        Serial.print(tag);
-        Serial.print(F("] "));
+#ifdef ARDUINO
+    BaseType_t core = (Constants::Logging::DRAIN_TASK_CORE < 0) ? tskNO_AFFINITY : Constants::Logging::DRAIN_TASK_CORE;
+    if (xTaskCreatePinnedToCore(&Logger::drainTaskEntry, "log_drain", Constants::Logging::DRAIN_TASK_STACK_SIZE,
+                                nullptr, Constants::Logging::DRAIN_TASK_PRIORITY, &drain_handle, core) != pdPASS) {
+        drain_running.store(false, std::memory_order_release);
+        LOG_ERROR("Logger", "Failed to create drain task");
+        return false;
     }
+#else
+    drain_thread = std::thread(&Logger::runDrain);
+#endif
     
-    char buffer[256];
-    vsnprintf(buffer, sizeof(buffer), format, args);
-    Serial.println(buffer);
+    // Lines logged up to here went straight to Serial
+    async_enabled.store(true, std::memory_order_release);
+    LOG_INFO("Logger", "Async logging on (%u byte buffer)", (unsigned)async_ring.capacity());
+    return true;
 }
 
-void Logger::printTimestamp() {
-    uint32_t elapsed = millis() - init_time;
-    uint32_t seconds = elapsed / 1000;
-    uint32_t ms = elapsed % 1000;
+void Logger::stopAsync() {
+    if (!async_enabled.load(std::memory_order_acquire)) {
+        return;
+    }
+    
+    async_enabled.store(false, std::memory_order_release);
+    drain_stop.store(true, std::memory_order_release);
+    
+#ifdef ARDUINO
+    // The task clears drain_running as the last thing before deleting itself
+    while (drain_running.load(std::memory_order_acquire)) {
+        vTaskDelay(1);
+    }
+    drain_handle = nullptr;
+#else
+    if (drain_thread.joinable()) {
+        drain_thread.join();
+    }
+    drain_running.store(false, std::memory_order_release);
+#endif
+    
+    // The caller is the only consumer now
+    drainQueued();
+}
+
+bool Logger::isAsync() {
+    return async_enabled.load(std::memory_order_acquire);
+}
+
+void Logger::setDropFillPercent(LogLevel level, uint8_t percent) {
+    uint8_t index = static_cast<uint8_t>(level);
+    if (index < LEVEL_COUNT) {
+        drop_fill_pct[index] = (percent > 100) ? 100 : percent;
+    }
+}
+
+Logger::AsyncStats Logger::getAsyncStats() {
+    AsyncStats stats;
+    stats.written = lines_written.load(std::memory_order_relaxed);
+    for (uint8_t i = 0; i < LEVEL_COUNT; i++) {
+        stats.dropped[i] = lines_dropped[i].load(std::memory_order_relaxed);
+    }
+    stats.high_watermark = async_ring.getHighWatermark();
+    return stats;
+}
+
+void Logger::drainQueued() {
+    char line[Constants::Logging::MAX_LINE_LENGTH + 1];
+    size_t length;
+    uint8_t tag;
+    while (async_ring.read(line, sizeof(line) - 1, length, tag)) {
+        if (tag & RECORD_FLAG) {
+            writeRecord(reinterpret_cast<const uint8_t*>(line), length);
+        } else {
+            line[length] = '\0';
+            Serial.println(line);
+        }
+        lines_written.fetch_add(1, std::memory_order_relaxed);
+    }
+    reportDrops();
+}
+
+void Logger::reportDrops() {
+    uint32_t dropped[LEVEL_COUNT];
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < LEVEL_COUNT; i++) {
+        dropped[i] = lines_dropped[i].load(std::memory_order_relaxed);
+        total += dropped[i];
+    }
+    if (total == reported_drops) {
+        return;
+    }
     
-    char timestamp[16];
-    snprintf(timestamp, sizeof(timestamp), "%6u.%03u", (unsigned)seconds, (unsigned)ms);
-    Serial.print(timestamp);
-}
\ No newline at end of file
+    char line[Constants::Logging::MAX_LINE_LENGTH];
+    formatLine(line, sizeof(line), LogLevel::LOG_LEVEL_WARNING, "Logger",
+               "Dropped %lu lines (total debug %lu, info %lu, warning %lu, error %lu, critical %lu)",
+               (unsigned long)(total - reported_drops), (unsigned long)dropped[0], (unsigned long)dropped[1],
+               (unsigned long)dropped[2], (unsigned long)dropped[3], (unsigned long)dropped[4]);
+    Serial.println(line);
+    reported_drops = total;
+}
+
+void Logger::runDrain() {
+    while (!drain_stop.load(std::memory_order_acquire)) {
+        drainQueued();
+#ifdef ARDUINO
+        vTaskDelay(pdMS_TO_TICKS(Constants::Logging::DRAIN_INTERVAL_MS));
+#else
+        std::this_thread::sleep_for(std::chrono::milliseconds(Constants::Logging::DRAIN_INTERVAL_MS));
+#endif
+    }
+}
+
+#ifdef ARDUINO
+void Logger::drainTaskEntry(void* arg) {
+    (void)arg;
+    runDrain();
+    drain_running.store(false, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+#endif
@@ -1,7 +1,7 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
-#include <Arduino.h>
+#include "Platform.h"
 #include <stdarg.h>
 
 enum class LogLevel {
@@ -21,6 +21,13 @@ public:
     
     static void log(LogLevel level, const char* tag, const char* format, ...);
     static void logRaw(const char* message);
+    static void logRecord(LogLevel level, const uint8_t* record, size_t length);  // BinaryLog record
+    // Records as frames for src/log_decoder instead of text lines; starts
+    // as Constants::Logging::BINARY_SERIAL_OUTPUT
+    static void setBinaryOutput(bool enabled);
+    
+    static bool isEnabled(LogLevel level) { return initialized && level >= current_level; }
+    static uint32_t getUptimeMs() { return millis() - init_time; }
     
     static void debug(const char* tag, const char* format, ...);
     static void info(const char* tag, const char* format, ...);
@@ -30,13 +37,41 @@ public:
     
     static const char* levelToString(LogLevel level);
     
+    // Asynchronous mode: log calls only format their line into a lock-free
+    // ring and return, a low-priority task writes the ring to Serial. Lines
+    // that would fill the ring beyond their level's share are dropped and
+    // counted (Constants::Logging::DROP_FILL_PCT); the drain task reports
+    // the drops.
+    struct AsyncStats {
+        uint32_t written;
+        uint32_t dropped[5];        // Per level, DEBUG to CRITICAL
+        uint32_t high_watermark;    // Bytes
+    };
+    
+    static bool startAsync();
+    static void stopAsync();        // Writes out what is still queued first
+    static bool isAsync();
+    static void setDropFillPercent(LogLevel level, uint8_t percent);
+    static AsyncStats getAsyncStats();
+    
 private:
     static LogLevel current_level;
     static bool initialized;
     static uint32_t init_time;
     
     static void vlog(LogLevel level, const char* tag, const char* format, va_list args);
-    static void printTimestamp();
+    static size_t vformatLine(char* line, size_t size, LogLevel level, const char* tag,
+                              const char* format, va_list args);
+    static size_t formatLine(char* line, size_t size, LogLevel level, const char* tag,
+                             const char* format, ...);
+    static void writeLine(LogLevel level, const char* line, size_t length);
+    static void writeRecord(const uint8_t* record, size_t length);
+    static void drainQueued();
+    static void reportDrops();
+    static void runDrain();
+#ifdef ARDUINO
+    static void drainTaskEntry(void* arg);
+#endif
 };
 
 #define LOG_DEBUG(tag, ...) Logger::debug(tag, __VA_ARGS__)
@@ -0,0 +1,123 @@
+#ifndef MPSC_BYTE_RING_H
+#define MPSC_BYTE_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+
+// Fixed-capacity, allocation-free multi-producer/single-consumer ring of
+// variable-length records. write() may be called from any number of tasks
+// at once, read() from one other task. Neither side ever blocks: a producer
+// claims its space with a compare-and-swap and fails when the ring is full.
+//
+// Records are stored as 32-bit words, a header word followed by the payload.
+// The producer publishes a record by storing its header last, so the
+// consumer stops at the first record that is still being written, even if
+// later ones are complete. A producer preempted between claiming and
+// publishing therefore holds back everything behind it until it resumes.
+template<size_t Capacity>
+class MPSCByteRing {
+    static_assert(Capacity >= 16 && (Capacity & (Capacity - 1)) == 0,
+                  "MPSCByteRing capacity must be a power of two of at least 16 bytes");
+
+public:
+    static constexpr size_t MAX_RECORD_SIZE = (Capacity - 4) < 0xFFFF ? (Capacity - 4) : 0xFFFF;
+
+    MPSCByteRing() : reserve_head(0), tail(0), high_watermark(0) {
+        for (uint32_t i = 0; i < WORDS; i++) {
+            words[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Producer side. Fails without side effects when the record would fill
+    // the ring beyond limit bytes, so callers can keep room for more
+    // important records.
+    bool write(const void* data, size_t length, uint8_t tag, size_t limit = Capacity) {
+        if (length > MAX_RECORD_SIZE) {
+            return false;
+        }
+        uint32_t needed = 1 + static_cast<uint32_t>((length + 3) / 4);
+        uint32_t limit_words = static_cast<uint32_t>((limit < Capacity ? limit : Capacity) / 4);
+
+        uint32_t pos = reserve_head.load(std::memory_order_relaxed);
+        uint32_t used;
+        do {
+            used = pos - tail.load(std::memory_order_acquire);
+            if (used + needed > limit_words) {
+                return false;
+            }
+        } while (!reserve_head.compare_exchange_weak(pos, pos + needed, std::memory_order_relaxed,
+                                                     std::memory_order_relaxed));
+
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (uint32_t i = 1; i < needed; i++) {
+            uint32_t word = 0;
+            size_t offset = (i - 1) * 4;
+            memcpy(&word, bytes + offset, length - offset < 4 ? length - offset : 4);
+            words[(pos + i) & MASK].store(word, std::memory_order_relaxed);
+        }
+        words[pos & MASK].store(COMMITTED | (static_cast<uint32_t>(tag) << 16) | static_cast<uint32_t>(length),
+                                std::memory_order_release);
+
+        uint32_t fill = (used + needed) * 4;
+        uint32_t seen = high_watermark.load(std::memory_order_relaxed);
+        while (fill > seen && !high_watermark.compare_exchange_weak(seen, fill, std::memory_order_relaxed)) {
+        }
+        return true;
+    }
+
+    // Consumer side. Copies up to max_length bytes of the next record (the
+    // rest is discarded) and returns false when there is no complete record.
+    bool read(void* out, size_t max_length, size_t& length, uint8_t& tag) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t header = words[t & MASK].load(std::memory_order_acquire);
+        if (!(header & COMMITTED)) {
+            return false;
+        }
+
+        size_t record_length = header & 0xFFFF;
+        uint32_t needed = 1 + static_cast<uint32_t>((record_length + 3) / 4);
+        length = record_length < max_length ? record_length : max_length;
+        tag = static_cast<uint8_t>(header >> 16);
+
+        uint8_t* bytes = static_cast<uint8_t*>(out);
+        for (uint32_t i = 1; i < needed; i++) {
+            size_t offset = (i - 1) * 4;
+            if (offset < length) {
+                uint32_t word = words[(t + i) & MASK].load(std::memory_order_relaxed);
+                memcpy(bytes + offset, &word, length - offset < 4 ? length - offset : 4);
+            }
+        }
+
+        // Any word may be a header the next time around, so all of them are
+        // cleared before the space is handed back
+        for (uint32_t i = 0; i < needed; i++) {
+            words[(t + i) & MASK].store(0, std::memory_order_relaxed);
+        }
+        tail.store(t + needed, std::memory_order_release);
+        return true;
+    }
+
+    // Bytes claimed, including records still being written. Approximate
+    // when called concurrently with the producers.
+    size_t size() const {
+        return (reserve_head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire)) * 4;
+    }
+    bool empty() const { return size() == 0; }
+    static constexpr size_t capacity() { return Capacity; }
+
+    uint32_t getHighWatermark() const { return high_watermark.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint32_t WORDS = Capacity / 4;
+    static constexpr uint32_t MASK = WORDS - 1;
+    static constexpr uint32_t COMMITTED = 0x80000000UL;
+
+    std::atomic<uint32_t> words[WORDS];
+    std::atomic<uint32_t> reserve_head;  // claimed by producers
+    std::atomic<uint32_t> tail;          // written by consumer only
+    std::atomic<uint32_t> high_watermark;
+};
+
+#endif
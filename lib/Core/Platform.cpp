@@ -0,0 +1,312 @@
+#include "Platform.h"
+
+#ifndef ARDUINO
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+HostSerial Serial;
+
+struct HostMutex {
+    std::recursive_timed_mutex mutex;
+    std::atomic<TaskHandle_t> holder;
+    uint32_t depth;
+};
+
+struct HostTimer {
+    esp_timer_cb_t callback;
+    void* arg;
+    bool skip_unhandled_events;
+    bool running;
+    uint64_t period_us;
+    uint64_t next_fire_us;
+};
+
+namespace {
+    std::atomic<uint64_t> sim_time_us(0);  // Read by host link-task threads
+    std::atomic<uint64_t> blocked_us(0);
+    uint32_t random_state = 0x9E3779B9;
+    std::vector<HostTimer*> timers;
+    // Link-task threads start and stop timers while advanceUs() fires them.
+    // Held through the callbacks, as the single esp_timer task serializes them.
+    std::recursive_mutex timer_lock;
+    std::map<TaskHandle_t, uint32_t> notifications;  // Under timer_lock, given from timer callbacks
+
+    HostTimer* nextDueTimer(uint64_t until_us) {
+        HostTimer* next = nullptr;
+        for (HostTimer* timer : timers) {
+            if (timer->running && timer->next_fire_us <= until_us &&
+                (!next || timer->next_fire_us < next->next_fire_us)) {
+                next = timer;
+            }
+        }
+        return next;
+    }
+}
+
+namespace Platform {
+
+uint64_t nowUs() {
+    return sim_time_us;
+}
+
+void setTimeUs(uint64_t time_us) {
+    sim_time_us = time_us;
+}
+
+void advanceUs(uint64_t delta_us) {
+    std::lock_guard<std::recursive_mutex> lock(timer_lock);
+    uint64_t target_us = sim_time_us + delta_us;
+
+    while (HostTimer* timer = nextDueTimer(target_us)) {
+        if (timer->next_fire_us > sim_time_us) {
+            sim_time_us = timer->next_fire_us;
+        }
+        timer->next_fire_us += timer->period_us;
+        if (timer->period_us == 0) {
+            timer->running = false;  // One-shot
+        } else if (timer->skip_unhandled_events && timer->next_fire_us <= sim_time_us) {
+            timer->next_fire_us = sim_time_us + timer->period_us;  // Never burst to catch up
+        }
+        timer->callback(timer->arg);
+    }
+
+    sim_time_us = target_us;
+}
+
+uint32_t randomU32() {
+    // xorshift32
+    uint32_t x = random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    random_state = x;
+    return x;
+}
+
+void setRandomSeed(uint32_t seed) {
+    random_state = seed ? seed : 1;
+}
+
+uint64_t blockedUs() {
+    return blocked_us;
+}
+
+}
+
+uint32_t millis() {
+    return static_cast<uint32_t>(sim_time_us / 1000);
+}
+
+uint32_t micros() {
+    return static_cast<uint32_t>(sim_time_us);
+}
+
+void delay(uint32_t ms) {
+    Platform::advanceUs(static_cast<uint64_t>(ms) * 1000);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    HostMutex* mutex = new HostMutex();
+    mutex->holder.store(nullptr);
+    mutex->depth = 0;
+    return mutex;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t mutex) {
+    delete mutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks) {
+    // Waits in real time: only other host threads can release it
+    if (!mutex || !mutex->mutex.try_lock_for(std::chrono::milliseconds(ticks))) {
+        return pdFALSE;
+    }
+    mutex->holder.store(xTaskGetCurrentTaskHandle());
+    mutex->depth++;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex) {
+    if (!mutex || mutex->holder.load() != xTaskGetCurrentTaskHandle()) {
+        return pdFALSE;
+    }
+    if (--mutex->depth == 0) {
+        mutex->holder.store(nullptr);
+    }
+    mutex->mutex.unlock();
+    return pdTRUE;
+}
+
+TaskHandle_t xSemaphoreGetMutexHolder(SemaphoreHandle_t mutex) {
+    return mutex ? mutex->holder.load() : nullptr;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    // One distinct address per host thread stands in for the task handle
+    static thread_local char task_tag;
+    return &task_tag;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    uint64_t delta_us = static_cast<uint64_t>(ticks) * portTICK_PERIOD_MS * 1000;
+    blocked_us += delta_us;
+    Platform::advanceUs(delta_us);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    uint64_t timeout_us = ticks == portMAX_DELAY
+        ? UINT64_MAX : sim_time_us + static_cast<uint64_t>(ticks) * portTICK_PERIOD_MS * 1000;
+    for (;;) {
+        uint64_t until_us;
+        {
+            std::lock_guard<std::recursive_mutex> lock(timer_lock);
+            uint32_t& count = notifications[self];
+            if (count > 0) {
+                uint32_t value = count;
+                count = clear_on_exit ? 0 : count - 1;
+                return value;
+            }
+            HostTimer* next = nextDueTimer(timeout_us);
+            if (!next && (timeout_us == UINT64_MAX || sim_time_us >= timeout_us)) {
+                return 0;  // Timed out, or nothing left that could wake it
+            }
+            until_us = next ? next->next_fire_us : timeout_us;
+        }
+        uint64_t delta_us = until_us > sim_time_us ? until_us - sim_time_us : 0;
+        blocked_us += delta_us;
+        Platform::advanceUs(delta_us);
+    }
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    std::lock_guard<std::recursive_mutex> lock(timer_lock);
+    notifications[task]++;
+    return pdTRUE;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out_handle) {
+    if (!args || !args->callback || !out_handle) {
+        return ESP_FAIL;
+    }
+    std::lock_guard<std::recursive_mutex> lock(timer_lock);
+    HostTimer* timer = new HostTimer();
+    timer->callback = args->callback;
+    timer->arg = args->arg;
+    timer->skip_unhandled_events = args->skip_unhandled_events;
+    timer->running = false;
+    timer->period_us = 0;
+    timer->next_fire_us = 0;
+    timers.push_back(timer);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    std::lock_guard<std::recursive_mutex> lock(timer_lock);
+    if (!timer || timer->running) {
+        return ESP_FAIL;
+    }
+    timer->period_us = 0;
+    timer->next_fire_us = sim_time_us + timeout_us;
+    timer->running = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+    std::lock_guard<std::recursive_mutex> lock(timer_lock);
+    if (!timer || period_us == 0 || timer->running) {
+        return ESP_FAIL;
+    }
+    timer->period_us = period_us;
+    timer->next_fire_us = sim_time_us + period_us;
+    timer->running = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    std::lock_guard<std::recursive_mutex> lock(timer_lock);
+    if (!timer || !timer->running) {
+        return ESP_FAIL;
+    }
+    timer->running = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    std::lock_guard<std::recursive_mutex> lock(timer_lock);
+    if (!timer || timer->running) {
+        return ESP_FAIL;
+    }
+    for (size_t i = 0; i < timers.size(); i++) {
+        if (timers[i] == timer) {
+            timers.erase(timers.begin() + i);
+            break;
+        }
+    }
+    delete timer;
+    return ESP_OK;
+}
+
+int64_t esp_timer_get_time() {
+    return static_cast<int64_t>(sim_time_us);
+}
+
+bool Preferences::begin(const char* name, bool read_only) {
+    current_namespace = name ? name : "";
+    is_open = true;
+    is_read_only = read_only;
+    return true;
+}
+
+void Preferences::end() {
+    is_open = false;
+}
+
+bool Preferences::clear() {
+    if (!is_open || is_read_only) return false;
+    storage[current_namespace].clear();
+    return true;
+}
+
+bool Preferences::getBool(const char* key, bool default_value) {
+    uint8_t value = 0;
+    return getBytes(key, &value, 1) == 1 ? value != 0 : default_value;
+}
+
+size_t Preferences::putBool(const char* key, bool value) {
+    uint8_t byte = value ? 1 : 0;
+    return putBytes(key, &byte, 1);
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t default_value) {
+    uint32_t value = 0;
+    return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : default_value;
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t max_len) {
+    if (!is_open || !key || !buf) return 0;
+
+    std::map<std::string, std::vector<uint8_t>>& entries = storage[current_namespace];
+    std::map<std::string, std::vector<uint8_t>>::const_iterator it = entries.find(key);
+    if (it == entries.end() || it->second.size() > max_len) return 0;
+
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+    if (!is_open || is_read_only || !key || !value) return 0;
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(value);
+    storage[current_namespace][key].assign(bytes, bytes + len);
+    return len;
+}
+
+#endif
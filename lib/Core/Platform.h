@@ -0,0 +1,162 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+// Platform layer for code that also has to build under [env:native]
+// (Logger, StateMachine and the ESP-NOW link). On target this is just the
+// Arduino core, FreeRTOS, esp_timer and Preferences.
+//
+// On the host, the small subset of those APIs the link code uses is emulated
+// in-process. Time comes from a simulated clock that only moves when the
+// test or simulator calls Platform::advanceUs() (or delay()). esp_timers
+// fire from inside advanceUs() at their exact simulated times.
+#ifdef ARDUINO
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+namespace Platform {
+    inline uint64_t nowUs() { return static_cast<uint64_t>(esp_timer_get_time()); }
+    inline uint32_t randomU32() { return esp_random(); }  // Hardware RNG
+}
+
+#else
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Platform {
+    uint64_t nowUs();
+    void setTimeUs(uint64_t time_us);
+    void advanceUs(uint64_t delta_us);  // Fires any esp_timer that falls due on the way
+    uint32_t randomU32();               // Seeded generator, reproducible between runs
+    void setRandomSeed(uint32_t seed);
+    uint64_t blockedUs();               // Simulated time spent in vTaskDelay()/ulTaskNotifyTake()
+}
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);  // Advances the simulated clock
+
+// Serial, only as far as Logger needs it
+#define F(str) (str)
+class HostSerial {
+public:
+    // Tests can take what would go out on the port; nullptr restores stdout
+    typedef void (*CaptureHandler)(const uint8_t* data, size_t length, void* context);
+
+    void begin(uint32_t) {}
+    void print(const char* text) { write(reinterpret_cast<const uint8_t*>(text), strlen(text)); }
+    void println(const char* text) {
+        print(text);
+        write(reinterpret_cast<const uint8_t*>("\n"), 1);
+    }
+    size_t write(const uint8_t* data, size_t length) {
+        if (capture) {
+            capture(data, length, capture_context);
+            return length;
+        }
+        return fwrite(data, 1, length, stdout);
+    }
+    void setCapture(CaptureHandler handler, void* context) {
+        capture = handler;
+        capture_context = context;
+    }
+    explicit operator bool() const { return true; }
+
+private:
+    CaptureHandler capture = nullptr;
+    void* capture_context = nullptr;
+};
+extern HostSerial Serial;
+
+// FreeRTOS subset
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+typedef struct HostMutex* SemaphoreHandle_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+void vSemaphoreDelete(SemaphoreHandle_t mutex);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex);
+TaskHandle_t xSemaphoreGetMutexHolder(SemaphoreHandle_t mutex);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+
+// Blocking waits move the simulated clock: the waiting thread advances it to
+// the next timer due until it is notified or times out. Only for the thread
+// that drives the clock.
+void vTaskDelay(TickType_t ticks);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+
+struct portMUX_TYPE {
+    std::atomic<bool> locked;
+};
+#define portMUX_INITIALIZE(mux) ((mux)->locked.store(false))
+#define portENTER_CRITICAL(mux) while ((mux)->locked.exchange(true, std::memory_order_acquire)) {}
+#define portEXIT_CRITICAL(mux) ((mux)->locked.store(false, std::memory_order_release))
+
+// esp_timer subset
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+typedef struct HostTimer* esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void* arg);
+typedef enum {
+    ESP_TIMER_TASK = 0
+} esp_timer_dispatch_t;
+typedef struct {
+    esp_timer_cb_t callback;
+    void* arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char* name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out_handle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+int64_t esp_timer_get_time();
+
+// Preferences backed by memory. Each instance is its own flash, so several
+// simulated nodes in one process don't share saved state.
+class Preferences {
+public:
+    bool begin(const char* name, bool read_only = false);
+    void end();
+    bool clear();
+
+    bool getBool(const char* key, bool default_value = false);
+    size_t putBool(const char* key, bool value);
+    uint32_t getUInt(const char* key, uint32_t default_value = 0);
+    size_t putUInt(const char* key, uint32_t value);
+    size_t getBytes(const char* key, void* buf, size_t max_len);
+    size_t putBytes(const char* key, const void* value, size_t len);
+
+private:
+    std::map<std::string, std::map<std::string, std::vector<uint8_t>>> storage;
+    std::string current_namespace;
+    bool is_open = false;
+    bool is_read_only = false;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Fixed-capacity, allocation-free single-producer/single-consumer ring.
+// push() may only be called from one context (e.g. the Wi-Fi callback) and
+// pop() from one other context (e.g. the main loop). Neither side ever blocks.
+template<typename T, size_t Capacity>
+class SPSCQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SPSCQueue capacity must be a power of two");
+
+public:
+    SPSCQueue() : head(0), tail(0), dropped(0), high_watermark(0) {}
+
+    // Producer side. Returns false (and counts a drop) when full.
+    bool push(const T& item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t used = h - tail.load(std::memory_order_acquire);
+        if (used >= Capacity) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        slots[h & MASK] = item;
+        head.store(h + 1, std::memory_order_release);
+
+        if (used + 1 > high_watermark.load(std::memory_order_relaxed)) {
+            high_watermark.store(used + 1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // Consumer side. Returns false when empty.
+    bool pop(T& out) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        out = slots[t & MASK];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called concurrently with the other side
+    size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    static constexpr size_t capacity() { return Capacity; }
+
+    uint32_t getDropCount() const { return dropped.load(std::memory_order_relaxed); }
+    uint32_t getHighWatermark() const { return high_watermark.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint32_t MASK = Capacity - 1;
+
+    T slots[Capacity];
+    std::atomic<uint32_t> head;  // written by producer only
+    std::atomic<uint32_t> tail;  // written by consumer only
+    std::atomic<uint32_t> dropped;
+    std::atomic<uint32_t> high_watermark;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef SNAPSHOT_BUFFER_H
+#define SNAPSHOT_BUFFER_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+// Single-writer, many-reader snapshot of a plain struct (e.g. statistics
+// owned by one task and shown by another). publish() writes the buffer the
+// readers are not being pointed at, then switches them over; read() copies
+// the current one and retries if the writer came round to it meanwhile.
+// A writer stalled in the middle of publish() never blocks readers: the
+// other buffer stays complete. Neither side takes a lock.
+template<typename T>
+class SnapshotBuffer {
+    static_assert(std::is_trivially_copyable<T>::value, "SnapshotBuffer needs a trivially copyable type");
+
+public:
+    SnapshotBuffer() : buffers(), latest(0) {
+        versions[0].store(0, std::memory_order_relaxed);
+        versions[1].store(0, std::memory_order_relaxed);
+    }
+
+    // Writer side only
+    void publish(const T& value) {
+        uint8_t next = latest.load(std::memory_order_relaxed) ^ 1;
+        uint32_t version = versions[next].load(std::memory_order_relaxed);
+        versions[next].store(version + 1, std::memory_order_relaxed);  // Odd: being written
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&buffers[next], &value, sizeof(T));
+        versions[next].store(version + 2, std::memory_order_release);
+        latest.store(next, std::memory_order_release);
+    }
+
+    // Any task
+    T read() const {
+        T out;
+        while (true) {
+            uint8_t index = latest.load(std::memory_order_acquire);
+            uint32_t before = versions[index].load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;  // Only after two publishes overtook this read
+            }
+            memcpy(&out, &buffers[index], sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (versions[index].load(std::memory_order_relaxed) == before) {
+                return out;
+            }
+        }
+    }
+
+private:
+    T buffers[2];
+    std::atomic<uint32_t> versions[2];
+    std::atomic<uint8_t> latest;
+};
+
+#endif
@@ -0,0 +1,125 @@
+#include "StateMachineBenchmark.h"
+
+#ifndef ARDUINO
+
+#include "StateManager.h"
+#include "FixedStateMachine.h"
+#include "Logger.h"
+#include <chrono>
+
+namespace {
+    enum class BenchState : uint16_t {
+        S0 = 0, S1, S2, S3, S4, S5, S6, S7, S8, S9, S10
+    };
+    const uint16_t STATE_COUNT = 11;
+    const char* const STATE_NAMES[STATE_COUNT] = {
+        "Init", "PreflightCheck", "Idle", "Arming", "Armed", "Takeoff",
+        "Hover", "Flying", "Landing", "Emergency", "Error"
+    };
+
+    uint64_t steadyClockNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Handlers with just enough work that the calls can't be dropped
+    class Fixture {
+    public:
+        Fixture()
+            : map_based("BenchMap")
+            , fixed("BenchFixed", this)
+            , work(0) {
+            for (uint16_t i = 0; i < STATE_COUNT; i++) {
+                BenchState state = static_cast<BenchState>(i);
+                StateManager::State def = {
+                    STATE_NAMES[i],
+                    [this](uint32_t dt) { return onEnter(dt); },
+                    [this](uint32_t dt) { return onUpdate(dt); },
+                    [this](uint32_t dt) { return onExit(dt); }
+                };
+                map_based.registerState(state, def);
+
+                FixedMachine::State fixed_def = {
+                    STATE_NAMES[i], &Fixture::onEnter, &Fixture::onUpdate, &Fixture::onExit
+                };
+                fixed.registerState(state, fixed_def);
+            }
+            // Start in the middle, where a map lookup is typical
+            map_based.transitionTo(BenchState::S5);
+            fixed.transitionTo(BenchState::S5);
+        }
+
+        using FixedMachine = FixedStateMachine<Fixture, BenchState, STATE_COUNT>;
+
+        StateMachine<BenchState> map_based;
+        FixedMachine fixed;
+        volatile uint32_t work;
+
+        hal_status_t onEnter(uint32_t) { work = work + 1; return HAL_OK; }
+        hal_status_t onUpdate(uint32_t dt) { work = work + dt; return HAL_OK; }
+        hal_status_t onExit(uint32_t) { work = work + 2; return HAL_OK; }
+    };
+
+    template<typename Machine>
+    StateMachineBenchmark::Timing measure(Machine& machine, uint32_t iterations) {
+        StateMachineBenchmark::Timing timing = {};
+        volatile uintptr_t sink = 0;
+
+        uint64_t start_ns = steadyClockNs();
+        for (uint32_t i = 0; i < iterations; i++) {
+            machine.update(1);
+        }
+        timing.update_ns = static_cast<float>(steadyClockNs() - start_ns) / iterations;
+
+        start_ns = steadyClockNs();
+        for (uint32_t i = 0; i < iterations; i++) {
+            sink = sink + reinterpret_cast<uintptr_t>(machine.getCurrentStateName());
+        }
+        timing.name_ns = static_cast<float>(steadyClockNs() - start_ns) / iterations;
+
+        start_ns = steadyClockNs();
+        for (uint32_t i = 0; i < iterations; i++) {
+            machine.transitionTo(static_cast<BenchState>(i % STATE_COUNT));
+        }
+        timing.transition_ns = static_cast<float>(steadyClockNs() - start_ns) / iterations;
+        return timing;
+    }
+}
+
+namespace StateMachineBenchmark {
+
+Result run(uint32_t iterations) {
+    Result result = {};
+    if (iterations == 0) {
+        return result;
+    }
+    result.iterations = iterations;
+
+    LogLevel level = Logger::getLevel();
+    Logger::setLevel(LogLevel::LOG_LEVEL_NONE);
+
+    Fixture fixture;
+    result.map_based = measure(fixture.map_based, iterations);
+    result.fixed = measure(fixture.fixed, iterations);
+
+    Logger::setLevel(level);
+    return result;
+}
+
+void print(const Result& result) {
+    Logger::logRaw("impl,iterations,update_ns,name_ns,transition_ns");
+
+    const Timing* rows[] = {&result.map_based, &result.fixed};
+    const char* names[] = {"StateMachine", "FixedStateMachine"};
+    for (uint8_t i = 0; i < 2; i++) {
+        char line[96];
+        snprintf(line, sizeof(line), "%s,%lu,%.2f,%.2f,%.2f", names[i],
+                 static_cast<unsigned long>(result.iterations),
+                 rows[i]->update_ns, rows[i]->name_ns, rows[i]->transition_ns);
+        Logger::logRaw(line);
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef STATE_MACHINE_BENCHMARK_H
+#define STATE_MACHINE_BENCHMARK_H
+
+#include "Platform.h"
+
+#ifndef ARDUINO
+
+// Host microbenchmark of StateMachine<T> (map of std::functions) against
+// FixedStateMachine (array of member-function pointers), on an 11-state
+// machine like the drone's. Times are nanoseconds per call from the host's
+// steady clock, logging muted while measuring.
+namespace StateMachineBenchmark {
+    struct Timing {
+        float update_ns;
+        float name_ns;          // getCurrentStateName()
+        float transition_ns;    // transitionTo() with empty enter and exit handlers
+    };
+
+    struct Result {
+        uint32_t iterations;
+        Timing map_based;
+        Timing fixed;
+    };
+
+    Result run(uint32_t iterations = 1000000);
+    void print(const Result& result);  // CSV, one row per implementation
+}
+
+#endif
+
+#endif
@@ -1,7 +1,7 @@
 #ifndef STATE_MANAGER_H
 #define STATE_MANAGER_H
 
-#include <Arduino.h>
+#include "Platform.h"
 #include "../HAL/Core/hal_types.h"
 #include <functional>
 #include <map>
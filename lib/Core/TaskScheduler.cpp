@@ -0,0 +1,208 @@
+#include "TaskScheduler.h"
+#include "Logger.h"
+
+TaskScheduler::TaskScheduler(ClockUs clock, SleepUs sleep)
+    : clock(clock ? clock : Platform::nowUs)
+    , sleep(sleep)
+    , wake_timer(nullptr)
+    , sleeping_task(nullptr)
+    , slots()
+    , task_count(0) {
+}
+
+TaskScheduler::~TaskScheduler() {
+    if (wake_timer) {
+        esp_timer_stop(wake_timer);
+        esp_timer_delete(wake_timer);
+    }
+}
+
+TaskScheduler::TaskId TaskScheduler::addTask(const Task& task) {
+    if (task_count >= MAX_TASKS || task.period_us == 0 || !task.handler) {
+        LOG_ERROR("Scheduler", "Cannot add task %s", task.name ? task.name : "?");
+        return INVALID_TASK;
+    }
+
+    Slot& slot = slots[task_count];
+    slot.task = task;
+    if (slot.task.deadline_us == 0) {
+        slot.task.deadline_us = task.period_us;
+    }
+    slot.stats = TaskStats();
+    slot.enabled = true;
+    slot.reported_overruns = 0;
+    slot.reported_skipped = 0;
+
+    uint64_t now_us = clock();
+    slot.release_us = now_us + task.phase_us;
+    slot.last_run_us = now_us;
+    return task_count++;
+}
+
+void TaskScheduler::setEnabled(TaskId id, bool enabled) {
+    if (id >= task_count || slots[id].enabled == enabled) {
+        return;
+    }
+    Slot& slot = slots[id];
+    slot.enabled = enabled;
+    if (enabled) {
+        slot.release_us = clock();
+        slot.last_run_us = slot.release_us;
+    }
+}
+
+void TaskScheduler::start() {
+    uint64_t now_us = clock();
+    for (uint8_t i = 0; i < task_count; i++) {
+        slots[i].release_us = now_us + slots[i].task.phase_us;
+        slots[i].last_run_us = now_us;
+    }
+}
+
+hal_status_t TaskScheduler::runDue() {
+    uint32_t done_mask = 0;
+    for (;;) {
+        uint64_t now_us = clock();
+        int8_t next = pickDue(now_us, done_mask);
+        if (next < 0) {
+            return HAL_OK;
+        }
+        done_mask |= 1UL << next;
+
+        hal_status_t status = runTask(slots[next], now_us);
+        if (status != HAL_OK) {
+            LOG_ERROR("Scheduler", "Task %s failed: %d", slots[next].task.name, status);
+            return status;
+        }
+    }
+}
+
+int8_t TaskScheduler::pickDue(uint64_t now_us, uint32_t done_mask) const {
+    int8_t best = -1;
+    for (uint8_t i = 0; i < task_count; i++) {
+        const Slot& slot = slots[i];
+        if (!slot.enabled || (done_mask & (1UL << i)) || slot.release_us > now_us) {
+            continue;
+        }
+        if (best < 0 || slot.task.priority > slots[best].task.priority ||
+            (slot.task.priority == slots[best].task.priority && slot.release_us < slots[best].release_us)) {
+            best = static_cast<int8_t>(i);
+        }
+    }
+    return best;
+}
+
+hal_status_t TaskScheduler::runTask(Slot& slot, uint64_t start_us) {
+    uint32_t delta_ms = static_cast<uint32_t>((start_us - slot.last_run_us) / 1000);
+    slot.last_run_us = start_us;
+
+    hal_status_t status = slot.task.handler(delta_ms);
+
+    uint64_t end_us = clock();
+    uint32_t latency_us = static_cast<uint32_t>(start_us - slot.release_us);
+    uint32_t run_us = static_cast<uint32_t>(end_us - start_us);
+
+    TaskStats& stats = slot.stats;
+    stats.runs++;
+    stats.total_run_us += run_us;
+    if (latency_us > stats.max_latency_us) stats.max_latency_us = latency_us;
+    if (run_us > stats.max_run_us) stats.max_run_us = run_us;
+    if (end_us - slot.release_us > slot.task.deadline_us) {
+        stats.overruns++;
+    }
+
+    // One late release may still run right away; anything older is dropped
+    slot.release_us += slot.task.period_us;
+    if (slot.release_us + slot.task.period_us <= end_us) {
+        uint64_t missed = (end_us - slot.release_us) / slot.task.period_us;
+        slot.release_us += missed * slot.task.period_us;
+        stats.skipped += static_cast<uint32_t>(missed);
+    }
+
+    return status;
+}
+
+uint32_t TaskScheduler::timeUntilNextUs() const {
+    uint64_t now_us = clock();
+    uint64_t shortest = UINT32_MAX;
+    for (uint8_t i = 0; i < task_count; i++) {
+        if (!slots[i].enabled) continue;
+        if (slots[i].release_us <= now_us) return 0;
+        uint64_t remaining = slots[i].release_us - now_us;
+        if (remaining < shortest) shortest = remaining;
+    }
+    return static_cast<uint32_t>(shortest);
+}
+
+void TaskScheduler::sleepUntilNext() {
+    uint32_t wait_us = timeUntilNextUs();
+    if (wait_us == 0 || wait_us == UINT32_MAX) {
+        return;
+    }
+    if (sleep) {
+        sleep(wait_us);
+    } else {
+        blockFor(wait_us);
+    }
+}
+
+void TaskScheduler::blockFor(uint32_t us) {
+    // A one-shot esp_timer wakes the task at the release itself. vTaskDelay()
+    // rounds to 1 ms ticks, a large part of the fast periods, and
+    // delayMicroseconds() spins, so nothing below loop() would get the core.
+    if (!wake_timer) {
+        esp_timer_create_args_t args = {};
+        args.callback = &TaskScheduler::onWakeTimer;
+        args.arg = this;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "sched_wake";
+        if (esp_timer_create(&args, &wake_timer) != ESP_OK) {
+            wake_timer = nullptr;
+        }
+    }
+
+    TickType_t ticks = pdMS_TO_TICKS((us + 999) / 1000);
+    sleeping_task = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTake(pdTRUE, 0);  // Drop a wake-up from a timer that fired after a timeout
+    if (!wake_timer || esp_timer_start_once(wake_timer, us) != ESP_OK) {
+        vTaskDelay(ticks > 0 ? ticks : 1);
+        return;
+    }
+    // The timeout only covers a lost wake-up
+    if (ulTaskNotifyTake(pdTRUE, ticks + 1) == 0) {
+        esp_timer_stop(wake_timer);
+    }
+}
+
+void TaskScheduler::onWakeTimer(void* arg) {
+    // esp_timer task context
+    xTaskNotifyGive(static_cast<TaskScheduler*>(arg)->sleeping_task);
+}
+
+TaskScheduler::TaskStats TaskScheduler::getStats(TaskId id) const {
+    return id < task_count ? slots[id].stats : TaskStats();
+}
+
+void TaskScheduler::resetStats() {
+    for (uint8_t i = 0; i < task_count; i++) {
+        slots[i].stats = TaskStats();
+        slots[i].reported_overruns = 0;
+        slots[i].reported_skipped = 0;
+    }
+}
+
+void TaskScheduler::reportOverruns(const char* tag) {
+    for (uint8_t i = 0; i < task_count; i++) {
+        Slot& slot = slots[i];
+        uint32_t overruns = slot.stats.overruns - slot.reported_overruns;
+        uint32_t skipped = slot.stats.skipped - slot.reported_skipped;
+        if (overruns == 0 && skipped == 0) {
+            continue;
+        }
+        LOG_WARNING(tag, "Task %s: %lu overruns, %lu skipped, worst latency %lu us, run %lu us",
+                    slot.task.name, (unsigned long)overruns, (unsigned long)skipped,
+                    (unsigned long)slot.stats.max_latency_us, (unsigned long)slot.stats.max_run_us);
+        slot.reported_overruns = slot.stats.overruns;
+        slot.reported_skipped = slot.stats.skipped;
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include "Platform.h"
+#include "../HAL/Core/hal_types.h"
+#include <functional>
+
+// Cooperative scheduler for the periodic work of the main loop.
+//
+// Each task is released every period_us, starting phase_us after start().
+// runDue() runs the released tasks to completion, highest priority first
+// (the earlier release between equals), each at most once per call, so a
+// task that takes longer than its period can't starve the loop. The loop
+// then sleeps until the next release with sleepUntilNext() instead of a
+// fixed delay.
+//
+// A task that finishes later than deadline_us after its release counts as
+// an overrun. When it falls a whole period behind, the missed releases are
+// dropped and counted instead of run back to back, so the task keeps its
+// phase.
+//
+// Time comes from the clock passed to the constructor, by default
+// Platform::nowUs(). The default sleep blocks the calling task on a
+// one-shot esp_timer set to the next release, so lower-priority tasks get
+// the core while it waits, however short the wait. On the host that is the
+// simulated clock and timer; tests can pass their own clock and sleep
+// functions instead.
+class TaskScheduler {
+public:
+    using TaskId = uint8_t;
+    using TaskHandler = std::function<hal_status_t(uint32_t)>;  // Gets ms since its last run
+    using ClockUs = uint64_t (*)();
+    using SleepUs = void (*)(uint32_t);
+
+    static constexpr uint8_t MAX_TASKS = 12;
+    static constexpr TaskId INVALID_TASK = 0xFF;
+
+    struct Task {
+        const char* name;
+        uint32_t period_us;
+        uint32_t phase_us;          // First release this long after start()
+        uint8_t priority;           // Higher runs first
+        uint32_t deadline_us;       // From the release, 0 = one period
+        TaskHandler handler;
+    };
+
+    struct TaskStats {
+        uint32_t runs;
+        uint32_t overruns;          // Finished after the deadline
+        uint32_t skipped;           // Releases dropped a whole period behind
+        uint32_t max_latency_us;    // Release to start
+        uint32_t max_run_us;
+        uint64_t total_run_us;
+    };
+
+    static constexpr uint32_t periodFromHz(uint32_t rate_hz) { return rate_hz ? 1000000UL / rate_hz : 0; }
+
+    explicit TaskScheduler(ClockUs clock = nullptr, SleepUs sleep = nullptr);
+    ~TaskScheduler();
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    // INVALID_TASK when the table is full or the period is 0
+    TaskId addTask(const Task& task);
+    void setEnabled(TaskId id, bool enabled);  // Re-enabled tasks are released right away
+    bool isEnabled(TaskId id) const { return id < task_count && slots[id].enabled; }
+
+    void start();                   // Releases every task relative to now
+    hal_status_t runDue();          // Stops at the first task returning an error
+    uint32_t timeUntilNextUs() const;  // 0 if a task is due, UINT32_MAX without tasks
+    void sleepUntilNext();
+
+    uint8_t getTaskCount() const { return task_count; }
+    const char* getTaskName(TaskId id) const { return id < task_count ? slots[id].task.name : nullptr; }
+    TaskStats getStats(TaskId id) const;
+    void resetStats();
+
+    // Logs the tasks that overran or skipped releases since the last report
+    void reportOverruns(const char* tag);
+
+private:
+    struct Slot {
+        Task task;
+        TaskStats stats;
+        uint64_t release_us;
+        uint64_t last_run_us;
+        bool enabled;
+        uint32_t reported_overruns;
+        uint32_t reported_skipped;
+    };
+
+    ClockUs clock;
+    SleepUs sleep;                  // nullptr: blockFor()
+    esp_timer_handle_t wake_timer;  // Created on the first blockFor()
+    TaskHandle_t sleeping_task;
+    Slot slots[MAX_TASKS];
+    uint8_t task_count;
+
+    int8_t pickDue(uint64_t now_us, uint32_t done_mask) const;
+    hal_status_t runTask(Slot& slot, uint64_t start_us);
+    void blockFor(uint32_t us);
+    static void onWakeTimer(void* arg);
+};
+
+#endif
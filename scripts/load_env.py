@@ -117,6 +117,37 @@ env.Append(
     ]
 )
 
+# Optional drone MAC address; the base station only listens for it when set
+drone_mac = env_vars.get('DRONE_MAC_ADDRESS', '')
+if drone_mac:
+    if not validate_mac_address(drone_mac):
+        print(f"\nERROR: Invalid MAC address format: DRONE_MAC_ADDRESS={drone_mac}\n")
+        sys.exit(1)
+    env.Append(
+        BUILD_FLAGS=[
+            f'-D DRONE_MAC_STRING=\\"{drone_mac}\\"',
+            f'-D "DRONE_MAC_ARRAY={mac_to_c_array(drone_mac)}"'
+        ]
+    )
+
+# Optional pre-shared key for encrypted sessions (64 hex digits, same on both ends)
+pairing_key = env_vars.get('ESPNOW_PAIRING_KEY', '')
+if pairing_key:
+    try:
+        key_bytes = bytes.fromhex(pairing_key)
+    except ValueError:
+        key_bytes = b''
+    if len(key_bytes) != 32 or not any(key_bytes):
+        print("\nERROR: ESPNOW_PAIRING_KEY must be 64 hex digits (32 bytes), not all zero")
+        print("Generate one with: python3 -c \"import secrets; print(secrets.token_hex(32))\"\n")
+        sys.exit(1)
+    key_array = '{' + ', '.join(f'0x{b:02X}' for b in key_bytes) + '}'
+    env.Append(BUILD_FLAGS=[f'-D "ESPNOW_PAIRING_KEY_ARRAY={key_array}"'])
+
 print(f"\n✓ Loaded MAC addresses from .env:")
 print(f"  Handheld:     {handheld_mac}")
-print(f"  Base Station: {base_mac}\n")
\ No newline at end of file
+print(f"  Base Station: {base_mac}")
+if drone_mac:
+    print(f"  Drone:        {drone_mac}")
+print(f"  Encryption:   {'on' if pairing_key else 'off'}")
+print()
\ No newline at end of file
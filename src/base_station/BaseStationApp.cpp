@@ -5,13 +5,9 @@
 #include "../../lib/SystemInfo/system_info.h"
 #include "../../lib/Config/espnow_config.h"
 
-// Global pointer for callbacks (necessary evil for C-style callbacks)
-// Protected by proper synchronization in the callbacks themselves
-static BaseStationApp* g_base_app_instance = nullptr;
-
 BaseStationApp::BaseStationApp()
     : AppFramework("BaseStation", HAL_BOARD_BASE_STATION)
-    , state_machine("BaseStationSM")
+    , state_machine("BaseStationSM", this)
     , system_monitor(nullptr)
     , display_controller(nullptr)
     , lcd_display(nullptr)
@@ -19,12 +15,13 @@ BaseStationApp::BaseStationApp()
     , counter_screen(nullptr)
     , espnow_screen(nullptr)
     , espnow_manager(nullptr)
+    , link_task(nullptr)
+    , benchmark(nullptr)
+    , drone_peer(ESPNowManager::INVALID_PEER)
     , remote_screen_type(0)
     , remote_button_states(0)
     , is_synced(false)
     , current_screen(nullptr) {
-    // Register this instance for callbacks
-    g_base_app_instance = this;
 }
 
 hal_status_t BaseStationApp::onInitialize() {
@@ -42,10 +39,28 @@ hal_status_t BaseStationApp::onInitialize() {
     if (status != HAL_OK) {
         LOG_WARNING("BaseStation", "ESP-NOW init failed, continuing without it");
     } else {
-        // Register callbacks using static functions (MISRA-C compliant)
-        espnow_manager->setScreenSyncCallback(&BaseStationApp::staticScreenSyncCallback);
-        espnow_manager->setButtonDataCallback(&BaseStationApp::staticButtonDataCallback);
-        LOG_INFO("BaseStation", "ESP-NOW callbacks registered");
+        ESPNowDispatchTable& dispatch = espnow_manager->getDispatchTable();
+        dispatch.on<ESPNowPayload::ScreenSync, BaseStationApp, &BaseStationApp::onScreenSync>(this);
+        dispatch.on<ESPNowPayload::ButtonData, BaseStationApp, &BaseStationApp::onButtonData>(this);
+        dispatch.on<ESPNowPayload::Command, BaseStationApp, &BaseStationApp::onCommand>(this);
+        
+        // The drone talks to us directly, alongside the paired handheld
+        if (ESPNowGlobalConfig::HAS_DRONE_PEER) {
+            drone_peer = espnow_manager->registerPeer(ESPNowGlobalConfig::DRONE_MAC, ESPNowConfig::ROLE_DRONE);
+            dispatch.on<BaseStationApp, &BaseStationApp::onDroneTelemetry>(ESPNowConfig::MSG_TELEMETRY, this);
+        }
+        benchmark = new ESPNowBenchmark(*espnow_manager);
+        LOG_INFO("BaseStation", "ESP-NOW handlers registered");
+        
+        // Peers and callbacks are set up, so the link can move to its own task
+        if (ESPNowGlobalConfig::ENABLE_LINK_TASK) {
+            link_task = new ESPNowLinkTask(*espnow_manager);
+            if (link_task->start() != HAL_OK) {
+                LOG_WARNING("BaseStation", "Link task failed, updating ESP-NOW from the main loop");
+                delete link_task;
+                link_task = nullptr;
+            }
+        }
     }
     
     status = initDisplay();
@@ -57,6 +72,9 @@ hal_status_t BaseStationApp::onInitialize() {
     status = initStates();
     if (status != HAL_OK) return status;
     
+    status = initTasks();
+    if (status != HAL_OK) return status;
+    
     return state_machine.transitionTo(AppState::STARTUP_SCREEN);
 }
 
@@ -86,7 +104,7 @@ hal_status_t BaseStationApp::initDisplay() {
     }
     
     if (espnow_manager) {
-        espnow_screen = new BaseStationESPNowScreen(espnow_manager);
+        espnow_screen = new BaseStationESPNowScreen(espnow_manager, benchmark);
         if (espnow_screen) {
             espnow_screen->onInitialize();
         }
@@ -103,23 +121,17 @@ hal_status_t BaseStationApp::initDisplay() {
 }
 
 hal_status_t BaseStationApp::initStates() {
-    state_machine.registerState(AppState::INIT, "Init",
-        [this](uint32_t dt) { return handleInitState(dt); });
+    state_machine.registerState(AppState::INIT, "Init", &BaseStationApp::handleInitState);
     
-    state_machine.registerState(AppState::STARTUP_SCREEN, "Startup",
-        [this](uint32_t dt) { return handleStartupScreen(dt); });
+    state_machine.registerState(AppState::STARTUP_SCREEN, "Startup", &BaseStationApp::handleStartupScreen);
     
-    state_machine.registerState(AppState::ESPNOW_TEST, "ESPNow",
-        [this](uint32_t dt) { return handleESPNowTest(dt); });
+    state_machine.registerState(AppState::ESPNOW_TEST, "ESPNow", &BaseStationApp::handleESPNowTest);
     
-    state_machine.registerState(AppState::IDLE, "Idle",
-        [this](uint32_t dt) { return handleIdleState(dt); });
+    state_machine.registerState(AppState::IDLE, "Idle", &BaseStationApp::handleIdleState);
     
-    state_machine.registerState(AppState::MONITORING, "Monitoring",
-        [this](uint32_t dt) { return handleMonitoringState(dt); });
+    state_machine.registerState(AppState::MONITORING, "Monitoring", &BaseStationApp::handleMonitoringState);
     
-    state_machine.registerState(AppState::ERROR, "Error",
-        [this](uint32_t dt) { return handleErrorState(dt); });
+    state_machine.registerState(AppState::ERROR, "Error", &BaseStationApp::handleErrorState);
     
     return HAL_OK;
 }
@@ -130,15 +142,46 @@ hal_status_t BaseStationApp::onStart() {
     return HAL_OK;
 }
 
-hal_status_t BaseStationApp::onUpdate(uint32_t delta_ms) {
-    if (system_monitor) {
-        system_monitor->update(delta_ms);
+hal_status_t BaseStationApp::initTasks() {
+    using namespace Constants::Tasks;
+    
+    if (espnow_manager) {
+        scheduler.addTask({"link", TaskScheduler::periodFromHz(LINK_RATE_HZ), 0, LINK_PRIORITY, 0,
+            [this](uint32_t dt) { return updateLink(dt); }});
     }
     
+    scheduler.addTask({"control", TaskScheduler::periodFromHz(CONTROL_RATE_HZ), CONTROL_PHASE_US, CONTROL_PRIORITY, 0,
+        [this](uint32_t dt) { return state_machine.update(dt); }});
+    
+    scheduler.addTask({"display", TaskScheduler::periodFromHz(DISPLAY_RATE_HZ), DISPLAY_PHASE_US, DISPLAY_PRIORITY, 0,
+        [this](uint32_t dt) { return updateDisplay(dt); }});
+    
+    scheduler.addTask({"monitor", TaskScheduler::periodFromHz(MONITOR_RATE_HZ), MONITOR_PHASE_US, MONITOR_PRIORITY, 0,
+        [this](uint32_t dt) { return updateMonitor(dt); }});
+    
+    return HAL_OK;
+}
+
+hal_status_t BaseStationApp::onUpdate(uint32_t delta_ms) {
+    // End of pass: send everything the tasks queued as one frame
     if (espnow_manager) {
-        espnow_manager->update(delta_ms);
+        espnow_manager->flush();
+    }
+    
+    return HAL_OK;
+}
+
+hal_status_t BaseStationApp::updateLink(uint32_t delta_ms) {
+    espnow_manager->update(delta_ms);
+    
+    if (benchmark) {
+        benchmark->update();
     }
     
+    return HAL_OK;
+}
+
+hal_status_t BaseStationApp::updateDisplay(uint32_t delta_ms) {
     if (current_screen && current_screen->isActive()) {
         current_screen->onUpdate(delta_ms);
         
@@ -150,15 +193,21 @@ hal_status_t BaseStationApp::onUpdate(uint32_t delta_ms) {
         }
     }
     
-    return state_machine.update(delta_ms);
+    return HAL_OK;
+}
+
+hal_status_t BaseStationApp::updateMonitor(uint32_t delta_ms) {
+    if (system_monitor) {
+        system_monitor->update(delta_ms);
+    }
+    
+    scheduler.reportOverruns("BaseStation");
+    return HAL_OK;
 }
 
 hal_status_t BaseStationApp::onShutdown() {
     LOG_INFO("BaseStation", "Shutting down");
     
-    // Clear global instance first
-    g_base_app_instance = nullptr;
-    
     if (startup_screen) {
         delete startup_screen;
         startup_screen = nullptr;
@@ -175,11 +224,20 @@ hal_status_t BaseStationApp::onShutdown() {
     }
     
     // Proper cleanup order to avoid use-after-free
+    if (link_task) {
+        link_task->stop();
+        delete link_task;
+        link_task = nullptr;
+    }
+    
+    if (benchmark) {
+        delete benchmark;
+        benchmark = nullptr;
+    }
+    
     if (espnow_manager) {
-        // Clear callbacks first to prevent access during shutdown
-        espnow_manager->setScreenSyncCallback(nullptr);
-        espnow_manager->setButtonDataCallback(nullptr);
-        espnow_manager->setInputEventCallback(nullptr);
+        // Clear handlers first to prevent access during shutdown
+        espnow_manager->getDispatchTable().clearOwner(this);
         
         // Then shutdown and delete
         espnow_manager->shutdown();
@@ -419,15 +477,28 @@ void BaseStationApp::updateSyncDisplay() {
     lcd_display->interface->refresh(lcd_display);
 }
 
-// Static callback functions that forward to instance methods
-void BaseStationApp::staticScreenSyncCallback(const ESPNowMessage* msg) {
-    if (g_base_app_instance && msg) {
-        g_base_app_instance->handleScreenSync(msg->getScreenId());
+// ESP-NOW handlers; UI sync and commands only come from the paired handheld
+void BaseStationApp::onScreenSync(const ESPNowPayload::ScreenSync& sync, ESPNowManager::PeerId peer) {
+    if (peer == espnow_manager->getPrimaryPeer()) {
+        handleScreenSync(sync.screen_id);
+    }
+}
+
+void BaseStationApp::onButtonData(const ESPNowPayload::ButtonData& buttons, ESPNowManager::PeerId peer) {
+    if (peer == espnow_manager->getPrimaryPeer()) {
+        handleButtonData(buttons.states);
+    }
+}
+
+void BaseStationApp::onCommand(const ESPNowPayload::Command& command, ESPNowManager::PeerId peer) {
+    if (peer == espnow_manager->getPrimaryPeer()) {
+        // Delivered exactly once; forwarding to the flight controller comes later
+        LOG_INFO("BaseStation", "Command %u (arg %u) received from handheld", command.command, command.argument);
     }
 }
 
-void BaseStationApp::staticButtonDataCallback(const ESPNowMessage* msg) {
-    if (g_base_app_instance && msg && msg->type == ESPNowConfig::MSG_BUTTON_DATA) {
-        g_base_app_instance->handleButtonData(msg->data[0]);
+void BaseStationApp::onDroneTelemetry(const ESPNowMessage& msg, ESPNowManager::PeerId peer) {
+    if (peer == drone_peer) {
+        LOG_DEBUG("BaseStation", "Telemetry received from drone (peer %u)", peer);
     }
 }
\ No newline at end of file
@@ -2,7 +2,7 @@
 #define BASE_STATION_APP_H
 
 #include "../../lib/Core/AppFramework.h"
-#include "../../lib/Core/StateManager.h"
+#include "../../lib/Core/FixedStateMachine.h"
 #include "../../lib/Core/AppScreen.h"
 #include "../../lib/Business/SystemMonitor.h"
 #include "../../lib/Business/DisplayController.h"
@@ -12,6 +12,8 @@
 #include "screens/CounterScreen.h"
 #include "screens/ESPNowScreen.h"
 #include "../../lib/Communication/ESPNow/ESPNowManager.h"
+#include "../../lib/Communication/ESPNow/ESPNowLinkTask.h"
+#include "../../lib/Communication/ESPNow/ESPNowBenchmark.h"
 #include "../../lib/Communication/ESPNow/ESPNowUtils.h"
 
 class BaseStationApp : public AppFramework {
@@ -24,6 +26,7 @@ public:
         MONITORING,
         ERROR
     };
+    static constexpr uint16_t STATE_COUNT = static_cast<uint16_t>(AppState::ERROR) + 1;
     
     BaseStationApp();
     ~BaseStationApp() = default;
@@ -36,7 +39,7 @@ protected:
     hal_status_t onError(hal_status_t error) override;
     
 private:
-    StateMachine<AppState> state_machine;
+    FixedStateMachine<BaseStationApp, AppState, STATE_COUNT> state_machine;
     SystemMonitor* system_monitor;
     DisplayController* display_controller;
     display_instance_t* lcd_display;
@@ -45,6 +48,9 @@ private:
     CounterScreen* counter_screen;
     BaseStationESPNowScreen* espnow_screen;
     ESPNowManager* espnow_manager;
+    ESPNowLinkTask* link_task;
+    ESPNowBenchmark* benchmark;     // Answers the handheld's link benchmark
+    ESPNowManager::PeerId drone_peer;
     
     // Simple sync state
     uint8_t remote_screen_type;
@@ -55,6 +61,11 @@ private:
     hal_status_t initHardware();
     hal_status_t initDisplay();
     hal_status_t initStates();
+    hal_status_t initTasks();
+    
+    hal_status_t updateLink(uint32_t delta_ms);
+    hal_status_t updateDisplay(uint32_t delta_ms);
+    hal_status_t updateMonitor(uint32_t delta_ms);
     
     hal_status_t handleInitState(uint32_t delta_ms);
     hal_status_t handleStartupScreen(uint32_t delta_ms);
@@ -71,9 +82,11 @@ private:
     void handleScreenSync(uint8_t screenType);
     void handleButtonData(uint8_t buttonStates);
     
-    // Static callbacks for ESP-NOW (MISRA-C compliant)
-    static void staticScreenSyncCallback(const ESPNowMessage* msg);
-    static void staticButtonDataCallback(const ESPNowMessage* msg);
+    // ESP-NOW message handlers, bound in the manager's dispatch table
+    void onScreenSync(const ESPNowPayload::ScreenSync& sync, ESPNowManager::PeerId peer);
+    void onButtonData(const ESPNowPayload::ButtonData& buttons, ESPNowManager::PeerId peer);
+    void onCommand(const ESPNowPayload::Command& command, ESPNowManager::PeerId peer);
+    void onDroneTelemetry(const ESPNowMessage& msg, ESPNowManager::PeerId peer);
 };
 
 #endif
\ No newline at end of file
@@ -7,6 +7,9 @@ static BaseStationApp* app = nullptr;
 
 void setup() {
     Logger::init(Constants::Serial::BAUD_RATE, Constants::Serial::INIT_TIMEOUT_MS);
+    if (Constants::Logging::ASYNC_ENABLED) {
+        Logger::startAsync();
+    }
     delay(Constants::Serial::INIT_DELAY_MS);
     
     LOG_INFO("Main", "=====================================");
@@ -45,5 +48,10 @@ void loop() {
         LOG_WARNING("Main", "Slow loop detected: %u us", (unsigned)loop_time);
     }
     
-    delay(Constants::Timing::INPUT_POLL_INTERVAL_MS);
+    // Sleep until the next task is released instead of a fixed poll delay
+    if (app) {
+        app->sleepUntilNextTask();
+    } else {
+        delay(Constants::Timing::INPUT_POLL_INTERVAL_MS);
+    }
 }
\ No newline at end of file
@@ -2,10 +2,13 @@
 #include "../../../lib/Core/Logger.h"
 #include "../../../lib/HAL/Display/display_interface.h"
 #include <stdio.h>
+#include <string.h>
 
-BaseStationESPNowScreen::BaseStationESPNowScreen(ESPNowManager* manager)
+BaseStationESPNowScreen::BaseStationESPNowScreen(ESPNowManager* manager, ESPNowBenchmark* benchmark)
     : AppScreen("ESPNow")
     , espnow_manager(manager)
+    , benchmark(benchmark)
+    , last_bench_replies(0)
     , update_timer(0)
     , animation_frame(0) {
 }
@@ -133,11 +136,52 @@ void BaseStationESPNowScreen::drawStatistics(display_instance_t* display) {
     const ESPNowManager::Stats& stats = espnow_manager->getStats();
     char buffer[17]; // 16 chars + null for LCD
     
-    // Line 1: Compact stats
+    // Line 1: Cycle through the stats pages every 2 seconds
     display_point_t cursor = {0, 1};
     display->interface->set_text_cursor(display, &cursor);
-    snprintf(buffer, sizeof(buffer), "P:%u/%u L:%ums",
-             stats.ping_count, stats.pong_count, stats.latency_ms);
+    
+    uint8_t page = (animation_frame / 4) % STATS_PAGE_COUNT;
+    if (stats.rtt.count == 0) page = 0;
+    
+    // The handheld is benchmarking the link: show our replies instead
+    uint32_t bench_replies = benchmark ? benchmark->getRepliesSent() : 0;
+    if (bench_replies != last_bench_replies) page = BENCH_PAGE;
+    last_bench_replies = bench_replies;
+    
+    switch (page) {
+        case 0:
+            snprintf(buffer, sizeof(buffer), "P:%u/%u L:%ums",
+                     stats.ping_count, stats.pong_count, stats.latency_ms);
+            break;
+        case 1:
+            snprintf(buffer, sizeof(buffer), "50:%u 99:%uus",
+                     stats.rtt.p50_us, stats.rtt.p99_us);
+            break;
+        case 2:
+            snprintf(buffer, sizeof(buffer), "Mx:%u J:%uus",
+                     stats.rtt.max_us, stats.rtt.jitter_us);
+            break;
+        case 3:
+            snprintf(buffer, sizeof(buffer), "Ch:%u %ddB M:%lu",
+                     stats.channel, stats.rssi, (unsigned long)stats.channel_moves);
+            break;
+        case BENCH_PAGE:
+            snprintf(buffer, sizeof(buffer), "BENCH rpl:%lu", (unsigned long)bench_replies);
+            break;
+        default:
+            if (stats.clock_offset_valid) {
+                snprintf(buffer, sizeof(buffer), "1W:%u O:%ld",
+                         stats.one_way.p50_us, (long)stats.clock_offset_us);
+            } else {
+                snprintf(buffer, sizeof(buffer), "1W: syncing");
+            }
+            break;
+    }
+    
+    // Pad so a shorter page fully overwrites the previous one
+    size_t len = strlen(buffer);
+    while (len < sizeof(buffer) - 1) buffer[len++] = ' ';
+    buffer[len] = '\0';
     display->interface->write_text(display, buffer, 1);
 }
 
@@ -3,10 +3,11 @@
 
 #include "../../../lib/Core/AppScreen.h"
 #include "../../../lib/Communication/ESPNow/ESPNowManager.h"
+#include "../../../lib/Communication/ESPNow/ESPNowBenchmark.h"
 
 class BaseStationESPNowScreen : public AppScreen {
 public:
-    BaseStationESPNowScreen(ESPNowManager* manager);
+    BaseStationESPNowScreen(ESPNowManager* manager, ESPNowBenchmark* benchmark = nullptr);
     ~BaseStationESPNowScreen() = default;
     
     hal_status_t onInitialize() override;
@@ -15,7 +16,12 @@ public:
     void onDraw(display_instance_t* display) override;
     
 private:
+    static constexpr uint8_t STATS_PAGE_COUNT = 5;  // counters, percentiles, max/jitter, channel, one-way
+    static constexpr uint8_t BENCH_PAGE = STATS_PAGE_COUNT;  // Not cycled, shown while benchmarking
+    
     ESPNowManager* espnow_manager;
+    ESPNowBenchmark* benchmark;
+    uint32_t last_bench_replies;    // Benchmark page shows while replies keep coming
     uint32_t update_timer;
     uint32_t animation_frame;
     
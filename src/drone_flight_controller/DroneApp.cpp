@@ -1,12 +1,13 @@
 #include "DroneApp.h"
 #include "../../lib/Core/Logger.h"
+#include "../../lib/Core/BinaryLog.h"
 #include "../../lib/Core/Constants.h"
 #include "../../lib/Business/DataFormatter.h"
 #include "../../lib/SystemInfo/system_info.h"
 
 DroneApp::DroneApp()
     : AppFramework("DroneFC", HAL_BOARD_DRONE)
-    , flight_state_machine("FlightSM")
+    , flight_state_machine("FlightSM", this)
     , system_monitor(nullptr) {
     
     memset(&flight_data, 0, sizeof(flight_data));
@@ -34,7 +35,10 @@ hal_status_t DroneApp::onInitialize() {
     status = initFlightStates();
     if (status != HAL_OK) return status;
     
-    return flight_state_machine.transitionTo(FlightState::PREFLIGHT_CHECK);
+    status = initTasks();
+    if (status != HAL_OK) return status;
+    
+    return flight_state_machine.start(FlightState::PREFLIGHT_CHECK);
 }
 
 hal_status_t DroneApp::initHardware() {
@@ -45,38 +49,43 @@ hal_status_t DroneApp::initHardware() {
 }
 
 hal_status_t DroneApp::initFlightStates() {
-    flight_state_machine.registerState(FlightState::INIT, "Init",
-        [this](uint32_t dt) { return handleInitState(dt); });
-    
-    flight_state_machine.registerState(FlightState::PREFLIGHT_CHECK, "PreflightCheck",
-        [this](uint32_t dt) { return handlePreflightCheck(dt); });
-    
-    flight_state_machine.registerState(FlightState::IDLE, "Idle",
-        [this](uint32_t dt) { return handleIdleState(dt); });
-    
-    flight_state_machine.registerState(FlightState::ARMING, "Arming",
-        [this](uint32_t dt) { return handleArmingState(dt); });
-    
-    flight_state_machine.registerState(FlightState::ARMED, "Armed",
-        [this](uint32_t dt) { return handleArmedState(dt); });
-    
-    flight_state_machine.registerState(FlightState::TAKEOFF, "Takeoff",
-        [this](uint32_t dt) { return handleTakeoffState(dt); });
-    
-    flight_state_machine.registerState(FlightState::HOVER, "Hover",
-        [this](uint32_t dt) { return handleHoverState(dt); });
-    
-    flight_state_machine.registerState(FlightState::FLYING, "Flying",
-        [this](uint32_t dt) { return handleFlyingState(dt); });
-    
-    flight_state_machine.registerState(FlightState::LANDING, "Landing",
-        [this](uint32_t dt) { return handleLandingState(dt); });
-    
-    flight_state_machine.registerState(FlightState::EMERGENCY, "Emergency",
-        [this](uint32_t dt) { return handleEmergencyState(dt); });
-    
-    flight_state_machine.registerState(FlightState::ERROR, "Error",
-        [this](uint32_t dt) { return handleErrorState(dt); });
+    const FlightState TOP = FlightMachine::TOP;
+    FlightMachine& sm = flight_state_machine;
+    
+    // name, parent, enter, update, exit
+    sm.registerState(FlightState::OPERATIONAL, {"Operational", TOP, nullptr, nullptr, nullptr});
+    sm.registerState(FlightState::PREFLIGHT_CHECK, {"PreflightCheck", FlightState::OPERATIONAL,
+        &DroneApp::enterPreflightCheck, &DroneApp::handlePreflightCheck, nullptr});
+    sm.registerState(FlightState::IDLE, "Idle", FlightState::OPERATIONAL, &DroneApp::handleIdleState);
+    sm.registerState(FlightState::MOTORS_ON, {"MotorsOn", FlightState::OPERATIONAL,
+        &DroneApp::enterMotorsOn, nullptr, &DroneApp::exitMotorsOn});
+    sm.registerState(FlightState::ARMED, "Armed", FlightState::MOTORS_ON, &DroneApp::handleArmedState);
+    sm.registerState(FlightState::AIRBORNE, {"Airborne", FlightState::MOTORS_ON,
+        &DroneApp::enterAirborne, nullptr, &DroneApp::exitAirborne});
+    sm.registerState(FlightState::HOVER, {"Hover", FlightState::AIRBORNE,
+        &DroneApp::enterHover, &DroneApp::handleHoverState, nullptr});
+    sm.registerState(FlightState::FLYING, "Flying", FlightState::AIRBORNE, &DroneApp::handleFlyingState);
+    sm.registerState(FlightState::EMERGENCY, {"Emergency", TOP,
+        &DroneApp::enterEmergency, &DroneApp::handleEmergencyState, nullptr});
+    sm.registerState(FlightState::ERROR, "Error", TOP, &DroneApp::handleErrorState);
+    
+    // Rows on a superstate apply to every state inside it, so the failsafes
+    // are declared once for all flight phases
+    static const FlightMachine::Transition TRANSITIONS[] = {
+        // from, event, to, guard, action
+        {FlightState::PREFLIGHT_CHECK, FlightEvent::PREFLIGHT_PASSED,  FlightState::IDLE,          nullptr, nullptr},
+        {FlightState::PREFLIGHT_CHECK, FlightEvent::PREFLIGHT_FAILED,  FlightState::ERROR,         nullptr, nullptr},
+        {FlightState::IDLE,            FlightEvent::ARM,               FlightState::ARMED,         &DroneApp::checkSafetyConditions, nullptr},
+        {FlightState::ARMED,           FlightEvent::DISARM,            FlightState::IDLE,          nullptr, nullptr},
+        {FlightState::ARMED,           FlightEvent::ARM_TIMEOUT,       FlightState::IDLE,          nullptr, nullptr},
+        {FlightState::ARMED,           FlightEvent::TAKEOFF,           FlightState::HOVER,         nullptr, nullptr},
+        {FlightState::HOVER,           FlightEvent::HOVER_DONE,        FlightState::FLYING,        nullptr, nullptr},
+        {FlightState::AIRBORNE,        FlightEvent::LAND,              FlightState::IDLE,          nullptr, nullptr},
+        {FlightState::OPERATIONAL,     FlightEvent::EMERGENCY_STOP,    FlightState::EMERGENCY,     nullptr, nullptr},
+        {FlightState::OPERATIONAL,     FlightEvent::FAULT,             FlightState::ERROR,         nullptr, nullptr}
+    };
+    hal_status_t status = sm.setTransitions(TRANSITIONS);
+    if (status != HAL_OK) return status;
     
     LOG_INFO("DroneFC", "Flight states initialized");
     return HAL_OK;
@@ -90,22 +99,41 @@ hal_status_t DroneApp::onStart() {
     return HAL_OK;
 }
 
-hal_status_t DroneApp::onUpdate(uint32_t delta_ms) {
-    if (system_monitor) {
-        system_monitor->update(delta_ms);
-    }
+hal_status_t DroneApp::initTasks() {
+    using namespace Constants::Tasks;
     
-    updateTelemetry();
-    sendHeartbeat();
+    scheduler.addTask({"control", TaskScheduler::periodFromHz(CONTROL_RATE_HZ), 0, CONTROL_PRIORITY, 0,
+        [this](uint32_t dt) { return updateControl(dt); }});
     
-    if (flight_data.emergency_stop) {
-        emergencyStop();
-        return flight_state_machine.transitionTo(FlightState::EMERGENCY);
+    scheduler.addTask({"telemetry", TaskScheduler::periodFromHz(TELEMETRY_RATE_HZ), CONTROL_PHASE_US, CONTROL_PRIORITY, 0,
+        [this](uint32_t dt) { updateTelemetry(); return HAL_OK; }});
+    
+    scheduler.addTask({"heartbeat", Constants::Timing::HEARTBEAT_INTERVAL_MS * 1000, MONITOR_PHASE_US, MONITOR_PRIORITY, 0,
+        [this](uint32_t dt) { sendHeartbeat(); return HAL_OK; }});
+    
+    scheduler.addTask({"monitor", TaskScheduler::periodFromHz(MONITOR_RATE_HZ), MONITOR_PHASE_US, MONITOR_PRIORITY, 0,
+        [this](uint32_t dt) { return updateMonitor(dt); }});
+    
+    return HAL_OK;
+}
+
+hal_status_t DroneApp::updateControl(uint32_t delta_ms) {
+    if (flight_data.emergency_stop && flight_state_machine.isInState(FlightState::OPERATIONAL)) {
+        flight_state_machine.post(FlightEvent::EMERGENCY_STOP);
     }
     
     return flight_state_machine.update(delta_ms);
 }
 
+hal_status_t DroneApp::updateMonitor(uint32_t delta_ms) {
+    if (system_monitor) {
+        system_monitor->update(delta_ms);
+    }
+    
+    scheduler.reportOverruns("DroneFC");
+    return HAL_OK;
+}
+
 hal_status_t DroneApp::onShutdown() {
     LOG_INFO("DroneFC", "Shutting down flight controller");
     
@@ -122,7 +150,8 @@ hal_status_t DroneApp::onShutdown() {
 hal_status_t DroneApp::onError(hal_status_t error) {
     LOG_ERROR("DroneFC", "Flight controller error: %s", DataFormatter::errorToString(error));
     emergencyStop();
-    return flight_state_machine.transitionTo(FlightState::ERROR);
+    // Stays in EMERGENCY if it is there already
+    return flight_state_machine.dispatch(FlightEvent::FAULT);
 }
 
 hal_status_t DroneApp::performPreflightCheck() {
@@ -155,25 +184,16 @@ hal_status_t DroneApp::performPreflightCheck() {
     }
 }
 
-hal_status_t DroneApp::handleInitState(uint32_t delta_ms) {
-    return flight_state_machine.transitionTo(FlightState::PREFLIGHT_CHECK);
+hal_status_t DroneApp::enterPreflightCheck(uint32_t delta_ms) {
+    LOG_INFO("DroneFC", "Starting preflight checks");
+    return HAL_OK;
 }
 
 hal_status_t DroneApp::handlePreflightCheck(uint32_t delta_ms) {
-    static uint32_t check_start_time = 0;
-    
-    if (check_start_time == 0) {
-        check_start_time = millis();
-        LOG_INFO("DroneFC", "Starting preflight checks");
-    }
-    
-    if (millis() - check_start_time > 2000) {
+    if (flight_state_machine.getStateTime() > 2000) {
         hal_status_t status = performPreflightCheck();
-        if (status == HAL_OK) {
-            return flight_state_machine.transitionTo(FlightState::IDLE);
-        } else {
-            return flight_state_machine.transitionTo(FlightState::ERROR);
-        }
+        return flight_state_machine.post(status == HAL_OK ? FlightEvent::PREFLIGHT_PASSED
+                                                          : FlightEvent::PREFLIGHT_FAILED);
     }
     
     return HAL_OK;
@@ -183,62 +203,64 @@ hal_status_t DroneApp::handleIdleState(uint32_t delta_ms) {
     static uint32_t last_status = 0;
     
     if (millis() - last_status > 5000) {
-        LOG_INFO("DroneFC", "System idle - Ready for arming");
+        LOG_BIN(DRONE_IDLE);
         last_status = millis();
     }
     
     return HAL_OK;
 }
 
-hal_status_t DroneApp::handleArmingState(uint32_t delta_ms) {
-    LOG_INFO("DroneFC", "Arming motors...");
-    
-    if (!checkSafetyConditions()) {
-        LOG_ERROR("DroneFC", "Safety check failed - cannot arm");
-        return flight_state_machine.transitionTo(FlightState::IDLE);
-    }
-    
+hal_status_t DroneApp::enterMotorsOn(uint32_t delta_ms) {
     flight_data.motors_armed = true;
     flight_data.arm_time = millis();
     
-    LOG_INFO("DroneFC", "Motors ARMED");
-    return flight_state_machine.transitionTo(FlightState::ARMED);
+    LOG_BIN(DRONE_MOTORS_ARMED);
+    return HAL_OK;
+}
+
+hal_status_t DroneApp::exitMotorsOn(uint32_t delta_ms) {
+    flight_data.motors_armed = false;
+    
+    LOG_BIN(DRONE_MOTORS_DISARMED);
+    return HAL_OK;
 }
 
 hal_status_t DroneApp::handleArmedState(uint32_t delta_ms) {
     static uint32_t last_status = 0;
     
     if (millis() - last_status > 2000) {
-        LOG_INFO("DroneFC", "Armed - Ready for takeoff");
+        LOG_BIN(DRONE_ARMED_READY);
         last_status = millis();
     }
     
-    if (millis() - flight_data.arm_time > 30000) {
-        LOG_WARNING("DroneFC", "Auto-disarm after 30s idle");
-        flight_data.motors_armed = false;
-        return flight_state_machine.transitionTo(FlightState::IDLE);
+    if (flight_state_machine.getStateTime() > 30000) {
+        LOG_BIN(DRONE_AUTO_DISARM);
+        return flight_state_machine.post(FlightEvent::ARM_TIMEOUT);
     }
     
     return HAL_OK;
 }
 
-hal_status_t DroneApp::handleTakeoffState(uint32_t delta_ms) {
-    LOG_INFO("DroneFC", "Taking off...");
+hal_status_t DroneApp::enterAirborne(uint32_t delta_ms) {
+    LOG_BIN(DRONE_TAKEOFF);
     flight_data.flight_time = millis();
-    
-    return flight_state_machine.transitionTo(FlightState::HOVER);
+    return HAL_OK;
+}
+
+hal_status_t DroneApp::exitAirborne(uint32_t delta_ms) {
+    uint32_t total_flight_time = (millis() - flight_data.flight_time) / 1000;
+    LOG_BIN(DRONE_LANDED, total_flight_time);
+    return HAL_OK;
+}
+
+hal_status_t DroneApp::enterHover(uint32_t delta_ms) {
+    LOG_BIN(DRONE_HOVER);
+    return HAL_OK;
 }
 
 hal_status_t DroneApp::handleHoverState(uint32_t delta_ms) {
-    static uint32_t hover_start = 0;
-    
-    if (hover_start == 0) {
-        hover_start = millis();
-        LOG_INFO("DroneFC", "Hovering");
-    }
-    
-    if (millis() - hover_start > 5000) {
-        return flight_state_machine.transitionTo(FlightState::FLYING);
+    if (flight_state_machine.getStateTime() > 5000) {
+        return flight_state_machine.post(FlightEvent::HOVER_DONE);
     }
     
     return HAL_OK;
@@ -249,33 +271,21 @@ hal_status_t DroneApp::handleFlyingState(uint32_t delta_ms) {
     
     if (millis() - last_telemetry > 1000) {
         uint32_t flight_duration = (millis() - flight_data.flight_time) / 1000;
-        LOG_INFO("DroneFC", "Flying - Duration: %lus", flight_duration);
+        LOG_BIN(DRONE_FLYING, flight_duration);
         last_telemetry = millis();
     }
     
     return HAL_OK;
 }
 
-hal_status_t DroneApp::handleLandingState(uint32_t delta_ms) {
-    LOG_INFO("DroneFC", "Landing...");
-    
-    flight_data.motors_armed = false;
-    
-    uint32_t total_flight_time = (millis() - flight_data.flight_time) / 1000;
-    LOG_INFO("DroneFC", "Landed - Total flight time: %lus", total_flight_time);
-    
-    return flight_state_machine.transitionTo(FlightState::IDLE);
+hal_status_t DroneApp::enterEmergency(uint32_t delta_ms) {
+    LOG_CRITICAL("DroneFC", "EMERGENCY STOP ACTIVATED");
+    emergencyStop();
+    flight_state_machine.logTrace();
+    return HAL_OK;
 }
 
 hal_status_t DroneApp::handleEmergencyState(uint32_t delta_ms) {
-    static bool emergency_logged = false;
-    
-    if (!emergency_logged) {
-        LOG_CRITICAL("DroneFC", "EMERGENCY STOP ACTIVATED");
-        emergencyStop();
-        emergency_logged = true;
-    }
-    
     digitalWrite(LED_BUILTIN, (millis() / 100) % 2);
     
     return HAL_OK;
@@ -285,7 +295,7 @@ hal_status_t DroneApp::handleErrorState(uint32_t delta_ms) {
     static uint32_t last_error_log = 0;
     
     if (millis() - last_error_log > 5000) {
-        LOG_ERROR("DroneFC", "System in ERROR state");
+        LOG_BIN(DRONE_ERROR_STATE);
         last_error_log = millis();
     }
     
@@ -295,30 +305,16 @@ hal_status_t DroneApp::handleErrorState(uint32_t delta_ms) {
 }
 
 void DroneApp::updateTelemetry() {
-    static uint32_t last_telemetry_update = 0;
-    
-    if (millis() - last_telemetry_update < 100) {
-        return;
-    }
-    
     flight_data.battery_voltage = 3.7f + (random(0, 20) - 10) * 0.01f;
     flight_data.signal_strength = 80 + random(0, 20);
-    
-    last_telemetry_update = millis();
 }
 
 void DroneApp::sendHeartbeat() {
-    static uint32_t last_heartbeat = 0;
-    
-    if (millis() - last_heartbeat > Constants::Timing::HEARTBEAT_INTERVAL_MS) {
-        LOG_DEBUG("DroneFC", "Heartbeat - State: %s, Armed: %s",
-                  flight_state_machine.getCurrentStateName(),
-                  flight_data.motors_armed ? "YES" : "NO");
-        last_heartbeat = millis();
-    }
+    LOG_BIN(DRONE_HEARTBEAT, flight_state_machine.getCurrentStateName(),
+            flight_data.motors_armed ? "YES" : "NO");
 }
 
-bool DroneApp::checkSafetyConditions() {
+bool DroneApp::checkSafetyConditions() const {
     bool safe = true;
     
     if (flight_data.battery_voltage < 3.0f) {
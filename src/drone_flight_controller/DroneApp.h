@@ -2,24 +2,40 @@
 #define DRONE_APP_H
 
 #include "../../lib/Core/AppFramework.h"
-#include "../../lib/Core/StateManager.h"
+#include "../../lib/Core/HierarchicalStateMachine.h"
 #include "../../lib/Business/SystemMonitor.h"
 
 class DroneApp : public AppFramework {
 public:
     enum class FlightState : uint16_t {
-        INIT = 0,
+        INIT = 0,           // Before the machine starts
+        OPERATIONAL,        // Superstate: everything but EMERGENCY and ERROR
         PREFLIGHT_CHECK,
         IDLE,
-        ARMING,
+        MOTORS_ON,          // Superstate: motors armed
         ARMED,
-        TAKEOFF,
+        AIRBORNE,           // Superstate, inside MOTORS_ON
         HOVER,
         FLYING,
-        LANDING,
         EMERGENCY,
         ERROR
     };
+    static constexpr uint16_t STATE_COUNT = static_cast<uint16_t>(FlightState::ERROR) + 1;
+    
+    enum class FlightEvent : uint8_t {
+        PREFLIGHT_PASSED,
+        PREFLIGHT_FAILED,
+        ARM,
+        DISARM,
+        ARM_TIMEOUT,
+        TAKEOFF,
+        HOVER_DONE,
+        LAND,
+        EMERGENCY_STOP,
+        FAULT
+    };
+    
+    using FlightMachine = HierarchicalStateMachine<DroneApp, FlightState, FlightEvent, STATE_COUNT>;
     
     DroneApp();
     ~DroneApp() = default;
@@ -27,12 +43,11 @@ public:
 protected:
     hal_status_t onInitialize() override;
     hal_status_t onStart() override;
-    hal_status_t onUpdate(uint32_t delta_ms) override;
     hal_status_t onShutdown() override;
     hal_status_t onError(hal_status_t error) override;
     
 private:
-    StateMachine<FlightState> flight_state_machine;
+    FlightMachine flight_state_machine;
     SystemMonitor* system_monitor;
     
     struct FlightData {
@@ -46,23 +61,29 @@ private:
     
     hal_status_t initHardware();
     hal_status_t initFlightStates();
+    hal_status_t initTasks();
     hal_status_t performPreflightCheck();
     
-    hal_status_t handleInitState(uint32_t delta_ms);
+    hal_status_t enterPreflightCheck(uint32_t delta_ms);
     hal_status_t handlePreflightCheck(uint32_t delta_ms);
     hal_status_t handleIdleState(uint32_t delta_ms);
-    hal_status_t handleArmingState(uint32_t delta_ms);
+    hal_status_t enterMotorsOn(uint32_t delta_ms);
+    hal_status_t exitMotorsOn(uint32_t delta_ms);
     hal_status_t handleArmedState(uint32_t delta_ms);
-    hal_status_t handleTakeoffState(uint32_t delta_ms);
+    hal_status_t enterAirborne(uint32_t delta_ms);
+    hal_status_t exitAirborne(uint32_t delta_ms);
+    hal_status_t enterHover(uint32_t delta_ms);
     hal_status_t handleHoverState(uint32_t delta_ms);
     hal_status_t handleFlyingState(uint32_t delta_ms);
-    hal_status_t handleLandingState(uint32_t delta_ms);
+    hal_status_t enterEmergency(uint32_t delta_ms);
     hal_status_t handleEmergencyState(uint32_t delta_ms);
     hal_status_t handleErrorState(uint32_t delta_ms);
     
+    hal_status_t updateControl(uint32_t delta_ms);
+    hal_status_t updateMonitor(uint32_t delta_ms);
     void updateTelemetry();
     void sendHeartbeat();
-    bool checkSafetyConditions();
+    bool checkSafetyConditions() const;
     void emergencyStop();
 };
 
@@ -8,7 +8,7 @@
 
 HandheldApp::HandheldApp()
     : AppFramework("Handheld", HAL_BOARD_HANDHELD)
-    , state_machine("HandheldSM")
+    , state_machine("HandheldSM", this)
     , system_monitor(nullptr)
     , input_handler(nullptr)
     , startup_screen(nullptr)
@@ -18,6 +18,9 @@ HandheldApp::HandheldApp()
     , settings_screen(nullptr)
     , espnow_screen(nullptr)
     , espnow_manager(nullptr)
+    , link_task(nullptr)
+    , benchmark(nullptr)
+    , commanded_mode(HandheldFlightControlScreen::FlightMode::DISARMED)
     , current_screen(nullptr)
     , hardware({nullptr, nullptr}) {
 }
@@ -46,6 +49,9 @@ hal_status_t HandheldApp::onInitialize() {
     status = initStates();
     if (status != HAL_OK) return status;
     
+    status = initTasks();
+    if (status != HAL_OK) return status;
+    
     return state_machine.transitionTo(AppState::STARTUP_SCREEN);
 }
 
@@ -98,7 +104,7 @@ hal_status_t HandheldApp::initScreens() {
     if (status != HAL_OK) return status;
     
     if (espnow_manager) {
-        espnow_screen = new HandheldESPNowScreen(espnow_manager);
+        espnow_screen = new HandheldESPNowScreen(espnow_manager, benchmark);
         if (espnow_screen) {
             espnow_screen->onInitialize();
         }
@@ -126,29 +132,21 @@ hal_status_t HandheldApp::initInput() {
 }
 
 hal_status_t HandheldApp::initStates() {
-    state_machine.registerState(AppState::INIT, "Init",
-        [this](uint32_t dt) { return handleInitState(dt); });
+    state_machine.registerState(AppState::INIT, "Init", &HandheldApp::handleInitState);
     
-    state_machine.registerState(AppState::STARTUP_SCREEN, "Startup",
-        [this](uint32_t dt) { return handleStartupScreen(dt); });
+    state_machine.registerState(AppState::STARTUP_SCREEN, "Startup", &HandheldApp::handleStartupScreen);
     
-    state_machine.registerState(AppState::ESPNOW_TEST, "ESPNow",
-        [this](uint32_t dt) { return handleESPNowTest(dt); });
+    state_machine.registerState(AppState::ESPNOW_TEST, "ESPNow", &HandheldApp::handleESPNowTest);
     
-    state_machine.registerState(AppState::BUTTON_TEST, "ButtonTest",
-        [this](uint32_t dt) { return handleButtonTest(dt); });
+    state_machine.registerState(AppState::BUTTON_TEST, "ButtonTest", &HandheldApp::handleButtonTest);
     
-    state_machine.registerState(AppState::MENU, "Menu",
-        [this](uint32_t dt) { return handleMenuState(dt); });
+    state_machine.registerState(AppState::MENU, "Menu", &HandheldApp::handleMenuState);
     
-    state_machine.registerState(AppState::FLIGHT_CONTROL, "FlightControl",
-        [this](uint32_t dt) { return handleFlightControl(dt); });
+    state_machine.registerState(AppState::FLIGHT_CONTROL, "FlightControl", &HandheldApp::handleFlightControl);
     
-    state_machine.registerState(AppState::SETTINGS, "Settings",
-        [this](uint32_t dt) { return handleSettings(dt); });
+    state_machine.registerState(AppState::SETTINGS, "Settings", &HandheldApp::handleSettings);
     
-    state_machine.registerState(AppState::ERROR, "Error",
-        [this](uint32_t dt) { return handleErrorState(dt); });
+    state_machine.registerState(AppState::ERROR, "Error", &HandheldApp::handleErrorState);
     
     return HAL_OK;
 }
@@ -159,21 +157,58 @@ hal_status_t HandheldApp::onStart() {
     return HAL_OK;
 }
 
-hal_status_t HandheldApp::onUpdate(uint32_t delta_ms) {
-    if (system_monitor) {
-        system_monitor->update(delta_ms);
+hal_status_t HandheldApp::initTasks() {
+    using namespace Constants::Tasks;
+    
+    if (espnow_manager) {
+        scheduler.addTask({"link", TaskScheduler::periodFromHz(LINK_RATE_HZ), 0, LINK_PRIORITY, 0,
+            [this](uint32_t dt) { return updateLink(dt); }});
     }
     
+    scheduler.addTask({"input", TaskScheduler::periodFromHz(INPUT_RATE_HZ), 0, INPUT_PRIORITY, 0,
+        [this](uint32_t dt) { return updateInput(dt); }});
+    
+    scheduler.addTask({"control", TaskScheduler::periodFromHz(CONTROL_RATE_HZ), CONTROL_PHASE_US, CONTROL_PRIORITY, 0,
+        [this](uint32_t dt) { return updateControl(dt); }});
+    
+    scheduler.addTask({"display", TaskScheduler::periodFromHz(DISPLAY_RATE_HZ), DISPLAY_PHASE_US, DISPLAY_PRIORITY, 0,
+        [this](uint32_t dt) { return updateDisplay(dt); }});
+    
+    scheduler.addTask({"monitor", TaskScheduler::periodFromHz(MONITOR_RATE_HZ), MONITOR_PHASE_US, MONITOR_PRIORITY, 0,
+        [this](uint32_t dt) { return updateMonitor(dt); }});
+    
+    return HAL_OK;
+}
+
+hal_status_t HandheldApp::onUpdate(uint32_t delta_ms) {
+    // End of pass: send everything the tasks queued as one frame
     if (espnow_manager) {
-        espnow_manager->update(delta_ms);
+        espnow_manager->flush();
+    }
+    
+    return HAL_OK;
+}
+
+hal_status_t HandheldApp::updateLink(uint32_t delta_ms) {
+    espnow_manager->update(delta_ms);
+    
+    if (benchmark) {
+        benchmark->update();
     }
     
+    return HAL_OK;
+}
+
+hal_status_t HandheldApp::updateInput(uint32_t delta_ms) {
     if (input_handler) {
         input_handler->update(delta_ms);
     }
     
     handleScreenInput();
-    
+    return HAL_OK;
+}
+
+hal_status_t HandheldApp::updateControl(uint32_t delta_ms) {
     // Periodically check for screen sync (catches connection events)
     if (current_screen) {
         uint8_t screenType = 0; // NONE
@@ -187,6 +222,10 @@ hal_status_t HandheldApp::onUpdate(uint32_t delta_ms) {
         sendScreenSync(screenType);  // Will only send if needed
     }
     
+    return state_machine.update(delta_ms);
+}
+
+hal_status_t HandheldApp::updateDisplay(uint32_t delta_ms) {
     if (current_screen && current_screen->isActive()) {
         current_screen->onUpdate(delta_ms);
         
@@ -197,7 +236,16 @@ hal_status_t HandheldApp::onUpdate(uint32_t delta_ms) {
         }
     }
     
-    return state_machine.update(delta_ms);
+    return HAL_OK;
+}
+
+hal_status_t HandheldApp::updateMonitor(uint32_t delta_ms) {
+    if (system_monitor) {
+        system_monitor->update(delta_ms);
+    }
+    
+    scheduler.reportOverruns("Handheld");
+    return HAL_OK;
 }
 
 hal_status_t HandheldApp::onShutdown() {
@@ -212,6 +260,13 @@ hal_status_t HandheldApp::onShutdown() {
     
     // No managers to delete
     
+    if (link_task) {
+        link_task->stop();
+        delete link_task;
+    }
+    
+    delete benchmark;
+    
     if (espnow_manager) {
         espnow_manager->shutdown();
         delete espnow_manager;
@@ -286,13 +341,66 @@ hal_status_t HandheldApp::handleFlightControl(uint32_t delta_ms) {
         switchToScreen(flight_screen);
     }
     
+    if (espnow_manager) {
+        updateRcChannels();
+        if (!espnow_manager->isRcStreaming() && espnow_manager->isPaired()) {
+            espnow_manager->startRcStream();
+        }
+        syncFlightMode();
+    }
+    
     if (input_handler && input_handler->isPressed(7)) {
+        if (espnow_manager) {
+            espnow_manager->stopRcStream();
+            // The screen comes back disarmed, so the vehicle must be too
+            if (commanded_mode != HandheldFlightControlScreen::FlightMode::DISARMED &&
+                espnow_manager->sendCommand(ESPNowConfig::CMD_DISARM) == HAL_OK) {
+                commanded_mode = HandheldFlightControlScreen::FlightMode::DISARMED;
+            }
+        }
         return state_machine.transitionTo(AppState::MENU);
     }
     
     return HAL_OK;
 }
 
+void HandheldApp::syncFlightMode() {
+    if (!flight_screen || !espnow_manager->isPaired()) return;
+    
+    HandheldFlightControlScreen::FlightMode mode = flight_screen->getMode();
+    if (mode == commanded_mode) return;
+    
+    // Arm, disarm and mode changes go on the reliable lane; if it is full, retry next tick
+    hal_status_t status;
+    switch (mode) {
+        case HandheldFlightControlScreen::FlightMode::DISARMED:
+            status = espnow_manager->sendCommand(ESPNowConfig::CMD_DISARM);
+            break;
+        case HandheldFlightControlScreen::FlightMode::ARMED:
+            status = espnow_manager->sendCommand(ESPNowConfig::CMD_ARM);
+            break;
+        default:
+            status = espnow_manager->sendCommand(ESPNowConfig::CMD_SET_MODE, static_cast<uint8_t>(mode));
+            break;
+    }
+    
+    if (status == HAL_OK) {
+        commanded_mode = mode;
+    }
+}
+
+void HandheldApp::updateRcChannels() {
+    if (!input_handler) return;
+    
+    // Until analog sticks are fitted, each button drives one channel low/high
+    uint16_t channels[8];
+    for (uint8_t i = 0; i < 8; i++) {
+        uint16_t us = input_handler->isPressed(i) ? ESPNowMessage::RC_MAX_US : ESPNowMessage::RC_MIN_US;
+        channels[i] = ESPNowMessage::rcValueFromMicros(us, ESPNowGlobalConfig::RC_CHANNEL_BITS);
+    }
+    espnow_manager->setRcChannels(channels, 8);
+}
+
 hal_status_t HandheldApp::handleSettings(uint32_t delta_ms) {
     if (current_screen != settings_screen) {
         switchToScreen(settings_screen);
@@ -386,6 +494,18 @@ hal_status_t HandheldApp::initESPNow() {
         return status;
     }
     
+    // Bound before the link task starts; started from the ESP-NOW screen
+    benchmark = new ESPNowBenchmark(*espnow_manager);
+    
+    // Always on here: RC frames are sent from the link task as the stream's
+    // timer releases them, not when the loop gets round to update()
+    link_task = new ESPNowLinkTask(*espnow_manager);
+    if (link_task->start() != HAL_OK) {
+        LOG_WARNING("Handheld", "Link task failed, updating ESP-NOW and RC frames from the main loop");
+        delete link_task;
+        link_task = nullptr;
+    }
+    
     LOG_INFO("Handheld", "ESP-NOW initialized");
     return HAL_OK;
 }
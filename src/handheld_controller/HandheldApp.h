@@ -2,7 +2,7 @@
 #define HANDHELD_APP_H
 
 #include "../../lib/Core/AppFramework.h"
-#include "../../lib/Core/StateManager.h"
+#include "../../lib/Core/FixedStateMachine.h"
 #include "../../lib/Core/AppScreen.h"
 #include "../../lib/Business/SystemMonitor.h"
 #include "../../lib/Business/DisplayController.h"
@@ -15,6 +15,8 @@
 #include "screens/SettingsScreen.h"
 #include "screens/ESPNowScreen.h"
 #include "../../lib/Communication/ESPNow/ESPNowManager.h"
+#include "../../lib/Communication/ESPNow/ESPNowLinkTask.h"
+#include "../../lib/Communication/ESPNow/ESPNowBenchmark.h"
 #include "../../lib/Communication/ESPNow/ESPNowUtils.h"
 // Simple screen sync - no complex managers
 
@@ -30,6 +32,7 @@ public:
         SETTINGS,
         ERROR
     };
+    static constexpr uint16_t STATE_COUNT = static_cast<uint16_t>(AppState::ERROR) + 1;
     
     HandheldApp();
     ~HandheldApp() = default;
@@ -42,7 +45,7 @@ protected:
     hal_status_t onError(hal_status_t error) override;
     
 private:
-    StateMachine<AppState> state_machine;
+    FixedStateMachine<HandheldApp, AppState, STATE_COUNT> state_machine;
     SystemMonitor* system_monitor;
     InputHandler* input_handler;
     
@@ -53,9 +56,14 @@ private:
     HandheldSettingsScreen* settings_screen;
     HandheldESPNowScreen* espnow_screen;
     ESPNowManager* espnow_manager;
+    ESPNowLinkTask* link_task;
+    ESPNowBenchmark* benchmark;
     // Simple sync
     void sendScreenSync(uint8_t screenType);
     void sendButtonData(uint8_t buttonStates);
+    void updateRcChannels();
+    void syncFlightMode();
+    HandheldFlightControlScreen::FlightMode commanded_mode;
     AppScreen* current_screen;
     
     handheld_hardware_t hardware;
@@ -66,6 +74,13 @@ private:
     hal_status_t initStates();
     hal_status_t initScreens();
     hal_status_t initESPNow();
+    hal_status_t initTasks();
+    
+    hal_status_t updateLink(uint32_t delta_ms);
+    hal_status_t updateInput(uint32_t delta_ms);
+    hal_status_t updateControl(uint32_t delta_ms);
+    hal_status_t updateDisplay(uint32_t delta_ms);
+    hal_status_t updateMonitor(uint32_t delta_ms);
     
     void switchToScreen(AppScreen* screen);
     void handleScreenInput();
@@ -3,9 +3,10 @@
 #include "../../../lib/Business/DisplayController.h"
 #include <stdio.h>
 
-HandheldESPNowScreen::HandheldESPNowScreen(ESPNowManager* manager)
+HandheldESPNowScreen::HandheldESPNowScreen(ESPNowManager* manager, ESPNowBenchmark* benchmark)
     : AppScreen("ESPNow")
     , espnow_manager(manager)
+    , benchmark(benchmark)
     , update_timer(0)
     , animation_frame(0) {
 }
@@ -81,12 +82,27 @@ void HandheldESPNowScreen::onDraw(display_instance_t* display) {
         char hint[64];
         if (state == ESPNowManager::State::UNINITIALIZED) {
             snprintf(hint, sizeof(hint), "[2] Connect");
+        } else if (state == ESPNowManager::State::PAIRED && benchmark && benchmark->isRunning()) {
+            snprintf(hint, sizeof(hint), "Bench %u/%u", 
+                     benchmark->getCurrentStep() + 1, benchmark->getStepCount());
+            DisplayController::drawCenteredText(display, 40, hint, 1);
+            snprintf(hint, sizeof(hint), "[4] Stop bench");
         } else if (state == ESPNowManager::State::PAIRED) {
-            const ESPNowManager::Stats& stats = espnow_manager->getStats();
-            snprintf(hint, sizeof(hint), "P:%u L:%ums", 
-                     stats.ping_count + stats.pong_count, stats.latency_ms);
+            // Alternate with the last benchmark step once there is one
+            uint8_t results = benchmark ? benchmark->getResultCount() : 0;
+            if (results > 0 && (animation_frame / 4) % 2) {
+                const ESPNowBenchmark::Result& last = benchmark->getResult(results - 1);
+                snprintf(hint, sizeof(hint), "%uB %uHz %d%% %ums", 
+                         last.payload_size, last.rate_hz, (int)(last.loss_pct + 0.5f),
+                         (unsigned)((last.rtt.p50_us + 500) / 1000));
+            } else {
+                const ESPNowManager::Stats& stats = espnow_manager->getStats();
+                snprintf(hint, sizeof(hint), "P:%u L:%ums Loss:%d%%", 
+                         stats.ping_count + stats.pong_count, stats.latency_ms,
+                         (int)(espnow_manager->getPacketLossRate1s() + 0.5f));
+            }
             DisplayController::drawCenteredText(display, 40, hint, 1);
-            snprintf(hint, sizeof(hint), "[3] Disconnect");
+            snprintf(hint, sizeof(hint), benchmark ? "[3] Disc [4] Bench" : "[3] Disconnect");
         } else if (state == ESPNowManager::State::SEARCHING || 
                    state == ESPNowManager::State::PAIRING ||
                    state == ESPNowManager::State::RECONNECTING) {
@@ -156,6 +172,18 @@ void HandheldESPNowScreen::onButtonPress(uint8_t button_id) {
             }
             break;
             
+        case 4:  // Button 4 - Start/stop the link benchmark (CSV on serial)
+            if (benchmark && benchmark->isRunning()) {
+                LOG_INFO("ESPNowScreen", "User stopped the benchmark");
+                benchmark->stop();
+                requestRedraw();
+            } else if (benchmark && state == ESPNowManager::State::PAIRED) {
+                LOG_INFO("ESPNowScreen", "User started the benchmark");
+                benchmark->start();
+                requestRedraw();
+            }
+            break;
+            
         case 7:  // Button 7 - Back (handled by HandheldApp)
             // Do nothing here, let the app handle navigation
             break;
@@ -3,10 +3,11 @@
 
 #include "../../../lib/Core/AppScreen.h"
 #include "../../../lib/Communication/ESPNow/ESPNowManager.h"
+#include "../../../lib/Communication/ESPNow/ESPNowBenchmark.h"
 
 class HandheldESPNowScreen : public AppScreen {
 public:
-    HandheldESPNowScreen(ESPNowManager* manager);
+    HandheldESPNowScreen(ESPNowManager* manager, ESPNowBenchmark* benchmark = nullptr);
     ~HandheldESPNowScreen() = default;
     
     hal_status_t onInitialize() override;
@@ -17,6 +18,7 @@ public:
     
 private:
     ESPNowManager* espnow_manager;
+    ESPNowBenchmark* benchmark;
     uint32_t update_timer;
     uint32_t animation_frame;
     
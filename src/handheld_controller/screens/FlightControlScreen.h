@@ -5,6 +5,14 @@
 
 class HandheldFlightControlScreen : public AppScreen {
 public:
+    enum class FlightMode : uint8_t {
+        DISARMED,
+        ARMED,
+        MANUAL,
+        STABILIZE,
+        AUTO
+    };
+    
     HandheldFlightControlScreen();
     
     void onEnter() override;
@@ -12,15 +20,9 @@ public:
     void onButtonPress(uint8_t button_id) override;
     void onUpdate(uint32_t delta_ms) override;
     
-private:
-    enum class FlightMode {
-        DISARMED,
-        ARMED,
-        MANUAL,
-        STABILIZE,
-        AUTO
-    };
+    FlightMode getMode() const { return current_mode; }
     
+private:
     FlightMode current_mode;
     uint32_t armed_time;
     bool connection_active;
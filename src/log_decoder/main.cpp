@@ -0,0 +1,42 @@
+// Host tool: turns a captured serial log with binary log frames (firmware
+// built with Constants::Logging::BINARY_SERIAL_OUTPUT, or switched over with
+// Logger::setBinaryOutput()) back into text.
+// Built from the same LogMessages.def as the firmware, so use the decoder
+// from the revision the firmware was built from.
+//
+//   pio run -e log_decoder
+//   .pio/build/log_decoder/program capture.bin > capture.txt
+//
+// Reads standard input without a file argument; text lines pass through.
+#include "../../lib/Core/BinaryLog.h"
+
+static void printLine(const char* line, void* context) {
+    (void)context;
+    puts(line);
+}
+
+int main(int argc, char** argv) {
+    FILE* input = stdin;
+    if (argc > 1) {
+        input = fopen(argv[1], "rb");
+        if (!input) {
+            fprintf(stderr, "Cannot open %s\n", argv[1]);
+            return 1;
+        }
+    }
+
+    BinaryLog::StreamDecoder decoder(printLine, nullptr);
+    uint8_t buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), input)) > 0) {
+        decoder.feed(buffer, length);
+    }
+    decoder.finish();
+
+    if (input != stdin) {
+        fclose(input);
+    }
+    fprintf(stderr, "%u frames decoded, %u bad\n",
+            (unsigned)decoder.getFrameCount(), (unsigned)decoder.getBadFrameCount());
+    return 0;
+}
@@ -0,0 +1,175 @@
+// LOG_BIN frames through BinaryLog::StreamDecoder: decoded lines match what
+// text output prints for the same records, text lines in between pass
+// through, and corrupt or cut-off frames cost only themselves.
+#include <unity.h>
+#include "../../lib/Core/Platform.h"
+#include "../../lib/Core/Logger.h"
+#include "../../lib/Core/BinaryLog.h"
+
+struct Capture {
+    uint8_t data[4096];
+    size_t length;
+
+    static void onWrite(const uint8_t* bytes, size_t count, void* context) {
+        Capture* capture = static_cast<Capture*>(context);
+        size_t room = sizeof(capture->data) - capture->length;
+        if (count > room) count = room;
+        memcpy(capture->data + capture->length, bytes, count);
+        capture->length += count;
+    }
+};
+
+struct Lines {
+    static const uint8_t MAX_LINES = 16;
+    char text[MAX_LINES][Constants::Logging::MAX_LINE_LENGTH];
+    uint8_t count;
+
+    static void onLine(const char* line, void* context) {
+        Lines* lines = static_cast<Lines*>(context);
+        if (lines->count < MAX_LINES) {
+            strncpy(lines->text[lines->count], line, sizeof(lines->text[0]) - 1);
+            lines->text[lines->count][sizeof(lines->text[0]) - 1] = '\0';
+            lines->count++;
+        }
+    }
+};
+
+static Capture capture;
+static Lines expected;
+
+// Runs the logging calls with Serial captured
+template<typename Calls>
+static void record(bool binary, Calls calls) {
+    capture.length = 0;
+    Logger::setBinaryOutput(binary);
+    Serial.setCapture(&Capture::onWrite, &capture);
+    calls();
+    Serial.setCapture(nullptr, nullptr);
+    Logger::setBinaryOutput(false);
+}
+
+// In chunks of 1 to 7 bytes, so frames and lines straddle feed() calls
+static void decode(const uint8_t* data, size_t length, BinaryLog::StreamDecoder& decoder) {
+    size_t chunk = 1;
+    for (size_t i = 0; i < length; i += chunk, chunk = chunk % 7 + 1) {
+        decoder.feed(data + i, (length - i < chunk) ? length - i : chunk);
+    }
+    decoder.finish();
+}
+
+static void logRecords() {
+    LOG_BIN(DRONE_LANDED, static_cast<uint32_t>(42));
+    LOG_BIN(DRONE_HEARTBEAT, "FLYING", "yes");
+    LOG_BIN(DRONE_FLYING, static_cast<uint32_t>(4000000000u));
+}
+
+static size_t frameLength(const uint8_t* frame) {
+    return frame[2] + BinaryLog::FRAME_OVERHEAD;
+}
+
+void setUp(void) {
+    Logger::init();
+    Logger::setLevel(LogLevel::LOG_LEVEL_DEBUG);
+
+    // What text output prints for the three records
+    memset(&expected, 0, sizeof(expected));
+    record(false, logRecords);
+    BinaryLog::StreamDecoder decoder(&Lines::onLine, &expected);
+    decode(capture.data, capture.length, decoder);
+}
+
+void tearDown(void) {
+}
+
+void test_frames_decode_to_the_text_lines(void) {
+    TEST_ASSERT_EQUAL_UINT8(3, expected.count);
+    TEST_ASSERT_NOT_NULL(strstr(expected.text[0], "Landed - Total flight time: 42s"));
+    TEST_ASSERT_NOT_NULL(strstr(expected.text[1], "Heartbeat - State: FLYING, Armed: yes"));
+    TEST_ASSERT_NOT_NULL(strstr(expected.text[2], "Flying - Duration: 4000000000s"));
+    size_t text_bytes = capture.length;
+
+    record(true, logRecords);
+    size_t frame_bytes = capture.length;
+    printf("3 records: %u bytes as text, %u as frames\n", static_cast<unsigned>(text_bytes),
+           static_cast<unsigned>(frame_bytes));
+    TEST_ASSERT_LESS_THAN(text_bytes / 2, frame_bytes);
+
+    record(true, []() {
+        LOG_INFO("Test", "Text before");
+        logRecords();
+        LOG_WARNING("Test", "Text after, %d", 7);
+    });
+    Lines lines = {};
+    BinaryLog::StreamDecoder decoder(&Lines::onLine, &lines);
+    decode(capture.data, capture.length, decoder);
+
+    TEST_ASSERT_EQUAL_UINT32(3, decoder.getFrameCount());
+    TEST_ASSERT_EQUAL_UINT32(0, decoder.getBadFrameCount());
+    TEST_ASSERT_EQUAL_UINT8(5, lines.count);
+    TEST_ASSERT_NOT_NULL(strstr(lines.text[0], "Text before"));
+    TEST_ASSERT_EQUAL_STRING(expected.text[0], lines.text[1]);
+    TEST_ASSERT_EQUAL_STRING(expected.text[1], lines.text[2]);
+    TEST_ASSERT_EQUAL_STRING(expected.text[2], lines.text[3]);
+    TEST_ASSERT_NOT_NULL(strstr(lines.text[4], "Text after, 7"));
+}
+
+void test_corrupt_frame_is_dropped_and_the_next_decodes(void) {
+    record(true, logRecords);
+    size_t second = frameLength(capture.data);
+    capture.data[second + 3 + 2] ^= 0x01;  // A timestamp bit of the second record
+
+    Lines lines = {};
+    BinaryLog::StreamDecoder decoder(&Lines::onLine, &lines);
+    decode(capture.data, capture.length, decoder);
+
+    TEST_ASSERT_EQUAL_UINT32(2, decoder.getFrameCount());
+    TEST_ASSERT_EQUAL_UINT32(1, decoder.getBadFrameCount());
+    TEST_ASSERT_GREATER_OR_EQUAL(2, lines.count);
+    TEST_ASSERT_EQUAL_STRING(expected.text[0], lines.text[0]);
+    TEST_ASSERT_EQUAL_STRING(expected.text[2], lines.text[lines.count - 1]);
+    for (uint8_t i = 0; i < lines.count; i++) {
+        TEST_ASSERT_NULL(strstr(lines.text[i], "Heartbeat"));
+    }
+}
+
+void test_truncated_frames_resync(void) {
+    record(true, logRecords);
+    size_t first = frameLength(capture.data);
+    size_t second = frameLength(capture.data + first);
+    size_t third = frameLength(capture.data + first + second);
+
+    // Bytes lost inside the second frame: it swallows the start of the third,
+    // fails its CRC, and the third is found again behind it
+    uint8_t stream[sizeof(capture.data)];
+    size_t length = first + second - 3;
+    memcpy(stream, capture.data, length);
+    memcpy(stream + length, capture.data + first + second, third);
+    length += third;
+
+    Lines lines = {};
+    BinaryLog::StreamDecoder decoder(&Lines::onLine, &lines);
+    decode(stream, length, decoder);
+    TEST_ASSERT_EQUAL_UINT32(2, decoder.getFrameCount());
+    TEST_ASSERT_GREATER_OR_EQUAL(1, decoder.getBadFrameCount());
+    TEST_ASSERT_GREATER_OR_EQUAL(2, lines.count);
+    TEST_ASSERT_EQUAL_STRING(expected.text[0], lines.text[0]);
+    TEST_ASSERT_EQUAL_STRING(expected.text[2], lines.text[lines.count - 1]);
+
+    // Capture cut off mid-frame: finish() gives up on it
+    Lines cut = {};
+    BinaryLog::StreamDecoder cut_decoder(&Lines::onLine, &cut);
+    decode(capture.data, first + 6, cut_decoder);
+    TEST_ASSERT_EQUAL_UINT32(1, cut_decoder.getFrameCount());
+    TEST_ASSERT_EQUAL_UINT32(1, cut_decoder.getBadFrameCount());
+    TEST_ASSERT_EQUAL_STRING(expected.text[0], cut.text[0]);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_frames_decode_to_the_text_lines);
+    RUN_TEST(test_corrupt_frame_is_dropped_and_the_next_decodes);
+    RUN_TEST(test_truncated_frames_resync);
+    return UNITY_END();
+}
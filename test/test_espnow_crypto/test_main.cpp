@@ -0,0 +1,325 @@
+// ESPNowCrypto against the RFC 8439 and XChaCha draft test vectors, and
+// ESPNowSession's sealed frames: round trip, replays, tampering, rekeying,
+// and seal() racing installTrafficKey() on another thread.
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include "../../lib/Core/Platform.h"
+#include "../../lib/Core/Logger.h"
+#include "../../lib/Communication/ESPNow/ESPNowConfig.h"
+#include "../../lib/Communication/ESPNow/ESPNowCrypto.h"
+#include "../../lib/Communication/ESPNow/ESPNowSession.h"
+
+static const uint8_t PAIRING_KEY[ESPNowSession::KEY_SIZE] = {
+    0x3a, 0x91, 0x5c, 0x07, 0xe2, 0x48, 0xbd, 0x16, 0x7f, 0x23, 0xc8, 0x64, 0x0e, 0xa5, 0x39, 0xd2,
+    0x81, 0x4b, 0xf6, 0x1d, 0x5e, 0x92, 0x2c, 0xb7, 0x63, 0x08, 0xda, 0x45, 0x9f, 0x71, 0xe3, 0x0a,
+};
+
+static void fromHex(const char* hex, uint8_t* out, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        unsigned int byte = 0;
+        sscanf(hex + 2 * i, "%2x", &byte);
+        out[i] = static_cast<uint8_t>(byte);
+    }
+}
+
+static void nonceFor(uint32_t n, uint8_t* nonce) {
+    memset(nonce, 0, ESPNowSession::NONCE_SIZE);
+    memcpy(nonce, &n, sizeof(n));
+}
+
+// Both ends share a master key, as after pairing
+static void pair(ESPNowSession& handheld, ESPNowSession& base) {
+    uint8_t hh_nonce[ESPNowSession::NONCE_SIZE];
+    uint8_t base_nonce[ESPNowSession::NONCE_SIZE];
+    uint8_t master[ESPNowSession::KEY_SIZE];
+    nonceFor(1, hh_nonce);
+    nonceFor(2, base_nonce);
+    handheld.setPairingKey(PAIRING_KEY);
+    base.setPairingKey(PAIRING_KEY);
+    handheld.deriveMasterKey(hh_nonce, base_nonce, master);
+    handheld.setMasterKey(master);
+    base.setMasterKey(master);
+}
+
+// Traffic key number index, the same on both ends
+static void install(ESPNowSession& session, uint32_t index) {
+    uint8_t hh_nonce[ESPNowSession::NONCE_SIZE];
+    uint8_t base_nonce[ESPNowSession::NONCE_SIZE];
+    nonceFor(0x1000 + index, hh_nonce);
+    nonceFor(0x2000 + index, base_nonce);
+    session.installTrafficKey(hh_nonce, base_nonce);
+}
+
+// A plain frame from the handheld with one opaque record and a dummy CRC
+static size_t plainFrame(uint8_t fill, uint8_t* frame) {
+    frame[0] = ESPNowWire::FRAME_MAGIC;
+    frame[1] = ESPNowWire::WIRE_VERSION << 4;
+    frame[2] = ESPNowConfig::ROLE_HANDHELD;
+    for (size_t i = 0; i < 20; i++) frame[3 + i] = static_cast<uint8_t>(fill + i);
+    frame[23] = 0;
+    frame[24] = 0;
+    return 25;
+}
+
+void setUp(void) {
+    Logger::init();
+    Logger::setLevel(LogLevel::LOG_LEVEL_ERROR);
+}
+
+void tearDown(void) {
+}
+
+// RFC 8439 section 2.5.2
+void test_poly1305_vector(void) {
+    uint8_t key[32];
+    uint8_t expected[16];
+    uint8_t tag[16];
+    fromHex("85d6be7857556d337f4452fe42d506a80103808afb0db2fd4abff6af4149f51b", key, sizeof(key));
+    fromHex("a8061dc1305136c6c22b8baf0c0127a9", expected, sizeof(expected));
+    const char* message = "Cryptographic Forum Research Group";
+
+    ESPNowCrypto::Poly1305 mac(key);
+    mac.update(reinterpret_cast<const uint8_t*>(message), strlen(message));
+    mac.finish(tag);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, tag, sizeof(tag));
+}
+
+// RFC 8439 section 2.8.2
+void test_aead_vector(void) {
+    uint8_t key[32];
+    uint8_t nonce[12];
+    uint8_t aad[12];
+    uint8_t expected[114];
+    uint8_t expected_tag[16];
+    for (size_t i = 0; i < sizeof(key); i++) key[i] = static_cast<uint8_t>(0x80 + i);
+    fromHex("070000004041424344454647", nonce, sizeof(nonce));
+    fromHex("50515253c0c1c2c3c4c5c6c7", aad, sizeof(aad));
+    fromHex("d31a8d34648e60db7b86afbc53ef7ec2a4aded51296e08fea9e2b5a736ee62d6"
+            "3dbea45e8ca9671282fafb69da92728b1a71de0a9e060b2905d6a5b67ecd3b36"
+            "92ddbd7f2d778b8c9803aee328091b58fab324e4fad675945585808b4831d7bc"
+            "3ff4def08e4b7a9de576d26586cec64b6116",
+            expected, sizeof(expected));
+    fromHex("1ae10b594f09e26a7e902ecbd0600691", expected_tag, sizeof(expected_tag));
+    const char* plaintext = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip "
+                            "for the future, sunscreen would be it.";
+    TEST_ASSERT_EQUAL(sizeof(expected), strlen(plaintext));
+
+    uint8_t data[114];
+    uint8_t tag[16];
+    memcpy(data, plaintext, sizeof(data));
+    ESPNowCrypto::seal(key, nonce, aad, sizeof(aad), data, sizeof(data), tag);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, data, sizeof(data));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected_tag, tag, sizeof(tag));
+
+    TEST_ASSERT_TRUE(ESPNowCrypto::open(key, nonce, aad, sizeof(aad), data, sizeof(data), tag, sizeof(tag)));
+    TEST_ASSERT_EQUAL_MEMORY(plaintext, data, sizeof(data));
+
+    // A bad tag leaves the ciphertext as it was
+    memcpy(data, expected, sizeof(data));
+    tag[15] ^= 0x01;
+    TEST_ASSERT_FALSE(ESPNowCrypto::open(key, nonce, aad, sizeof(aad), data, sizeof(data), tag, sizeof(tag)));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, data, sizeof(data));
+}
+
+// draft-irtf-cfrg-xchacha section 2.2.1
+void test_hchacha20_vector(void) {
+    uint8_t key[32];
+    uint8_t input[16];
+    uint8_t expected[32];
+    uint8_t out[32];
+    for (size_t i = 0; i < sizeof(key); i++) key[i] = static_cast<uint8_t>(i);
+    fromHex("000000090000004a0000000031415927", input, sizeof(input));
+    fromHex("82413b4227b27bfed30e42508a877d73a0f9e4d58a74a853c12ec41326d3ecdc", expected, sizeof(expected));
+
+    ESPNowCrypto::hchacha20(key, input, out);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, out, sizeof(out));
+}
+
+void test_sealed_frame_round_trip_and_replay(void) {
+    ESPNowSession handheld;
+    ESPNowSession base;
+    pair(handheld, base);
+    install(handheld, 0);
+    install(base, 0);
+
+    uint8_t plain[ESPNowWire::MAX_FRAME_SIZE];
+    uint8_t sealed[ESPNowWire::MAX_FRAME_SIZE];
+    uint8_t opened[ESPNowWire::MAX_FRAME_SIZE];
+    size_t plain_len = plainFrame(0x40, plain);
+    size_t sealed_len = handheld.seal(plain, plain_len, sealed, sizeof(sealed));
+    TEST_ASSERT_EQUAL(plain_len + ESPNowSession::OVERHEAD, sealed_len);
+    TEST_ASSERT_TRUE(ESPNowSession::isSealed(sealed, sealed_len));
+    // Records are not in the clear
+    TEST_ASSERT_TRUE(memcmp(plain + 3, sealed + ESPNowSession::SEALED_HEADER_SIZE, 20) != 0);
+
+    size_t opened_len = base.open(sealed, sealed_len, ESPNowConfig::ROLE_HANDHELD, opened, sizeof(opened), 0);
+    TEST_ASSERT_EQUAL(plain_len - ESPNowWire::FRAME_TRAILER_SIZE, opened_len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(plain, opened, opened_len);
+
+    // The same frame again is a replay, and so is anything older than the window
+    TEST_ASSERT_EQUAL(0, base.open(sealed, sealed_len, ESPNowConfig::ROLE_HANDHELD, opened, sizeof(opened), 0));
+    uint8_t old[ESPNowWire::MAX_FRAME_SIZE];
+    memcpy(old, sealed, sealed_len);
+    for (uint32_t i = 0; i < 100; i++) {
+        sealed_len = handheld.seal(plain, plain_len, sealed, sizeof(sealed));
+        TEST_ASSERT_NOT_EQUAL(0, base.open(sealed, sealed_len, ESPNowConfig::ROLE_HANDHELD, opened, sizeof(opened), 0));
+    }
+    TEST_ASSERT_EQUAL(0, base.open(old, sealed_len, ESPNowConfig::ROLE_HANDHELD, opened, sizeof(opened), 0));
+
+    ESPNowSession::Stats stats = base.getStats();
+    TEST_ASSERT_EQUAL_UINT32(101, stats.frames_opened);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.replays_rejected);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.auth_failures);
+}
+
+void test_tampered_frames_fail_their_tag(void) {
+    ESPNowSession handheld;
+    ESPNowSession base;
+    pair(handheld, base);
+    install(handheld, 0);
+    install(base, 0);
+
+    uint8_t plain[ESPNowWire::MAX_FRAME_SIZE];
+    uint8_t sealed[ESPNowWire::MAX_FRAME_SIZE];
+    uint8_t opened[ESPNowWire::MAX_FRAME_SIZE];
+    size_t plain_len = plainFrame(0x10, plain);
+    size_t sealed_len = handheld.seal(plain, plain_len, sealed, sizeof(sealed));
+
+    // Counter, a record byte, the tag
+    const size_t flips[] = {3, ESPNowSession::SEALED_HEADER_SIZE + 5, sealed_len - 1};
+    uint32_t expected_failures = 0;
+    for (size_t offset : flips) {
+        sealed[offset] ^= 0x20;
+        TEST_ASSERT_EQUAL(0, base.open(sealed, sealed_len, ESPNowConfig::ROLE_HANDHELD, opened, sizeof(opened), 0));
+        sealed[offset] ^= 0x20;
+        expected_failures++;
+    }
+    // Truncated, and claimed to come from the wrong peer
+    TEST_ASSERT_EQUAL(0, base.open(sealed, sealed_len - 1, ESPNowConfig::ROLE_HANDHELD, opened, sizeof(opened), 0));
+    TEST_ASSERT_EQUAL(0, base.open(sealed, sealed_len, ESPNowConfig::ROLE_BASE_STATION, opened, sizeof(opened), 0));
+    expected_failures += 2;
+    TEST_ASSERT_EQUAL_UINT32(expected_failures, base.getStats().auth_failures);
+    TEST_ASSERT_EQUAL_UINT32(0, base.getStats().replays_rejected);
+
+    // None of it moved the replay window; the untouched frame still opens
+    TEST_ASSERT_NOT_EQUAL(0, base.open(sealed, sealed_len, ESPNowConfig::ROLE_HANDHELD, opened, sizeof(opened), 0));
+}
+
+void test_new_traffic_key_restarts_counters_and_drops_old_frames(void) {
+    ESPNowSession handheld;
+    ESPNowSession base;
+    pair(handheld, base);
+    install(handheld, 0);
+    install(base, 0);
+
+    uint8_t plain[ESPNowWire::MAX_FRAME_SIZE];
+    uint8_t sealed[ESPNowWire::MAX_FRAME_SIZE];
+    uint8_t old[ESPNowWire::MAX_FRAME_SIZE];
+    uint8_t opened[ESPNowWire::MAX_FRAME_SIZE];
+    size_t plain_len = plainFrame(0x70, plain);
+    size_t sealed_len = 0;
+    for (uint32_t i = 0; i < 10; i++) {
+        sealed_len = handheld.seal(plain, plain_len, old, sizeof(old));
+    }
+
+    // Installing the same nonces again is a no-op; new ones restart the counter
+    install(handheld, 0);
+    TEST_ASSERT_NOT_EQUAL(0, handheld.seal(plain, plain_len, sealed, sizeof(sealed)));
+    TEST_ASSERT_EQUAL_HEX8(10, sealed[3]);
+    for (uint32_t k = 1; k <= 3; k++) {
+        install(handheld, k);
+        install(base, k);
+        sealed_len = handheld.seal(plain, plain_len, sealed, sizeof(sealed));
+        TEST_ASSERT_EQUAL_HEX8(0, sealed[3]);
+        TEST_ASSERT_NOT_EQUAL(0, base.open(sealed, sealed_len, ESPNowConfig::ROLE_HANDHELD, opened, sizeof(opened), 0));
+        TEST_ASSERT_EQUAL(0, base.open(old, sealed_len, ESPNowConfig::ROLE_HANDHELD, opened, sizeof(opened), 0));
+    }
+
+    base.clear();
+    TEST_ASSERT_FALSE(base.hasTrafficKey());
+    TEST_ASSERT_EQUAL(0, base.open(sealed, sealed_len, ESPNowConfig::ROLE_HANDHELD, opened, sizeof(opened), 0));
+}
+
+// One thread seals while another keeps installing keys, reusing each slot
+// every second install. A frame either seals under a single intact key or
+// is dropped; never a torn key or another key's counter.
+void test_seal_racing_installs_never_uses_a_torn_key(void) {
+    static const uint32_t KEYS = 200;
+    ESPNowSession handheld;
+    ESPNowSession base;
+    pair(handheld, base);
+    install(handheld, 0);
+
+    struct Sealed {
+        uint8_t frame[ESPNowWire::MAX_FRAME_SIZE];
+        size_t len;
+    };
+    std::vector<Sealed> frames;
+    frames.reserve(200000);
+    std::atomic<bool> done(false);
+    uint32_t dropped = 0;
+
+    std::thread sealer([&]() {
+        uint8_t plain[ESPNowWire::MAX_FRAME_SIZE];
+        size_t plain_len = plainFrame(0x33, plain);
+        Sealed sealed;
+        while (!done.load(std::memory_order_acquire) && frames.size() < 200000) {
+            sealed.len = handheld.seal(plain, plain_len, sealed.frame, sizeof(sealed.frame));
+            if (sealed.len == 0) {
+                dropped++;
+                continue;
+            }
+            frames.push_back(sealed);
+        }
+    });
+    for (uint32_t k = 1; k < KEYS; k++) {
+        install(handheld, k);
+        std::this_thread::yield();
+    }
+    done.store(true, std::memory_order_release);
+    sealer.join();
+
+    // Keys only move forward, so each frame opens under the current
+    // receiver key or a later one
+    uint8_t opened[ESPNowWire::MAX_FRAME_SIZE];
+    uint32_t key = 0;
+    install(base, key);
+    uint32_t unopened = 0;
+    for (const Sealed& sealed : frames) {
+        uint32_t k = key;
+        while (k < KEYS) {
+            if (k != key) install(base, k);
+            if (base.open(sealed.frame, sealed.len, ESPNowConfig::ROLE_HANDHELD, opened, sizeof(opened), 0)) {
+                break;
+            }
+            k++;
+        }
+        if (k == KEYS) {
+            unopened++;
+            install(base, key);  // Back to where the last good frame was
+        } else {
+            key = k;
+        }
+    }
+    printf("sealed %u frames across %u keys, %u dropped mid-install\n", static_cast<unsigned>(frames.size()),
+           static_cast<unsigned>(KEYS), static_cast<unsigned>(dropped));
+    TEST_ASSERT_GREATER_THAN(0, frames.size());
+    TEST_ASSERT_EQUAL_UINT32(0, unopened);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_poly1305_vector);
+    RUN_TEST(test_aead_vector);
+    RUN_TEST(test_hchacha20_vector);
+    RUN_TEST(test_sealed_frame_round_trip_and_replay);
+    RUN_TEST(test_tampered_frames_fail_their_tag);
+    RUN_TEST(test_new_traffic_key_restarts_counters_and_drops_old_frames);
+    RUN_TEST(test_seal_racing_installs_never_uses_a_torn_key);
+    return UNITY_END();
+}
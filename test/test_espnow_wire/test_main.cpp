@@ -0,0 +1,278 @@
+// ESPNowWire round trips: every message type through encode and decode,
+// bytes on air against the legacy packed frame, trailing-zero stripping of
+// variable payloads and the delta timestamp chain, including wrap-around.
+#include <unity.h>
+#include <stdio.h>
+#include "../../lib/Communication/ESPNow/ESPNowWire.h"
+
+static const uint8_t FIRST_TYPE = ESPNowConfig::MSG_ANNOUNCE;
+static const uint8_t LAST_TYPE = ESPNowConfig::MSG_CHANNEL_PROBE;
+
+struct Capture {
+    ESPNowMessage messages[8];
+    uint8_t flags[8];
+    size_t count;
+
+    static void sink(void* context, const ESPNowMessage& msg, uint8_t record_flags) {
+        Capture* capture = static_cast<Capture*>(context);
+        if (capture->count < 8) {
+            capture->messages[capture->count] = msg;
+            capture->flags[capture->count] = record_flags;
+            capture->count++;
+        }
+    }
+};
+
+static size_t varintSize(uint32_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+// A message of the given type whose payload fills what the type sends
+static ESPNowMessage makeMessage(uint8_t type, uint32_t sequence, uint32_t timestamp) {
+    ESPNowMessage msg;
+    msg.type = type;
+    msg.role = ESPNowConfig::ROLE_HANDHELD;
+    msg.sequence = sequence;
+    msg.timestamp = timestamp;
+    uint8_t fixed = ESPNowWire::payloadSize(type);
+    uint8_t used = fixed == ESPNowWire::PAYLOAD_VARIABLE ? 10 : fixed;
+    for (uint8_t i = 0; i < used; i++) {
+        msg.data[i] = static_cast<uint8_t>(0x11 * (i + 1) + type);
+    }
+    return msg;
+}
+
+static void assertSameMessage(const ESPNowMessage& expected, const ESPNowMessage& actual) {
+    TEST_ASSERT_EQUAL_UINT8(expected.type, actual.type);
+    TEST_ASSERT_EQUAL_UINT8(expected.role, actual.role);
+    TEST_ASSERT_EQUAL_UINT32(expected.sequence, actual.sequence);
+    TEST_ASSERT_EQUAL_UINT32(expected.timestamp, actual.timestamp);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected.data, actual.data, sizeof(expected.data));
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_every_type_round_trips_with_expected_bytes_on_air(void) {
+    size_t total_compact = 0;
+    size_t type_count = 0;
+    for (uint8_t type = FIRST_TYPE; type <= LAST_TYPE; type++) {
+        ESPNowWire::EncoderState encoder;
+        ESPNowWire::DecoderState decoder;
+        ESPNowWire::resetEncoder(encoder);
+        ESPNowWire::resetDecoder(decoder);
+
+        ESPNowMessage msg = makeMessage(type, 300, 123456);
+        uint8_t frame[ESPNowWire::MAX_FRAME_SIZE];
+        size_t length = ESPNowWire::encode(msg, encoder, frame, sizeof(frame));
+
+        uint8_t fixed = ESPNowWire::payloadSize(type);
+        size_t payload = fixed == ESPNowWire::PAYLOAD_VARIABLE ? 1 + 10 : fixed;
+        size_t expected = ESPNowWire::FRAME_HEADER_SIZE + 1 + varintSize(300) + varintSize(123456) + payload +
+                          ESPNowWire::FRAME_TRAILER_SIZE;
+        TEST_ASSERT_EQUAL(expected, length);
+        TEST_ASSERT_LESS_THAN(sizeof(ESPNowMessage), length);
+
+        Capture capture = {};
+        TEST_ASSERT_EQUAL(1, ESPNowWire::decodeFrame(frame, length, decoder, &Capture::sink, &capture));
+        TEST_ASSERT_EQUAL(1, capture.count);
+        assertSameMessage(msg, capture.messages[0]);
+        TEST_ASSERT_EQUAL_UINT8(0, capture.flags[0]);
+
+        total_compact += length;
+        type_count++;
+    }
+    printf("wire: %u types, %.1f bytes per frame on average, legacy frame %u bytes\n", (unsigned)type_count,
+           static_cast<double>(total_compact) / type_count, (unsigned)sizeof(ESPNowMessage));
+}
+
+void test_reliable_flag_and_batched_records_survive(void) {
+    ESPNowWire::EncoderState encoder;
+    ESPNowWire::DecoderState decoder;
+    ESPNowWire::resetEncoder(encoder);
+    ESPNowWire::resetDecoder(decoder);
+
+    ESPNowMessage first = makeMessage(ESPNowConfig::MSG_COMMAND, 1, 1000);
+    ESPNowMessage second = makeMessage(ESPNowConfig::MSG_TELEMETRY, 2, 1004);
+    uint8_t frame[ESPNowWire::MAX_FRAME_SIZE];
+    ESPNowWire::FrameWriter writer;
+    writer.begin(frame, sizeof(frame), ESPNowConfig::ROLE_HANDHELD);
+    TEST_ASSERT_TRUE(writer.append(first, encoder, ESPNowWire::RECORD_FLAG_RELIABLE));
+    TEST_ASSERT_TRUE(writer.append(second, encoder));
+    size_t length = writer.finish();
+
+    Capture capture = {};
+    TEST_ASSERT_EQUAL(2, ESPNowWire::decodeFrame(frame, length, decoder, &Capture::sink, &capture));
+    assertSameMessage(first, capture.messages[0]);
+    assertSameMessage(second, capture.messages[1]);
+    TEST_ASSERT_EQUAL_UINT8(ESPNowWire::RECORD_FLAG_RELIABLE, capture.flags[0]);
+    TEST_ASSERT_EQUAL_UINT8(0, capture.flags[1]);
+}
+
+void test_variable_payload_drops_trailing_zeros_only(void) {
+    ESPNowWire::EncoderState encoder;
+    ESPNowWire::DecoderState decoder;
+    ESPNowWire::resetEncoder(encoder);
+    ESPNowWire::resetDecoder(decoder);
+
+    ESPNowMessage msg;
+    msg.type = ESPNowConfig::MSG_TELEMETRY;
+    msg.sequence = 5;
+    msg.timestamp = 10;
+    msg.data[0] = 1;
+    msg.data[1] = 0;  // Inner zeros stay
+    msg.data[2] = 0;
+    msg.data[3] = 7;
+
+    uint8_t frame[ESPNowWire::MAX_FRAME_SIZE];
+    size_t length = ESPNowWire::encode(msg, encoder, frame, sizeof(frame));
+    // header, type, sequence, timestamp, length byte 4, 4 payload bytes, crc
+    TEST_ASSERT_EQUAL(3 + 1 + 1 + 1 + 1 + 4 + 2, length);
+    TEST_ASSERT_EQUAL_UINT8(4, frame[6]);
+
+    // Whatever the claimed buffer held before, the stripped tail decodes as zeros
+    ESPNowMessage reused;
+    memset(reused.data, 0xEE, sizeof(reused.data));
+    struct Claim {
+        ESPNowMessage* buffer;
+        static ESPNowMessage* claim(void* context) { return static_cast<Claim*>(context)->buffer; }
+        static void commit(void*, const ESPNowMessage&, uint8_t) {}
+    } claim = {&reused};
+    TEST_ASSERT_EQUAL(1, ESPNowWire::decodeFrameInto(frame, length, decoder, &Claim::claim, &Claim::commit, &claim));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(msg.data, reused.data, sizeof(msg.data));
+
+    // An all-zero variable payload is just its length byte
+    ESPNowMessage empty;
+    empty.type = ESPNowConfig::MSG_SCREEN_SYNC;
+    empty.sequence = 6;
+    empty.timestamp = 11;
+    length = ESPNowWire::encode(empty, encoder, frame, sizeof(frame));
+    TEST_ASSERT_EQUAL(3 + 1 + 1 + 1 + 1 + 2, length);
+    Capture capture = {};
+    TEST_ASSERT_EQUAL(1, ESPNowWire::decodeFrame(frame, length, decoder, &Capture::sink, &capture));
+    assertSameMessage(empty, capture.messages[0]);
+}
+
+void test_delta_timestamps_with_keyframes(void) {
+    ESPNowWire::EncoderState encoder;
+    ESPNowWire::DecoderState decoder;
+    ESPNowWire::resetEncoder(encoder);
+    ESPNowWire::resetDecoder(decoder);
+
+    uint8_t frame[ESPNowWire::MAX_FRAME_SIZE];
+    uint32_t timestamp = 5000000;
+    uint32_t keyframes = 0;
+    for (uint32_t i = 0; i < 40; i++) {
+        ESPNowMessage msg = makeMessage(ESPNowConfig::MSG_BUTTON_DATA, i + 1, timestamp);
+        size_t length = ESPNowWire::encode(msg, encoder, frame, sizeof(frame));
+        bool keyframe = (frame[3] & ESPNowWire::RECORD_FLAG_ABS_TIMESTAMP) != 0;
+        if (keyframe) {
+            keyframes++;
+            TEST_ASSERT_EQUAL(3 + 1 + 1 + varintSize(timestamp) + 5 + 2, length);
+        } else {
+            TEST_ASSERT_EQUAL(3 + 1 + 1 + 1 + 5 + 2, length);  // 20 ms delta fits one byte
+        }
+
+        Capture capture = {};
+        TEST_ASSERT_EQUAL(1, ESPNowWire::decodeFrame(frame, length, decoder, &Capture::sink, &capture));
+        TEST_ASSERT_EQUAL_UINT32(timestamp, capture.messages[0].timestamp);
+        timestamp += 20;
+    }
+    // The first record, then one every TIMESTAMP_KEYFRAME_INTERVAL deltas
+    TEST_ASSERT_EQUAL_UINT32(1 + 39 / (ESPNowWire::TIMESTAMP_KEYFRAME_INTERVAL + 1), keyframes);
+}
+
+void test_timestamp_wrap_sends_a_keyframe(void) {
+    ESPNowWire::EncoderState encoder;
+    ESPNowWire::DecoderState decoder;
+    ESPNowWire::resetEncoder(encoder);
+    ESPNowWire::resetDecoder(decoder);
+
+    const uint32_t timestamps[] = {0xFFFFFFD0u, 0xFFFFFFE4u, 0xFFFFFFF8u, 0x0000000Cu, 0x00000020u};
+    const bool expect_keyframe[] = {true, false, false, true, false};
+    uint8_t frame[ESPNowWire::MAX_FRAME_SIZE];
+    for (uint32_t i = 0; i < 5; i++) {
+        ESPNowMessage msg = makeMessage(ESPNowConfig::MSG_PING, i + 1, timestamps[i]);
+        size_t length = ESPNowWire::encode(msg, encoder, frame, sizeof(frame));
+        TEST_ASSERT_EQUAL(expect_keyframe[i], (frame[3] & ESPNowWire::RECORD_FLAG_ABS_TIMESTAMP) != 0);
+
+        Capture capture = {};
+        TEST_ASSERT_EQUAL(1, ESPNowWire::decodeFrame(frame, length, decoder, &Capture::sink, &capture));
+        TEST_ASSERT_EQUAL_UINT32(timestamps[i], capture.messages[0].timestamp);
+    }
+}
+
+void test_out_of_band_frames_leave_the_delta_chain_alone(void) {
+    ESPNowWire::EncoderState encoder;
+    ESPNowWire::EncoderState rc_encoder;
+    ESPNowWire::DecoderState decoder;
+    ESPNowWire::resetEncoder(encoder);
+    ESPNowWire::resetEncoder(rc_encoder);
+    ESPNowWire::resetDecoder(decoder);
+
+    uint8_t frame[ESPNowWire::MAX_FRAME_SIZE];
+    Capture capture = {};
+    ESPNowMessage a = makeMessage(ESPNowConfig::MSG_BUTTON_DATA, 1, 1000);
+    size_t length = ESPNowWire::encode(a, encoder, frame, sizeof(frame));
+    ESPNowWire::decodeFrame(frame, length, decoder, &Capture::sink, &capture);
+
+    ESPNowMessage rc = makeMessage(ESPNowConfig::MSG_RC_CHANNELS, 50, 90000);
+    length = ESPNowWire::encode(rc, rc_encoder, frame, sizeof(frame), ESPNowWire::FRAME_FLAG_OUT_OF_BAND);
+    ESPNowWire::decodeFrame(frame, length, decoder, &Capture::sink, &capture);
+
+    ESPNowMessage b = makeMessage(ESPNowConfig::MSG_BUTTON_DATA, 2, 1030);
+    length = ESPNowWire::encode(b, encoder, frame, sizeof(frame));
+    ESPNowWire::decodeFrame(frame, length, decoder, &Capture::sink, &capture);
+
+    TEST_ASSERT_EQUAL(3, capture.count);
+    TEST_ASSERT_EQUAL_UINT32(90000, capture.messages[1].timestamp);
+    TEST_ASSERT_EQUAL_UINT32(1030, capture.messages[2].timestamp);
+}
+
+void test_corrupt_and_legacy_frames(void) {
+    ESPNowWire::EncoderState encoder;
+    ESPNowWire::DecoderState decoder;
+    ESPNowWire::resetEncoder(encoder);
+    ESPNowWire::resetDecoder(decoder);
+
+    ESPNowMessage msg = makeMessage(ESPNowConfig::MSG_PONG, 9, 777);
+    uint8_t frame[ESPNowWire::MAX_FRAME_SIZE];
+    size_t length = ESPNowWire::encode(msg, encoder, frame, sizeof(frame));
+    Capture capture = {};
+    for (size_t i = 0; i < length; i++) {
+        frame[i] ^= 0x01;
+        TEST_ASSERT_EQUAL(0, ESPNowWire::decodeFrame(frame, length, decoder, &Capture::sink, &capture));
+        frame[i] ^= 0x01;
+    }
+    TEST_ASSERT_EQUAL(0, ESPNowWire::decodeFrame(frame, length - 1, decoder, &Capture::sink, &capture));
+    TEST_ASSERT_EQUAL(0, capture.count);
+
+    // The packed legacy frame of older firmware is still accepted
+    msg.updateCRC();
+    memcpy(frame, &msg, sizeof(msg));
+    TEST_ASSERT_TRUE(ESPNowWire::isLegacyFrame(frame, sizeof(msg)));
+    TEST_ASSERT_EQUAL(1, ESPNowWire::decodeFrame(frame, sizeof(msg), decoder, &Capture::sink, &capture));
+    assertSameMessage(msg, capture.messages[0]);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_every_type_round_trips_with_expected_bytes_on_air);
+    RUN_TEST(test_reliable_flag_and_batched_records_survive);
+    RUN_TEST(test_variable_payload_drops_trailing_zeros_only);
+    RUN_TEST(test_delta_timestamps_with_keyframes);
+    RUN_TEST(test_timestamp_wrap_sends_a_keyframe);
+    RUN_TEST(test_out_of_band_frames_leave_the_delta_chain_alone);
+    RUN_TEST(test_corrupt_and_legacy_frames);
+    return UNITY_END();
+}
@@ -0,0 +1,177 @@
+// ESPNowLinkTask on a host thread: app calls are queued to the task, the
+// getters read a published snapshot while the task writes, and disconnect()
+// doesn't hold up the caller.
+#include <unity.h>
+#include <thread>
+#include "../../lib/Core/Platform.h"
+#include "../../lib/Core/Logger.h"
+#include "../../lib/Core/SnapshotBuffer.h"
+#include "../../lib/Communication/ESPNow/ESPNowManager.h"
+#include "../../lib/Communication/ESPNow/ESPNowLinkTask.h"
+#include "../../lib/Communication/ESPNow/SimNetwork.h"
+
+struct Counters {
+    std::atomic<uint32_t> buttons{0};
+
+    void onButtons(const ESPNowPayload::ButtonData&, ESPNowManager::PeerId) { buttons++; }
+};
+
+void setUp(void) {
+    Logger::init();
+    Logger::setLevel(LogLevel::LOG_LEVEL_ERROR);
+}
+
+void tearDown(void) {
+}
+
+// Every word of a snapshot carries the same value, so a torn read shows
+void test_snapshot_reads_are_never_torn(void) {
+    struct Block {
+        uint32_t words[64];
+    };
+    static SnapshotBuffer<Block> buffer;
+    static const uint32_t PUBLISHES = 500000;
+    std::atomic<bool> done(false);
+    uint32_t torn = 0;
+    uint32_t backwards = 0;
+    uint32_t reads = 0;
+
+    std::thread reader([&]() {
+        uint32_t last = 0;
+        while (!done.load(std::memory_order_acquire)) {
+            Block block = buffer.read();
+            for (uint32_t i = 1; i < 64; i++) {
+                if (block.words[i] != block.words[0]) {
+                    torn++;
+                    break;
+                }
+            }
+            if (block.words[0] < last) backwards++;
+            last = block.words[0];
+            reads++;
+        }
+    });
+    Block block;
+    for (uint32_t n = 1; n <= PUBLISHES; n++) {
+        for (uint32_t i = 0; i < 64; i++) block.words[i] = n;
+        buffer.publish(block);
+    }
+    done.store(true, std::memory_order_release);
+    reader.join();
+
+    TEST_ASSERT_GREATER_THAN(0, reads);
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+    TEST_ASSERT_EQUAL_UINT32(0, backwards);
+    TEST_ASSERT_EQUAL_UINT32(PUBLISHES, buffer.read().words[0]);
+}
+
+void test_app_calls_run_on_the_link_task(void) {
+    // The base runs on its link task; this thread is the base's app task,
+    // the Wi-Fi and timer tasks of both, and the handheld's loop
+    SimNetwork net(5);
+    ESPNowManager& base = net.addBaseStation();
+    ESPNowManager& handheld = net.addHandheld();
+    TEST_ASSERT_EQUAL(HAL_OK, net.initAll());
+    net.setPacingUs(100);  // So the link task keeps up with the simulated clock
+    Counters counters;
+    base.getDispatchTable().on<ESPNowPayload::ButtonData, Counters, &Counters::onButtons>(&counters);
+
+    ESPNowLinkTask task(base);
+    TEST_ASSERT_EQUAL(HAL_OK, task.start());
+
+    // Answered by the task before registerPeer() returns
+    uint8_t peers_before = base.getPeerCount();
+    ESPNowManager::PeerId drone = base.registerPeer(SimNetwork::DRONE_MAC, ESPNowConfig::ROLE_DRONE);
+    TEST_ASSERT_NOT_EQUAL(ESPNowManager::INVALID_PEER, drone);
+    TEST_ASSERT_EQUAL(drone, base.findPeer(SimNetwork::DRONE_MAC));
+    TEST_ASSERT_EQUAL(peers_before + 1, base.getPeerCount());
+
+    // Another task polls the getters throughout; counters only ever grow
+    std::atomic<bool> done(false);
+    uint32_t went_backwards = 0;
+    uint32_t snapshots = 0;
+    std::thread display([&]() {
+        uint32_t last_sent = 0;
+        uint32_t last_received = 0;
+        while (!done.load(std::memory_order_acquire)) {
+            ESPNowManager::Stats stats = base.getStats();
+            if (stats.messages_sent < last_sent || stats.messages_received < last_received) went_backwards++;
+            last_sent = stats.messages_sent;
+            last_received = stats.messages_received;
+            float loss = base.getPacketLossRate1s();
+            if (loss < 0.0f || loss > 100.0f) went_backwards++;
+            base.getRttHistogram();
+            snapshots++;
+        }
+    });
+
+    handheld.startConnection();
+    TEST_ASSERT_TRUE(net.pair(base, handheld, 5000) >= 0);
+
+    base.setCoalescing(false);
+    uint16_t channels[4] = {1000, 1500, 1500, 2000};
+    base.setRcChannels(channels, 4);
+    TEST_ASSERT_EQUAL(HAL_OK, base.startRcStream(50));
+    TEST_ASSERT_TRUE(net.tickUntil([&]() { return base.isRcStreaming(); }, 50));
+
+    for (uint32_t i = 0; i < 100; i++) {
+        ESPNowMessage msg;
+        msg.setButtonData(i);
+        handheld.sendMessage(msg);
+        net.tick(10);
+    }
+    TEST_ASSERT_EQUAL(HAL_OK, base.stopRcStream());
+    TEST_ASSERT_TRUE(net.tickUntil([&]() { return !base.isRcStreaming(); }, 50));
+    TEST_ASSERT_GREATER_THAN(0, base.getStats().rc_frames_sent);
+
+    // Queued like a send; gone once the task has run
+    TEST_ASSERT_EQUAL(HAL_OK, base.unregisterPeer(drone));
+    TEST_ASSERT_TRUE(net.tickUntil([&]() { return base.getPeerCount() == peers_before; }, 50));
+
+    done.store(true, std::memory_order_release);
+    display.join();
+    task.stop();
+
+    printf("%u snapshots read, %u buttons dispatched, %u link task updates\n", static_cast<unsigned>(snapshots),
+           static_cast<unsigned>(counters.buttons.load()), static_cast<unsigned>(task.getUpdateCount()));
+    TEST_ASSERT_GREATER_THAN(0, snapshots);
+    TEST_ASSERT_EQUAL_UINT32(0, went_backwards);
+    TEST_ASSERT_GREATER_OR_EQUAL(98, counters.buttons.load());
+    TEST_ASSERT_EQUAL_UINT32(0, base.getStats().link_requests_dropped);
+}
+
+// The disconnect goes out reliably and the radio peer stays until it is
+// acknowledged; the caller itself never waits for it
+void test_disconnect_returns_without_waiting(void) {
+    SimNetwork net(9);
+    ESPNowManager& base = net.addBaseStation();
+    ESPNowManager& handheld = net.addHandheld();
+    net.initAll();
+    handheld.startConnection();
+    TEST_ASSERT_GREATER_OR_EQUAL(0, net.pair(base, handheld, 5000));
+
+    uint64_t before_us = Platform::nowUs();
+    TEST_ASSERT_EQUAL(HAL_OK, handheld.disconnect());
+    TEST_ASSERT_EQUAL_UINT32(0, static_cast<uint32_t>(Platform::nowUs() - before_us));
+    TEST_ASSERT_FALSE(handheld.isPaired());
+    TEST_ASSERT_TRUE(net.getRadio(handheld).hasPeer(SimNetwork::BASE_MAC));  // Until the ACK
+
+    // The handheld searches again right away, so the base may re-pair soon after
+    int32_t base_dropped_ms = -1;
+    for (uint32_t ms = 0; ms < 100 && base_dropped_ms < 0; ms++) {
+        net.tick();
+        if (!base.isPaired()) base_dropped_ms = static_cast<int32_t>(ms);
+    }
+    TEST_ASSERT_GREATER_OR_EQUAL(0, base_dropped_ms);
+    TEST_ASSERT_LESS_THAN(20, base_dropped_ms);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_snapshot_reads_are_never_torn);
+    RUN_TEST(test_app_calls_run_on_the_link_task);
+    RUN_TEST(test_disconnect_returns_without_waiting);
+    return UNITY_END();
+}
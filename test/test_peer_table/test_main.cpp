@@ -0,0 +1,240 @@
+// ESPNowPeerTable lookups, removal while the receive callback holds a peer,
+// and peers coming and going on a live four-node SimRadioMedium network.
+#include <unity.h>
+#include <thread>
+#include "../../lib/Core/Platform.h"
+#include "../../lib/Core/Logger.h"
+#include "../../lib/Communication/ESPNow/ESPNowPeerTable.h"
+#include "../../lib/Communication/ESPNow/ESPNowManager.h"
+#include "../../lib/Communication/ESPNow/SimNetwork.h"
+
+typedef ESPNowPeerTable<4> Table;
+
+static void macFor(uint8_t n, uint8_t* mac) {
+    const uint8_t prefix[5] = {0x02, 0x10, 0x20, 0x30, 0x40};
+    memcpy(mac, prefix, 5);
+    mac[5] = n;
+}
+
+void setUp(void) {
+    Logger::init();
+    Logger::setLevel(LogLevel::LOG_LEVEL_ERROR);
+}
+
+void tearDown(void) {
+}
+
+void test_add_find_remove(void) {
+    Table table(100);
+    uint8_t mac[4][6];
+    Table::PeerId ids[4];
+    for (uint8_t i = 0; i < 4; i++) {
+        macFor(i, mac[i]);
+        ids[i] = table.add(mac[i], i);
+        TEST_ASSERT_NOT_EQUAL(Table::INVALID_PEER, ids[i]);
+    }
+    uint8_t extra[6];
+    macFor(9, extra);
+    TEST_ASSERT_EQUAL(Table::INVALID_PEER, table.add(extra, 9));
+    TEST_ASSERT_EQUAL(ids[2], table.add(mac[2], 2));  // Already there
+    for (uint8_t i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(ids[i], table.find(mac[i]));
+    }
+
+    uint8_t generation = table.get(ids[1]).generation;
+    TEST_ASSERT_TRUE(table.remove(ids[1]));
+    TEST_ASSERT_FALSE(table.isValid(ids[1]));
+    TEST_ASSERT_EQUAL(Table::INVALID_PEER, table.find(mac[1]));
+    TEST_ASSERT_EQUAL(3, table.count());
+
+    // The slot is reused, as a new generation; lookups past the tombstone still work
+    TEST_ASSERT_EQUAL(ids[1], table.add(extra, 9));
+    TEST_ASSERT_FALSE(table.isCurrent(ids[1], generation));
+    TEST_ASSERT_TRUE(table.isCurrent(ids[1], table.get(ids[1]).generation));
+    TEST_ASSERT_EQUAL(ids[1], table.find(extra));
+    TEST_ASSERT_EQUAL(ids[3], table.find(mac[3]));
+}
+
+void test_removing_a_pinned_peer_defers_its_slot(void) {
+    Table table(100);
+    uint8_t a[6];
+    uint8_t b[6];
+    macFor(1, a);
+    macFor(2, b);
+    Table::PeerId id = table.add(a, 1);
+
+    // The callback holds a; the main loop removes it and adds b
+    TEST_ASSERT_EQUAL(id, table.pin(a));
+    TEST_ASSERT_TRUE(table.remove(id));
+    TEST_ASSERT_EQUAL(Table::INVALID_PEER, table.find(a));
+    TEST_ASSERT_FALSE(table.isValid(id));
+    Table::PeerId other = table.add(b, 2);
+    TEST_ASSERT_NOT_EQUAL(id, other);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(a, table.get(id).mac, 6);  // Untouched under the pin
+    table.unpin();
+
+    // Unpinned, the slot comes back on the next add()
+    TEST_ASSERT_TRUE(table.remove(other));
+    uint8_t c[6];
+    macFor(3, c);
+    Table::PeerId reused = table.add(c, 3);
+    TEST_ASSERT_TRUE(reused == id || reused == other);
+    TEST_ASSERT_EQUAL(1, table.count());
+
+    // A removed peer can't be pinned
+    TEST_ASSERT_EQUAL(Table::INVALID_PEER, table.pin(a));
+}
+
+// The callback thread pins peers and checks the slot keeps the MAC it was
+// found by, while the main thread removes and re-adds peers with more MACs
+// than slots, so every slot keeps changing hands.
+void test_pinned_slots_survive_concurrent_churn(void) {
+    static const uint32_t ROUNDS = 200000;
+    static Table table(100);
+    const uint8_t MAC_COUNT = 6;
+    uint8_t macs[MAC_COUNT][6];
+    for (uint8_t i = 0; i < MAC_COUNT; i++) {
+        macFor(i, macs[i]);
+    }
+    for (uint8_t i = 0; i < 4; i++) {
+        table.add(macs[i], i);
+    }
+
+    std::atomic<bool> done(false);
+    uint32_t pinned = 0;
+    uint32_t changed = 0;
+    std::thread callback([&]() {
+        uint32_t n = 0;
+        while (!done.load(std::memory_order_acquire)) {
+            const uint8_t* mac = macs[n++ % MAC_COUNT];
+            Table::PeerId id = table.pin(mac);
+            if (id == Table::INVALID_PEER) continue;
+            pinned++;
+            const ESPNowPeer& peer = table.get(id);
+            for (uint32_t spin = 0; spin < 20; spin++) {
+                if (memcmp(peer.mac, mac, 6) != 0 || peer.role != mac[5]) changed++;
+            }
+            table.unpin();
+        }
+    });
+
+    for (uint32_t round = 0; round < ROUNDS; round++) {
+        uint8_t n = round % MAC_COUNT;
+        Table::PeerId id = table.find(macs[n]);
+        if (id != Table::INVALID_PEER) {
+            table.remove(id);
+        } else {
+            table.add(macs[n], n);
+        }
+    }
+    done.store(true, std::memory_order_release);
+    callback.join();
+
+    printf("%u pins during %u adds/removes\n", static_cast<unsigned>(pinned), static_cast<unsigned>(ROUNDS));
+    TEST_ASSERT_GREATER_THAN(0, pinned);
+    TEST_ASSERT_EQUAL_UINT32(0, changed);
+}
+
+struct Senders {
+    ESPNowManager::PeerId drone = ESPNowManager::INVALID_PEER;
+    ESPNowManager::PeerId spare = ESPNowManager::INVALID_PEER;
+    uint32_t from_drone = 0;
+    uint32_t from_spare = 0;
+    uint32_t misrouted = 0;
+
+    // The payload's first byte says who sent it
+    void onTelemetry(const ESPNowMessage& msg, ESPNowManager::PeerId peer) {
+        if (msg.data[0] == 'D' && peer == drone) {
+            from_drone++;
+        } else if (msg.data[0] == 'S' && peer == spare) {
+            from_spare++;
+        } else {
+            misrouted++;
+        }
+    }
+};
+
+static void sendTelemetry(ESPNowManager& sender, ESPNowManager::PeerId to, char tag) {
+    ESPNowMessage msg;
+    msg.type = ESPNowConfig::MSG_TELEMETRY;
+    msg.data[0] = static_cast<uint8_t>(tag);
+    sender.sendMessageTo(to, msg);
+}
+
+// The base drops a drone and takes another into the same slot while the
+// pilot link and both drones keep sending. Frames queued before the swap
+// are not handed out as the new drone's.
+void test_peers_come_and_go_on_a_live_network(void) {
+    SimNetwork net(3);
+    ESPNowManager& base = net.addBaseStation();
+    ESPNowManager& handheld = net.addHandheld();
+    ESPNowManager& drone = net.addDrone();
+    ESPNowManager& spare = net.addDrone(SimNetwork::SPARE_MAC);
+    TEST_ASSERT_EQUAL(HAL_OK, net.initAll());
+
+    Senders senders;
+    base.getDispatchTable().on<Senders, &Senders::onTelemetry>(ESPNowConfig::MSG_TELEMETRY, &senders);
+    senders.drone = base.registerPeer(SimNetwork::DRONE_MAC, ESPNowConfig::ROLE_DRONE);
+    ESPNowManager::PeerId drone_to_base = drone.registerPeer(SimNetwork::BASE_MAC, ESPNowConfig::ROLE_BASE_STATION);
+    ESPNowManager::PeerId spare_to_base = spare.registerPeer(SimNetwork::BASE_MAC, ESPNowConfig::ROLE_BASE_STATION);
+    TEST_ASSERT_NOT_EQUAL(ESPNowManager::INVALID_PEER, senders.drone);
+
+    handheld.startConnection();
+    net.tickUntil([&]() { return base.isPaired(); }, 5000);
+    TEST_ASSERT_TRUE(base.isPaired());
+
+    uint32_t buttons_sent = 0;
+    for (uint32_t cycle = 0; cycle < 10; cycle++) {
+        for (uint32_t ms = 0; ms < 200; ms++) {
+            if (ms % 10 == 0) {
+                ESPNowMessage msg;
+                msg.setButtonData(ms & 0xFF);
+                if (handheld.sendMessage(msg) == HAL_OK) buttons_sent++;
+            }
+            if (ms % 5 == 0) {
+                sendTelemetry(drone, drone_to_base, 'D');
+                sendTelemetry(spare, spare_to_base, 'S');
+            }
+            net.tick(1);
+        }
+
+        // Swap between the radio delivering and update() handling: the
+        // drone's frames are queued under the slot the spare is about to get
+        sendTelemetry(drone, drone_to_base, 'D');
+        Platform::advanceUs(5000);
+        net.getMedium().poll(Platform::nowUs());
+        bool drone_registered = (cycle % 2 == 0);
+        ESPNowManager::PeerId& leaving = drone_registered ? senders.drone : senders.spare;
+        ESPNowManager::PeerId& joining = drone_registered ? senders.spare : senders.drone;
+        ESPNowManager::PeerId slot = leaving;
+        TEST_ASSERT_EQUAL(HAL_OK, base.unregisterPeer(leaving));
+        leaving = ESPNowManager::INVALID_PEER;
+        joining = base.registerPeer(drone_registered ? SimNetwork::SPARE_MAC : SimNetwork::DRONE_MAC,
+                                    ESPNowConfig::ROLE_DRONE);
+        TEST_ASSERT_EQUAL(slot, joining);
+        TEST_ASSERT_EQUAL(2, base.getPeerCount());
+    }
+    net.tick(100);
+
+    // Each is registered for five of the ten cycles, 40 messages a cycle
+    printf("drone %u, spare %u, unknown %u\n", static_cast<unsigned>(senders.from_drone),
+           static_cast<unsigned>(senders.from_spare), static_cast<unsigned>(base.getStats().rx_unknown_peer));
+    TEST_ASSERT_EQUAL_UINT32(0, senders.misrouted);
+    TEST_ASSERT_GREATER_OR_EQUAL(190, senders.from_drone);
+    TEST_ASSERT_GREATER_OR_EQUAL(190, senders.from_spare);
+    // Whoever isn't registered is an unknown peer to the base
+    TEST_ASSERT_GREATER_OR_EQUAL(190, base.getStats().rx_unknown_peer);
+    TEST_ASSERT_TRUE(base.isPaired());
+    TEST_ASSERT_GREATER_THAN(180, buttons_sent);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_add_find_remove);
+    RUN_TEST(test_removing_a_pinned_peer_defers_its_slot);
+    RUN_TEST(test_pinned_slots_survive_concurrent_churn);
+    RUN_TEST(test_peers_come_and_go_on_a_live_network);
+    return UNITY_END();
+}
@@ -0,0 +1,147 @@
+// RC channel stream end to end: the timer's cadence reaches the receiver
+// frame for frame with the channels intact, both when update() is called
+// inline and when the handheld's link task sends on the timer's wake-up.
+#include <unity.h>
+#include <thread>
+#include "../../lib/Core/Platform.h"
+#include "../../lib/Core/Logger.h"
+#include "../../lib/Communication/ESPNow/ESPNowManager.h"
+#include "../../lib/Communication/ESPNow/ESPNowLinkTask.h"
+#include "../../lib/Communication/ESPNow/SimNetwork.h"
+
+// Every channel of a frame carries the same value, so a frame mixing two
+// setRcChannels() calls shows
+struct Receiver {
+    uint32_t frames = 0;
+    uint32_t mixed = 0;
+    uint32_t wrong_count = 0;
+    uint16_t last_value = 0;
+    uint64_t last_us = 0;
+    uint64_t max_gap_us = 0;
+
+    void onRc(const ESPNowPayload::RcChannels& rc, ESPNowManager::PeerId) {
+        uint64_t now_us = Platform::nowUs();
+        if (frames > 0 && now_us - last_us > max_gap_us) max_gap_us = now_us - last_us;
+        last_us = now_us;
+        frames++;
+        if (rc.count != ESPNowMessage::RC_MAX_CHANNELS) wrong_count++;
+        for (uint8_t i = 1; i < rc.count; i++) {
+            if (rc.channels[i] != rc.channels[0]) {
+                mixed++;
+                break;
+            }
+        }
+        last_value = rc.channels[0];
+    }
+};
+
+// Paired and past the channel survey that follows, whose hops lose frames
+static bool pairAndSettle(SimNetwork& net, ESPNowManager& base, ESPNowManager& handheld) {
+    handheld.startConnection();
+    if (net.pair(base, handheld, 5000) < 0) return false;
+    net.tick(1500);
+    return base.isPaired() && handheld.isPaired();
+}
+
+static void setAll(ESPNowManager& manager, uint16_t value) {
+    uint16_t channels[ESPNowMessage::RC_MAX_CHANNELS];
+    for (uint8_t i = 0; i < ESPNowMessage::RC_MAX_CHANNELS; i++) channels[i] = value;
+    manager.setRcChannels(channels, ESPNowMessage::RC_MAX_CHANNELS);
+}
+
+void setUp(void) {
+    Logger::init();
+    Logger::setLevel(LogLevel::LOG_LEVEL_ERROR);
+}
+
+void tearDown(void) {
+}
+
+void test_inline_stream_round_trip(void) {
+    SimNetwork net(3);
+    ESPNowManager& base = net.addBaseStation();
+    ESPNowManager& handheld = net.addHandheld();
+    net.initAll();
+    Receiver receiver;
+    base.getDispatchTable().on<ESPNowPayload::RcChannels, Receiver, &Receiver::onRc>(&receiver);
+    TEST_ASSERT_TRUE(pairAndSettle(net, base, handheld));
+
+    // Nothing set yet: the stream stays quiet
+    uint32_t messages_before = handheld.getStats().messages_sent;
+    TEST_ASSERT_EQUAL(HAL_OK, handheld.startRcStream(100));
+    net.tick(100);
+    TEST_ASSERT_EQUAL_UINT32(0, receiver.frames);
+
+    // 11-bit values round trip unchanged, including both ends of the range
+    const uint16_t values[] = {0, 1000, 1500, 2000, 2047};
+    for (uint8_t i = 0; i < 5; i++) {
+        setAll(handheld, values[i]);
+        net.tick(400);
+        TEST_ASSERT_EQUAL_UINT16(values[i], receiver.last_value);
+    }
+    handheld.stopRcStream();
+    net.tick(50);
+
+    // 100 Hz for 2 s, on an ideal link every frame arrives
+    uint32_t sent = handheld.getStats().rc_frames_sent;
+    TEST_ASSERT_UINT32_WITHIN(2, 200, sent);
+    TEST_ASSERT_EQUAL_UINT32(sent, receiver.frames);
+    TEST_ASSERT_GREATER_OR_EQUAL(messages_before + sent, handheld.getStats().messages_sent);
+    TEST_ASSERT_EQUAL_UINT32(0, receiver.mixed);
+    TEST_ASSERT_EQUAL_UINT32(0, receiver.wrong_count);
+
+    uint32_t after_stop = receiver.frames;
+    net.tick(100);
+    TEST_ASSERT_EQUAL_UINT32(after_stop, receiver.frames);
+}
+
+// As on the handheld: the app task updates the channels, the link task
+// sends, the timer only sets the pace. The app's loop only comes round
+// every 20 ms, which must not show in the stream.
+void test_link_task_stream_throughput(void) {
+    SimNetwork net(3);
+    ESPNowManager& base = net.addBaseStation();
+    ESPNowManager& handheld = net.addHandheld();
+    net.initAll();
+    net.setPacingUs(200);  // So the link task keeps up with the simulated clock
+    Receiver receiver;
+    base.getDispatchTable().on<ESPNowPayload::RcChannels, Receiver, &Receiver::onRc>(&receiver);
+
+    ESPNowLinkTask task(handheld);
+    TEST_ASSERT_EQUAL(HAL_OK, task.start());
+    TEST_ASSERT_TRUE(pairAndSettle(net, base, handheld));
+
+    setAll(handheld, 1000);
+    TEST_ASSERT_EQUAL(HAL_OK, handheld.startRcStream(ESPNowGlobalConfig::RC_STREAM_MAX_RATE_HZ));
+    net.setUpdateInterval(handheld, 20);
+    static const uint32_t DURATION_MS = 4000;
+    for (uint32_t ms = 0; ms < DURATION_MS; ms += 10) {
+        setAll(handheld, static_cast<uint16_t>(1000 + ms / 10 % 1000));
+        net.tick(10);
+    }
+    handheld.stopRcStream();
+    net.tick(50);
+    task.stop();
+
+    uint32_t sent = handheld.getStats().rc_frames_sent;
+    uint32_t expected = ESPNowGlobalConfig::RC_STREAM_MAX_RATE_HZ * DURATION_MS / 1000;
+    float payload_kbps = receiver.frames * 23 * 8.0f / DURATION_MS;  // 16 channels at 11 bits plus the count
+    printf("%u of %u RC frames received, %.1f kbps of channel data, longest gap %u us\n",
+           static_cast<unsigned>(receiver.frames), static_cast<unsigned>(expected),
+           static_cast<double>(payload_kbps), static_cast<unsigned>(receiver.max_gap_us));
+    TEST_ASSERT_GREATER_OR_EQUAL(expected * 95 / 100, receiver.frames);
+    TEST_ASSERT_LESS_OR_EQUAL(expected + 2, sent);
+    TEST_ASSERT_EQUAL_UINT32(sent, receiver.frames);
+    TEST_ASSERT_LESS_THAN(3 * 1000000 / ESPNowGlobalConfig::RC_STREAM_MAX_RATE_HZ, receiver.max_gap_us);
+    TEST_ASSERT_EQUAL_UINT32(0, receiver.mixed);
+    TEST_ASSERT_EQUAL_UINT32(0, receiver.wrong_count);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_inline_stream_round_trip);
+    RUN_TEST(test_link_task_stream_throughput);
+    return UNITY_END();
+}
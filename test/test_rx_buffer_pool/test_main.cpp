@@ -0,0 +1,179 @@
+// Receive path copies: records are decoded in place into BufferPool buffers
+// and handlers read them there, so a message is never copied on its way in.
+#include <unity.h>
+#include <set>
+#include "../../lib/Core/Platform.h"
+#include "../../lib/Core/Logger.h"
+#include "../../lib/Core/BufferPool.h"
+#include "../../lib/Communication/ESPNow/ESPNowManager.h"
+#include "../../lib/Communication/ESPNow/ESPNowWire.h"
+#include "../../lib/Communication/ESPNow/SimNetwork.h"
+
+void setUp(void) {
+    Logger::init();
+    Logger::setLevel(LogLevel::LOG_LEVEL_ERROR);
+}
+
+void tearDown(void) {
+}
+
+typedef BufferPool<ESPNowMessage, 8> MessagePool;
+typedef BufferPool<uint32_t, 4> SmallPool;
+
+// Claims and commits as the manager does: one pool buffer per record
+struct PoolSink {
+    MessagePool pool;
+    MessagePool::Index claimed = MessagePool::INVALID_INDEX;
+    uint32_t claims = 0;
+    uint32_t commits = 0;
+    uint32_t copies = 0;     // Commits whose message isn't the claimed buffer
+    uint8_t last_button = 0;
+
+    static ESPNowMessage* claim(void* context) {
+        PoolSink* sink = static_cast<PoolSink*>(context);
+        if (sink->claimed == MessagePool::INVALID_INDEX) {
+            sink->claimed = sink->pool.claim();
+            if (sink->claimed == MessagePool::INVALID_INDEX) return nullptr;
+            sink->claims++;
+        }
+        return &sink->pool[sink->claimed];
+    }
+
+    static void commit(void* context, const ESPNowMessage& msg, uint8_t) {
+        PoolSink* sink = static_cast<PoolSink*>(context);
+        if (&msg != &sink->pool[sink->claimed]) sink->copies++;
+        sink->commits++;
+        sink->last_button = msg.getButtonStates();
+        sink->pool.release(sink->claimed);
+        sink->claimed = MessagePool::INVALID_INDEX;
+    }
+};
+
+void test_buffer_pool_exhausts_and_recovers(void) {
+    SmallPool pool;
+    SmallPool::Index indices[4];
+    for (int i = 0; i < 4; i++) {
+        indices[i] = pool.claim();
+        TEST_ASSERT_NOT_EQUAL(SmallPool::INVALID_INDEX, indices[i]);
+    }
+    TEST_ASSERT_EQUAL(0, pool.available());
+    TEST_ASSERT_EQUAL(SmallPool::INVALID_INDEX, pool.claim());
+    TEST_ASSERT_EQUAL_UINT32(1, pool.getExhaustedCount());
+
+    pool.release(indices[2]);
+    TEST_ASSERT_EQUAL(indices[2], pool.claim());
+    for (int i = 0; i < 4; i++) {
+        pool.release(indices[i]);
+    }
+    TEST_ASSERT_EQUAL(4, pool.available());
+}
+
+void test_wire_decodes_records_into_claimed_buffers(void) {
+    ESPNowWire::EncoderState encoder;
+    ESPNowWire::DecoderState decoder;
+    ESPNowWire::resetEncoder(encoder);
+    ESPNowWire::resetDecoder(decoder);
+
+    PoolSink sink;
+    uint8_t frame[ESPNowWire::MAX_FRAME_SIZE];
+    for (uint32_t i = 0; i < 100; i++) {
+        ESPNowWire::FrameWriter writer;
+        writer.begin(frame, sizeof(frame), ESPNowConfig::ROLE_HANDHELD);
+        for (uint32_t r = 0; r < 3; r++) {
+            ESPNowMessage msg;
+            msg.setButtonData(static_cast<uint8_t>(i + r));
+            msg.sequence = i * 3 + r + 1;
+            TEST_ASSERT_TRUE(writer.append(msg, encoder));
+        }
+        size_t length = writer.finish();
+        TEST_ASSERT_EQUAL(3, ESPNowWire::decodeFrameInto(frame, length, decoder,
+                                                         &PoolSink::claim, &PoolSink::commit, &sink));
+        TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(i + 2), sink.last_button);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(300, sink.commits);
+    TEST_ASSERT_EQUAL_UINT32(300, sink.claims);
+    TEST_ASSERT_EQUAL_UINT32(0, sink.copies);
+    TEST_ASSERT_EQUAL(8, sink.pool.available());
+}
+
+// A full pool stops decoding instead of overwriting a buffer in use
+void test_wire_stops_when_pool_is_exhausted(void) {
+    ESPNowWire::EncoderState encoder;
+    ESPNowWire::DecoderState decoder;
+    ESPNowWire::resetEncoder(encoder);
+    ESPNowWire::resetDecoder(decoder);
+
+    PoolSink sink;
+    MessagePool::Index held[8];
+    for (int i = 0; i < 8; i++) held[i] = sink.pool.claim();
+
+    ESPNowMessage msg;
+    msg.setButtonData(1);
+    msg.sequence = 1;
+    uint8_t frame[ESPNowWire::MAX_FRAME_SIZE];
+    size_t length = ESPNowWire::encode(msg, encoder, frame, sizeof(frame));
+    TEST_ASSERT_EQUAL(0, ESPNowWire::decodeFrameInto(frame, length, decoder,
+                                                     &PoolSink::claim, &PoolSink::commit, &sink));
+    TEST_ASSERT_EQUAL_UINT32(0, sink.commits);
+    TEST_ASSERT_EQUAL_UINT32(1, sink.pool.getExhaustedCount());
+    for (int i = 0; i < 8; i++) sink.pool.release(held[i]);
+}
+
+struct AddressRecorder {
+    const uint8_t* owner_begin = nullptr;
+    const uint8_t* owner_end = nullptr;
+    std::set<const ESPNowMessage*> buffers;
+    uint32_t received = 0;
+    uint32_t outside_owner = 0;  // Handler saw a copy instead of the pool buffer
+
+    void onButtons(const ESPNowMessage& msg, ESPNowManager::PeerId) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(&msg);
+        if (p < owner_begin || p + sizeof(msg) > owner_end) outside_owner++;
+        buffers.insert(&msg);
+        received++;
+    }
+};
+
+void test_handlers_read_messages_in_place(void) {
+    SimNetwork net(3);
+    ESPNowManager& base = net.addBaseStation();
+    ESPNowManager& handheld = net.addHandheld();
+    TEST_ASSERT_EQUAL(HAL_OK, net.initAll());
+
+    AddressRecorder recorder;
+    recorder.owner_begin = reinterpret_cast<const uint8_t*>(&base);
+    recorder.owner_end = recorder.owner_begin + sizeof(base);
+    base.getDispatchTable().on<AddressRecorder, &AddressRecorder::onButtons>(ESPNowConfig::MSG_BUTTON_DATA,
+                                                                             &recorder);
+
+    handheld.startConnection();
+    TEST_ASSERT_GREATER_OR_EQUAL(0, net.pair(base, handheld, 5000));
+
+    uint32_t sent = 0;
+    for (uint32_t ms = 0; ms < 2100; ms++) {
+        if (ms < 2000 && ms % 2 == 0) {
+            ESPNowMessage msg;
+            msg.setButtonData(ms & 0xFF);
+            if (handheld.sendMessage(msg) == HAL_OK) sent++;
+        }
+        net.tick();
+    }
+
+    TEST_ASSERT_GREATER_THAN(900, sent);
+    TEST_ASSERT_GREATER_OR_EQUAL(sent * 95 / 100, recorder.received);
+    TEST_ASSERT_EQUAL_UINT32(0, recorder.outside_owner);
+    TEST_ASSERT_LESS_OR_EQUAL(ESPNowGlobalConfig::RX_BUFFER_POOL_SIZE, recorder.buffers.size());
+    TEST_ASSERT_EQUAL_UINT32(0, base.getStats().rx_pool_exhausted);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_buffer_pool_exhausts_and_recovers);
+    RUN_TEST(test_wire_decodes_records_into_claimed_buffers);
+    RUN_TEST(test_wire_stops_when_pool_is_exhausted);
+    RUN_TEST(test_handlers_read_messages_in_place);
+    return UNITY_END();
+}
@@ -0,0 +1,151 @@
+// ESP-NOW link regression over SimRadioMedium: three nodes sharing one
+// lossy medium, pairing, delivery and reconnect after an outage.
+#include <unity.h>
+#include "../../lib/Core/Platform.h"
+#include "../../lib/Core/Logger.h"
+#include "../../lib/Communication/ESPNow/ESPNowManager.h"
+#include "../../lib/Communication/ESPNow/SimNetwork.h"
+
+struct Counters {
+    uint32_t buttons = 0;
+    uint32_t telemetry = 0;
+
+    void onButtons(const ESPNowPayload::ButtonData&, ESPNowManager::PeerId) { buttons++; }
+    void onTelemetry(const ESPNowMessage&, ESPNowManager::PeerId) { telemetry++; }
+};
+
+void setUp(void) {
+    Logger::init();
+    Logger::setLevel(LogLevel::LOG_LEVEL_ERROR);
+}
+
+void tearDown(void) {
+}
+
+void test_three_nodes_pair_and_deliver_over_lossy_medium(void) {
+    SimNetwork net(42);
+    ESPNowManager& base = net.addBaseStation();
+    ESPNowManager& handheld = net.addHandheld();
+    ESPNowManager& drone = net.addDrone();
+    SimRadioMedium::LinkConfig link = SimRadioMedium::idealLink();
+    link.loss_rate = 0.05f;
+    link.jitter_us = 300;
+    link.reorder_rate = 0.02f;
+    link.reorder_delay_us = 1500;
+    net.getMedium().setLinkConfig(link);
+
+    TEST_ASSERT_EQUAL(HAL_OK, base.init());
+    TEST_ASSERT_EQUAL(HAL_OK, handheld.init());
+    TEST_ASSERT_EQUAL(HAL_OK, drone.init());
+
+    Counters counters;
+    ESPNowManager::PeerId drone_peer = base.registerPeer(SimNetwork::DRONE_MAC, ESPNowConfig::ROLE_DRONE);
+    ESPNowManager::PeerId base_peer = drone.registerPeer(SimNetwork::BASE_MAC, ESPNowConfig::ROLE_BASE_STATION);
+    TEST_ASSERT_NOT_EQUAL(ESPNowManager::INVALID_PEER, drone_peer);
+    TEST_ASSERT_NOT_EQUAL(ESPNowManager::INVALID_PEER, base_peer);
+    base.getDispatchTable().on<ESPNowPayload::ButtonData, Counters, &Counters::onButtons>(&counters);
+    base.getDispatchTable().on<Counters, &Counters::onTelemetry>(ESPNowConfig::MSG_TELEMETRY, &counters);
+
+    TEST_ASSERT_EQUAL(HAL_OK, handheld.startConnection());
+    int32_t paired_ms = net.pair(base, handheld, 5000);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, paired_ms);
+    TEST_ASSERT_LESS_THAN(3000, paired_ms);
+
+    uint32_t buttons_sent = 0;
+    uint32_t telemetry_sent = 0;
+    for (uint32_t ms = 0; ms < 10000; ms++) {
+        if (ms % 10 == 0 && handheld.isPaired()) {
+            ESPNowMessage msg;
+            msg.setButtonData(ms & 0xFF);
+            if (handheld.sendMessage(msg) == HAL_OK) buttons_sent++;
+        }
+        if (ms % 20 == 0) {
+            ESPNowMessage msg;
+            msg.type = ESPNowConfig::MSG_TELEMETRY;
+            if (drone.sendMessageTo(base_peer, msg) == HAL_OK) telemetry_sent++;
+        }
+        net.tick(1);
+    }
+
+    // 5% loss; the unreliable lanes may lose that much, not much more
+    TEST_ASSERT_GREATER_THAN(900, buttons_sent);
+    TEST_ASSERT_GREATER_OR_EQUAL(buttons_sent * 90 / 100, counters.buttons);
+    TEST_ASSERT_LESS_OR_EQUAL(buttons_sent, counters.buttons);
+    TEST_ASSERT_GREATER_OR_EQUAL(telemetry_sent * 90 / 100, counters.telemetry);
+    TEST_ASSERT_LESS_OR_EQUAL(telemetry_sent, counters.telemetry);
+
+    // The drone's traffic doesn't disturb the pairing peer and is routed by MAC
+    TEST_ASSERT_TRUE(base.isPaired());
+    TEST_ASSERT_TRUE(drone.getPeer(base_peer) != nullptr);
+    TEST_ASSERT_EQUAL(ESPNowPeerState::ACTIVE, base.getPeer(drone_peer)->state);
+    TEST_ASSERT_EQUAL_UINT32(0, base.getStats().rx_unknown_peer);
+}
+
+void test_link_failsafe_and_recovery_after_short_outage(void) {
+    SimNetwork net(7);
+    ESPNowManager& base = net.addBaseStation();
+    ESPNowManager& handheld = net.addHandheld();
+    net.addDrone();
+    net.initAll();
+    handheld.startConnection();
+    TEST_ASSERT_GREATER_OR_EQUAL(0, net.pair(base, handheld, 5000));
+    net.tick(1000);
+    TEST_ASSERT_TRUE(base.isLinkAlive());
+
+    // Well inside CONNECTION_TIMEOUT_MS: the failsafe trips, pairing stays
+    net.getMedium().setNodeEnabled(SimNetwork::HANDHELD_MAC, false);
+    int32_t failsafe_ms = -1;
+    for (uint32_t ms = 0; ms < 1000 && failsafe_ms < 0; ms++) {
+        net.tick(1);
+        if (!base.isLinkAlive()) failsafe_ms = static_cast<int32_t>(ms);
+    }
+    TEST_ASSERT_GREATER_OR_EQUAL(0, failsafe_ms);
+    TEST_ASSERT_LESS_OR_EQUAL(250, failsafe_ms);
+    TEST_ASSERT_TRUE(base.isPaired());
+
+    net.getMedium().setNodeEnabled(SimNetwork::HANDHELD_MAC, true);
+    net.tick(300);
+    TEST_ASSERT_TRUE(base.isLinkAlive());
+    TEST_ASSERT_TRUE(handheld.isLinkAlive());
+}
+
+void test_reconnect_after_outage_longer_than_timeout(void) {
+    SimNetwork net(11);
+    ESPNowManager& base = net.addBaseStation();
+    ESPNowManager& handheld = net.addHandheld();
+    net.addDrone();
+    net.initAll();
+    handheld.startConnection();
+    TEST_ASSERT_GREATER_OR_EQUAL(0, net.pair(base, handheld, 5000));
+    net.tick(1000);
+
+    net.getMedium().setNodeEnabled(SimNetwork::HANDHELD_MAC, false);
+    net.tick(ESPNowConfig::CONNECTION_TIMEOUT_MS + 1000);
+    TEST_ASSERT_FALSE(base.isPaired());
+    TEST_ASSERT_FALSE(handheld.isPaired());
+
+    net.getMedium().setNodeEnabled(SimNetwork::HANDHELD_MAC, true);
+    int32_t repaired_ms = net.pair(base, handheld, 15000);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, repaired_ms);
+
+    // And traffic flows again
+    Counters counters;
+    base.getDispatchTable().on<ESPNowPayload::ButtonData, Counters, &Counters::onButtons>(&counters);
+    for (uint32_t i = 0; i < 20; i++) {
+        ESPNowMessage msg;
+        msg.setButtonData(i);
+        handheld.sendMessage(msg);
+        net.tick(10);
+    }
+    TEST_ASSERT_GREATER_OR_EQUAL(18, counters.buttons);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_three_nodes_pair_and_deliver_over_lossy_medium);
+    RUN_TEST(test_link_failsafe_and_recovery_after_short_outage);
+    RUN_TEST(test_reconnect_after_outage_longer_than_timeout);
+    return UNITY_END();
+}
@@ -0,0 +1,74 @@
+// ESPNowBenchmark sweep through SimLinkBenchmark: every step completes and
+// reports, delivery and goodput match the offered load on an ideal link,
+// and the measured loss tracks the medium's on a lossy one.
+#include <unity.h>
+#include "../../lib/Core/Platform.h"
+#include "../../lib/Core/Logger.h"
+#include "../../lib/Communication/ESPNow/SimLinkBenchmark.h"
+
+void setUp(void) {
+    Logger::init();
+    Logger::setLevel(LogLevel::LOG_LEVEL_ERROR);
+}
+
+void tearDown(void) {
+}
+
+void test_ideal_link_delivers_every_message(void) {
+    SimLinkBenchmark::Config config = SimLinkBenchmark::defaultConfig();
+    SimLinkBenchmark::Result result = SimLinkBenchmark::run(config);
+
+    TEST_ASSERT_TRUE(result.paired);
+    TEST_ASSERT_TRUE(result.completed);
+    TEST_ASSERT_EQUAL_UINT8(15, result.step_count);
+
+    for (uint8_t i = 0; i < result.step_count; i++) {
+        const ESPNowBenchmark::Result& step = result.steps[i];
+        TEST_ASSERT_TRUE(step.report_received);
+        TEST_ASSERT_GREATER_THAN(0, step.sent);
+        TEST_ASSERT_EQUAL_UINT32(0, step.send_failed);
+        TEST_ASSERT_EQUAL_UINT32(step.sent, step.received);
+        TEST_ASSERT_TRUE(step.loss_pct == 0.0f);
+
+        // Offered load in, offered load out
+        float offered_kbps = step.payload_size * 8.0f * step.rate_hz / 1000.0f;
+        TEST_ASSERT_FLOAT_WITHIN(offered_kbps * 0.02f, offered_kbps, step.goodput_kbps);
+
+        // Echoes every Nth message; a round trip is two link latencies plus
+        // up to a tick of update latency on each end
+        TEST_ASSERT_GREATER_THAN(0, step.rtt.count);
+        TEST_ASSERT_LESS_OR_EQUAL(5000, step.rtt.p99_us);
+    }
+}
+
+void test_lossy_link_reports_the_medium_loss(void) {
+    SimLinkBenchmark::Config config = SimLinkBenchmark::defaultConfig();
+    config.link.loss_rate = 0.1f;
+    SimLinkBenchmark::Result result = SimLinkBenchmark::run(config);
+
+    TEST_ASSERT_TRUE(result.paired);
+    TEST_ASSERT_TRUE(result.completed);
+
+    uint32_t sent = 0;
+    uint32_t received = 0;
+    for (uint8_t i = 0; i < result.step_count; i++) {
+        const ESPNowBenchmark::Result& step = result.steps[i];
+        TEST_ASSERT_TRUE(step.report_received);
+        TEST_ASSERT_LESS_OR_EQUAL(step.sent, step.received);
+        // Binomial spread for 100-2000 messages per step
+        TEST_ASSERT_FLOAT_WITHIN(8.0f, 10.0f, step.loss_pct);
+        sent += step.sent;
+        received += step.received;
+    }
+    float loss_pct = 100.0f * (sent - received) / sent;
+    TEST_ASSERT_FLOAT_WITHIN(1.5f, 10.0f, loss_pct);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_ideal_link_delivers_every_message);
+    RUN_TEST(test_lossy_link_reports_the_medium_loss);
+    return UNITY_END();
+}
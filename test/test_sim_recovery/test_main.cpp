@@ -0,0 +1,90 @@
+// Fast reconnect after an RF dropout, through SimRecoveryBenchmark: both
+// ends resume the cached session with MSG_RESUME once the radio is back,
+// without pilot action, until FAST_RECONNECT_WINDOW_MS runs out.
+#include <unity.h>
+#include "../../lib/Core/Platform.h"
+#include "../../lib/Core/Logger.h"
+#include "../../lib/Config/espnow_config.h"
+#include "../../lib/Communication/ESPNow/SimRecoveryBenchmark.h"
+
+// Radio back to both ends PAIRED; resume retries are at most
+// FAST_RECONNECT_STEP_MS apart
+static const uint32_t RESUME_LIMIT_MS = 300;
+
+void setUp(void) {
+    Logger::init();
+    Logger::setLevel(LogLevel::LOG_LEVEL_ERROR);
+}
+
+void tearDown(void) {
+}
+
+void test_outage_below_timeout_keeps_the_link(void) {
+    SimRecoveryBenchmark::Result result = SimRecoveryBenchmark::run(SimRecoveryBenchmark::defaultConfig(1000));
+    TEST_ASSERT_TRUE(result.paired);
+    TEST_ASSERT_TRUE(result.recovered);
+    TEST_ASSERT_EQUAL_UINT32(0, result.recover_ms);
+    TEST_ASSERT_EQUAL_UINT32(0, result.link_down_ms);
+    TEST_ASSERT_FALSE(result.resumed);
+}
+
+void test_timeouts_resume_without_pilot_action(void) {
+    const uint32_t outages[] = {5300, 6300, 7700, 9100, 12900};
+    for (uint32_t outage_ms : outages) {
+        SimRecoveryBenchmark::Config config = SimRecoveryBenchmark::defaultConfig(outage_ms);
+        config.restart_handheld = false;
+        SimRecoveryBenchmark::Result result = SimRecoveryBenchmark::run(config);
+
+        TEST_ASSERT_TRUE(result.paired);
+        TEST_ASSERT_TRUE_MESSAGE(result.recovered, "no recovery");
+        TEST_ASSERT_TRUE_MESSAGE(result.resumed, "recovered without MSG_RESUME");
+        TEST_ASSERT_FALSE(result.handheld_restarted);
+        TEST_ASSERT_LESS_OR_EQUAL(RESUME_LIMIT_MS, result.recover_ms);
+        // The base saw the whole outage, not a fresh pairing
+        TEST_ASSERT_GREATER_OR_EQUAL(outage_ms, result.link_down_ms);
+        TEST_ASSERT_LESS_OR_EQUAL(outage_ms + RESUME_LIMIT_MS, result.link_down_ms);
+    }
+}
+
+void test_resume_over_a_lossy_link(void) {
+    for (uint32_t seed = 1; seed <= 4; seed++) {
+        SimRecoveryBenchmark::Config config = SimRecoveryBenchmark::defaultConfig(7700);
+        config.restart_handheld = false;
+        config.seed = seed;
+        config.link.loss_rate = 0.1f;
+        SimRecoveryBenchmark::Result result = SimRecoveryBenchmark::run(config);
+
+        TEST_ASSERT_TRUE(result.recovered);
+        TEST_ASSERT_TRUE(result.resumed);
+        TEST_ASSERT_LESS_OR_EQUAL(2 * RESUME_LIMIT_MS, result.recover_ms);
+    }
+}
+
+void test_outage_past_the_resume_window_falls_back_to_pairing(void) {
+    uint32_t outage_ms = ESPNowConfig::CONNECTION_TIMEOUT_MS + ESPNowGlobalConfig::FAST_RECONNECT_WINDOW_MS + 5000;
+
+    // A manual-mode handheld stops once the window is over...
+    SimRecoveryBenchmark::Config config = SimRecoveryBenchmark::defaultConfig(outage_ms);
+    config.restart_handheld = false;
+    SimRecoveryBenchmark::Result result = SimRecoveryBenchmark::run(config);
+    TEST_ASSERT_TRUE(result.paired);
+    TEST_ASSERT_FALSE(result.recovered);
+
+    // ...and pairs again when the pilot presses connect
+    config.restart_handheld = true;
+    result = SimRecoveryBenchmark::run(config);
+    TEST_ASSERT_TRUE(result.recovered);
+    TEST_ASSERT_TRUE(result.handheld_restarted);
+    TEST_ASSERT_FALSE(result.resumed);
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_outage_below_timeout_keeps_the_link);
+    RUN_TEST(test_timeouts_resume_without_pilot_action);
+    RUN_TEST(test_resume_over_a_lossy_link);
+    RUN_TEST(test_outage_past_the_resume_window_falls_back_to_pairing);
+    return UNITY_END();
+}
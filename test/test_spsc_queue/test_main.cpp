@@ -0,0 +1,174 @@
+// SPSCQueue and BufferPool, single-threaded and with a producer and a
+// consumer std::thread as the Wi-Fi callback and the main loop would use them.
+#include <unity.h>
+#include <thread>
+#include "../../lib/Core/SPSCQueue.h"
+#include "../../lib/Core/BufferPool.h"
+
+static const uint32_t STRESS_ITEMS = 1000000;
+
+// Large enough that a torn copy would show up in the check word
+struct Item {
+    uint32_t sequence;
+    uint32_t payload[6];
+    uint32_t check;
+
+    void fill(uint32_t seq) {
+        sequence = seq;
+        check = seq;
+        for (uint32_t i = 0; i < 6; i++) {
+            payload[i] = seq * 2654435761u + i;
+            check ^= payload[i];
+        }
+    }
+    bool intact() const {
+        uint32_t c = sequence;
+        for (uint32_t i = 0; i < 6; i++) c ^= payload[i];
+        return c == check;
+    }
+};
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_queue_fills_drops_and_drains_in_order(void) {
+    SPSCQueue<uint32_t, 8> queue;
+    TEST_ASSERT_TRUE(queue.empty());
+    for (uint32_t i = 0; i < 8; i++) {
+        TEST_ASSERT_TRUE(queue.push(i));
+    }
+    TEST_ASSERT_FALSE(queue.push(99));
+    TEST_ASSERT_EQUAL_UINT32(1, queue.getDropCount());
+    TEST_ASSERT_EQUAL_UINT32(8, queue.getHighWatermark());
+    TEST_ASSERT_EQUAL(8, queue.size());
+
+    uint32_t value;
+    for (uint32_t i = 0; i < 8; i++) {
+        TEST_ASSERT_TRUE(queue.pop(value));
+        TEST_ASSERT_EQUAL_UINT32(i, value);
+    }
+    TEST_ASSERT_FALSE(queue.pop(value));
+
+    // Indices keep counting past the capacity
+    for (uint32_t i = 0; i < 100; i++) {
+        TEST_ASSERT_TRUE(queue.push(i));
+        TEST_ASSERT_TRUE(queue.pop(value));
+        TEST_ASSERT_EQUAL_UINT32(i, value);
+    }
+    TEST_ASSERT_EQUAL_UINT32(8, queue.getHighWatermark());
+}
+
+void test_two_threads_keep_order_without_loss(void) {
+    static SPSCQueue<Item, 64> queue;
+    uint32_t full = 0;
+
+    std::thread producer([&full]() {
+        Item item;
+        for (uint32_t seq = 0; seq < STRESS_ITEMS; seq++) {
+            item.fill(seq);
+            while (!queue.push(item)) {
+                full++;
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    uint32_t out_of_order = 0;
+    uint32_t torn = 0;
+    Item item;
+    while (expected < STRESS_ITEMS) {
+        if (!queue.pop(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (!item.intact()) torn++;
+        if (item.sequence != expected) out_of_order++;
+        expected = item.sequence + 1;
+    }
+    producer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, out_of_order);
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+    TEST_ASSERT_EQUAL_UINT32(STRESS_ITEMS, expected);
+    TEST_ASSERT_TRUE(queue.empty());
+    // Every refused push was retried, and counted as a drop
+    TEST_ASSERT_EQUAL_UINT32(full, queue.getDropCount());
+    TEST_ASSERT_LESS_OR_EQUAL(64, queue.getHighWatermark());
+}
+
+void test_pool_exhausts_and_releases(void) {
+    typedef BufferPool<Item, 4> Pool;
+    Pool pool;
+    Pool::Index claimed[4];
+    for (uint32_t i = 0; i < 4; i++) {
+        claimed[i] = pool.claim();
+        TEST_ASSERT_TRUE(claimed[i] < Pool::capacity());
+    }
+    TEST_ASSERT_EQUAL(Pool::INVALID_INDEX, pool.claim());
+    TEST_ASSERT_EQUAL(Pool::INVALID_INDEX, pool.claim());
+    TEST_ASSERT_EQUAL_UINT32(2, pool.getExhaustedCount());
+    TEST_ASSERT_EQUAL(0, pool.available());
+
+    pool.release(claimed[1]);
+    TEST_ASSERT_EQUAL(1, pool.available());
+    TEST_ASSERT_EQUAL(claimed[1], pool.claim());
+    for (uint32_t i = 0; i < 4; i++) {
+        pool.release(claimed[i]);
+    }
+    TEST_ASSERT_EQUAL(4, pool.available());
+}
+
+// Claim on one thread, hand the index over, read and release on the other
+void test_pool_buffers_cross_threads_intact(void) {
+    typedef BufferPool<Item, 16> Pool;
+    static Pool pool;
+    static SPSCQueue<Pool::Index, 16> handoff;
+    uint32_t exhausted_waits = 0;
+
+    std::thread producer([&exhausted_waits]() {
+        for (uint32_t seq = 0; seq < STRESS_ITEMS; seq++) {
+            Pool::Index index;
+            while ((index = pool.claim()) == Pool::INVALID_INDEX) {
+                exhausted_waits++;
+                std::this_thread::yield();
+            }
+            pool[index].fill(seq);
+            // The pool and the hand-off have the same size, so this can't fail
+            handoff.push(index);
+        }
+    });
+
+    uint32_t expected = 0;
+    uint32_t bad = 0;
+    while (expected < STRESS_ITEMS) {
+        Pool::Index index;
+        if (!handoff.pop(index)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (!pool[index].intact() || pool[index].sequence != expected) bad++;
+        expected++;
+        pool.release(index);
+    }
+    producer.join();
+
+    TEST_ASSERT_EQUAL_UINT32(0, bad);
+    TEST_ASSERT_EQUAL_UINT32(0, handoff.getDropCount());
+    TEST_ASSERT_EQUAL_UINT32(exhausted_waits, pool.getExhaustedCount());
+    TEST_ASSERT_EQUAL(16, pool.available());
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_queue_fills_drops_and_drains_in_order);
+    RUN_TEST(test_two_threads_keep_order_without_loss);
+    RUN_TEST(test_pool_exhausts_and_releases);
+    RUN_TEST(test_pool_buffers_cross_threads_intact);
+    return UNITY_END();
+}
@@ -0,0 +1,141 @@
+// FixedStateMachine behaviour, and the StateMachineBenchmark claim that it
+// beats the map-based StateMachine on every operation.
+#include <unity.h>
+#include <string.h>
+#include "../../lib/Core/Platform.h"
+#include "../../lib/Core/Logger.h"
+#include "../../lib/Core/FixedStateMachine.h"
+#include "../../lib/Core/StateMachineBenchmark.h"
+
+enum class Light : uint8_t { OFF = 0, RED, GREEN, COUNT };
+
+struct Controller {
+    FixedStateMachine<Controller, Light, static_cast<uint16_t>(Light::COUNT)> machine;
+    char trace[64];
+    uint32_t updated_ms;
+    uint32_t transitions;
+    Light last_from;
+    Light last_to;
+    bool fail_enter_green;
+
+    Controller()
+        : machine("Light", this)
+        , trace()
+        , updated_ms(0)
+        , transitions(0)
+        , last_from(Light::OFF)
+        , last_to(Light::OFF)
+        , fail_enter_green(false) {
+        machine.registerState(Light::OFF, {"OFF", nullptr, nullptr, nullptr});
+        machine.registerState(Light::RED, {"RED", &Controller::enterRed, &Controller::updateRed,
+                                           &Controller::exitRed});
+        machine.registerState(Light::GREEN, {"GREEN", &Controller::enterGreen, nullptr, nullptr});
+        machine.setTransitionHandler(&Controller::onTransition);
+    }
+
+    void mark(const char* step) { strncat(trace, step, sizeof(trace) - strlen(trace) - 1); }
+
+    hal_status_t enterRed(uint32_t) {
+        mark("r+");
+        return HAL_OK;
+    }
+    hal_status_t updateRed(uint32_t delta_ms) {
+        updated_ms += delta_ms;
+        if (updated_ms >= 30) {
+            machine.transitionTo(Light::GREEN);
+        }
+        return HAL_OK;
+    }
+    hal_status_t exitRed(uint32_t) {
+        mark("r-");
+        return HAL_OK;
+    }
+    hal_status_t enterGreen(uint32_t) {
+        mark("g+");
+        if (fail_enter_green) {
+            return HAL_ERROR;
+        }
+        // Asked for during a transition, so it runs after this one
+        machine.transitionTo(Light::OFF);
+        return HAL_OK;
+    }
+    void onTransition(Light from, Light to) {
+        transitions++;
+        last_from = from;
+        last_to = to;
+    }
+};
+
+void setUp(void) {
+    Logger::init();
+    Logger::setLevel(LogLevel::LOG_LEVEL_ERROR);
+}
+
+void tearDown(void) {
+}
+
+void test_update_before_first_transition_is_rejected(void) {
+    Controller c;
+    TEST_ASSERT_EQUAL(HAL_NOT_INITIALIZED, c.machine.update(10));
+    TEST_ASSERT_EQUAL_STRING("INVALID", c.machine.getCurrentStateName());
+}
+
+void test_enter_update_exit_and_deferred_transition(void) {
+    Controller c;
+    TEST_ASSERT_EQUAL(HAL_OK, c.machine.transitionTo(Light::RED));
+    TEST_ASSERT_EQUAL_STRING("RED", c.machine.getCurrentStateName());
+    TEST_ASSERT_EQUAL_UINT32(1, c.transitions);
+
+    c.machine.update(10);
+    c.machine.update(10);
+    TEST_ASSERT_EQUAL_UINT32(20, c.machine.getStateTime());
+    c.machine.update(10);
+
+    // RED -> GREEN from update, then OFF deferred from GREEN's enter handler
+    TEST_ASSERT_EQUAL_STRING("r+r-g+", c.trace);
+    TEST_ASSERT_TRUE(c.machine.isInState(Light::OFF));
+    TEST_ASSERT_TRUE(c.machine.getPreviousState() == Light::GREEN);
+    TEST_ASSERT_TRUE(c.last_from == Light::GREEN);
+    TEST_ASSERT_TRUE(c.last_to == Light::OFF);
+    TEST_ASSERT_EQUAL_UINT32(3, c.transitions);
+    TEST_ASSERT_EQUAL_UINT32(0, c.machine.getStateTime());
+}
+
+void test_failed_enter_keeps_previous_state(void) {
+    Controller c;
+    c.fail_enter_green = true;
+    c.machine.transitionTo(Light::OFF);
+    TEST_ASSERT_EQUAL(HAL_ERROR, c.machine.transitionTo(Light::GREEN));
+    TEST_ASSERT_TRUE(c.machine.isInState(Light::OFF));
+    TEST_ASSERT_EQUAL_UINT32(1, c.transitions);
+}
+
+void test_unregistered_and_duplicate_states_are_rejected(void) {
+    Controller c;
+    TEST_ASSERT_EQUAL(HAL_INVALID_PARAM, c.machine.transitionTo(Light::COUNT));
+    TEST_ASSERT_EQUAL(HAL_ERROR, c.machine.registerState(Light::RED, "AGAIN", nullptr));
+    TEST_ASSERT_FALSE(c.machine.hasState(Light::COUNT));
+}
+
+void test_benchmark_fixed_beats_map_based(void) {
+    StateMachineBenchmark::Result result = StateMachineBenchmark::run(200000);
+    StateMachineBenchmark::print(result);
+
+    TEST_ASSERT_EQUAL_UINT32(200000, result.iterations);
+    TEST_ASSERT_TRUE(result.fixed.update_ns > 0.0f);
+    TEST_ASSERT_TRUE_MESSAGE(result.fixed.update_ns < result.map_based.update_ns, "update");
+    TEST_ASSERT_TRUE_MESSAGE(result.fixed.name_ns < result.map_based.name_ns, "getCurrentStateName");
+    TEST_ASSERT_TRUE_MESSAGE(result.fixed.transition_ns < result.map_based.transition_ns, "transitionTo");
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_update_before_first_transition_is_rejected);
+    RUN_TEST(test_enter_update_exit_and_deferred_transition);
+    RUN_TEST(test_failed_enter_keeps_previous_state);
+    RUN_TEST(test_unregistered_and_duplicate_states_are_rejected);
+    RUN_TEST(test_benchmark_fixed_beats_map_based);
+    return UNITY_END();
+}
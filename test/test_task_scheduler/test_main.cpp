@@ -0,0 +1,207 @@
+// TaskScheduler on a fake clock: tasks advance it by their run time, so
+// release order, overruns and dropped releases are exact. The default
+// blocking sleep runs on the simulated clock.
+#include <unity.h>
+#include <string.h>
+#include "../../lib/Core/Platform.h"
+#include "../../lib/Core/Logger.h"
+#include "../../lib/Core/TaskScheduler.h"
+
+static uint64_t fake_now_us = 0;
+static uint64_t fakeClock() { return fake_now_us; }
+static void fakeSleep(uint32_t us) { fake_now_us += us; }
+
+static char order[32];
+static void mark(char task) {
+    size_t length = strlen(order);
+    if (length + 1 < sizeof(order)) {
+        order[length] = task;
+        order[length + 1] = '\0';
+    }
+}
+
+void setUp(void) {
+    Logger::init();
+    Logger::setLevel(LogLevel::LOG_LEVEL_ERROR);
+    fake_now_us = 1000000;
+    order[0] = '\0';
+}
+
+void tearDown(void) {
+}
+
+void test_due_tasks_run_highest_priority_first(void) {
+    TaskScheduler scheduler(fakeClock, fakeSleep);
+    scheduler.addTask({"low", 1000, 0, 1, 0, [](uint32_t) { mark('L'); return HAL_OK; }});
+    scheduler.addTask({"high", 1000, 0, 5, 0, [](uint32_t) { mark('H'); return HAL_OK; }});
+    scheduler.addTask({"mid", 1000, 0, 3, 0, [](uint32_t) { mark('M'); return HAL_OK; }});
+    scheduler.start();
+
+    TEST_ASSERT_EQUAL(HAL_OK, scheduler.runDue());
+    TEST_ASSERT_EQUAL_STRING("HML", order);
+
+    // Nothing is due until the next period, and each task runs once per call
+    TEST_ASSERT_EQUAL_UINT32(1000, scheduler.timeUntilNextUs());
+    scheduler.runDue();
+    TEST_ASSERT_EQUAL_STRING("HML", order);
+    scheduler.sleepUntilNext();
+    scheduler.runDue();
+    TEST_ASSERT_EQUAL_STRING("HMLHML", order);
+}
+
+void test_equal_priority_runs_earlier_release_first(void) {
+    TaskScheduler scheduler(fakeClock, fakeSleep);
+    scheduler.addTask({"late", 1000, 300, 2, 0, [](uint32_t) { mark('B'); return HAL_OK; }});
+    scheduler.addTask({"early", 1000, 100, 2, 0, [](uint32_t) { mark('A'); return HAL_OK; }});
+    scheduler.start();
+
+    fake_now_us += 500;
+    scheduler.runDue();
+    TEST_ASSERT_EQUAL_STRING("AB", order);
+}
+
+void test_overrun_is_counted_against_the_deadline(void) {
+    static uint32_t run_us;
+    run_us = 100;
+    TaskScheduler scheduler(fakeClock, fakeSleep);
+    TaskScheduler::TaskId id = scheduler.addTask(
+        {"work", 1000, 0, 1, 500, [](uint32_t) { fake_now_us += run_us; return HAL_OK; }});
+    scheduler.start();
+
+    for (int i = 0; i < 5; i++) {
+        scheduler.runDue();
+        scheduler.sleepUntilNext();
+    }
+    TEST_ASSERT_EQUAL_UINT32(5, scheduler.getStats(id).runs);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.getStats(id).overruns);
+
+    run_us = 700;
+    scheduler.runDue();
+    TaskScheduler::TaskStats stats = scheduler.getStats(id);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.overruns);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.skipped);
+    TEST_ASSERT_EQUAL_UINT32(700, stats.max_run_us);
+}
+
+void test_releases_a_whole_period_behind_are_dropped(void) {
+    static uint32_t run_us;
+    run_us = 200;
+    TaskScheduler scheduler(fakeClock, fakeSleep);
+    TaskScheduler::TaskId id = scheduler.addTask(
+        {"slow", 1000, 0, 1, 0, [](uint32_t) { fake_now_us += run_us; return HAL_OK; }});
+    scheduler.start();
+    uint64_t start_us = fake_now_us;
+
+    // 3.5 periods in one run: releases 1 and 2 are a whole period behind
+    run_us = 3500;
+    scheduler.runDue();
+    TaskScheduler::TaskStats stats = scheduler.getStats(id);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.runs);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.overruns);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.skipped);
+
+    // Release 3 is late but still runs once, then the task is back in phase
+    run_us = 200;
+    scheduler.runDue();
+    TEST_ASSERT_EQUAL_UINT32(2, scheduler.getStats(id).runs);
+    TEST_ASSERT_EQUAL_UINT32(2, scheduler.getStats(id).skipped);
+    scheduler.sleepUntilNext();
+    TEST_ASSERT_EQUAL_UINT32(4000, static_cast<uint32_t>(fake_now_us - start_us));
+}
+
+void test_failing_task_stops_the_pass(void) {
+    TaskScheduler scheduler(fakeClock, fakeSleep);
+    scheduler.addTask({"bad", 1000, 0, 5, 0, [](uint32_t) { mark('X'); return HAL_ERROR; }});
+    scheduler.addTask({"next", 1000, 0, 1, 0, [](uint32_t) { mark('N'); return HAL_OK; }});
+    scheduler.start();
+
+    TEST_ASSERT_EQUAL(HAL_ERROR, scheduler.runDue());
+    TEST_ASSERT_EQUAL_STRING("X", order);
+}
+
+void test_handler_gets_ms_since_its_last_run(void) {
+    static uint32_t last_delta;
+    TaskScheduler scheduler(fakeClock, fakeSleep);
+    TaskScheduler::TaskId id = scheduler.addTask(
+        {"ui", 20000, 0, 1, 0, [](uint32_t delta_ms) { last_delta = delta_ms; return HAL_OK; }});
+    scheduler.start();
+    scheduler.runDue();
+    scheduler.sleepUntilNext();
+    scheduler.runDue();
+    TEST_ASSERT_EQUAL_UINT32(20, last_delta);
+
+    // Re-enabling releases it right away
+    scheduler.setEnabled(id, false);
+    fake_now_us += 5000;
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, scheduler.timeUntilNextUs());
+    scheduler.setEnabled(id, true);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.timeUntilNextUs());
+}
+
+void test_invalid_tasks_are_rejected(void) {
+    TaskScheduler scheduler(fakeClock, fakeSleep);
+    TEST_ASSERT_EQUAL(TaskScheduler::INVALID_TASK,
+                      scheduler.addTask({"zero", 0, 0, 1, 0, [](uint32_t) { return HAL_OK; }}));
+    TEST_ASSERT_EQUAL(TaskScheduler::INVALID_TASK, scheduler.addTask({"none", 1000, 0, 1, 0, nullptr}));
+    for (uint8_t i = 0; i < TaskScheduler::MAX_TASKS; i++) {
+        scheduler.addTask({"t", 1000, 0, 1, 0, [](uint32_t) { return HAL_OK; }});
+    }
+    TEST_ASSERT_EQUAL(TaskScheduler::INVALID_TASK,
+                      scheduler.addTask({"full", 1000, 0, 1, 0, [](uint32_t) { return HAL_OK; }}));
+    TEST_ASSERT_EQUAL(TaskScheduler::MAX_TASKS, scheduler.getTaskCount());
+}
+
+// The default sleep, on the simulated clock and esp_timer: the task blocks
+// until a one-shot timer at the release wakes it, so no part of a wait is
+// spun, and waits under a tick are neither rounded up nor cut short
+void test_default_sleep_blocks_until_the_release(void) {
+    TaskScheduler scheduler;
+    TaskScheduler::TaskId input = scheduler.addTask({"input", 400, 0, 2, 0, [](uint32_t) { return HAL_OK; }});
+    TaskScheduler::TaskId link = scheduler.addTask({"link", 2500, 100, 1, 0, [](uint32_t) { return HAL_OK; }});
+    scheduler.start();
+    uint64_t start_us = Platform::nowUs();
+    uint64_t blocked_start_us = Platform::blockedUs();
+
+    uint32_t sleeps = 0;
+    while (Platform::nowUs() - start_us < 10000) {
+        scheduler.runDue();
+        uint32_t wait_us = scheduler.timeUntilNextUs();
+        TEST_ASSERT_LESS_THAN_UINT32(1000, wait_us);
+        uint64_t before_us = Platform::nowUs();
+        uint64_t blocked_before_us = Platform::blockedUs();
+        scheduler.sleepUntilNext();
+        TEST_ASSERT_EQUAL_UINT32(wait_us, static_cast<uint32_t>(Platform::nowUs() - before_us));
+        TEST_ASSERT_EQUAL_UINT32(wait_us, static_cast<uint32_t>(Platform::blockedUs() - blocked_before_us));
+        sleeps++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(10000, static_cast<uint32_t>(Platform::blockedUs() - blocked_start_us));
+    TEST_ASSERT_GREATER_THAN_UINT32(25, sleeps);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.getStats(input).max_latency_us);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.getStats(link).max_latency_us);
+    TEST_ASSERT_EQUAL_UINT32(25, scheduler.getStats(input).runs);
+    TEST_ASSERT_EQUAL_UINT32(4, scheduler.getStats(link).runs);
+
+    // Longer than a tick but not a whole number of them: not truncated to 2 ms
+    TaskScheduler slow;
+    slow.addTask({"link", 2500, 0, 1, 0, [](uint32_t) { return HAL_OK; }});
+    slow.start();
+    slow.runDue();
+    uint64_t before_us = Platform::nowUs();
+    slow.sleepUntilNext();
+    TEST_ASSERT_EQUAL_UINT32(2500, static_cast<uint32_t>(Platform::nowUs() - before_us));
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_due_tasks_run_highest_priority_first);
+    RUN_TEST(test_equal_priority_runs_earlier_release_first);
+    RUN_TEST(test_overrun_is_counted_against_the_deadline);
+    RUN_TEST(test_releases_a_whole_period_behind_are_dropped);
+    RUN_TEST(test_failing_task_stops_the_pass);
+    RUN_TEST(test_handler_gets_ms_since_its_last_run);
+    RUN_TEST(test_invalid_tasks_are_rejected);
+    RUN_TEST(test_default_sleep_blocks_until_the_release);
+    return UNITY_END();
+}